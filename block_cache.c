@@ -38,6 +38,7 @@
 #include "block_cache.h"
 #include "dcache.h"
 #include "hash.h"
+#include "pool.h"
 #include "util.h"
 
 /*
@@ -61,6 +62,13 @@
  * The linked list for CLEAN/CLEAN2 blocks is actually two lists, hi_cleans and lo_cleans.
  * This allows us to evict "low priority" blocks before "high priority" blocks.
  *
+ * If config->scan_resistant is set, each of those lists is further split in two (segmented LRU):
+ * blocks start out in lo_cleans/hi_cleans, and are promoted to lo_hots/hi_hots ("hot" blocks) when
+ * they are read again by the upper layer while cached, except when that read is part of a sequential
+ * stream. At most HOT_PERCENT of the cache may be hot; beyond that the least recently used hot blocks
+ * are demoted back to the tail of lo_cleans/hi_cleans. We evict from the non-hot list first, so a
+ * large sequential scan (backup, fsck, dd) only churns the non-hot blocks and leaves the working set.
+ *
  * Blocks in the DIRTY state are linked in a list in the order they should be written.
  * A pool of worker threads picks them off and writes them through to the underlying
  * s3backer_store; while being written they are in state WRITING, or WRITING2 if another
@@ -75,10 +83,17 @@
  * its write attempt, the worker thread then checks for this condition and, if indeed
  * the block has changed to WRITING2, it knows to free the original buffer.
  *
- * Blocks in the READING/READING2 and WRITING/WRITING2 states are not in either list.
+ * Blocks in the READING/READING2 and WRITING/WRITING2 states are not in any list.
  *
  * Only CLEAN and CLEAN2 blocks are eligible to be evicted from the cache. We evict entries
  * either when they timeout or the cache is full and we need to add a new entry to it.
+ *
+ * The cache is divided into config->num_shards shards by block number. Each shard has its own mutex,
+ * hash table, lists, and share of the total cache size, so operations on blocks in different shards
+ * don't contend with each other. Everything described above happens independently within each shard.
+ * The worker threads, read-ahead state, and prefetch queue are shared by all shards and protected by
+ * the global mutex, and the total number of dirty blocks is maintained atomically. Lock ordering is:
+ * shard mutex, then global mutex, then dcache mutex; no thread ever holds two shard mutexes at once.
  */
 
 // Cache entry states
@@ -105,17 +120,20 @@
  *  State       ENTRY_IN_LIST()?    dirty?   timeout == -1  verify  dcache
  *  -----       ----------------    ------   -------------  ------  ------
  *
- *  CLEAN       YES: priv->cleans   NO       ?                0     recorded
- *  CLEAN2      YES: priv->cleans   NO       ?                1     recorded
+ *  CLEAN       YES: shard->cleans  NO       ?                0     recorded
+ *  CLEAN2      YES: shard->cleans  NO       ?                1     recorded
  *  READING     NO                  NO       YES              0     allocated
  *  READING2    NO                  NO       YES              1     allocated
- *  DIRTY       YES: priv->dirties  YES      ?                ?     allocated
+ *  DIRTY       YES: shard->dirties YES      ?                ?     allocated
  *  WRITING     NO                  NO       NO               ?     allocated
  *  WRITING2    NO                  YES      NO               ?     allocated
  *
  * Timeouts: we track time in units of TIME_UNIT_MILLIS milliseconds from when we start.
- * This is so we can jam them into 30 bits instead of 64. It's possible for the time value
- * to wrap after about two years; the effect would be mis-timed writes and evictions.
+ * This is so we can jam them into 32 bits instead of 64. It's possible for the time value
+ * to wrap after about eight years; the effect would be mis-timed writes and evictions.
+ *
+ * The flush flag is only set in states DIRTY, WRITING, and WRITING2, when some thread is waiting
+ * in block_cache_flush_blocks() for the block to be written; such blocks are written before any others.
  *
  * In state CLEAN2 only, the ETag to verify immediately follows the structure.
  */
@@ -123,7 +141,9 @@ struct cache_entry {
     s3b_block_t                     block_num;      // block number - MUST BE FIRST
     u_int                           dirty:1;        // indicates state DIRTY or WRITING2
     u_int                           verify:1;       // data should be verified first
-    uint32_t                        timeout:30;     // when to evict (CLEAN[2]) or write (DIRTY)
+    u_int                           hot:1;          // block has been re-referenced (scan_resistant only)
+    u_int                           flush:1;        // a flush is waiting for this block to be written
+    uint32_t                        timeout;        // when to evict (CLEAN[2]) or write (DIRTY)
     TAILQ_ENTRY(cache_entry)        link;           // next in list (cleans or dirties)
     union {
         void                        *data;          // data buffer in memory
@@ -147,42 +167,110 @@ struct cache_entry {
 #define DIRTY_RATIO_WRITE_ASAP      0.90            // 90%
 
 // Special timeout value for entries in state READING and READING2
-#define READING_TIMEOUT             ((uint32_t)0x3fffffff)
+#define READING_TIMEOUT             ((uint32_t)0xffffffff)
+
+// Maximum percentage of the cache that may be occupied by hot blocks (scan_resistant only)
+#define HOT_PERCENT                 75
+
+// Read-ahead parameters
+#define MAX_READ_STREAMS            8               // max # of concurrent sequential read streams we track
+#define EWMA_SHIFT                  3               // weight of new samples in moving averages is 1/8
 
 // Declare the list "head" struct
 TAILQ_HEAD(list_head, cache_entry);
 
-// Private data
-struct block_cache_private {
-    struct block_cache_conf         *config;        // configuration
-    struct s3backer_store           *inner;         // underlying s3backer store
+/*
+ * One sequential read stream detected by block_cache_track_sequential().
+ *
+ * Each stream has its own read-ahead window, which starts at config->read_ahead blocks. The window
+ * doubles whenever the upper layer catches up with the read-ahead for that stream (i.e., has to wait
+ * for a block), and shrinks by one block at a time while it is larger than needed to cover the average
+ * latency of the underlying store at the rate the stream is being consumed.
+ */
+struct read_stream {
+    s3b_block_t                     last;           // last block read in sequence by upper layer
+    u_int                           count;          // # of blocks read in sequence by upper layer (zero = unused)
+    u_int                           ra_count;       // # of blocks of read-ahead initiated
+    u_int                           window;         // current read-ahead window size in blocks
+    uint64_t                        last_micros;    // time of the most recent read in this stream
+    uint64_t                        interval;       // moving average of microseconds between sequential reads
+};
+
+/*
+ * A DIRTY, WRITING, or WRITING2 entry whose data is only partially valid (partial_writes only).
+ *
+ * Only the bytes in the range [off, end) have been written; the rest of the entry's data buffer is garbage until
+ * the worker thread reads the original block from the underlying store and merges it in, just prior to writing
+ * the block back. Entries having a record in shard->partials are always in memory (there is no disk cache).
+ */
+struct partial_block {
+    s3b_block_t                     block_num;      // block number - MUST BE FIRST
+    u_int                           off;            // offset of the first valid byte
+    u_int                           end;            // offset of the byte after the last valid byte
+};
+
+/*
+ * One shard of the cache. Each block belongs to exactly one shard, determined by block_cache_shard().
+ */
+struct block_cache_shard {
     struct block_cache_stats        stats;          // statistics
     struct list_head                lo_cleans;      // list of low priority clean blocks (LRU order)
     struct list_head                hi_cleans;      // list of high priority clean blocks (LRU order)
+    struct list_head                lo_hots;        // list of low priority hot clean blocks (LRU order)
+    struct list_head                hi_hots;        // list of high priority hot clean blocks (LRU order)
     struct list_head                dirties;        // list of dirty blocks (write order)
-    struct s3b_hash                 *hashtable;     // hashtable of all cached blocks
+    struct s3b_hash                 *hashtable;     // hashtable of all cached blocks in this shard
+    struct s3b_hash                 *partials;      // partially valid entries in this shard (partial_writes only)
+    struct s3b_pool                 *entry_pool;    // pool of cache_entry structures
+    struct s3b_pool                 *etag_pool;     // pool of cache_entry structures with trailing ETag (CLEAN2)
+    struct s3b_pool                 *data_pool;     // pool of block data buffers
+    u_int                           cache_size;     // maximum number of blocks in this shard
+    u_int                           num_cleans;     // combined lengths of all four clean lists
+    u_int                           num_hots;       // combined lengths of 'lo_hots' and 'hi_hots'
+    u_int                           max_hots;       // maximum value for 'num_hots'
+    u_int                           num_dirties;    // # blocks in this shard that are DIRTY, WRITING, or WRITING2
+    block_list_func_t               *survey_callback;// non-zero survey is running and this is the callback
+    void                            *survey_arg;    // non-zero survey is running and this is the arg
+    pthread_mutex_t                 mutex;          // shard mutex
+    pthread_cond_t                  space_avail;    // there is new space available in this shard
+    pthread_cond_t                  end_reading;    // some entry in state READING[2] changed state
+    pthread_cond_t                  write_complete; // a write has completed
+};
+
+// Private data
+struct block_cache_private {
+    struct block_cache_conf         *config;        // configuration
+    struct s3backer_store           *inner;         // underlying s3backer store
+    struct block_cache_shard        *shards;        // cache shards
+    u_int                           num_shards;     // number of cache shards
     struct s3b_dcache               *dcache;        // on-disk persistent cache
-    u_int                           num_cleans;     // combined lengths of 'lo_cleans' and 'hi_cleans'
-    u_int                           num_dirties;    // # blocks that are DIRTY, WRITING, or WRITING2
+    struct list_head                load_cleans;    // clean blocks loaded from the disk cache (during startup only)
+    struct list_head                load_dirties;   // dirty blocks loaded from the disk cache (during startup only)
+    struct s3b_hash                 *load_hash;     // all blocks loaded from the disk cache (during startup only)
+    u_int                           num_dirties;    // # blocks that are DIRTY, WRITING, or WRITING2 (atomic)
+    u_int                           num_flushes;    // # blocks having the flush flag set (atomic)
     u_int64_t                       start_time;     // when we started
     u_int32_t                       clean_timeout;  // timeout for clean entries in time units
     u_int32_t                       dirty_timeout;  // timeout for dirty entries in time units
     double                          max_dirty_ratio;// dirty ratio at which we write immediately
-    s3b_block_t                     seq_last;       // last block read in sequence by upper layer
-    u_int                           seq_count;      // # of blocks read in sequence by upper layer
-    u_int                           ra_count;       // # of blocks of read-ahead initiated
+    struct read_stream              streams[MAX_READ_STREAMS];  // sequential read streams
+    u_int                           ra_max;         // maximum read-ahead window size in blocks
+    uint64_t                        read_latency;   // moving average of microseconds per underlying block read
+    struct latency_hist             hit_latency;    // reads satisfied from the cache
+    struct latency_hist             miss_latency;   // reads that had to go to the underlying store
+    struct latency_hist             space_wait_latency;     // waits for a free cache entry
+    struct latency_hist             dirty_wait_latency;     // waits for the number of dirty blocks to drop below max_dirty
+    struct block_list               prefetches;     // blocks queued by block_cache_read_blocks() for worker threads
     u_int                           thread_id;      // next thread id
-    u_int                           num_threads;    // number of alive worker threads
+    u_int                           num_threads;    // number of alive worker threads (atomic)
     pthread_t                       *threads;       // worker threads
-    int                             stopping;       // signals worker threads to exit
-    block_list_func_t               *survey_callback;// non-zero survey is running and this is the callback
-    void                            *survey_arg;    // non-zero survey is running and this is the arg
-    pthread_mutex_t                 mutex;          // my mutex
-    pthread_cond_t                  space_avail;    // there is new space available in cache
-    pthread_cond_t                  end_reading;    // some entry in state READING[2] changed state
+    int                             stopping;       // signals worker threads to exit (atomic)
+    u_int                           work_gen;       // incremented every time worker_work is signaled
+    pthread_mutex_t                 mutex;          // global mutex
+    pthread_mutex_t                 dcache_mutex;   // protects dcache slot allocation
     pthread_cond_t                  worker_work;    // there is new work for worker thread(s)
     pthread_cond_t                  worker_exit;    // a worker thread has exited
-    pthread_cond_t                  write_complete; // a write has completed
+    pthread_cond_t                  dirty_space;    // the number of dirty blocks has decreased
 };
 
 // s3backer_store functions
@@ -191,45 +279,89 @@ static int block_cache_meta_data(struct s3backer_store *s3b, off_t *file_sizep,
 static int block_cache_set_mount_token(struct s3backer_store *s3b, int32_t *old_valuep, int32_t new_value);
 static int block_cache_read_block(struct s3backer_store *s3b, s3b_block_t block_num, void *dest,
   u_char *actual_etag, const u_char *expect_etag, int strict);
+static int block_cache_read_blocks(struct s3backer_store *s3b, s3b_block_t block_num, u_int num_blocks, void *dest);
+static int block_cache_prefetch_blocks(struct s3backer_store *s3b, s3b_block_t block_num, u_int num_blocks);
 static int block_cache_write_block(struct s3backer_store *s3b, s3b_block_t block_num, const void *src, u_char *etag,
   check_cancel_t *check_cancel, void *check_cancel_arg);
+static int block_cache_write_blocks(struct s3backer_store *s3b, s3b_block_t block_num, u_int num_blocks, const void *src);
 static int block_cache_read_block_part(struct s3backer_store *s3b, s3b_block_t block_num, u_int off, u_int len, void *dest);
 static int block_cache_write_block_part(struct s3backer_store *s3b, s3b_block_t block_num, u_int off, u_int len, const void *src);
 static int block_cache_flush_blocks(struct s3backer_store *s3b, const s3b_block_t *block_nums, u_int num_blocks, long timeout);
 static int block_cache_survey_non_zero(struct s3backer_store *s3b, block_list_func_t *callback, void *arg);
+static int block_cache_block_status(struct s3backer_store *s3b, s3b_block_t block_num, u_int num_blocks, int *zerop, u_int *countp);
 static int block_cache_shutdown(struct s3backer_store *s3b);
 static void block_cache_destroy(struct s3backer_store *s3b);
 
 // Other functions
+static int block_cache_init_shard(struct block_cache_private *priv, struct block_cache_shard *shard, u_int cache_size);
+static void block_cache_destroy_shard(struct block_cache_shard *shard);
+static struct cache_entry *block_cache_alloc_entry(struct block_cache_shard *shard, int verify);
+static void block_cache_release_entry(struct block_cache_shard *shard, struct cache_entry *entry);
+static struct block_cache_shard *block_cache_shard(struct block_cache_private *priv, s3b_block_t block_num);
 static s3b_dcache_visit_t block_cache_dcache_load;
+static int block_cache_distribute_loaded(struct block_cache_private *priv);
 static s3b_hash_visit_t block_cache_append_block_list;
+static int block_cache_unwritten(struct block_cache_private *priv, s3b_block_t block_num);
 static int block_cache_read(struct block_cache_private *priv, s3b_block_t block_num, u_int off, u_int len, void *dest);
-static int block_cache_do_read(struct block_cache_private *priv, s3b_block_t block_num, u_int off, u_int len, void *dest, int stats);
+static int block_cache_do_read(struct block_cache_private *priv, struct block_cache_shard *shard, s3b_block_t block_num,
+  u_int off, u_int len, void *dest, int stats, int sequential);
+static int block_cache_track_sequential(struct block_cache_private *priv, struct block_cache_shard *shard,
+  s3b_block_t block_num);
+static struct read_stream *block_cache_read_ahead_stream(struct block_cache_private *priv);
+static u_int block_cache_queue_prefetches(struct block_cache_private *priv, s3b_block_t block_num, u_int num_blocks);
 static int block_cache_write(struct block_cache_private *priv, s3b_block_t block_num, u_int off, u_int len, const void *src);
+static int block_cache_do_write(struct block_cache_private *priv, struct block_cache_shard *shard, s3b_block_t block_num,
+  u_int off, u_int len, const void *src);
+static void block_cache_wait_written(struct block_cache_private *priv, struct block_cache_shard *shard, s3b_block_t block_num);
+static void block_cache_wait_dirty_space(struct block_cache_private *priv, struct block_cache_shard *shard);
+static void block_cache_wait_space(struct block_cache_private *priv, struct block_cache_shard *shard);
+static void block_cache_dirty_done(struct block_cache_private *priv, struct block_cache_shard *shard);
+static struct partial_block *block_cache_get_partial(struct block_cache_shard *shard, s3b_block_t block_num);
+static void block_cache_wait_partial(struct block_cache_private *priv, struct block_cache_shard *shard, s3b_block_t block_num);
+static void block_cache_merge_partial(struct block_cache_private *priv, struct block_cache_shard *shard,
+  struct cache_entry *entry, const void *data);
 static void *block_cache_worker_main(void *arg);
+static int block_cache_worker_shard(struct block_cache_private *priv, struct block_cache_shard *shard, void *buf,
+  int stopping, int flushes_only, uint32_t *wakep, int *have_wakep);
+static u_int block_cache_coalesce(struct block_cache_private *priv, s3b_block_t block_num, void *buf);
+static void block_cache_write_done(struct block_cache_private *priv, struct block_cache_shard *shard, struct cache_entry *entry,
+  int r, const u_char *etag, uint32_t now);
+static int block_cache_worker_read(struct block_cache_private *priv);
 static int block_cache_check_cancel(void *arg, s3b_block_t block_num);
-static int block_cache_get_entry(struct block_cache_private *priv, struct cache_entry **entryp, void **datap);
-static void block_cache_free_entry(struct block_cache_private *priv, struct cache_entry **entryp);
+static int block_cache_get_entry(struct block_cache_private *priv, struct block_cache_shard *shard,
+  struct cache_entry **entryp, void **datap);
+static void block_cache_free_entry(struct block_cache_private *priv, struct block_cache_shard *shard,
+  struct cache_entry **entryp);
 static s3b_hash_visit_t block_cache_free_one;
-static struct cache_entry *block_cache_verified(struct block_cache_private *priv, struct cache_entry *entry);
+static struct cache_entry *block_cache_verified(struct block_cache_private *priv, struct block_cache_shard *shard,
+  struct cache_entry *entry);
 static double block_cache_dirty_ratio(struct block_cache_private *priv);
-static void block_cache_worker_wait(struct block_cache_private *priv, struct cache_entry *entry);
-static int block_cache_cond_timedwait(struct block_cache_private *priv, pthread_cond_t *cond, uint64_t wake_time_millis);
-static struct list_head *block_cache_cleans_list(struct block_cache_private *priv, s3b_block_t block_num);
+static void block_cache_wake_workers(struct block_cache_private *priv, int all);
+static void block_cache_worker_wait(struct block_cache_private *priv, int have_wake, uint32_t wake);
+static int block_cache_cond_timedwait(pthread_cond_t *cond, pthread_mutex_t *mutex, uint64_t wake_time_millis);
+static struct list_head *block_cache_cleans_list(struct block_cache_private *priv, struct block_cache_shard *shard,
+  struct cache_entry *entry);
+static void block_cache_clean_insert(struct block_cache_private *priv, struct block_cache_shard *shard,
+  struct cache_entry *entry);
+static void block_cache_clean_remove(struct block_cache_private *priv, struct block_cache_shard *shard,
+  struct cache_entry *entry);
+static void block_cache_demote_hots(struct block_cache_private *priv, struct block_cache_shard *shard);
 static int block_cache_high_prio(struct block_cache_conf *conf, s3b_block_t block_num);
 static uint32_t block_cache_get_time(struct block_cache_private *priv);
 static uint64_t block_cache_get_time_millis(void);
+static uint64_t block_cache_get_time_micros(void);
 static int block_cache_read_data(struct block_cache_private *priv, struct cache_entry *entry, void *dest, u_int off, u_int len);
 static int block_cache_write_data(struct block_cache_private *priv, struct cache_entry *entry, const void *src, u_int off,
   u_int len);
 
 // Invariants checking
 #ifndef NDEBUG
-static void block_cache_check_invariants(struct block_cache_private *priv, int allow_stopping);
+static void block_cache_check_invariants(struct block_cache_private *priv, struct block_cache_shard *shard,
+  int allow_stopping);
 static s3b_hash_visit_t block_cache_check_one;
-#define S3BCACHE_CHECK_INVARIANTS(priv, allow_stopping)     block_cache_check_invariants(priv, allow_stopping)
+#define S3BCACHE_CHECK_INVARIANTS(priv, shard, allow_stopping)  block_cache_check_invariants(priv, shard, allow_stopping)
 #else
-#define S3BCACHE_CHECK_INVARIANTS(priv, allow_stopping)     do { } while (0)
+#define S3BCACHE_CHECK_INVARIANTS(priv, shard, allow_stopping)  do { } while (0)
 #endif
 
 /*
@@ -243,7 +375,7 @@ block_cache_create(struct block_cache_conf *config, struct s3backer_store *inner
 {
     struct s3backer_store *s3b;
     struct block_cache_private *priv;
-    struct cache_entry *entry;
+    u_int i;
     int r;
 
     // Initialize s3backer_store structure
@@ -256,12 +388,16 @@ block_cache_create(struct block_cache_conf *config, struct s3backer_store *inner
     s3b->meta_data = block_cache_meta_data;
     s3b->set_mount_token = block_cache_set_mount_token;
     s3b->read_block = block_cache_read_block;
+    s3b->read_blocks = block_cache_read_blocks;
+    s3b->prefetch_blocks = block_cache_prefetch_blocks;
     s3b->write_block = block_cache_write_block;
+    s3b->write_blocks = block_cache_write_blocks;
     s3b->read_block_part = block_cache_read_block_part;
     s3b->write_block_part = block_cache_write_block_part;
     s3b->flush_blocks = block_cache_flush_blocks;
     s3b->bulk_zero = generic_bulk_zero;
     s3b->survey_non_zero = block_cache_survey_non_zero;
+    s3b->block_status = block_cache_block_status;
     s3b->shutdown = block_cache_shutdown;
     s3b->destroy = block_cache_destroy;
 
@@ -276,27 +412,41 @@ block_cache_create(struct block_cache_conf *config, struct s3backer_store *inner
     priv->start_time = block_cache_get_time_millis();
     priv->clean_timeout = (config->timeout + TIME_UNIT_MILLIS - 1) / TIME_UNIT_MILLIS;
     priv->dirty_timeout = (config->write_delay + TIME_UNIT_MILLIS - 1) / TIME_UNIT_MILLIS;
+    priv->ra_max = config->read_ahead_max < config->cache_size / 4 ? config->read_ahead_max : config->cache_size / 4;
+    if (priv->ra_max < config->read_ahead)
+        priv->ra_max = config->read_ahead;
+    priv->num_shards = config->num_shards > 0 ? config->num_shards : 1;
+    if (priv->num_shards > config->cache_size)
+        priv->num_shards = config->cache_size;
     if ((r = pthread_mutex_init(&priv->mutex, NULL)) != 0)
         goto fail2;
-    if ((r = pthread_cond_init(&priv->space_avail, NULL)) != 0)
+    if ((r = pthread_mutex_init(&priv->dcache_mutex, NULL)) != 0)
         goto fail3;
-    if ((r = pthread_cond_init(&priv->end_reading, NULL)) != 0)
-        goto fail4;
     if ((r = pthread_cond_init(&priv->worker_work, NULL)) != 0)
-        goto fail5;
+        goto fail4;
     if ((r = pthread_cond_init(&priv->worker_exit, NULL)) != 0)
+        goto fail5;
+    if ((r = pthread_cond_init(&priv->dirty_space, NULL)) != 0)
         goto fail6;
-    if ((r = pthread_cond_init(&priv->write_complete, NULL)) != 0)
+    if ((priv->threads = calloc(config->num_threads, sizeof(*priv->threads))) == NULL) {
+        r = errno;
         goto fail7;
-    if ((priv->threads = calloc(config->num_threads, sizeof(*priv->threads))) == NULL)
+    }
+    if ((priv->shards = calloc(priv->num_shards, sizeof(*priv->shards))) == NULL) {
+        r = errno;
         goto fail8;
-    TAILQ_INIT(&priv->lo_cleans);
-    TAILQ_INIT(&priv->hi_cleans);
-    TAILQ_INIT(&priv->dirties);
-    if ((r = s3b_hash_create(&priv->hashtable, config->cache_size)) != 0)
-        goto fail9;
+    }
+    block_list_init(&priv->prefetches);
     s3b->data = priv;
 
+    // Initialize shards, dividing the cache size evenly among them
+    for (i = 0; i < priv->num_shards; i++) {
+        const u_int shard_size = config->cache_size / priv->num_shards + (i < config->cache_size % priv->num_shards);
+
+        if ((r = block_cache_init_shard(priv, &priv->shards[i], shard_size)) != 0)
+            goto fail9;
+    }
+
     // Compute dirty ratio at which we will be writing immediately
     priv->max_dirty_ratio = (double)(config->max_dirty != 0 ? config->max_dirty : config->cache_size) / (double)config->cache_size;
     if (priv->max_dirty_ratio > DIRTY_RATIO_WRITE_ASAP)
@@ -304,47 +454,57 @@ block_cache_create(struct block_cache_conf *config, struct s3backer_store *inner
 
     // Initialize on-disk cache and read in directory
     if (config->cache_file != NULL) {
-        if ((r = s3b_dcache_open(&priv->dcache, config, block_cache_dcache_load, priv, config->perform_flush)) != 0)
+        TAILQ_INIT(&priv->load_cleans);
+        TAILQ_INIT(&priv->load_dirties);
+        if ((r = s3b_hash_create(&priv->load_hash, config->cache_size)) != 0)
             goto fail10;
+        if ((r = s3b_dcache_open(&priv->dcache, config, block_cache_dcache_load, priv, config->perform_flush)) != 0)
+            goto fail11;
+        if ((r = block_cache_distribute_loaded(priv)) != 0)
+            goto fail11;
+        s3b_hash_destroy(priv->load_hash);
+        priv->load_hash = NULL;
         if (config->perform_flush && priv->num_dirties > 0)
             (*config->log)(LOG_INFO, "%u dirty blocks in cache file `%s' will be recovered", priv->num_dirties, config->cache_file);
-        priv->stats.initial_size = priv->num_cleans + priv->num_dirties;
+        for (i = 0; i < priv->num_shards; i++)
+            priv->shards[0].stats.initial_size += s3b_hash_size(priv->shards[i].hashtable);
     }
 
-    // Grab lock
-    pthread_mutex_lock(&priv->mutex);
-    S3BCACHE_CHECK_INVARIANTS(priv, 0);
+#ifndef NDEBUG
+    // Sanity check
+    for (i = 0; i < priv->num_shards; i++) {
+        pthread_mutex_lock(&priv->shards[i].mutex);
+        S3BCACHE_CHECK_INVARIANTS(priv, &priv->shards[i], 0);
+        CHECK_RETURN(pthread_mutex_unlock(&priv->shards[i].mutex));
+    }
+#endif
 
     // Done
-    CHECK_RETURN(pthread_mutex_unlock(&priv->mutex));
     return s3b;
 
+fail11:
+    for (i = 0; i < priv->num_shards; i++)
+        s3b_hash_foreach(priv->shards[i].hashtable, block_cache_free_one, priv);
+    s3b_hash_foreach(priv->load_hash, block_cache_free_one, priv);
+    s3b_hash_destroy(priv->load_hash);
+    if (priv->dcache != NULL)
+        s3b_dcache_close(priv->dcache);
 fail10:
-    if (config->cache_file != NULL) {
-        while ((entry = TAILQ_FIRST(&priv->lo_cleans)) != NULL) {
-            TAILQ_REMOVE(&priv->lo_cleans, entry, link);
-            free(entry);
-        }
-        while ((entry = TAILQ_FIRST(&priv->hi_cleans)) != NULL) {
-            TAILQ_REMOVE(&priv->hi_cleans, entry, link);
-            free(entry);
-        }
-        if (priv->dcache != NULL)
-            s3b_dcache_close(priv->dcache);
-    }
-    s3b_hash_destroy(priv->hashtable);
+    i = priv->num_shards;
 fail9:
-    free(priv->threads);
+    while (i-- > 0)
+        block_cache_destroy_shard(&priv->shards[i]);
+    free(priv->shards);
 fail8:
-    pthread_cond_destroy(&priv->write_complete);
+    free(priv->threads);
 fail7:
-    pthread_cond_destroy(&priv->worker_exit);
+    pthread_cond_destroy(&priv->dirty_space);
 fail6:
-    pthread_cond_destroy(&priv->worker_work);
+    pthread_cond_destroy(&priv->worker_exit);
 fail5:
-    pthread_cond_destroy(&priv->end_reading);
+    pthread_cond_destroy(&priv->worker_work);
 fail4:
-    pthread_cond_destroy(&priv->space_avail);
+    pthread_mutex_destroy(&priv->dcache_mutex);
 fail3:
     pthread_mutex_destroy(&priv->mutex);
 fail2:
@@ -357,8 +517,125 @@ fail0:
     return NULL;
 }
 
+/*
+ * Initialize a cache shard.
+ */
+static int
+block_cache_init_shard(struct block_cache_private *priv, struct block_cache_shard *shard, u_int cache_size)
+{
+    struct block_cache_conf *const config = priv->config;
+    int r;
+
+    shard->cache_size = cache_size;
+    shard->max_hots = config->scan_resistant ? (u_int)(((uint64_t)cache_size * HOT_PERCENT) / 100) : 0;
+    TAILQ_INIT(&shard->lo_cleans);
+    TAILQ_INIT(&shard->hi_cleans);
+    TAILQ_INIT(&shard->lo_hots);
+    TAILQ_INIT(&shard->hi_hots);
+    TAILQ_INIT(&shard->dirties);
+    if ((r = pthread_mutex_init(&shard->mutex, NULL)) != 0)
+        goto fail0;
+    if ((r = pthread_cond_init(&shard->space_avail, NULL)) != 0)
+        goto fail1;
+    if ((r = pthread_cond_init(&shard->end_reading, NULL)) != 0)
+        goto fail2;
+    if ((r = pthread_cond_init(&shard->write_complete, NULL)) != 0)
+        goto fail3;
+    if ((r = s3b_hash_create(&shard->hashtable, cache_size)) != 0)
+        goto fail4;
+    if ((r = s3b_pool_create(&shard->entry_pool, sizeof(struct cache_entry), config->huge_pages, config->log)) != 0)
+        goto fail5;
+    if (!config->no_verify
+      && (r = s3b_pool_create(&shard->etag_pool, sizeof(struct cache_entry) + MD5_DIGEST_LENGTH, config->huge_pages, config->log)) != 0)
+        goto fail6;
+    if ((r = s3b_pool_create(&shard->data_pool, config->block_size, config->huge_pages, config->log)) != 0)
+        goto fail7;
+    if (config->partial_writes && (r = s3b_hash_create(&shard->partials, cache_size)) != 0)
+        goto fail8;
+
+    // Done
+    return 0;
+
+fail8:
+    s3b_pool_destroy(shard->data_pool);
+fail7:
+    s3b_pool_destroy(shard->etag_pool);
+fail6:
+    s3b_pool_destroy(shard->entry_pool);
+fail5:
+    s3b_hash_destroy(shard->hashtable);
+fail4:
+    pthread_cond_destroy(&shard->write_complete);
+fail3:
+    pthread_cond_destroy(&shard->end_reading);
+fail2:
+    pthread_cond_destroy(&shard->space_avail);
+fail1:
+    pthread_mutex_destroy(&shard->mutex);
+fail0:
+    return r;
+}
+
+/*
+ * Destroy a cache shard. Does not free the entries in it.
+ */
+static void
+block_cache_destroy_shard(struct block_cache_shard *shard)
+{
+    if (shard->partials != NULL)
+        s3b_hash_destroy(shard->partials);
+    s3b_pool_destroy(shard->data_pool);
+    s3b_pool_destroy(shard->etag_pool);
+    s3b_pool_destroy(shard->entry_pool);
+    s3b_hash_destroy(shard->hashtable);
+    pthread_cond_destroy(&shard->write_complete);
+    pthread_cond_destroy(&shard->end_reading);
+    pthread_cond_destroy(&shard->space_avail);
+    pthread_mutex_destroy(&shard->mutex);
+}
+
+/*
+ * Get the shard to which a block belongs. Consecutive blocks are spread across shards.
+ */
+static struct block_cache_shard *
+block_cache_shard(struct block_cache_private *priv, s3b_block_t block_num)
+{
+    return &priv->shards[block_num % priv->num_shards];
+}
+
+/*
+ * Allocate a zeroed cache entry from the shard's pool. If "verify" is set, the entry
+ * has room for a trailing ETag and its verify flag is set.
+ *
+ * Returns NULL and sets errno on failure.
+ */
+static struct cache_entry *
+block_cache_alloc_entry(struct block_cache_shard *shard, int verify)
+{
+    struct s3b_pool *const pool = verify ? shard->etag_pool : shard->entry_pool;
+    struct cache_entry *entry;
+
+    assert(pool != NULL);
+    if ((entry = s3b_pool_alloc(pool)) == NULL)
+        return NULL;
+    memset(entry, 0, sizeof(*entry) + (verify ? MD5_DIGEST_LENGTH : 0));
+    entry->verify = verify;
+    return entry;
+}
+
+/*
+ * Return a cache entry to the shard's pool.
+ */
+static void
+block_cache_release_entry(struct block_cache_shard *shard, struct cache_entry *entry)
+{
+    s3b_pool_free(entry->verify ? shard->etag_pool : shard->entry_pool, entry);
+}
+
 /*
  * Callback function to pre-load the cache from a pre-existing cache file.
+ *
+ * Loaded blocks are held aside until block_cache_distribute_loaded() assigns them to shards.
  */
 static int
 block_cache_dcache_load(void *arg, s3b_block_t dslot, s3b_block_t block_num, const u_char *etag)
@@ -366,7 +643,6 @@ block_cache_dcache_load(void *arg, s3b_block_t dslot, s3b_block_t block_num, con
     const u_int dirty = etag == NULL;
     struct block_cache_private *const priv = arg;
     struct block_cache_conf *const config = priv->config;
-    struct list_head *const cleans_list = block_cache_cleans_list(priv, block_num);
     struct cache_entry *entry;
     int r;
 
@@ -375,7 +651,7 @@ block_cache_dcache_load(void *arg, s3b_block_t dslot, s3b_block_t block_num, con
     assert(!dirty || config->perform_flush);            // we should never see dirty blocks unless we asked for them
 
     // Sanity check a block is not listed twice
-    if ((entry = s3b_hash_get(priv->hashtable, block_num)) != NULL) {
+    if ((entry = s3b_hash_get(priv->load_hash, block_num)) != NULL) {
         (*config->log)(LOG_ERR, "corrupted cache file: block 0x%0*jx listed twice (in dslots %ju and %ju)",
           S3B_BLOCK_NUM_DIGITS, (uintmax_t)block_num, (uintmax_t)entry->u.dslot, (uintmax_t)dslot);
         return EINVAL;
@@ -383,10 +659,10 @@ block_cache_dcache_load(void *arg, s3b_block_t dslot, s3b_block_t block_num, con
 
     // Create a new cache entry
     assert(config->cache_file != NULL);
-    if ((entry = calloc(1, sizeof(*entry) + (!config->no_verify ? MD5_DIGEST_LENGTH : 0))) == NULL) {
+    if ((entry = block_cache_alloc_entry(block_cache_shard(priv, block_num), !dirty && !config->no_verify)) == NULL) {
         r = errno;
         (*config->log)(LOG_ERR, "can't allocate block cache entry: %s", strerror(r));
-        priv->stats.out_of_memory_errors++;
+        priv->shards[0].stats.out_of_memory_errors++;
         return r;
     }
     entry->block_num = block_num;
@@ -396,18 +672,72 @@ block_cache_dcache_load(void *arg, s3b_block_t dslot, s3b_block_t block_num, con
     // Mark as clean or dirty accordingly
     if (dirty) {
         entry->dirty = 1;
-        TAILQ_INSERT_TAIL(&priv->dirties, entry, link);
-        priv->num_dirties++;
-        assert(ENTRY_GET_STATE(entry) == DIRTY);
+        TAILQ_INSERT_TAIL(&priv->load_dirties, entry, link);
     } else {
-        entry->verify = !config->no_verify;
         if (entry->verify)
             memcpy(&entry->etag, etag, MD5_DIGEST_LENGTH);
-        TAILQ_INSERT_TAIL(cleans_list, entry, link);
-        priv->num_cleans++;
+        TAILQ_INSERT_TAIL(&priv->load_cleans, entry, link);
+    }
+    s3b_hash_put_new(priv->load_hash, entry);
+    return 0;
+}
+
+/*
+ * Assign the blocks loaded from the disk cache to their shards.
+ *
+ * Because the cache file doesn't know about shards, a shard can end up with more blocks than it has room
+ * for (e.g., if the number of shards changed). Dirty blocks are assigned first because they must be kept;
+ * clean blocks that don't fit are simply discarded.
+ */
+static int
+block_cache_distribute_loaded(struct block_cache_private *priv)
+{
+    struct block_cache_conf *const config = priv->config;
+    struct block_cache_shard *shard;
+    struct cache_entry *entry;
+    u_int num_discarded = 0;
+    int r;
+
+    // Assign dirty blocks
+    while ((entry = TAILQ_FIRST(&priv->load_dirties)) != NULL) {
+        shard = block_cache_shard(priv, entry->block_num);
+        if (s3b_hash_size(shard->hashtable) >= shard->cache_size) {
+            (*config->log)(LOG_ERR, "too many dirty blocks in cache file `%s' for %u shards; try fewer shards",
+              config->cache_file, priv->num_shards);
+            return EINVAL;
+        }
+        TAILQ_REMOVE(&priv->load_dirties, entry, link);
+        s3b_hash_remove(priv->load_hash, entry->block_num);
+        TAILQ_INSERT_TAIL(&shard->dirties, entry, link);
+        s3b_hash_put_new(shard->hashtable, entry);
+        shard->num_dirties++;
+        priv->num_dirties++;
+        assert(ENTRY_GET_STATE(entry) == DIRTY);
+    }
+
+    // Assign clean blocks, or discard them if there's no room
+    while ((entry = TAILQ_FIRST(&priv->load_cleans)) != NULL) {
+        shard = block_cache_shard(priv, entry->block_num);
+        TAILQ_REMOVE(&priv->load_cleans, entry, link);
+        s3b_hash_remove(priv->load_hash, entry->block_num);
+        if (s3b_hash_size(shard->hashtable) >= shard->cache_size) {
+            if ((r = s3b_dcache_erase_block(priv->dcache, entry->u.dslot)) != 0
+              || (r = s3b_dcache_free_block(priv->dcache, entry->u.dslot)) != 0) {
+                block_cache_release_entry(shard, entry);
+                return r;
+            }
+            block_cache_release_entry(shard, entry);
+            num_discarded++;
+            continue;
+        }
+        block_cache_clean_insert(priv, shard, entry);
+        s3b_hash_put_new(shard->hashtable, entry);
         assert(ENTRY_GET_STATE(entry) == (config->no_verify ? CLEAN : CLEAN2));
     }
-    s3b_hash_put_new(priv->hashtable, entry);
+    if (num_discarded > 0)
+        (*config->log)(LOG_INFO, "discarded %u clean blocks from cache file `%s' that don't fit", num_discarded, config->cache_file);
+
+    // Done
     return 0;
 }
 
@@ -424,13 +754,12 @@ block_cache_create_threads(struct s3backer_store *s3b)
 
     // Grab lock
     pthread_mutex_lock(&priv->mutex);
-    S3BCACHE_CHECK_INVARIANTS(priv, 0);
 
     // Create threads
     while (priv->num_threads < config->num_threads) {
         if ((r = pthread_create(&priv->threads[priv->num_threads], NULL, block_cache_worker_main, priv)) != 0)
             goto fail;
-        priv->num_threads++;
+        ATOMIC_ADD(priv->num_threads, 1);
     }
 
 fail:
@@ -469,86 +798,114 @@ block_cache_flush_blocks(struct s3backer_store *s3b, const s3b_block_t *const bl
 {
     struct block_cache_private *const priv = s3b->data;
     const uint32_t now = block_cache_get_time(priv);
+    struct block_cache_shard *shard;
     struct cache_entry *entry;
     uint64_t absolute_timeout;
-    int need_signal = 0;
     int r = 0;
+    u_int num_flushed = 0;
     u_int i;
 
     // Calculate absolute timeout
     absolute_timeout = timeout > 0 ? block_cache_get_time_millis() + timeout : 0;
 
-    // Grab lock and sanity check
-    pthread_mutex_lock(&priv->mutex);
-    S3BCACHE_CHECK_INVARIANTS(priv, 0);
-
-    // Move all DIRTY blocks to the front of the queue (in the order given to us) so they will be written first
+    /*
+     * Flag all unwritten blocks so worker threads will write them before any other blocks, and
+     * move DIRTY blocks to the front of their queue (in the order given to us). A block in WRITING2
+     * has been modified since its current write started; the flag makes sure its second write
+     * happens immediately, rather than after another write delay.
+     */
     for (i = num_blocks; i > 0; i--) {
         const s3b_block_t block_num = block_nums[i - 1];
 
-        // Check if block exists and is DIRTY
-        if ((entry = s3b_hash_get(priv->hashtable, block_num)) == NULL)
-            continue;
-        if (ENTRY_GET_STATE(entry) != DIRTY)
-            continue;
+        // Grab lock and sanity check
+        shard = block_cache_shard(priv, block_num);
+        pthread_mutex_lock(&shard->mutex);
+        S3BCACHE_CHECK_INVARIANTS(priv, shard, 0);
+
+        // Check if block exists and is not yet written
+        if ((entry = s3b_hash_get(shard->hashtable, block_num)) != NULL) {
+            switch (ENTRY_GET_STATE(entry)) {
+            case DIRTY:
+
+                // Move it to the front of the queue if not there already
+                if (entry != TAILQ_FIRST(&shard->dirties)) {
+                    TAILQ_REMOVE(&shard->dirties, entry, link);
+                    TAILQ_INSERT_HEAD(&shard->dirties, entry, link);
+                }
 
-        // Move it to the front of the queue if not there already
-        if (entry != TAILQ_FIRST(&priv->dirties)) {
-            TAILQ_REMOVE(&priv->dirties, entry, link);
-            TAILQ_INSERT_HEAD(&priv->dirties, entry, link);
+                // Set for immediate write timeout
+                entry->timeout = now;
+                num_flushed++;
+                // FALLTHROUGH
+            case WRITING:
+            case WRITING2:
+                if (!entry->flush) {
+                    entry->flush = 1;
+                    ATOMIC_ADD(priv->num_flushes, 1);
+                }
+                break;
+            default:
+                break;
+            }
         }
 
-        // Set for immediate write timeout
-        entry->timeout = now;
-        need_signal = 1;
+        // Release lock
+        CHECK_RETURN(pthread_mutex_unlock(&shard->mutex));
     }
-    if (need_signal)
-        pthread_cond_signal(&priv->worker_work);
+    if (num_flushed > 0)
+        block_cache_wake_workers(priv, num_flushed > 1);
 
     // Wait for each block in our list to become clean
-    for (i = 0; i < num_blocks; ) {
+    for (i = 0; i < num_blocks && r == 0; i++) {
         const s3b_block_t block_num = block_nums[i];
 
-        // Check for stopping condition; this shouldn't ever happen but if it does we don't want to hang
-        if (priv->stopping != 0) {
-            r = EINTR;
-            break;
-        }
+        // Grab lock
+        shard = block_cache_shard(priv, block_num);
+        pthread_mutex_lock(&shard->mutex);
 
-        // Is this block in the cache?
-        if ((entry = s3b_hash_get(priv->hashtable, block_num)) == NULL) {
-            i++;                                // this block is not in the cache - advance to the next block
-            continue;
-        }
+        // Wait for this block to become clean
+        while (1) {
 
-        // Check its state
-        switch (ENTRY_GET_STATE(entry)) {
-        case CLEAN:
-        case CLEAN2:
-        case READING:
-        case READING2:                          // this block is clean - advance to the next block
-            i++;
-            continue;
-        case DIRTY:                             // this block is waiting for a worker thread to get to it
-            break;
-        case WRITING:
-        case WRITING2:                          // a worker thread is currently writing out this block
-            break;
-        default:
-            assert(0);
-            break;
-        }
+            // Check for stopping condition; this shouldn't ever happen but if it does we don't want to hang
+            if (ATOMIC_LOAD(priv->stopping) != 0) {
+                r = EINTR;
+                break;
+            }
 
-        // Wait for ANY block to finish being written, then reevaluate
-        if (timeout > 0) {
-            if ((r = block_cache_cond_timedwait(priv, &priv->write_complete, absolute_timeout)) != 0)
+            // Is this block in the cache?
+            if ((entry = s3b_hash_get(shard->hashtable, block_num)) == NULL)
+                break;                              // this block is not in the cache - advance to the next block
+
+            // Check its state
+            switch (ENTRY_GET_STATE(entry)) {
+            case CLEAN:
+            case CLEAN2:
+            case READING:
+            case READING2:                          // this block is clean - advance to the next block
+                break;
+            case DIRTY:                             // this block is waiting for a worker thread to get to it
+            case WRITING:
+            case WRITING2:                          // a worker thread is currently writing out this block
+                entry = NULL;
+                break;
+            default:
+                assert(0);
+                break;
+            }
+            if (entry != NULL)
                 break;
-        } else
-            pthread_cond_wait(&priv->write_complete, &priv->mutex);
-    }
 
-    // Release lock
-    CHECK_RETURN(pthread_mutex_unlock(&priv->mutex));
+            // Wait for ANY block in this shard to finish being written, then reevaluate
+            if (timeout > 0) {
+                if ((r = block_cache_cond_timedwait(&shard->write_complete, &shard->mutex, absolute_timeout)) != 0)
+                    break;
+            } else
+                pthread_cond_wait(&shard->write_complete, &shard->mutex);
+        }
+
+        // Release lock
+        CHECK_RETURN(pthread_mutex_unlock(&shard->mutex));
+    }
 
     // Now flush them in the next layer down
     if (r == 0) {
@@ -574,14 +931,14 @@ block_cache_shutdown(struct s3backer_store *const s3b)
     int i;
     int r;
 
-    // Grab lock and sanity check
+    // Grab lock
     pthread_mutex_lock(&priv->mutex);
-    S3BCACHE_CHECK_INVARIANTS(priv, 0);
 
     // Wait for all dirty blocks to be written and all worker threads to exit
     orig_num_threads = priv->num_threads;
-    priv->stopping = 1;
-    while (TAILQ_FIRST(&priv->dirties) != NULL || priv->num_threads > 0) {
+    ATOMIC_STORE(priv->stopping, 1);
+    while (ATOMIC_LOAD(priv->num_dirties) > 0 || priv->num_threads > 0) {
+        priv->work_gen++;
         pthread_cond_broadcast(&priv->worker_work);
         pthread_cond_wait(&priv->worker_exit, &priv->mutex);
     }
@@ -602,11 +959,18 @@ block_cache_destroy(struct s3backer_store *const s3b)
 {
     struct block_cache_private *const priv = s3b->data;
     struct block_cache_conf *const config = priv->config;
+    u_int i;
 
-    // Grab lock and sanity check
-    pthread_mutex_lock(&priv->mutex);
-    S3BCACHE_CHECK_INVARIANTS(priv, 1);
-    assert(TAILQ_FIRST(&priv->dirties) == NULL && priv->num_threads == 0);
+    // Sanity check
+    assert(priv->num_dirties == 0 && priv->num_flushes == 0 && priv->num_threads == 0);
+#ifndef NDEBUG
+    for (i = 0; i < priv->num_shards; i++) {
+        pthread_mutex_lock(&priv->shards[i].mutex);
+        S3BCACHE_CHECK_INVARIANTS(priv, &priv->shards[i], 1);
+        assert(TAILQ_FIRST(&priv->shards[i].dirties) == NULL);
+        CHECK_RETURN(pthread_mutex_unlock(&priv->shards[i].mutex));
+    }
+#endif
 
     // Destroy inner store
     (*priv->inner->destroy)(priv->inner);
@@ -614,14 +978,16 @@ block_cache_destroy(struct s3backer_store *const s3b)
     // Free structures
     if (config->cache_file != NULL)
         s3b_dcache_close(priv->dcache);
-    s3b_hash_foreach(priv->hashtable, block_cache_free_one, priv);
-    s3b_hash_destroy(priv->hashtable);
-    pthread_cond_destroy(&priv->write_complete);
+    for (i = 0; i < priv->num_shards; i++) {
+        s3b_hash_foreach(priv->shards[i].hashtable, block_cache_free_one, priv);
+        block_cache_destroy_shard(&priv->shards[i]);
+    }
+    free(priv->shards);
+    block_list_free(&priv->prefetches);
+    pthread_cond_destroy(&priv->dirty_space);
     pthread_cond_destroy(&priv->worker_exit);
     pthread_cond_destroy(&priv->worker_work);
-    pthread_cond_destroy(&priv->end_reading);
-    pthread_cond_destroy(&priv->space_avail);
-    CHECK_RETURN(pthread_mutex_unlock(&priv->mutex));
+    pthread_mutex_destroy(&priv->dcache_mutex);
     pthread_mutex_destroy(&priv->mutex);
     free(priv->threads);
     free(priv);
@@ -632,22 +998,52 @@ void
 block_cache_get_stats(struct s3backer_store *s3b, struct block_cache_stats *stats)
 {
     struct block_cache_private *const priv = s3b->data;
+    u_int i;
 
-    pthread_mutex_lock(&priv->mutex);
-    memcpy(stats, &priv->stats, sizeof(*stats));
-    stats->current_size = s3b_hash_size(priv->hashtable);
+    memset(stats, 0, sizeof(*stats));
+    for (i = 0; i < priv->num_shards; i++) {
+        struct block_cache_shard *const shard = &priv->shards[i];
+
+        pthread_mutex_lock(&shard->mutex);
+        stats->initial_size += shard->stats.initial_size;
+        stats->current_size += s3b_hash_size(shard->hashtable);
+        stats->read_hits += shard->stats.read_hits;
+        stats->read_misses += shard->stats.read_misses;
+        stats->write_hits += shard->stats.write_hits;
+        stats->write_misses += shard->stats.write_misses;
+        stats->verified += shard->stats.verified;
+        stats->mismatch += shard->stats.mismatch;
+        stats->out_of_memory_errors += shard->stats.out_of_memory_errors;
+        CHECK_RETURN(pthread_mutex_unlock(&shard->mutex));
+    }
     stats->dirty_ratio = block_cache_dirty_ratio(priv);
-    CHECK_RETURN(pthread_mutex_unlock(&priv->mutex));
+    latency_hist_copy(&stats->hit_latency, &priv->hit_latency);
+    latency_hist_copy(&stats->miss_latency, &priv->miss_latency);
+    latency_hist_copy(&stats->space_wait_latency, &priv->space_wait_latency);
+    latency_hist_copy(&stats->dirty_wait_latency, &priv->dirty_wait_latency);
+    if (priv->dcache != NULL)
+        s3b_dcache_get_stats(priv->dcache, &stats->dcache_read_latency, &stats->dcache_write_latency, &stats->dcache_fsync_latency);
 }
 
 void
 block_cache_clear_stats(struct s3backer_store *s3b)
 {
     struct block_cache_private *const priv = s3b->data;
+    u_int i;
 
-    pthread_mutex_lock(&priv->mutex);
-    memset(&priv->stats, 0, sizeof(priv->stats));
-    CHECK_RETURN(pthread_mutex_unlock(&priv->mutex));
+    for (i = 0; i < priv->num_shards; i++) {
+        struct block_cache_shard *const shard = &priv->shards[i];
+
+        pthread_mutex_lock(&shard->mutex);
+        memset(&shard->stats, 0, sizeof(shard->stats));
+        CHECK_RETURN(pthread_mutex_unlock(&shard->mutex));
+    }
+    latency_hist_clear(&priv->hit_latency);
+    latency_hist_clear(&priv->miss_latency);
+    latency_hist_clear(&priv->space_wait_latency);
+    latency_hist_clear(&priv->dirty_wait_latency);
+    if (priv->dcache != NULL)
+        s3b_dcache_clear_stats(priv->dcache);
 }
 
 static int
@@ -655,42 +1051,47 @@ block_cache_survey_non_zero(struct s3backer_store *s3b, block_list_func_t *callb
 {
     struct block_cache_private *const priv = s3b->data;
     struct block_list list;
-    int r;
-
-    // Lock mutex
-    pthread_mutex_lock(&priv->mutex);
-    assert(priv->survey_callback == NULL);
-
-    // Record survey in progress
-    priv->survey_callback = callback;
-    priv->survey_arg = arg;
+    u_int i;
+    int r = 0;
 
-    // Inventory all blocks currently in the cache; we don't bother trying to discern the zero blocks
+    // Record survey in progress and inventory all blocks currently in the cache, one shard at a time
     block_list_init(&list);
-    if ((r = s3b_hash_foreach(priv->hashtable, block_cache_append_block_list, &list)) != 0)
+    for (i = 0; i < priv->num_shards; i++) {
+        struct block_cache_shard *const shard = &priv->shards[i];
+
+        pthread_mutex_lock(&shard->mutex);
+        assert(shard->survey_callback == NULL);
+        shard->survey_callback = callback;
+        shard->survey_arg = arg;
+
+        // We don't bother trying to discern the zero blocks
+        if (r == 0)
+            r = s3b_hash_foreach(shard->hashtable, block_cache_append_block_list, &list);
+        CHECK_RETURN(pthread_mutex_unlock(&shard->mutex));
+    }
+    if (r != 0)
         goto done;
 
-    // Unlock mutex
-    CHECK_RETURN(pthread_mutex_unlock(&priv->mutex));
-
     // Report all blocks inventoried above
     (*callback)(arg, list.blocks, list.num_blocks);
-    block_list_free(&list);
 
     // Invoke lower layer
     r = (*priv->inner->survey_non_zero)(priv->inner, callback, arg);
 
-    // Lock mutex
-    pthread_mutex_lock(&priv->mutex);
-
+done:
     // Finish up
-    assert(priv->survey_callback != NULL);
-    priv->survey_callback = NULL;
-    priv->survey_arg = NULL;
+    block_list_free(&list);
+    for (i = 0; i < priv->num_shards; i++) {
+        struct block_cache_shard *const shard = &priv->shards[i];
+
+        pthread_mutex_lock(&shard->mutex);
+        assert(shard->survey_callback != NULL);
+        shard->survey_callback = NULL;
+        shard->survey_arg = NULL;
+        CHECK_RETURN(pthread_mutex_unlock(&shard->mutex));
+    }
 
-done:
     // Done
-    CHECK_RETURN(pthread_mutex_unlock(&priv->mutex));
     return r;
 }
 
@@ -703,17 +1104,80 @@ block_cache_append_block_list(void *arg, void *value)
     return block_list_append(list, entry->block_num);
 }
 
+/*
+ * Blocks that have not yet been written to the lower layer could be non-zero, no matter what the
+ * lower layer says; otherwise, the lower layer is up to date.
+ */
 static int
-block_cache_read_block(struct s3backer_store *const s3b, s3b_block_t block_num, void *dest,
-  u_char *actual_etag, const u_char *expect_etag, int strict)
+block_cache_block_status(struct s3backer_store *s3b, s3b_block_t block_num, u_int num_blocks, int *zerop, u_int *countp)
 {
     struct block_cache_private *const priv = s3b->data;
-    struct block_cache_conf *const config = priv->config;
+    u_int count;
+    int r;
 
-    assert(expect_etag == NULL);
-    assert(actual_etag == NULL);
-    return block_cache_read(priv, block_num, 0, config->block_size, dest);
-}
+    // Report any leading unwritten blocks
+    for (count = 0; count < num_blocks && block_cache_unwritten(priv, block_num + count); count++)
+        ;
+    if (count > 0) {
+        *zerop = 0;
+        *countp = count;
+        return 0;
+    }
+
+    // Ask the lower layer, and stop any zero range at the first unwritten block
+    if ((r = (*priv->inner->block_status)(priv->inner, block_num, num_blocks, zerop, countp)) != 0)
+        return r;
+    if (*zerop) {
+        for (count = 1; count < *countp && !block_cache_unwritten(priv, block_num + count); count++)
+            ;
+        *countp = count;
+    }
+    return 0;
+}
+
+// Determine whether a block is DIRTY, WRITING, or WRITING2
+static int
+block_cache_unwritten(struct block_cache_private *priv, s3b_block_t block_num)
+{
+    struct block_cache_shard *shard;
+    struct cache_entry *entry;
+    int unwritten;
+
+    // Avoid the lookup in the common case
+    if (ATOMIC_LOAD(priv->num_dirties) == 0)
+        return 0;
+
+    // Check the cache entry, if any
+    shard = block_cache_shard(priv, block_num);
+    pthread_mutex_lock(&shard->mutex);
+    if ((entry = s3b_hash_get(shard->hashtable, block_num)) != NULL) {
+        switch (ENTRY_GET_STATE(entry)) {
+        case DIRTY:
+        case WRITING:
+        case WRITING2:
+            unwritten = 1;
+            break;
+        default:
+            unwritten = 0;
+            break;
+        }
+    } else
+        unwritten = 0;
+    CHECK_RETURN(pthread_mutex_unlock(&shard->mutex));
+    return unwritten;
+}
+
+static int
+block_cache_read_block(struct s3backer_store *const s3b, s3b_block_t block_num, void *dest,
+  u_char *actual_etag, const u_char *expect_etag, int strict)
+{
+    struct block_cache_private *const priv = s3b->data;
+    struct block_cache_conf *const config = priv->config;
+
+    assert(expect_etag == NULL);
+    assert(actual_etag == NULL);
+    return block_cache_read(priv, block_num, 0, config->block_size, dest);
+}
 
 static int
 block_cache_read_block_part(struct s3backer_store *s3b, s3b_block_t block_num, u_int off, u_int len, void *dest)
@@ -738,83 +1202,308 @@ static int
 block_cache_read(struct block_cache_private *const priv, s3b_block_t block_num, u_int off, u_int len, void *dest)
 {
     struct block_cache_conf *const config = priv->config;
+    struct block_cache_shard *const shard = block_cache_shard(priv, block_num);
+    int sequential;
     int r;
 
+    // Sanity check
+    if (ATOMIC_LOAD(priv->num_threads) == 0) {
+        (*config->log)(LOG_ERR, "block_cache_read(): no threads created yet");
+        return ENOTCONN;
+    }
+
     // Grab lock
-    pthread_mutex_lock(&priv->mutex);
-    S3BCACHE_CHECK_INVARIANTS(priv, 0);
+    pthread_mutex_lock(&shard->mutex);
+    S3BCACHE_CHECK_INVARIANTS(priv, shard, 0);
+
+    // Update read-ahead state
+    sequential = block_cache_track_sequential(priv, shard, block_num);
+
+    // Peform the read
+    r = block_cache_do_read(priv, shard, block_num, off, len, dest, 1, sequential);
+
+    // Release lock
+    CHECK_RETURN(pthread_mutex_unlock(&shard->mutex));
+    return r;
+}
+
+/*
+ * Read a range of blocks.
+ *
+ * Any blocks not already in the cache are handed off to the worker threads so they can be read from the
+ * underlying s3backer_store concurrently. Then we read the blocks in order as usual; for blocks whose reads
+ * were started by some worker thread, we'll just wait for them to complete (in state READING).
+ */
+static int
+block_cache_read_blocks(struct s3backer_store *const s3b, s3b_block_t block_num, u_int num_blocks, void *dest)
+{
+    struct block_cache_private *const priv = s3b->data;
+    struct block_cache_conf *const config = priv->config;
+    struct block_cache_shard *shard;
+    u_int i;
+    int r = 0;
 
     // Sanity check
-    if (priv->num_threads == 0) {
-        (*config->log)(LOG_ERR, "block_cache_read(): no threads created yet");
-        r = ENOTCONN;
-        goto done;
+    if (ATOMIC_LOAD(priv->num_threads) == 0) {
+        (*config->log)(LOG_ERR, "block_cache_read_blocks(): no threads created yet");
+        return ENOTCONN;
+    }
+
+    /*
+     * Queue up uncached blocks for the worker threads, except for the first block which we're about to read
+     * ourselves. Don't bother if the range is so large that blocks read early would likely get evicted before
+     * we got around to copying them.
+     */
+    if (num_blocks > 1 && num_blocks <= config->cache_size / 2)
+        (void)block_cache_queue_prefetches(priv, block_num + 1, num_blocks - 1);
+
+    // Read the blocks
+    for (i = 0; i < num_blocks; i++) {
+        int sequential;
+
+        shard = block_cache_shard(priv, block_num + i);
+        pthread_mutex_lock(&shard->mutex);
+        S3BCACHE_CHECK_INVARIANTS(priv, shard, 0);
+        sequential = block_cache_track_sequential(priv, shard, block_num + i);
+        r = block_cache_do_read(priv, shard, block_num + i, 0, config->block_size, dest, 1, sequential);
+        CHECK_RETURN(pthread_mutex_unlock(&shard->mutex));
+        if (r != 0)
+            break;
+        dest = (char *)dest + config->block_size;
+    }
+
+    // Done
+    return r;
+}
+
+/*
+ * Queue up blocks for the worker threads to read into the cache, without waiting for them.
+ *
+ * If the range is larger than half the cache, only the first part of it is loaded, because blocks
+ * read early would likely get evicted before the end of the range was reached.
+ */
+static int
+block_cache_prefetch_blocks(struct s3backer_store *const s3b, s3b_block_t block_num, u_int num_blocks)
+{
+    struct block_cache_private *const priv = s3b->data;
+    struct block_cache_conf *const config = priv->config;
+
+    // Sanity check
+    if (ATOMIC_LOAD(priv->num_threads) == 0) {
+        (*config->log)(LOG_ERR, "block_cache_prefetch_blocks(): no threads created yet");
+        return ENOTCONN;
+    }
+
+    // Queue blocks
+    if (num_blocks > config->cache_size / 2)
+        num_blocks = config->cache_size / 2;
+    (void)block_cache_queue_prefetches(priv, block_num, num_blocks);
+    return 0;
+}
+
+/*
+ * Queue up the uncached blocks in the given range for the worker threads. Workers take blocks from the
+ * end of the list, so add them in reverse order. If we run out of memory, we just queue fewer blocks.
+ * The queue is limited to half the cache; whatever doesn't fit is dropped from the end of the range.
+ *
+ * Returns the number of blocks queued. The global mutex must not be held.
+ */
+static u_int
+block_cache_queue_prefetches(struct block_cache_private *priv, s3b_block_t block_num, u_int num_blocks)
+{
+    struct block_cache_conf *const config = priv->config;
+    const u_int max_queued = config->cache_size / 2;
+    struct block_cache_shard *shard;
+    u_int num_queued = 0;
+    int cached;
+    u_int i;
+    int r;
+
+    // Don't let repeated or overlapping requests grow the queue without bound
+    pthread_mutex_lock(&priv->mutex);
+    if (priv->prefetches.num_blocks >= max_queued)
+        num_blocks = 0;
+    else if (num_blocks > max_queued - priv->prefetches.num_blocks)
+        num_blocks = max_queued - priv->prefetches.num_blocks;
+    CHECK_RETURN(pthread_mutex_unlock(&priv->mutex));
+
+    // Queue blocks
+    for (i = num_blocks; i-- > 0; ) {
+        shard = block_cache_shard(priv, block_num + i);
+        pthread_mutex_lock(&shard->mutex);
+        cached = s3b_hash_get(shard->hashtable, block_num + i) != NULL;
+        CHECK_RETURN(pthread_mutex_unlock(&shard->mutex));
+        if (cached)
+            continue;
+        pthread_mutex_lock(&priv->mutex);
+        r = priv->prefetches.num_blocks < max_queued ? block_list_append(&priv->prefetches, block_num + i) : ENOSPC;
+        CHECK_RETURN(pthread_mutex_unlock(&priv->mutex));
+        if (r != 0)
+            break;                                                      // not fatal, we'll just read fewer
+        num_queued++;
+    }
+    if (num_queued > 0)
+        block_cache_wake_workers(priv, 1);
+    return num_queued;
+}
+
+/*
+ * Update count of block(s) read sequentially by the upper layer, and start read-ahead if needed.
+ *
+ * Returns non-zero if this read continues a sequential stream (including re-reading its last block).
+ *
+ * Assumes the mutex for the block's shard is held; the global mutex must not be held.
+ */
+static int
+block_cache_track_sequential(struct block_cache_private *const priv, struct block_cache_shard *shard, s3b_block_t block_num)
+{
+    struct block_cache_conf *const config = priv->config;
+    const uint64_t now = block_cache_get_time_micros();
+    struct read_stream *stream = NULL;
+    struct cache_entry *entry;
+    uint64_t target;
+    int waiting;
+    int i;
+
+    // Will the upper layer have to wait for this block?
+    entry = s3b_hash_get(shard->hashtable, block_num);
+    waiting = entry == NULL || ENTRY_GET_STATE(entry) == READING || ENTRY_GET_STATE(entry) == READING2;
+
+    // Grab global lock
+    pthread_mutex_lock(&priv->mutex);
+
+    // Find the stream this read belongs to, if any, otherwise the least recently used stream
+    for (i = 0; i < MAX_READ_STREAMS; i++) {
+        struct read_stream *const candidate = &priv->streams[i];
+
+        if (candidate->count > 0 && (block_num == candidate->last + 1 || block_num == candidate->last)) {
+            stream = candidate;
+            break;
+        }
+        if (stream == NULL || candidate->last_micros < stream->last_micros)
+            stream = candidate;
+    }
+
+    // Start a new stream if necessary
+    if (i == MAX_READ_STREAMS) {
+        memset(stream, 0, sizeof(*stream));
+        stream->last = block_num;
+        stream->count = 1;
+        stream->window = config->read_ahead;
+        stream->last_micros = now;
+        CHECK_RETURN(pthread_mutex_unlock(&priv->mutex));
+        return 0;
+    }
+
+    // Re-reading the same block (e.g., a smaller read from the upper layer) doesn't advance anything
+    if (block_num == stream->last) {
+        CHECK_RETURN(pthread_mutex_unlock(&priv->mutex));
+        return 1;
     }
 
     // Update count of block(s) read sequentially by the upper layer
-    if (block_num == priv->seq_last + 1) {
-        priv->seq_count++;
-        if (priv->ra_count > 0)
-            priv->ra_count--;
-    } else if (block_num != priv->seq_last) {
-        priv->seq_count = 1;
-        priv->ra_count = 0;
+    stream->count++;
+    if (stream->ra_count > 0)
+        stream->ra_count--;
+    stream->last = block_num;
+    if (stream->interval == 0)
+        stream->interval = now - stream->last_micros;
+    else
+        stream->interval += ((int64_t)(now - stream->last_micros) - (int64_t)stream->interval) >> EWMA_SHIFT;
+    stream->last_micros = now;
+
+    // Adapt read-ahead window: grow if the upper layer is about to wait for this block, else shrink if too large
+    if (stream->window > 0 && stream->count > config->read_ahead_trigger) {
+        if (waiting)
+            stream->window = stream->window * 2 < priv->ra_max ? stream->window * 2 : priv->ra_max;
+        else {
+            target = stream->interval > 0 ? priv->read_latency / stream->interval + 1 : priv->ra_max;
+            if (stream->window > target && stream->window > 1)
+                stream->window--;
+        }
     }
-    priv->seq_last = block_num;
 
     // Wakeup a worker thread to read the next read-ahead block if needed
-    if (priv->seq_count >= config->read_ahead_trigger && priv->ra_count < config->read_ahead)
+    if (stream->count >= config->read_ahead_trigger && stream->ra_count < stream->window) {
+        priv->work_gen++;
         pthread_cond_signal(&priv->worker_work);
+    }
 
-    // Peform the read
-    r = block_cache_do_read(priv, block_num, off, len, dest, 1);
-
-done:
-    // Release lock
+    // Release global lock
     CHECK_RETURN(pthread_mutex_unlock(&priv->mutex));
-    return r;
+    return 1;
+}
+
+/*
+ * Find a sequential read stream that needs more read-ahead, if any.
+ *
+ * Assumes the global mutex is held.
+ */
+static struct read_stream *
+block_cache_read_ahead_stream(struct block_cache_private *const priv)
+{
+    struct block_cache_conf *const config = priv->config;
+    int i;
+
+    for (i = 0; i < MAX_READ_STREAMS; i++) {
+        struct read_stream *const stream = &priv->streams[i];
+
+        if (stream->count > 0 && stream->count >= config->read_ahead_trigger && stream->ra_count < stream->window)
+            return stream;
+    }
+    return NULL;
 }
 
 /*
  * Read a block or a portion thereof.
  *
- * Assumes the mutex is held.
+ * If "sequential" is false, a cache hit counts as a re-reference of the block for the purpose of scan_resistant.
+ *
+ * Assumes the mutex for the block's shard is held.
  */
 static int
-block_cache_do_read(struct block_cache_private *const priv, s3b_block_t block_num, u_int off, u_int len, void *dest, int stats)
+block_cache_do_read(struct block_cache_private *const priv, struct block_cache_shard *shard, s3b_block_t block_num,
+  u_int off, u_int len, void *dest, int stats, int sequential)
 {
     struct block_cache_conf *const config = priv->config;
-    struct list_head *const cleans_list = block_cache_cleans_list(priv, block_num);
+    const int temp_data = config->cache_file != NULL && !config->use_mmap;
+    struct partial_block *partial;
     struct cache_entry *entry;
     u_char etag[MD5_DIGEST_LENGTH];
+    const uint64_t begin_micros = stats ? block_cache_get_time_micros() : 0;
     int verified_but_not_read = 0;
+    uint64_t start_micros;
     void *data = NULL;
+    int missed = 0;
     int r;
 
     // Sanity check
     assert(off <= priv->config->block_size);
     assert(len <= priv->config->block_size);
     assert(off + len <= priv->config->block_size);
+    assert(shard == block_cache_shard(priv, block_num));
 
 again:
     // Check to see if a cache entry already exists
-    if ((entry = s3b_hash_get(priv->hashtable, block_num)) != NULL) {
+    if ((entry = s3b_hash_get(shard->hashtable, block_num)) != NULL) {
         assert(entry->block_num == block_num);
         switch (ENTRY_GET_STATE(entry)) {
         case READING:       // Wait for other thread already reading this block to finish
         case READING2:
-            pthread_cond_wait(&priv->end_reading, &priv->mutex);
+            pthread_cond_wait(&shard->end_reading, &shard->mutex);
             goto again;
         case CLEAN2:        // Go into READING2 state to read/verify the data
 
-            // Allocate temporary buffer for reading the data if necessary
-            if (config->cache_file != NULL) {
-                if ((data = malloc(config->block_size)) == NULL) {
+            // Allocate temporary buffer for reading the data if necessary; with a memory mapped disk cache, read in place
+            if (temp_data) {
+                if ((data = s3b_pool_alloc(shard->data_pool)) == NULL) {
                     r = errno;
                     (*config->log)(LOG_ERR, "can't allocate block cache buffer: %s", strerror(r));
                     return r;
                 }
-            } else
+            } else if (config->cache_file != NULL)
+                data = s3b_dcache_block_data(priv->dcache, entry->u.dslot);
+            else
                 data = entry->u.data;
 
             // Change from CLEAN2 to READING2
@@ -822,9 +1511,8 @@ again:
                 if ((r = s3b_dcache_erase_block(priv->dcache, entry->u.dslot)) != 0)
                     (*config->log)(LOG_ERR, "can't erase cached block! %s", strerror(r));
             }
-            TAILQ_REMOVE(cleans_list, entry, link);
+            block_cache_clean_remove(priv, shard, entry);
             ENTRY_RESET_LINK(entry);
-            priv->num_cleans--;
             entry->timeout = READING_TIMEOUT;
             assert(entry->verify);
             assert(ENTRY_GET_STATE(entry) == READING2);
@@ -832,13 +1520,21 @@ again:
             // Now go read/verify the data
             goto read;
         case CLEAN:         // Update timestamp and move to the end of the list to maintain LRU ordering
-            TAILQ_REMOVE(cleans_list, entry, link);
-            TAILQ_INSERT_TAIL(cleans_list, entry, link);
+            block_cache_clean_remove(priv, shard, entry);
+            if (shard->max_hots > 0 && !sequential)
+                entry->hot = 1;
             entry->timeout = block_cache_get_time(priv) + priv->clean_timeout;
+            block_cache_clean_insert(priv, shard, entry);
+            block_cache_demote_hots(priv, shard);
             // FALLTHROUGH
-        case DIRTY:         // Copy the cached data
+        case DIRTY:         // Copy the cached data, unless it's not all there yet
         case WRITING:
         case WRITING2:
+            if (len > 0 && (partial = block_cache_get_partial(shard, block_num)) != NULL
+              && (off < partial->off || off + len > partial->end)) {
+                block_cache_wait_partial(priv, shard, block_num);
+                goto again;
+            }
             if ((r = block_cache_read_data(priv, entry, dest, off, len)) != 0)
                 return r;
             break;
@@ -846,16 +1542,19 @@ again:
             assert(0);
             break;
         }
-        if (stats)
-            priv->stats.read_hits++;
+        if (stats) {
+            shard->stats.read_hits++;
+            latency_hist_record(missed ? &priv->miss_latency : &priv->hit_latency,
+              block_cache_get_time_micros() - begin_micros);
+        }
         return 0;
     }
 
     // Create a new cache entry in state READING
-    if ((r = block_cache_get_entry(priv, &entry, &data)) != 0)
+    if ((r = block_cache_get_entry(priv, shard, &entry, &data)) != 0)
         return r;
     if (entry == NULL) {                                            // no free entries right now
-        pthread_cond_wait(&priv->space_avail, &priv->mutex);
+        block_cache_wait_space(priv, shard);
         goto again;
     }
     entry->block_num = block_num;
@@ -863,27 +1562,38 @@ again:
     entry->verify = 0;
     entry->timeout = READING_TIMEOUT;
     ENTRY_RESET_LINK(entry);
-    s3b_hash_put_new(priv->hashtable, entry);
+    s3b_hash_put_new(shard->hashtable, entry);
     assert(ENTRY_GET_STATE(entry) == READING);
 
     // Update stats
     if (stats)
-        priv->stats.read_misses++;
+        shard->stats.read_misses++;
 
     // Conservatively disqualify this block as zero in any ongoing non-zero survey
-    if (priv->survey_callback != NULL)
-        (*priv->survey_callback)(priv->survey_arg, &block_num, 1);
+    if (shard->survey_callback != NULL)
+        (*shard->survey_callback)(shard->survey_arg, &block_num, 1);
 
 read:
     // Read the block from the underlying s3backer_store
     assert(ENTRY_GET_STATE(entry) == READING || ENTRY_GET_STATE(entry) == READING2);
-    CHECK_RETURN(pthread_mutex_unlock(&priv->mutex));
+    missed = 1;
+    start_micros = block_cache_get_time_micros();
+    CHECK_RETURN(pthread_mutex_unlock(&shard->mutex));
     r = (*priv->inner->read_block)(priv->inner, block_num, data, etag, entry->verify ? entry->etag : NULL, 0);
-    pthread_mutex_lock(&priv->mutex);
-    S3BCACHE_CHECK_INVARIANTS(priv, 0);
+    pthread_mutex_lock(&shard->mutex);
+    S3BCACHE_CHECK_INVARIANTS(priv, shard, 1);
+
+    // Update average read latency, which determines how much read-ahead we need
+    if (r == 0) {
+        const int64_t latency = (int64_t)(block_cache_get_time_micros() - start_micros);
+
+        pthread_mutex_lock(&priv->mutex);
+        priv->read_latency += (latency - (int64_t)priv->read_latency) >> EWMA_SHIFT;
+        CHECK_RETURN(pthread_mutex_unlock(&priv->mutex));
+    }
 
     // The entry should still exist and be in state READING[2]
-    assert(s3b_hash_get(priv->hashtable, block_num) == entry);
+    assert(s3b_hash_get(shard->hashtable, block_num) == entry);
     assert(ENTRY_GET_STATE(entry) == READING || ENTRY_GET_STATE(entry) == READING2);
     assert(config->cache_file != NULL || entry->u.data == data);
 
@@ -892,8 +1602,8 @@ read:
      * change from READING[2] and we will create new available space
      * in the cache. Wake up any threads waiting on those events.
      */
-    pthread_cond_broadcast(&priv->end_reading);
-    pthread_cond_signal(&priv->space_avail);
+    pthread_cond_broadcast(&shard->end_reading);
+    pthread_cond_signal(&shard->space_avail);
 
     // Check for unexpected error from underlying s3backer_store
     if (r != 0 && !(entry->verify && r == EEXIST))
@@ -902,16 +1612,16 @@ read:
     // Handle READING2 blocks that were verified (revert to READING)
     if (entry->verify) {
         if (r == EEXIST) {                  // ETag matched our expectation, download avoided
-            priv->stats.read_hits++;
-            priv->stats.verified++;
+            shard->stats.read_hits++;
+            shard->stats.verified++;
             verified_but_not_read = 1;
             r = 0;
         } else {
             assert(r == 0);
-            priv->stats.read_misses++;
-            priv->stats.mismatch++;
+            shard->stats.read_misses++;
+            shard->stats.mismatch++;
         }
-        entry = block_cache_verified(priv, entry);
+        entry = block_cache_verified(priv, shard, entry);
         assert(ENTRY_GET_STATE(entry) == READING);
     }
 
@@ -919,25 +1629,23 @@ read:
     if (!verified_but_not_read)
         memcpy(dest, (char *)data + off, len);
 
-    // Copy data into the disk cache and free temporary buffer (if necessary)
-    if (config->cache_file != NULL) {
-        if (!verified_but_not_read) {
-            if ((r = s3b_dcache_write_block(priv->dcache, entry->u.dslot, data, 0, config->block_size)) != 0)
-                goto fail;
-        }
-        free(data);
-    }
-
-    // Change entry from READING to CLEAN
+    // Copy data into the disk cache (if necessary) and record it there, then free temporary buffer (if any)
     assert(ENTRY_GET_STATE(entry) == READING);
     assert(!entry->verify);
-    if (config->cache_file != NULL) {
+    if (temp_data && !verified_but_not_read) {
+        if ((r = s3b_dcache_store_block(priv->dcache, entry->u.dslot, entry->block_num, data, etag)) != 0)
+            goto fail;
+    } else if (config->cache_file != NULL) {
         if ((r = s3b_dcache_record_block(priv->dcache, entry->u.dslot, entry->block_num, etag)) != 0)
             (*config->log)(LOG_ERR, "can't record cached block! %s", strerror(r));
     }
+    if (temp_data)
+        s3b_pool_free(shard->data_pool, data);
+
+    // Change entry from READING to CLEAN
     entry->timeout = block_cache_get_time(priv) + priv->clean_timeout;
-    TAILQ_INSERT_TAIL(cleans_list, entry, link);
-    priv->num_cleans++;
+    block_cache_clean_insert(priv, shard, entry);
+    block_cache_demote_hots(priv, shard);
     assert(ENTRY_GET_STATE(entry) == CLEAN);
 
     // If data was only verified, we have to actually go read it now
@@ -945,16 +1653,22 @@ read:
         goto again;
 
     // Done
+    if (stats)
+        latency_hist_record(&priv->miss_latency, block_cache_get_time_micros() - begin_micros);
     return 0;
 
 fail:
     assert(r != 0);
     assert(ENTRY_GET_STATE(entry) == READING || ENTRY_GET_STATE(entry) == READING2);
-    if (config->cache_file != NULL)
+    if (config->cache_file != NULL) {
+        pthread_mutex_lock(&priv->dcache_mutex);
         s3b_dcache_free_block(priv->dcache, entry->u.dslot);
-    s3b_hash_remove(priv->hashtable, entry->block_num);
-    free(data);
-    free(entry);
+        CHECK_RETURN(pthread_mutex_unlock(&priv->dcache_mutex));
+    }
+    s3b_hash_remove(shard->hashtable, entry->block_num);
+    if (config->cache_file == NULL || temp_data)
+        s3b_pool_free(shard->data_pool, data);
+    block_cache_release_entry(shard, entry);
     return r;
 }
 
@@ -985,6 +1699,45 @@ block_cache_write_block_part(struct s3backer_store *s3b, s3b_block_t block_num,
     return block_cache_write(priv, block_num, off, len, src);
 }
 
+/*
+ * Write a range of blocks.
+ *
+ * All of the blocks are entered into the cache before waiting for any of them to be written.
+ */
+static int
+block_cache_write_blocks(struct s3backer_store *const s3b, s3b_block_t block_num, u_int num_blocks, const void *src)
+{
+    struct block_cache_private *const priv = s3b->data;
+    struct block_cache_conf *const config = priv->config;
+    struct block_cache_shard *shard;
+    u_int i;
+    int r = 0;
+
+    // Write the blocks
+    for (i = 0; i < num_blocks; i++) {
+        shard = block_cache_shard(priv, block_num + i);
+        pthread_mutex_lock(&shard->mutex);
+        r = block_cache_do_write(priv, shard, block_num + i, 0, config->block_size, src);
+        CHECK_RETURN(pthread_mutex_unlock(&shard->mutex));
+        if (r != 0)
+            return r;
+        src = (const char *)src + config->block_size;
+    }
+
+    // If doing synchronous writes, wait for all of the writes to complete
+    if (config->synchronous) {
+        for (i = 0; i < num_blocks; i++) {
+            shard = block_cache_shard(priv, block_num + i);
+            pthread_mutex_lock(&shard->mutex);
+            block_cache_wait_written(priv, shard, block_num + i);
+            CHECK_RETURN(pthread_mutex_unlock(&shard->mutex));
+        }
+    }
+
+    // Done
+    return 0;
+}
+
 /*
  * Write a block or a portion thereof.
  */
@@ -992,7 +1745,35 @@ static int
 block_cache_write(struct block_cache_private *const priv, s3b_block_t block_num, u_int off, u_int len, const void *src)
 {
     struct block_cache_conf *const config = priv->config;
-    struct list_head *const cleans_list = block_cache_cleans_list(priv, block_num);
+    struct block_cache_shard *const shard = block_cache_shard(priv, block_num);
+    int r;
+
+    // Grab lock
+    pthread_mutex_lock(&shard->mutex);
+
+    // Perform the write
+    r = block_cache_do_write(priv, shard, block_num, off, len, src);
+
+    // If doing synchronous writes, wait for write to complete
+    if (r == 0 && config->synchronous)
+        block_cache_wait_written(priv, shard, block_num);
+
+    // Release lock
+    CHECK_RETURN(pthread_mutex_unlock(&shard->mutex));
+    return r;
+}
+
+/*
+ * Write a block or a portion thereof into the cache.
+ *
+ * Assumes the mutex for the block's shard is held.
+ */
+static int
+block_cache_do_write(struct block_cache_private *const priv, struct block_cache_shard *shard, s3b_block_t block_num,
+  u_int off, u_int len, const void *src)
+{
+    struct block_cache_conf *const config = priv->config;
+    struct partial_block *partial;
     struct cache_entry *entry;
     int partial_miss = 0;
     int r;
@@ -1001,36 +1782,32 @@ block_cache_write(struct block_cache_private *const priv, s3b_block_t block_num,
     assert(off <= config->block_size);
     assert(len <= config->block_size);
     assert(off + len <= config->block_size);
-
-    // Grab lock
-    pthread_mutex_lock(&priv->mutex);
+    assert(shard == block_cache_shard(priv, block_num));
 
 again:
     // Sanity check
-    S3BCACHE_CHECK_INVARIANTS(priv, 0);
-    if (priv->num_threads == 0) {
+    S3BCACHE_CHECK_INVARIANTS(priv, shard, 0);
+    if (ATOMIC_LOAD(priv->num_threads) == 0) {
         (*config->log)(LOG_ERR, "block_cache_write(): no threads created yet");
-        r = ENOTCONN;
-        goto fail;
+        return ENOTCONN;
     }
 
     // Find cache entry
-    if ((entry = s3b_hash_get(priv->hashtable, block_num)) != NULL) {
+    if ((entry = s3b_hash_get(shard->hashtable, block_num)) != NULL) {
         assert(entry->block_num == block_num);
         switch (ENTRY_GET_STATE(entry)) {
         case READING:               // wait for entry to leave READING
         case READING2:
-            pthread_cond_wait(&priv->end_reading, &priv->mutex);
+            pthread_cond_wait(&shard->end_reading, &shard->mutex);
             goto again;
         case CLEAN2:                // convert to CLEAN, then proceed
-            entry = block_cache_verified(priv, entry);
+            entry = block_cache_verified(priv, shard, entry);
             // FALLTHROUGH
         case CLEAN:                // update data, move to state DIRTY
 
             // If there are too many dirty blocks, we have to wait
-            if (config->max_dirty != 0 && priv->num_dirties >= config->max_dirty) {
-                pthread_cond_signal(&priv->worker_work);
-                pthread_cond_wait(&priv->write_complete, &priv->mutex);
+            if (config->max_dirty != 0 && ATOMIC_LOAD(priv->num_dirties) >= config->max_dirty) {
+                block_cache_wait_dirty_space(priv, shard);
                 goto again;
             }
 
@@ -1040,76 +1817,108 @@ again:
                     (*config->log)(LOG_ERR, "can't dirty cached block %u! %s", block_num,  strerror(r));
             }
 
-            // Change from CLEAN to DIRTY
-            TAILQ_REMOVE(cleans_list, entry, link);
-            priv->num_cleans--;
-            TAILQ_INSERT_TAIL(&priv->dirties, entry, link);
-            priv->num_dirties++;
+            // Change from CLEAN to DIRTY (a hot block stays hot, and will return to its hot list once clean)
+            block_cache_clean_remove(priv, shard, entry);
+            TAILQ_INSERT_TAIL(&shard->dirties, entry, link);
+            shard->num_dirties++;
+            ATOMIC_ADD(priv->num_dirties, 1);
             entry->timeout = block_cache_get_time(priv) + priv->dirty_timeout;
-            pthread_cond_signal(&priv->worker_work);
+            block_cache_wake_workers(priv, 0);
             // FALLTHROUGH
         case WRITING2:              // update data, stay in state WRITING2
         case WRITING:               // update data, move to state WRITING2
         case DIRTY:                 // update data, stay in state DIRTY
+
+            // If the block is only partially valid, the valid range must stay contiguous
+            if ((partial = block_cache_get_partial(shard, block_num)) != NULL) {
+                if (off > partial->end || off + len < partial->off) {
+                    block_cache_wait_partial(priv, shard, block_num);
+                    goto again;
+                }
+                if (off < partial->off)
+                    partial->off = off;
+                if (off + len > partial->end)
+                    partial->end = off + len;
+                if (partial->off == 0 && partial->end == config->block_size) {
+                    s3b_hash_remove(shard->partials, block_num);
+                    free(partial);
+                }
+            }
             if ((r = block_cache_write_data(priv, entry, src, off, len)) != 0)
                 (*config->log)(LOG_ERR, "error updating dirty block! %s", strerror(r));
             entry->dirty = 1;
             if (!partial_miss)
-                priv->stats.write_hits++;
+                shard->stats.write_hits++;
             break;
         default:
             assert(0);
             break;
         }
-        goto success;
+        return 0;
     }
 
     // Conservatively disqualify any non-zero block as being zero in any ongoing non-zero survey
-    if (src != NULL && priv->survey_callback != NULL)
-        (*priv->survey_callback)(priv->survey_arg, &block_num, 1);
+    if (src != NULL && shard->survey_callback != NULL)
+        (*shard->survey_callback)(shard->survey_arg, &block_num, 1);
 
     /*
-     * The block is not in the cache. If we're writing a partial block,
-     * we have to read it into the cache first.
+     * The block is not in the cache. If we're writing a partial block, we have to read it
+     * into the cache first, unless we can defer that until the block is written back.
      */
-    if (off != 0 || len != config->block_size) {
-        if ((r = block_cache_do_read(priv, block_num, 0, 0, NULL, 0)) != 0)
-            goto fail;
+    if ((off != 0 || len != config->block_size) && !config->partial_writes) {
+        if ((r = block_cache_do_read(priv, shard, block_num, 0, 0, NULL, 0, 1)) != 0)
+            return r;
         if (partial_miss++ == 0)
-            priv->stats.write_misses++;
+            shard->stats.write_misses++;
         goto again;
     }
 
     // If there are too many dirty blocks, we have to wait
-    if (config->max_dirty != 0 && priv->num_dirties >= config->max_dirty) {
-        pthread_cond_signal(&priv->worker_work);
-        pthread_cond_wait(&priv->write_complete, &priv->mutex);
+    if (config->max_dirty != 0 && ATOMIC_LOAD(priv->num_dirties) >= config->max_dirty) {
+        block_cache_wait_dirty_space(priv, shard);
         goto again;
     }
 
     // Get a cache entry, evicting a CLEAN[2] entry if necessary
-    if ((r = block_cache_get_entry(priv, &entry, NULL)) != 0)
-        goto fail;
+    if ((r = block_cache_get_entry(priv, shard, &entry, NULL)) != 0)
+        return r;
 
     // If cache is full, wait for an entry to go CLEAN[2] so we can evict it
     if (entry == NULL) {
-        pthread_cond_wait(&priv->space_avail, &priv->mutex);
+        block_cache_wait_space(priv, shard);
         goto again;
     }
 
+    // If we're writing a partial block, remember which part of the data is valid
+    if (off != 0 || len != config->block_size) {
+        if ((partial = malloc(sizeof(*partial))) == NULL) {
+            r = errno;
+            (*config->log)(LOG_ERR, "can't allocate partial block record: %s", strerror(r));
+            shard->stats.out_of_memory_errors++;
+            s3b_pool_free(shard->data_pool, entry->u.data);
+            block_cache_release_entry(shard, entry);
+            return r;
+        }
+        partial->block_num = block_num;
+        partial->off = off;
+        partial->end = off + len;
+        s3b_hash_put_new(shard->partials, partial);
+    }
+
     // Record block data
     if ((r = block_cache_write_data(priv, entry, src, off, len)) != 0)
         (*config->log)(LOG_ERR, "error updating dirty block! %s", strerror(r));
 
     // Initialize a new DIRTY cache entry
-    priv->stats.write_misses++;
+    shard->stats.write_misses++;
     entry->block_num = block_num;
     entry->timeout = block_cache_get_time(priv) + priv->dirty_timeout;
     entry->dirty = 1;
-    assert(off == 0 && len == config->block_size);
-    s3b_hash_put_new(priv->hashtable, entry);
-    TAILQ_INSERT_TAIL(&priv->dirties, entry, link);
-    priv->num_dirties++;
+    assert(config->partial_writes || (off == 0 && len == config->block_size));
+    s3b_hash_put_new(shard->hashtable, entry);
+    TAILQ_INSERT_TAIL(&shard->dirties, entry, link);
+    shard->num_dirties++;
+    ATOMIC_ADD(priv->num_dirties, 1);
     assert(ENTRY_GET_STATE(entry) == DIRTY);
 
     // Record dirty disk cache entry
@@ -1119,55 +1928,169 @@ again:
     }
 
     // Wake up a worker thread to go write it
+    block_cache_wake_workers(priv, 0);
+
+    // Done
+    return 0;
+}
+
+/*
+ * Wait for the given block, if dirty, to be written out to the underlying s3backer_store.
+ *
+ * Assumes the mutex for the block's shard is held.
+ */
+static void
+block_cache_wait_written(struct block_cache_private *const priv, struct block_cache_shard *shard, s3b_block_t block_num)
+{
+    struct cache_entry *entry;
+    int state;
+
+    while (1) {
+
+        // Sanity check
+        S3BCACHE_CHECK_INVARIANTS(priv, shard, 0);
+
+        // Find cache entry
+        if ((entry = s3b_hash_get(shard->hashtable, block_num)) == NULL)
+            break;
+
+        // See if it is now clean
+        state = ENTRY_GET_STATE(entry);
+        if (state == CLEAN || state == CLEAN2 || state == READING || state == READING2)
+            break;
+
+        // Not written yet, wait for notification
+        pthread_cond_wait(&shard->write_complete, &shard->mutex);
+    }
+}
+
+/*
+ * Wait for the total number of dirty blocks to drop below config->max_dirty.
+ *
+ * Assumes the mutex for the given shard is held; it is released while waiting.
+ */
+static void
+block_cache_wait_dirty_space(struct block_cache_private *priv, struct block_cache_shard *shard)
+{
+    struct block_cache_conf *const config = priv->config;
+    const uint64_t start_micros = block_cache_get_time_micros();
+
+    CHECK_RETURN(pthread_mutex_unlock(&shard->mutex));
+    pthread_mutex_lock(&priv->mutex);
+    priv->work_gen++;
     pthread_cond_signal(&priv->worker_work);
+    while (ATOMIC_LOAD(priv->num_dirties) >= config->max_dirty && !priv->stopping)
+        pthread_cond_wait(&priv->dirty_space, &priv->mutex);
+    CHECK_RETURN(pthread_mutex_unlock(&priv->mutex));
+    pthread_mutex_lock(&shard->mutex);
+    latency_hist_record(&priv->dirty_wait_latency, block_cache_get_time_micros() - start_micros);
+}
 
-success:
-    // If doing synchronous writes, wait for write to complete
-    if (config->synchronous) {
-        while (1) {
-            int state;
+/*
+ * Wait for a cache entry in the given shard to become available for reuse.
+ *
+ * Assumes the mutex for the given shard is held; it is released while waiting.
+ */
+static void
+block_cache_wait_space(struct block_cache_private *priv, struct block_cache_shard *shard)
+{
+    const uint64_t start_micros = block_cache_get_time_micros();
 
-            // Wait for notification
-            pthread_cond_wait(&priv->write_complete, &priv->mutex);
+    pthread_cond_wait(&shard->space_avail, &shard->mutex);
+    latency_hist_record(&priv->space_wait_latency, block_cache_get_time_micros() - start_micros);
+}
 
-            // Sanity check
-            S3BCACHE_CHECK_INVARIANTS(priv, 0);
+/*
+ * Account for a dirty block having been written.
+ *
+ * Assumes the mutex for the block's shard is held.
+ */
+static void
+block_cache_dirty_done(struct block_cache_private *priv, struct block_cache_shard *shard)
+{
+    struct block_cache_conf *const config = priv->config;
 
-            // Find cache entry
-            if ((entry = s3b_hash_get(priv->hashtable, block_num)) == NULL)
-                break;
+    shard->num_dirties--;
+    ATOMIC_SUB(priv->num_dirties, 1);
+    if (config->max_dirty != 0) {
+        pthread_mutex_lock(&priv->mutex);
+        pthread_cond_broadcast(&priv->dirty_space);
+        CHECK_RETURN(pthread_mutex_unlock(&priv->mutex));
+    }
+}
 
-            // See if it is now clean
-            state = ENTRY_GET_STATE(entry);
-            if (state == CLEAN || state == CLEAN2 || state == READING || state == READING2)
-                break;
+/*
+ * Find the partial block record for a block, if any.
+ *
+ * Assumes the mutex for the block's shard is held.
+ */
+static struct partial_block *
+block_cache_get_partial(struct block_cache_shard *shard, s3b_block_t block_num)
+{
+    if (shard->partials == NULL)
+        return NULL;
+    return s3b_hash_get(shard->partials, block_num);
+}
 
-            // Not written yet, go back to sleep
-            continue;
+/*
+ * Wait for the given block's data to become fully valid, i.e., for a worker thread to merge in
+ * the original block. If the block is still waiting to be written, move it to the front of the line.
+ *
+ * Assumes the mutex for the block's shard is held; it is released while waiting.
+ */
+static void
+block_cache_wait_partial(struct block_cache_private *priv, struct block_cache_shard *shard, s3b_block_t block_num)
+{
+    struct cache_entry *entry;
+
+    while ((entry = s3b_hash_get(shard->hashtable, block_num)) != NULL
+      && block_cache_get_partial(shard, block_num) != NULL) {
+        if (ENTRY_GET_STATE(entry) == DIRTY && (entry != TAILQ_FIRST(&shard->dirties) || entry->timeout != 0)) {
+            TAILQ_REMOVE(&shard->dirties, entry, link);
+            TAILQ_INSERT_HEAD(&shard->dirties, entry, link);
+            entry->timeout = 0;
+            block_cache_wake_workers(priv, 0);
         }
+        pthread_cond_wait(&shard->write_complete, &shard->mutex);
     }
-    r = 0;
+}
 
-fail:
-    // Done
-    CHECK_RETURN(pthread_mutex_unlock(&priv->mutex));
-    return r;
+/*
+ * Merge the original block data into a partially valid entry, preserving the valid range, and discard its partial record.
+ *
+ * Assumes the mutex for the block's shard is held.
+ */
+static void
+block_cache_merge_partial(struct block_cache_private *priv, struct block_cache_shard *shard,
+  struct cache_entry *entry, const void *data)
+{
+    struct block_cache_conf *const config = priv->config;
+    struct partial_block *const partial = s3b_hash_get(shard->partials, entry->block_num);
+
+    assert(config->cache_file == NULL);
+    assert(partial != NULL);
+    memcpy(entry->u.data, data, partial->off);
+    memcpy((char *)entry->u.data + partial->end, (const char *)data + partial->end, config->block_size - partial->end);
+    s3b_hash_remove(shard->partials, entry->block_num);
+    free(partial);
 }
 
 /*
- * Acquire a new cache entry. If the cache is full, and there is at least one
+ * Acquire a new cache entry. If the shard is full, and there is at least one
  * CLEAN[2] entry, evict and return it (uninitialized). Otherwise, return NULL entry.
  *
- * On successful return, *datap will point to a malloc'd buffer for the data. If using
- * the disk cache, this will be a temporary buffer, otherwise it's the in-memory buffer.
- * If datap == NULL, then in the case of the disk cache only, no buffer is allocated.
+ * On successful return, *datap will point to a pooled buffer for the data. If using
+ * the disk cache, this will be a temporary buffer (or the data slot itself, if the disk
+ * cache is memory mapped), otherwise it's the in-memory buffer. If datap == NULL, then
+ * in the case of the disk cache only, no buffer is allocated.
  *
- * This assumes the mutex is held.
+ * This assumes the mutex for the shard is held.
  *
  * Returns non-zero on error.
  */
 static int
-block_cache_get_entry(struct block_cache_private *priv, struct cache_entry **entryp, void **datap)
+block_cache_get_entry(struct block_cache_private *priv, struct block_cache_shard *shard,
+  struct cache_entry **entryp, void **datap)
 {
     struct block_cache_conf *const config = priv->config;
     struct cache_entry *entry;
@@ -1176,36 +2099,35 @@ block_cache_get_entry(struct block_cache_private *priv, struct cache_entry **ent
 
 again:
     /*
-     * If cache is not full, allocate a new entry. We allocate the structure
-     * and the data separately in hopes that the malloc() implementation will
-     * put the data into its own page of virtual memory.
+     * If shard is not full, allocate a new entry. Entries and data buffers come
+     * from separate pools, so data buffers are packed contiguously in their slabs.
      *
-     * If the cache is full, try to evict a clean entry. Evict low priority
-     * blocks before high priority blocks.
+     * If the shard is full, try to evict a clean entry. Evict low priority
+     * blocks before high priority blocks, and non-hot blocks before hot blocks.
      */
-    if (s3b_hash_size(priv->hashtable) < config->cache_size) {
-        if ((entry = calloc(1, sizeof(*entry))) == NULL) {
+    if (s3b_hash_size(shard->hashtable) < shard->cache_size) {
+        if ((entry = block_cache_alloc_entry(shard, 0)) == NULL) {
             r = errno;
             (*config->log)(LOG_ERR, "can't allocate block cache entry: %s", strerror(r));
-            priv->stats.out_of_memory_errors++;
+            shard->stats.out_of_memory_errors++;
             return r;
         }
-    } else if ((entry = TAILQ_FIRST(&priv->lo_cleans)) != NULL) {
-        block_cache_free_entry(priv, &entry);
-        goto again;
-    } else if ((entry = TAILQ_FIRST(&priv->hi_cleans)) != NULL) {
-        block_cache_free_entry(priv, &entry);
+    } else if ((entry = TAILQ_FIRST(&shard->lo_cleans)) != NULL
+      || (entry = TAILQ_FIRST(&shard->lo_hots)) != NULL
+      || (entry = TAILQ_FIRST(&shard->hi_cleans)) != NULL
+      || (entry = TAILQ_FIRST(&shard->hi_hots)) != NULL) {
+        block_cache_free_entry(priv, shard, &entry);
         goto again;
     } else
         goto done;
 
     // Get associated data buffer
-    if (datap != NULL || config->cache_file == NULL) {
-        if ((data = malloc(config->block_size)) == NULL) {
+    if (config->cache_file == NULL || (datap != NULL && !config->use_mmap)) {
+        if ((data = s3b_pool_alloc(shard->data_pool)) == NULL) {
             r = errno;
             (*config->log)(LOG_ERR, "can't allocate block cache buffer: %s", strerror(r));
-            priv->stats.out_of_memory_errors++;
-            free(entry);
+            shard->stats.out_of_memory_errors++;
+            block_cache_release_entry(shard, entry);
             return r;
         }
     }
@@ -1213,13 +2135,20 @@ again:
     // Get permanent data buffer
     if (config->cache_file == NULL)
         entry->u.data = data;
-    else if ((r = s3b_dcache_alloc_block(priv->dcache, &entry->u.dslot)) != 0) {    // should not happen
-        (*config->log)(LOG_ERR, "can't alloc cached block! %s", strerror(r));
-        free(data);             // OK if NULL
-        data = NULL;
-        free(entry);
-        entry = NULL;
-        goto done;
+    else {
+        pthread_mutex_lock(&priv->dcache_mutex);
+        r = s3b_dcache_alloc_block(priv->dcache, &entry->u.dslot);
+        CHECK_RETURN(pthread_mutex_unlock(&priv->dcache_mutex));
+        if (r != 0) {                                                   // should not happen
+            (*config->log)(LOG_ERR, "can't alloc cached block! %s", strerror(r));
+            s3b_pool_free(shard->data_pool, data);      // OK if NULL
+            data = NULL;
+            block_cache_release_entry(shard, entry);
+            entry = NULL;
+            goto done;
+        }
+        if (datap != NULL && config->use_mmap)
+            data = s3b_dcache_block_data(priv->dcache, entry->u.dslot);
     }
 
 done:
@@ -1234,11 +2163,10 @@ done:
  * Evict a CLEAN[2] entry.
  */
 static void
-block_cache_free_entry(struct block_cache_private *priv, struct cache_entry **entryp)
+block_cache_free_entry(struct block_cache_private *priv, struct block_cache_shard *shard, struct cache_entry **entryp)
 {
     struct block_cache_conf *const config = priv->config;
     struct cache_entry *const entry = *entryp;
-    struct list_head *const cleans_list = block_cache_cleans_list(priv, entry->block_num);
     int r;
 
     // Sanity check
@@ -1251,177 +2179,398 @@ block_cache_free_entry(struct block_cache_private *priv, struct cache_entry **en
     if (config->cache_file != NULL) {
         if ((r = s3b_dcache_erase_block(priv->dcache, entry->u.dslot)) != 0)
             (*config->log)(LOG_ERR, "can't erase cached block! %s", strerror(r));
-        if ((r = s3b_dcache_free_block(priv->dcache, entry->u.dslot)) != 0)
+        pthread_mutex_lock(&priv->dcache_mutex);
+        r = s3b_dcache_free_block(priv->dcache, entry->u.dslot);
+        CHECK_RETURN(pthread_mutex_unlock(&priv->dcache_mutex));
+        if (r != 0)
             (*config->log)(LOG_ERR, "can't free cached block! %s", strerror(r));
     } else
-        free(entry->u.data);
+        s3b_pool_free(shard->data_pool, entry->u.data);
 
     // Remove entry from the clean list
-    TAILQ_REMOVE(cleans_list, entry, link);
-    s3b_hash_remove(priv->hashtable, entry->block_num);
-    priv->num_cleans--;
+    block_cache_clean_remove(priv, shard, entry);
+    s3b_hash_remove(shard->hashtable, entry->block_num);
 
     // Free the entry
-    free(entry);
+    block_cache_release_entry(shard, entry);
 }
 
 /*
  * Worker thread main entry point.
+ *
+ * Each pass services every shard in turn, starting from a different shard for each thread,
+ * then handles any prefetch or read-ahead work. If there was nothing to do, we sleep until
+ * signaled or the next timeout in any shard.
  */
 static void *
 block_cache_worker_main(void *arg)
 {
     struct block_cache_private *const priv = arg;
     struct block_cache_conf *const config = priv->config;
-    struct cache_entry *entry;
-    struct cache_entry *clean_entry = NULL;
-    struct list_head *cleans_list;
-    u_char etag[MD5_DIGEST_LENGTH];
-    uint32_t adjusted_now;
-    uint32_t now;
+    uint32_t wake = 0;
+    int have_wake;
+    u_int work_gen;
     u_int thread_id;
+    int did_work;
+    int stopping;
     void *buf;
-    int r;
-
-    // Grab lock
-    pthread_mutex_lock(&priv->mutex);
+    u_int i;
 
     // Assign myself a thread ID (for debugging purposes)
+    pthread_mutex_lock(&priv->mutex);
     thread_id = priv->thread_id++;
+    CHECK_RETURN(pthread_mutex_unlock(&priv->mutex));
 
     /*
      * Allocate buffer for outgoing block data. We have to copy it before we send it in case
      * another write to this block comes in and updates the data associated with the cache entry.
      */
-    if ((buf = malloc(config->block_size)) == NULL) {
+    if ((buf = malloc((size_t)config->block_size * (config->write_coalesce > 1 ? config->write_coalesce : 1))) == NULL) {
         (*config->log)(LOG_ERR, "block_cache worker %u can't alloc buffer, exiting: %s", thread_id, strerror(errno));
-        goto done;
+        return NULL;
     }
 
     // Repeatedly do stuff until told to stop
     while (1) {
 
-        // Sanity check
-        S3BCACHE_CHECK_INVARIANTS(priv, 1);
+        // Snapshot the work generation so we will notice any new work that arrives while we're looking
+        pthread_mutex_lock(&priv->mutex);
+        work_gen = priv->work_gen;
+        stopping = priv->stopping;
+        CHECK_RETURN(pthread_mutex_unlock(&priv->mutex));
 
-        // Get current time
-        now = block_cache_get_time(priv);
+        // Write out any blocks that a flush is waiting for before anything else, in whichever shard they are
+        did_work = 0;
+        have_wake = 0;
+        if (ATOMIC_LOAD(priv->num_flushes) > 0) {
+            for (i = 0; i < priv->num_shards; i++) {
+                struct block_cache_shard *const shard = &priv->shards[(thread_id + i) % priv->num_shards];
 
-        // Evict any CLEAN[2] blocks that have timed out (if enabled)
-        if (priv->clean_timeout != 0) {
-            while ((clean_entry = TAILQ_FIRST(&priv->lo_cleans)) != NULL && now >= clean_entry->timeout) {
-                block_cache_free_entry(priv, &clean_entry);
-                pthread_cond_signal(&priv->space_avail);
-            }
-            while ((clean_entry = TAILQ_FIRST(&priv->hi_cleans)) != NULL && now >= clean_entry->timeout) {
-                block_cache_free_entry(priv, &clean_entry);
-                pthread_cond_signal(&priv->space_avail);
+                did_work |= block_cache_worker_shard(priv, shard, buf, stopping, 1, &wake, &have_wake);
             }
+            if (did_work)
+                continue;
         }
 
-        // As we approach our maximum dirty block limit, force earlier than planned writes
-        adjusted_now = now + (uint32_t)(priv->dirty_timeout * (block_cache_dirty_ratio(priv) / priv->max_dirty_ratio));
+        // Evict timed out blocks and write out dirty blocks in each shard
+        for (i = 0; i < priv->num_shards; i++) {
+            struct block_cache_shard *const shard = &priv->shards[(thread_id + i) % priv->num_shards];
+
+            did_work |= block_cache_worker_shard(priv, shard, buf, stopping, 0, &wake, &have_wake);
+        }
+        if (did_work)
+            continue;
 
-        // See if there is a block that needs writing
-        if ((entry = TAILQ_FIRST(&priv->dirties)) != NULL && (priv->stopping || adjusted_now >= entry->timeout)) {
+        // Are we supposed to stop?
+        if (stopping)
+            break;
 
-            // If we are also supposed to do read-ahead, wake up a sibling to handle it
-            if (priv->seq_count >= config->read_ahead_trigger && priv->ra_count < config->read_ahead)
-                pthread_cond_signal(&priv->worker_work);
+        // See if there is a prefetch or read-ahead block that needs to be read
+        if (block_cache_worker_read(priv))
+            continue;
 
-            // Copy data to our private buffer; it may change while we're writing
-            if ((r = block_cache_read_data(priv, entry, buf, 0, config->block_size)) != 0) {
-                (*config->log)(LOG_ERR, "error reading cached block! %s", strerror(r));
-                sleep(5);
-                continue;
+        // There is nothing to do at this time; sleep until there is something to do
+        pthread_mutex_lock(&priv->mutex);
+        if (priv->work_gen == work_gen && !priv->stopping)
+            block_cache_worker_wait(priv, have_wake, wake);
+        CHECK_RETURN(pthread_mutex_unlock(&priv->mutex));
+    }
+
+    // Decrement live worker thread count
+    pthread_mutex_lock(&priv->mutex);
+    ATOMIC_SUB(priv->num_threads, 1);
+    pthread_cond_signal(&priv->worker_exit);
+    CHECK_RETURN(pthread_mutex_unlock(&priv->mutex));
+
+    // Done
+    free(buf);
+    return NULL;
+}
+
+/*
+ * Perform worker thread duties for one shard: evict any CLEAN[2] blocks that have timed out,
+ * and write out the first DIRTY block if it's time. Update *wakep with the earliest time at which
+ * there will be more to do in this shard, if any, and set *have_wakep if so.
+ *
+ * Returns non-zero if a write was attempted.
+ */
+static int
+block_cache_worker_shard(struct block_cache_private *priv, struct block_cache_shard *shard, void *buf,
+  int stopping, int flushes_only, uint32_t *wakep, int *have_wakep)
+{
+    struct block_cache_conf *const config = priv->config;
+    struct cache_entry *clean_entry = NULL;
+    struct cache_entry *entry;
+    u_char etag[MD5_DIGEST_LENGTH];
+    uint32_t adjusted_now;
+    uint32_t now;
+    u_int num_blocks;
+    int zero = 0;
+    size_t i;
+    int r;
+
+    // Grab lock and sanity check
+    pthread_mutex_lock(&shard->mutex);
+    S3BCACHE_CHECK_INVARIANTS(priv, shard, 1);
+
+    // Get current time
+    now = block_cache_get_time(priv);
+
+    // Evict any CLEAN[2] blocks that have timed out (if enabled), and find the next one to time out
+    if (priv->clean_timeout != 0 && !flushes_only) {
+        struct list_head *const clean_lists[] = { &shard->lo_cleans, &shard->lo_hots, &shard->hi_cleans, &shard->hi_hots };
+        struct cache_entry *next_clean = NULL;
+
+        for (i = 0; i < sizeof(clean_lists) / sizeof(*clean_lists); i++) {
+            while ((clean_entry = TAILQ_FIRST(clean_lists[i])) != NULL && now >= clean_entry->timeout) {
+                block_cache_free_entry(priv, shard, &clean_entry);
+                pthread_cond_signal(&shard->space_avail);
             }
+            if (clean_entry != NULL && (next_clean == NULL || clean_entry->timeout < next_clean->timeout))
+                next_clean = clean_entry;
+        }
+        clean_entry = next_clean;
+    }
 
-            // Move to WRITING state
-            assert(ENTRY_GET_STATE(entry) == DIRTY);
-            TAILQ_REMOVE(&priv->dirties, entry, link);
-            ENTRY_RESET_LINK(entry);
-            entry->dirty = 0;
-            entry->timeout = 0;
-            assert(ENTRY_GET_STATE(entry) == WRITING);
+    // As we approach our maximum dirty block limit, force earlier than planned writes
+    adjusted_now = now + (uint32_t)(priv->dirty_timeout * (block_cache_dirty_ratio(priv) / priv->max_dirty_ratio));
 
-            // Attempt to write the block
-            CHECK_RETURN(pthread_mutex_unlock(&priv->mutex));
-            r = (*priv->inner->write_block)(priv->inner, entry->block_num, buf, etag, block_cache_check_cancel, priv);
-            pthread_mutex_lock(&priv->mutex);
-            S3BCACHE_CHECK_INVARIANTS(priv, 1);
+    // See if there is a block that needs writing
+    if ((entry = TAILQ_FIRST(&shard->dirties)) != NULL
+      && (flushes_only ? entry->flush : (stopping || adjusted_now >= entry->timeout))) {
 
-            // Sanity checks
-            assert(ENTRY_GET_STATE(entry) == WRITING || ENTRY_GET_STATE(entry) == WRITING2);
+        // If we are also supposed to do read-ahead or prefetching, wake up a sibling to handle it
+        pthread_mutex_lock(&priv->mutex);
+        if (priv->prefetches.num_blocks > 0 || block_cache_read_ahead_stream(priv) != NULL) {
+            priv->work_gen++;
+            pthread_cond_signal(&priv->worker_work);
+        }
+        CHECK_RETURN(pthread_mutex_unlock(&priv->mutex));
 
-            // If write attempt failed (or we canceled it), go back to the DIRTY state and try again later
+        // Move to WRITING state
+        assert(ENTRY_GET_STATE(entry) == DIRTY);
+        TAILQ_REMOVE(&shard->dirties, entry, link);
+        ENTRY_RESET_LINK(entry);
+        entry->dirty = 0;
+        entry->timeout = 0;
+        assert(ENTRY_GET_STATE(entry) == WRITING);
+
+        // If the block is only partially valid, read the original and merge it in first (the valid range may grow meanwhile)
+        if (block_cache_get_partial(shard, entry->block_num) != NULL) {
+            CHECK_RETURN(pthread_mutex_unlock(&shard->mutex));
+            r = (*priv->inner->read_block)(priv->inner, entry->block_num, buf, NULL, NULL, 0);
+            pthread_mutex_lock(&shard->mutex);
+            S3BCACHE_CHECK_INVARIANTS(priv, shard, 1);
+            assert(ENTRY_GET_STATE(entry) == WRITING || ENTRY_GET_STATE(entry) == WRITING2);
             if (r != 0) {
+                (*config->log)(LOG_ERR, "error reading partially written block %0*jx: %s",
+                  S3B_BLOCK_NUM_DIGITS, (uintmax_t)entry->block_num, strerror(r));
                 entry->dirty = 1;
-                TAILQ_INSERT_HEAD(&priv->dirties, entry, link);
-                continue;
+                TAILQ_INSERT_HEAD(&shard->dirties, entry, link);
+                pthread_cond_broadcast(&shard->write_complete);
+                CHECK_RETURN(pthread_mutex_unlock(&shard->mutex));
+                sleep(5);
+                return 1;
             }
+            if (block_cache_get_partial(shard, entry->block_num) != NULL)
+                block_cache_merge_partial(priv, shard, entry, buf);
+            pthread_cond_broadcast(&shard->write_complete);
+        }
 
-            // If block was not modified while being written (WRITING), it is now CLEAN
-            if (!entry->dirty) {
-                if (config->cache_file != NULL) {
-                    if ((r = s3b_dcache_record_block(priv->dcache, entry->u.dslot, entry->block_num, etag)) != 0)
-                        (*config->log)(LOG_ERR, "can't record cached block! %s", strerror(r));
-                }
-                priv->num_dirties--;
-                cleans_list = block_cache_cleans_list(priv, entry->block_num);
-                TAILQ_INSERT_TAIL(cleans_list, entry, link);
-                entry->verify = 0;
-                entry->timeout = block_cache_get_time(priv) + priv->clean_timeout;
-                priv->num_cleans++;
-                assert(ENTRY_GET_STATE(entry) == CLEAN);
-                pthread_cond_signal(&priv->space_avail);
-                pthread_cond_broadcast(&priv->write_complete);
-                continue;
+        // Copy data to our private buffer; it may change while we're writing. When in memory, detect zeros as we copy.
+        if (config->cache_file == NULL)
+            zero = block_copy_is_zeros(buf, entry->u.data);
+        else if ((r = block_cache_read_data(priv, entry, buf, 0, config->block_size)) != 0) {
+            (*config->log)(LOG_ERR, "error reading cached block! %s", strerror(r));
+            entry->dirty = 1;
+            TAILQ_INSERT_HEAD(&shard->dirties, entry, link);
+            CHECK_RETURN(pthread_mutex_unlock(&shard->mutex));
+            sleep(5);
+            return 1;
+        }
+        entry->dirty = 0;                               // our copy includes any changes made while we were merging
+
+        // Attempt to write the block, along with any immediately following dirty blocks
+        CHECK_RETURN(pthread_mutex_unlock(&shard->mutex));
+        if ((num_blocks = block_cache_coalesce(priv, entry->block_num, buf)) > 1) {
+            r = (*priv->inner->write_blocks)(priv->inner, entry->block_num, num_blocks, buf);
+            for (i = 1; i < num_blocks; i++) {
+                struct block_cache_shard *const next_shard = block_cache_shard(priv, entry->block_num + i);
+
+                pthread_mutex_lock(&next_shard->mutex);
+                S3BCACHE_CHECK_INVARIANTS(priv, next_shard, 1);
+                block_cache_write_done(priv, next_shard, s3b_hash_get(next_shard->hashtable, entry->block_num + i), r, NULL, now);
+                CHECK_RETURN(pthread_mutex_unlock(&next_shard->mutex));
             }
+        } else
+            r = (*priv->inner->write_block)(priv->inner, entry->block_num, zero ? NULL : buf, etag, block_cache_check_cancel, priv);
+        pthread_mutex_lock(&shard->mutex);
+        S3BCACHE_CHECK_INVARIANTS(priv, shard, 1);
+        block_cache_write_done(priv, shard, entry, r, etag, now);
+        goto done;
+    }
 
-            // Block was modified while being written (WRITING2), so it stays DIRTY
-            TAILQ_INSERT_TAIL(&priv->dirties, entry, link);
-            entry->timeout = now + priv->dirty_timeout;     // update for 2nd write timing conservatively
-            continue;
-        }
+    // Nothing to write yet; note when we next need to look at this shard
+    if (flushes_only) {
+        CHECK_RETURN(pthread_mutex_unlock(&shard->mutex));
+        return 0;
+    }
+    if (entry == NULL || (clean_entry != NULL && clean_entry->timeout < entry->timeout))
+        entry = clean_entry;
+    if (entry != NULL && (!*have_wakep || entry->timeout < *wakep)) {
+        *wakep = entry->timeout;
+        *have_wakep = 1;
+    }
+    CHECK_RETURN(pthread_mutex_unlock(&shard->mutex));
+    return 0;
 
-        // Are we supposed to stop?
-        if (priv->stopping != 0)
+done:
+    // Release lock
+    CHECK_RETURN(pthread_mutex_unlock(&shard->mutex));
+    return 1;
+}
+
+/*
+ * Gather the dirty blocks immediately following the given block, which has already been copied into the start
+ * of "buf", into the rest of "buf", moving each one to the WRITING state. Stops at the first block that is not
+ * DIRTY and fully valid, or after config->write_coalesce blocks in total.
+ *
+ * Returns the total number of blocks in "buf", including the first one.
+ *
+ * Assumes no shard mutex is held.
+ */
+static u_int
+block_cache_coalesce(struct block_cache_private *priv, s3b_block_t block_num, void *buf)
+{
+    struct block_cache_conf *const config = priv->config;
+    struct block_cache_shard *shard;
+    struct cache_entry *entry;
+    u_int num_blocks;
+
+    // Coalescing is not supported with the disk cache (write_blocks() doesn't report ETags)
+    if (config->cache_file != NULL)
+        return 1;
+
+    // Gather as many following dirty blocks as we can
+    for (num_blocks = 1; num_blocks < config->write_coalesce && block_num + num_blocks > block_num; num_blocks++) {
+        shard = block_cache_shard(priv, block_num + num_blocks);
+        pthread_mutex_lock(&shard->mutex);
+        S3BCACHE_CHECK_INVARIANTS(priv, shard, 1);
+        if ((entry = s3b_hash_get(shard->hashtable, block_num + num_blocks)) == NULL
+          || ENTRY_GET_STATE(entry) != DIRTY
+          || block_cache_get_partial(shard, entry->block_num) != NULL) {
+            CHECK_RETURN(pthread_mutex_unlock(&shard->mutex));
             break;
+        }
+        TAILQ_REMOVE(&shard->dirties, entry, link);
+        ENTRY_RESET_LINK(entry);
+        entry->dirty = 0;
+        entry->timeout = 0;
+        assert(ENTRY_GET_STATE(entry) == WRITING);
+        memcpy((char *)buf + (size_t)num_blocks * config->block_size, entry->u.data, config->block_size);
+        CHECK_RETURN(pthread_mutex_unlock(&shard->mutex));
+    }
+    return num_blocks;
+}
 
-        // See if there is a read-ahead block that needs to be read
-        if (priv->seq_count >= config->read_ahead_trigger && priv->ra_count < config->read_ahead) {
-            while (priv->ra_count < config->read_ahead) {
-                s3b_block_t ra_block;
+/*
+ * Update a WRITING or WRITING2 entry after an attempt to write it out has completed with result "r".
+ *
+ * Assumes the mutex for the block's shard is held.
+ */
+static void
+block_cache_write_done(struct block_cache_private *priv, struct block_cache_shard *shard, struct cache_entry *entry,
+  int r, const u_char *etag, uint32_t now)
+{
+    struct block_cache_conf *const config = priv->config;
 
-                // We will handle read-ahead for the next read-ahead block; claim it now
-                ra_block = priv->seq_last + ++priv->ra_count;
+    // Sanity checks
+    assert(entry != NULL);
+    assert(ENTRY_GET_STATE(entry) == WRITING || ENTRY_GET_STATE(entry) == WRITING2);
 
-                // If block already exists in the cache, nothing needs to be done
-                if (s3b_hash_get(priv->hashtable, ra_block) != NULL)
-                    continue;
+    // If write attempt failed (or we canceled it), go back to the DIRTY state and try again later
+    if (r != 0) {
+        entry->dirty = 1;
+        TAILQ_INSERT_HEAD(&shard->dirties, entry, link);
+        return;
+    }
 
-                // Perform a speculative read of the block so it will get stored in the cache
-                (void)block_cache_do_read(priv, ra_block, 0, 0, NULL, 0);
-                break;
-            }
-            continue;
+    // If block was not modified while being written (WRITING), it is now CLEAN
+    if (!entry->dirty) {
+        if (config->cache_file != NULL) {
+            if ((r = s3b_dcache_record_block(priv->dcache, entry->u.dslot, entry->block_num, etag)) != 0)
+                (*config->log)(LOG_ERR, "can't record cached block! %s", strerror(r));
         }
+        if (entry->flush) {
+            entry->flush = 0;
+            ATOMIC_SUB(priv->num_flushes, 1);
+        }
+        entry->verify = 0;
+        entry->timeout = block_cache_get_time(priv) + priv->clean_timeout;
+        block_cache_clean_insert(priv, shard, entry);
+        block_cache_demote_hots(priv, shard);
+        assert(ENTRY_GET_STATE(entry) == CLEAN);
+        block_cache_dirty_done(priv, shard);
+        pthread_cond_signal(&shard->space_avail);
+        pthread_cond_broadcast(&shard->write_complete);
+        return;
+    }
 
-        // There is nothing to do at this time; sleep until there is something to do
-        if (entry == NULL || (clean_entry != NULL && clean_entry->timeout < entry->timeout))
-            entry = clean_entry;
-        block_cache_worker_wait(priv, entry);
+    // Block was modified while being written (WRITING2), so it stays DIRTY; write it again immediately if being flushed
+    if (entry->flush) {
+        TAILQ_INSERT_HEAD(&shard->dirties, entry, link);
+        entry->timeout = now;
+        return;
     }
+    TAILQ_INSERT_TAIL(&shard->dirties, entry, link);
+    entry->timeout = now + priv->dirty_timeout;     // update for 2nd write timing conservatively
+}
 
-    // Decrement live worker thread count
-    priv->num_threads--;
-    pthread_cond_signal(&priv->worker_exit);
+/*
+ * Perform one prefetch or read-ahead block read, if any is needed.
+ *
+ * Returns non-zero if there was such work to do.
+ */
+static int
+block_cache_worker_read(struct block_cache_private *priv)
+{
+    struct block_cache_shard *shard;
+    struct read_stream *stream;
+    s3b_block_t block_num;
 
-done:
-    // Done
+    // Grab global lock
+    pthread_mutex_lock(&priv->mutex);
+
+    // Don't start anything new if we're stopping
+    if (priv->stopping) {
+        CHECK_RETURN(pthread_mutex_unlock(&priv->mutex));
+        return 0;
+    }
+
+    // See if there is a block queued by block_cache_read_blocks() that needs to be read
+    if (priv->prefetches.num_blocks > 0)
+        block_num = priv->prefetches.blocks[--priv->prefetches.num_blocks];
+
+    // See if there is a read-ahead block that needs to be read; if so, claim it now
+    else if ((stream = block_cache_read_ahead_stream(priv)) != NULL)
+        block_num = stream->last + ++stream->ra_count;
+
+    // Nothing to do
+    else {
+        CHECK_RETURN(pthread_mutex_unlock(&priv->mutex));
+        return 0;
+    }
+
+    // Release global lock
     CHECK_RETURN(pthread_mutex_unlock(&priv->mutex));
-    free(buf);
-    return NULL;
+
+    // Perform a speculative read of the block so it will get stored in the cache, unless it's already there
+    shard = block_cache_shard(priv, block_num);
+    pthread_mutex_lock(&shard->mutex);
+    if (s3b_hash_get(shard->hashtable, block_num) == NULL)
+        (void)block_cache_do_read(priv, shard, block_num, 0, 0, NULL, 0, 1);
+    CHECK_RETURN(pthread_mutex_unlock(&shard->mutex));
+    return 1;
 }
 
 /*
@@ -1431,15 +2580,16 @@ static int
 block_cache_check_cancel(void *arg, s3b_block_t block_num)
 {
     struct block_cache_private *const priv = arg;
+    struct block_cache_shard *const shard = block_cache_shard(priv, block_num);
     struct cache_entry *entry;
     int r;
 
     // Lock mutex
-    pthread_mutex_lock(&priv->mutex);
-    S3BCACHE_CHECK_INVARIANTS(priv, 1);
+    pthread_mutex_lock(&shard->mutex);
+    S3BCACHE_CHECK_INVARIANTS(priv, shard, 1);
 
     // Find cache entry
-    entry = s3b_hash_get(priv->hashtable, block_num);
+    entry = s3b_hash_get(shard->hashtable, block_num);
 
     // Sanity check
     assert(entry != NULL);
@@ -1450,27 +2600,44 @@ block_cache_check_cancel(void *arg, s3b_block_t block_num)
     r = entry->dirty;
 
     // Unlock mutex
-    CHECK_RETURN(pthread_mutex_unlock(&priv->mutex));
+    CHECK_RETURN(pthread_mutex_unlock(&shard->mutex));
     return r;
 }
 
+/*
+ * Wake up one (or all) worker threads because there is new work to do.
+ *
+ * The global mutex must not be held.
+ */
+static void
+block_cache_wake_workers(struct block_cache_private *priv, int all)
+{
+    pthread_mutex_lock(&priv->mutex);
+    priv->work_gen++;
+    if (all)
+        pthread_cond_broadcast(&priv->worker_work);
+    else
+        pthread_cond_signal(&priv->worker_work);
+    CHECK_RETURN(pthread_mutex_unlock(&priv->mutex));
+}
+
 /*
  * Sleep until either the 'worker_work' condition becomes true, or the
- * entry (if any) times out.
+ * wake time (if any) is reached.
  *
- * This assumes the mutex is held.
+ * This assumes the global mutex is held.
  */
 static void
-block_cache_worker_wait(struct block_cache_private *priv, struct cache_entry *entry)
+block_cache_worker_wait(struct block_cache_private *priv, int have_wake, uint32_t wake)
 {
     uint64_t wake_time_millis;
 
-    if (entry == NULL) {
+    if (!have_wake) {
         pthread_cond_wait(&priv->worker_work, &priv->mutex);
         return;
     }
-    wake_time_millis = priv->start_time + ((uint64_t)entry->timeout * TIME_UNIT_MILLIS);
-    block_cache_cond_timedwait(priv, &priv->worker_work, wake_time_millis);
+    wake_time_millis = priv->start_time + ((uint64_t)wake * TIME_UNIT_MILLIS);
+    block_cache_cond_timedwait(&priv->worker_work, &priv->mutex, wake_time_millis);
 }
 
 /*
@@ -1479,13 +2646,13 @@ block_cache_worker_wait(struct block_cache_private *priv, struct cache_entry *en
  * Returns ETIMEDOUT if we timed out.
  */
 static int
-block_cache_cond_timedwait(struct block_cache_private *priv, pthread_cond_t *cond, uint64_t wake_time_millis)
+block_cache_cond_timedwait(pthread_cond_t *cond, pthread_mutex_t *mutex, uint64_t wake_time_millis)
 {
     struct timespec wake_time;
 
     wake_time.tv_sec = wake_time_millis / 1000;
     wake_time.tv_nsec = (wake_time_millis % 1000) * 1000000;
-    return pthread_cond_timedwait(cond, &priv->mutex, &wake_time);
+    return pthread_cond_timedwait(cond, mutex, &wake_time);
 }
 
 /*
@@ -1501,12 +2668,57 @@ block_cache_get_time(struct block_cache_private *priv)
 }
 
 /*
- * Get the head of the appropriate clean list, based on whether the block is low or high priority.
+ * Get the head of the appropriate clean list, based on whether the block is low or high priority, and hot or not.
  */
 static struct list_head *
-block_cache_cleans_list(struct block_cache_private *const priv, s3b_block_t block_num)
+block_cache_cleans_list(struct block_cache_private *const priv, struct block_cache_shard *shard, struct cache_entry *entry)
+{
+    if (block_cache_high_prio(priv->config, entry->block_num))
+        return entry->hot ? &shard->hi_hots : &shard->hi_cleans;
+    return entry->hot ? &shard->lo_hots : &shard->lo_cleans;
+}
+
+/*
+ * Add an entry to the tail of the appropriate clean list.
+ */
+static void
+block_cache_clean_insert(struct block_cache_private *const priv, struct block_cache_shard *shard, struct cache_entry *entry)
+{
+    TAILQ_INSERT_TAIL(block_cache_cleans_list(priv, shard, entry), entry, link);
+    shard->num_cleans++;
+    if (entry->hot)
+        shard->num_hots++;
+}
+
+/*
+ * Remove an entry from its clean list.
+ */
+static void
+block_cache_clean_remove(struct block_cache_private *const priv, struct block_cache_shard *shard, struct cache_entry *entry)
+{
+    TAILQ_REMOVE(block_cache_cleans_list(priv, shard, entry), entry, link);
+    shard->num_cleans--;
+    if (entry->hot)
+        shard->num_hots--;
+}
+
+/*
+ * Demote the least recently used hot blocks until we're back under the limit.
+ */
+static void
+block_cache_demote_hots(struct block_cache_private *const priv, struct block_cache_shard *shard)
 {
-    return block_cache_high_prio(priv->config, block_num) ? &priv->hi_cleans : &priv->lo_cleans;
+    struct cache_entry *entry;
+
+    while (shard->num_hots > shard->max_hots) {
+        if ((entry = TAILQ_FIRST(&shard->lo_hots)) == NULL)
+            entry = TAILQ_FIRST(&shard->hi_hots);
+        assert(entry != NULL);
+        block_cache_clean_remove(priv, shard, entry);
+        entry->hot = 0;
+        entry->timeout = block_cache_get_time(priv) + priv->clean_timeout;     // keep the list in timeout order
+        block_cache_clean_insert(priv, shard, entry);
+    }
 }
 
 /*
@@ -1532,16 +2744,26 @@ block_cache_get_time_millis(void)
     return (uint64_t)tv.tv_sec * 1000 + (uint64_t)tv.tv_usec / 1000;
 }
 
+static uint64_t
+block_cache_get_time_micros(void)
+{
+    struct timeval tv;
+
+    gettimeofday(&tv, NULL);
+    return (uint64_t)tv.tv_sec * 1000000 + (uint64_t)tv.tv_usec;
+}
+
 static int
 block_cache_free_one(void *arg, void *value)
 {
     struct block_cache_private *const priv = arg;
     struct block_cache_conf *const config = priv->config;
     struct cache_entry *const entry = value;
+    struct block_cache_shard *const shard = block_cache_shard(priv, entry->block_num);
 
     if (config->cache_file == NULL)
-        free(entry->u.data);
-    free(entry);
+        s3b_pool_free(shard->data_pool, entry->u.data);
+    block_cache_release_entry(shard, entry);
     return 0;
 }
 
@@ -1549,27 +2771,30 @@ block_cache_free_one(void *arg, void *value)
  * Mark an entry verified and free the extra bytes we allocated for the ETag.
  */
 static struct cache_entry *
-block_cache_verified(struct block_cache_private *priv, struct cache_entry *entry)
+block_cache_verified(struct block_cache_private *priv, struct block_cache_shard *shard, struct cache_entry *entry)
 {
-    struct list_head *const cleans_list = block_cache_cleans_list(priv, entry->block_num);
+    struct list_head *const cleans_list = block_cache_cleans_list(priv, shard, entry);
     struct cache_entry *new_entry;
 
     // Sanity check
     assert(entry->verify);
     assert(ENTRY_GET_STATE(entry) == CLEAN2 || ENTRY_GET_STATE(entry) == READING2);
 
-    // Allocate new, smaller entry; if we can't no big deal
-    if ((new_entry = malloc(sizeof(*entry))) == NULL)
+    /*
+     * Allocate new, smaller entry; if we can't no big deal. In that case the larger
+     * entry is later returned to the small entry pool, which is harmless.
+     */
+    if ((new_entry = s3b_pool_alloc(shard->entry_pool)) == NULL)
         goto done;
     memcpy(new_entry, entry, sizeof(*entry));
 
     // Update all references that point to the entry
-    s3b_hash_put(priv->hashtable, new_entry);
+    s3b_hash_put(shard->hashtable, new_entry);
     if (ENTRY_IN_LIST(entry)) {
         TAILQ_REMOVE(cleans_list, entry, link);
         TAILQ_INSERT_TAIL(cleans_list, new_entry, link);
     }
-    free(entry);
+    block_cache_release_entry(shard, entry);
     entry = new_entry;
 
 done:
@@ -1636,7 +2861,7 @@ block_cache_dirty_ratio(struct block_cache_private *priv)
 {
     struct block_cache_conf *const config = priv->config;
 
-    return (double)priv->num_dirties / (double)config->cache_size;
+    return (double)ATOMIC_LOAD(priv->num_dirties) / (double)config->cache_size;
 }
 
 #ifndef NDEBUG
@@ -1650,56 +2875,93 @@ struct check_info {
     u_int   num_writing2;
 };
 
+/*
+ * Check invariants for one shard.
+ *
+ * Assumes the mutex for the shard is held.
+ */
 static void
-block_cache_check_invariants(struct block_cache_private *priv, int allow_stopping)
+block_cache_check_invariants(struct block_cache_private *priv, struct block_cache_shard *shard, int allow_stopping)
 {
     struct block_cache_conf *const config = priv->config;
     struct cache_entry *entry;
     struct check_info info;
     int clean_len = 0;
     int dirty_len = 0;
+    int hot_len = 0;
+    int i;
 
     // Check for stopping
-    assert(allow_stopping || !priv->stopping);
+    assert(allow_stopping || !ATOMIC_LOAD(priv->stopping));
 
     // Check CLEANs and CLEAN2s
-    for (entry = TAILQ_FIRST(&priv->lo_cleans); entry != NULL; entry = TAILQ_NEXT(entry, link)) {
+    for (entry = TAILQ_FIRST(&shard->lo_cleans); entry != NULL; entry = TAILQ_NEXT(entry, link)) {
         assert(ENTRY_GET_STATE(entry) == CLEAN || ENTRY_GET_STATE(entry) == CLEAN2);
-        assert(s3b_hash_get(priv->hashtable, entry->block_num) == entry);
+        assert(s3b_hash_get(shard->hashtable, entry->block_num) == entry);
+        assert(block_cache_shard(priv, entry->block_num) == shard);
         assert(!block_cache_high_prio(config, entry->block_num));
+        assert(!entry->hot);
         clean_len++;
     }
-    for (entry = TAILQ_FIRST(&priv->hi_cleans); entry != NULL; entry = TAILQ_NEXT(entry, link)) {
+    for (entry = TAILQ_FIRST(&shard->hi_cleans); entry != NULL; entry = TAILQ_NEXT(entry, link)) {
         assert(ENTRY_GET_STATE(entry) == CLEAN || ENTRY_GET_STATE(entry) == CLEAN2);
-        assert(s3b_hash_get(priv->hashtable, entry->block_num) == entry);
+        assert(s3b_hash_get(shard->hashtable, entry->block_num) == entry);
+        assert(block_cache_shard(priv, entry->block_num) == shard);
         assert(block_cache_high_prio(config, entry->block_num));
+        assert(!entry->hot);
         clean_len++;
     }
-    assert(clean_len == priv->num_cleans);
+    for (entry = TAILQ_FIRST(&shard->lo_hots); entry != NULL; entry = TAILQ_NEXT(entry, link)) {
+        assert(ENTRY_GET_STATE(entry) == CLEAN || ENTRY_GET_STATE(entry) == CLEAN2);
+        assert(s3b_hash_get(shard->hashtable, entry->block_num) == entry);
+        assert(block_cache_shard(priv, entry->block_num) == shard);
+        assert(!block_cache_high_prio(config, entry->block_num));
+        assert(entry->hot);
+        hot_len++;
+    }
+    for (entry = TAILQ_FIRST(&shard->hi_hots); entry != NULL; entry = TAILQ_NEXT(entry, link)) {
+        assert(ENTRY_GET_STATE(entry) == CLEAN || ENTRY_GET_STATE(entry) == CLEAN2);
+        assert(s3b_hash_get(shard->hashtable, entry->block_num) == entry);
+        assert(block_cache_shard(priv, entry->block_num) == shard);
+        assert(block_cache_high_prio(config, entry->block_num));
+        assert(entry->hot);
+        hot_len++;
+    }
+    assert(clean_len + hot_len == shard->num_cleans);
+    assert(hot_len == shard->num_hots);
+    assert(shard->num_hots <= shard->max_hots);
 
     // Check DIRTYs
-    for (entry = TAILQ_FIRST(&priv->dirties); entry != NULL; entry = TAILQ_NEXT(entry, link)) {
+    for (entry = TAILQ_FIRST(&shard->dirties); entry != NULL; entry = TAILQ_NEXT(entry, link)) {
         assert(ENTRY_GET_STATE(entry) == DIRTY);
-        assert(s3b_hash_get(priv->hashtable, entry->block_num) == entry);
+        assert(s3b_hash_get(shard->hashtable, entry->block_num) == entry);
+        assert(block_cache_shard(priv, entry->block_num) == shard);
         dirty_len++;
     }
 
     // Check hash table size
-    assert(s3b_hash_size(priv->hashtable) <= config->cache_size);
+    assert(s3b_hash_size(shard->hashtable) <= shard->cache_size);
 
     // Check hash table entries
     memset(&info, 0, sizeof(info));
-    s3b_hash_foreach(priv->hashtable, block_cache_check_one, &info);
+    s3b_hash_foreach(shard->hashtable, block_cache_check_one, &info);
 
     // Check agreement
-    assert(info.num_clean == clean_len);
+    assert(info.num_clean == clean_len + hot_len);
     assert(info.num_dirty == dirty_len);
     assert(info.num_clean + info.num_dirty + info.num_reading + info.num_writing + info.num_writing2
-      == s3b_hash_size(priv->hashtable));
-    assert(priv->num_dirties == info.num_dirty + info.num_writing + info.num_writing2);
+      == s3b_hash_size(shard->hashtable));
+    assert(shard->num_dirties == info.num_dirty + info.num_writing + info.num_writing2);
+    assert(shard->num_dirties <= ATOMIC_LOAD(priv->num_dirties));
+    assert(shard->partials == NULL || s3b_hash_size(shard->partials) <= shard->num_dirties);
 
     // Check read-ahead
-    assert(priv->ra_count <= config->read_ahead);
+    pthread_mutex_lock(&priv->mutex);
+    for (i = 0; i < MAX_READ_STREAMS; i++) {
+        assert(priv->streams[i].window <= priv->ra_max);
+        assert(priv->streams[i].ra_count <= priv->ra_max);
+    }
+    CHECK_RETURN(pthread_mutex_unlock(&priv->mutex));
 }
 
 static int
@@ -1712,6 +2974,7 @@ block_cache_check_one(void *arg, void *value)
     switch (ENTRY_GET_STATE(entry)) {
     case CLEAN:
     case CLEAN2:
+        assert(!entry->flush);
         info->num_clean++;
         break;
     case DIRTY:
@@ -1720,6 +2983,7 @@ block_cache_check_one(void *arg, void *value)
     case READING:
     case READING2:
         assert(!entry->dirty);
+        assert(!entry->flush);
         info->num_reading++;
         break;
     case WRITING:
@@ -1735,4 +2999,3 @@ block_cache_check_one(void *arg, void *value)
     return 0;
 }
 #endif
-
@@ -43,10 +43,20 @@ struct block_cache_conf {
     u_int               synchronous;
     u_int               timeout;
     u_int               num_threads;
+    u_int               num_shards;
     u_int               read_ahead;
     u_int               read_ahead_trigger;
+    u_int               read_ahead_max;
     u_int               no_verify;
+    u_int               scan_resistant;
+    u_int               partial_writes;
+    u_int               write_coalesce;
     u_int               fadvise;
+    u_int               use_mmap;
+    u_int               use_uring;
+    u_int               sync_delay;
+    u_int               use_index;
+    u_int               huge_pages;
     u_int               recover_dirty_blocks;
     u_int               perform_flush;
     u_int               num_protected;
@@ -66,6 +76,13 @@ struct block_cache_stats {
     u_int               verified;
     u_int               mismatch;
     u_int               out_of_memory_errors;
+    struct latency_hist hit_latency;                // reads satisfied from the cache
+    struct latency_hist miss_latency;               // reads that went to the underlying store
+    struct latency_hist space_wait_latency;         // waits for a free cache entry
+    struct latency_hist dirty_wait_latency;         // waits for dirty blocks to drop below max_dirty
+    struct latency_hist dcache_read_latency;        // cache file reads (only with cache_file)
+    struct latency_hist dcache_write_latency;       // cache file writes (only with cache_file)
+    struct latency_hist dcache_fsync_latency;       // cache file syncs (only with cache_file)
 };
 
 // block_cache.c
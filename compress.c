@@ -39,11 +39,49 @@
 
 #if ZSTD
 #include <zstd.h>
+#include <zdict.h>
 #endif
 
+// Adaptive compression tuning
+#define ADAPT_PROBE_WINDOWS         32                  // number of sample windows probed per block
+#define ADAPT_PROBE_WINDOW_SIZE     32                  // size of each sample window
+#define ADAPT_ENTROPY_THRESHOLD     (7 * 256 + 128)     // 7.5 bits/byte (8.8 fixed point), above which we don't compress
+#define ADAPT_INTERVAL              32                  // blocks compressed between level adjustments
+#define ADAPT_EWMA_WEIGHT           0.125               // weight given to each new measurement
+#define ADAPT_NETWORK_MARGIN        2.0                 // raise level only when upload time exceeds CPU time by this much
+
+// Adaptive compression state
+struct comp_adapt {
+    log_func_t              *log;
+    const struct comp_alg   *calg;
+    pthread_mutex_t         mutex;
+    int                     level;                      // current compression level
+    u_int                   count;                      // blocks compressed at "level" since the last adjustment
+    double                  cpu_time;                   // average CPU time to compress one block at "level", or zero
+    double                  upload_time;                // average time to upload one block, or zero
+};
+
+// Per-thread compression state, created on demand and reused for every block
+struct comp_thread {
+    z_stream            deflate;
+    int                 deflate_level;          // level "deflate" was initialized with
+    u_char              deflate_valid;          // "deflate" has been initialized
+    z_stream            inflate;
+    u_char              inflate_valid;          // "inflate" has been initialized
+#if ZSTD
+    ZSTD_CCtx           *zstd_cctx;
+    ZSTD_DCtx           *zstd_dctx;
+#endif
+};
+
 // Internal helpers
 static int  *parse_integer_level(const char *string);
 static void free_integer_level(void *levelp);
+static struct comp_thread *comp_get_thread(log_func_t *log);
+static void comp_create_thread_key(void);
+static void comp_free_thread(void *arg);
+static u_int comp_log2_fixed(u_int value);
+static void comp_adapt_adjust(struct comp_adapt *adapt);
 
 // Compression hooks - Deflate
 static comp_cfunc_t    deflate_compress;
@@ -56,6 +94,10 @@ static comp_lparse_t   deflate_lparse;
 static comp_cfunc_t    zstd_compress;
 static comp_dfunc_t    zstd_decompress;
 static comp_lparse_t   zstd_lparse;
+static comp_dtrain_t   zstd_dtrain;
+static comp_dload_t    zstd_dload;
+static comp_dfree_t    zstd_dfree;
+static comp_dneeds_t   zstd_dneeds;
 #endif
 
 // Compression algorithms
@@ -70,7 +112,10 @@ const struct comp_alg comp_algs[] = {
         .cfunc=     deflate_compress,
         .dfunc=     deflate_decompress,
         .lparse=    deflate_lparse,
-        .lfree=     free_integer_level
+        .lfree=     free_integer_level,
+        .min_level= Z_BEST_SPEED,
+        .max_level= Z_BEST_COMPRESSION,
+        .default_level= 6
     },
 
 #if ZSTD
@@ -80,12 +125,24 @@ const struct comp_alg comp_algs[] = {
         .cfunc=     zstd_compress,
         .dfunc=     zstd_decompress,
         .lparse=    zstd_lparse,
-        .lfree=     free_integer_level
+        .lfree=     free_integer_level,
+        .dtrain=    zstd_dtrain,
+        .dload=     zstd_dload,
+        .dfree=     zstd_dfree,
+        .dneeds=    zstd_dneeds,
+        .min_level= 1,
+        .max_level= 19,                                 // higher "ultra" levels need too much memory
+        .default_level= ZSTD_CLEVEL_DEFAULT
     },
 #endif
 };
 const size_t num_comp_algs = sizeof(comp_algs) / sizeof(*comp_algs);
 
+// Thread-local key for struct comp_thread
+static pthread_once_t comp_thread_once = PTHREAD_ONCE_INIT;
+static pthread_key_t comp_thread_key;
+static int comp_thread_key_error;
+
 /****************************************************************************
  *                          GENERAL PURPOSE                                 *
  ****************************************************************************/
@@ -104,18 +161,207 @@ comp_find(const char *name)
     return NULL;
 }
 
+/****************************************************************************
+ *                          ADAPTIVE COMPRESSION                            *
+ ****************************************************************************/
+
+/*
+ * Guess whether data is not worth compressing (e.g., it's already compressed or encrypted).
+ *
+ * This samples a few small windows spread across the data and estimates the byte entropy of the sample.
+ * It's much cheaper than actually trying to compress the data, and random looking data rarely compresses.
+ *
+ * Returns non-zero if the data looks incompressible.
+ */
+int
+comp_probe_incompressible(const void *data, size_t len)
+{
+    const u_char *const bytes = data;
+    u_int counts[256];
+    u_int num_sampled;
+    uint64_t sum;
+    size_t stride;
+    size_t off;
+    u_int i;
+    u_int j;
+
+    // Gather byte histogram of the sample
+    memset(counts, 0, sizeof(counts));
+    if (len <= ADAPT_PROBE_WINDOWS * ADAPT_PROBE_WINDOW_SIZE) {
+        for (off = 0; off < len; off++)
+            counts[bytes[off]]++;
+        num_sampled = len;
+    } else {
+        stride = (len - ADAPT_PROBE_WINDOW_SIZE) / (ADAPT_PROBE_WINDOWS - 1);
+        for (i = 0, off = 0; i < ADAPT_PROBE_WINDOWS; i++, off += stride) {
+            for (j = 0; j < ADAPT_PROBE_WINDOW_SIZE; j++)
+                counts[bytes[off + j]]++;
+        }
+        num_sampled = ADAPT_PROBE_WINDOWS * ADAPT_PROBE_WINDOW_SIZE;
+    }
+    if (num_sampled == 0)
+        return 0;
+
+    // Compute entropy in bits per byte: log2(N) - (1/N) * sum(c * log2(c))
+    sum = 0;
+    for (i = 0; i < 256; i++) {
+        if (counts[i] != 0)
+            sum += (uint64_t)counts[i] * comp_log2_fixed(counts[i]);
+    }
+    return comp_log2_fixed(num_sampled) - (u_int)(sum / num_sampled) > ADAPT_ENTROPY_THRESHOLD;
+}
+
+/*
+ * Create adaptive compression state.
+ *
+ * Adaptive compression measures how long it takes to compress each block and how long it takes to upload each block.
+ * While the CPU is keeping ahead of the network, the level is raised to get a better ratio; when compression is
+ * taking longer than the uploads, the level is lowered. The configured level (if any) is where we start.
+ *
+ * Returns NULL with errno set on failure.
+ */
+struct comp_adapt *
+comp_adapt_create(log_func_t *log, const struct comp_alg *calg, void *level)
+{
+    struct comp_adapt *adapt;
+    int r;
+
+    // Sanity check
+    if (calg->max_level == 0) {
+        (*log)(LOG_ERR, "%s compression does not support adaptive levels", calg->name);
+        errno = EINVAL;
+        return NULL;
+    }
+
+    // Initialize
+    if ((adapt = calloc(1, sizeof(*adapt))) == NULL) {
+        r = errno;
+        (*log)(LOG_ERR, "calloc: %s", strerror(r));
+        errno = r;
+        return NULL;
+    }
+    if ((r = pthread_mutex_init(&adapt->mutex, NULL)) != 0) {
+        free(adapt);
+        errno = r;
+        return NULL;
+    }
+    adapt->log = log;
+    adapt->calg = calg;
+    adapt->level = calg->default_level;
+    if (level != NULL && *(int *)level >= calg->min_level && *(int *)level <= calg->max_level)
+        adapt->level = *(int *)level;
+
+    // Done
+    return adapt;
+}
+
+/*
+ * Free adaptive compression state. OK if NULL.
+ */
+void
+comp_adapt_destroy(struct comp_adapt *adapt)
+{
+    if (adapt == NULL)
+        return;
+    pthread_mutex_destroy(&adapt->mutex);
+    free(adapt);
+}
+
+/*
+ * Compress data at the current adaptive level.
+ *
+ * Same as comp_cfunc_t, except that if the compressed data would not be any smaller than the input,
+ * then zero is returned with *outputp set to NULL, and the data should be stored uncompressed.
+ */
+int
+comp_adapt_compress(struct comp_adapt *adapt, const void *input, size_t inlen, void **outputp, size_t *outlenp,
+    const struct comp_dict *dict)
+{
+    struct timespec start;
+    struct timespec finish;
+    double cpu_time;
+    int level;
+    int r;
+
+    // Get current level
+    pthread_mutex_lock(&adapt->mutex);
+    level = adapt->level;
+    CHECK_RETURN(pthread_mutex_unlock(&adapt->mutex));
+
+    // Compress, measuring the CPU time it takes
+    (void)clock_gettime(CLOCK_THREAD_CPUTIME_ID, &start);
+    if ((r = (*adapt->calg->cfunc)(adapt->log, input, inlen, outputp, outlenp, &level, dict)) != 0) {
+        *outputp = NULL;
+        return r;
+    }
+    (void)clock_gettime(CLOCK_THREAD_CPUTIME_ID, &finish);
+    cpu_time = (double)(finish.tv_sec - start.tv_sec) + (double)(finish.tv_nsec - start.tv_nsec) / 1e9;
+
+    // Update measurements, unless the level changed underneath us
+    pthread_mutex_lock(&adapt->mutex);
+    if (level == adapt->level) {
+        adapt->cpu_time = adapt->cpu_time == 0.0 ? cpu_time : adapt->cpu_time + (cpu_time - adapt->cpu_time) * ADAPT_EWMA_WEIGHT;
+        if (++adapt->count >= ADAPT_INTERVAL && adapt->upload_time != 0.0)
+            comp_adapt_adjust(adapt);
+    }
+    CHECK_RETURN(pthread_mutex_unlock(&adapt->mutex));
+
+    // Don't bother with compressed data that is no smaller
+    if (*outlenp >= inlen) {
+        free(*outputp);
+        *outputp = NULL;
+    }
+    return 0;
+}
+
+/*
+ * Record the time it took to upload one block.
+ */
+void
+comp_adapt_uploaded(struct comp_adapt *adapt, double secs)
+{
+    pthread_mutex_lock(&adapt->mutex);
+    adapt->upload_time = adapt->upload_time == 0.0 ? secs : adapt->upload_time + (secs - adapt->upload_time) * ADAPT_EWMA_WEIGHT;
+    CHECK_RETURN(pthread_mutex_unlock(&adapt->mutex));
+}
+
+/*
+ * Get the current adaptive compression level.
+ */
+int
+comp_adapt_level(struct comp_adapt *adapt)
+{
+    int level;
+
+    pthread_mutex_lock(&adapt->mutex);
+    level = adapt->level;
+    CHECK_RETURN(pthread_mutex_unlock(&adapt->mutex));
+    return level;
+}
+
 /****************************************************************************
  *                                DEFLATE                                   *
  ****************************************************************************/
 
 static int
-deflate_compress(log_func_t *log, const void *input, size_t inlen, void **outputp, size_t *outlenp, void *levelp)
+deflate_compress(log_func_t *log, const void *input, size_t inlen, void **outputp, size_t *outlenp, void *levelp,
+    const struct comp_dict *dict)
 {
+    struct comp_thread *ct;
+    z_stream *zs;
     u_long clen;
     void *cbuf;
     int level;
     int r;
 
+    // Sanity check
+    assert(dict == NULL);
+
+    // Get this thread's state
+    if ((ct = comp_get_thread(log)) == NULL)
+        return ENOMEM;
+    zs = &ct->deflate;
+
     // Allocate buffer
     clen = compressBound(inlen);
     if ((cbuf = malloc(clen)) == NULL) {
@@ -127,13 +373,35 @@ deflate_compress(log_func_t *log, const void *input, size_t inlen, void **output
     // Extract compression level
     level = levelp != NULL ? *(int *)levelp : Z_DEFAULT_COMPRESSION;
 
+    // (Re)initialize stream if needed; otherwise it was already reset after its previous use
+    if (ct->deflate_valid && ct->deflate_level != level) {
+        (void)deflateEnd(zs);
+        ct->deflate_valid = 0;
+    }
+    if (!ct->deflate_valid) {
+        memset(zs, 0, sizeof(*zs));
+        if ((r = deflateInit(zs, level)) != Z_OK)
+            goto error;
+        ct->deflate_level = level;
+        ct->deflate_valid = 1;
+    }
+
     // Compress data
-    r = compress2(cbuf, &clen, input, inlen, level);
-    switch (r) {
-    case Z_OK:
+    zs->next_in = (Bytef *)(uintptr_t)input;
+    zs->avail_in = inlen;
+    zs->next_out = cbuf;
+    zs->avail_out = clen;
+    r = deflate(zs, Z_FINISH);
+    clen = zs->total_out;
+    (void)deflateReset(zs);
+    if (r == Z_STREAM_END) {
         *outputp = cbuf;
         *outlenp = clen;
         return 0;
+    }
+
+error:
+    switch (r) {
     case Z_MEM_ERROR:
         (*log)(LOG_ERR, "zlib compress: %s", strerror(ENOMEM));
         r = ENOMEM;
@@ -150,18 +418,49 @@ deflate_compress(log_func_t *log, const void *input, size_t inlen, void **output
 }
 
 static int
-deflate_decompress(log_func_t *log, const void *input, size_t inlen, void *output, size_t *outlenp)
+deflate_decompress(log_func_t *log, const void *input, size_t inlen, void *output, size_t *outlenp,
+    const struct comp_dict *dict)
 {
-    u_long uclen = *outlenp;
+    struct comp_thread *ct;
+    z_stream *zs;
     int r;
 
-    switch ((r = uncompress(output, &uclen, input, inlen))) {
-    case Z_OK:
-        *outlenp = uclen;
+    // Sanity check
+    assert(dict == NULL);
+
+    // Get this thread's state
+    if ((ct = comp_get_thread(log)) == NULL)
+        return ENOMEM;
+    zs = &ct->inflate;
+
+    // Initialize stream if needed; otherwise it was already reset after its previous use
+    if (!ct->inflate_valid) {
+        memset(zs, 0, sizeof(*zs));
+        if ((r = inflateInit(zs)) != Z_OK)
+            goto error;
+        ct->inflate_valid = 1;
+    }
+
+    // Decompress data
+    zs->next_in = (Bytef *)(uintptr_t)input;
+    zs->avail_in = inlen;
+    zs->next_out = output;
+    zs->avail_out = *outlenp;
+    r = inflate(zs, Z_FINISH);
+    if (r == Z_STREAM_END)
+        *outlenp = zs->total_out;
+    else if (r == Z_NEED_DICT || ((r == Z_OK || r == Z_BUF_ERROR) && zs->avail_out > 0))
+        r = Z_DATA_ERROR;                       // same as uncompress()
+    (void)inflateReset(zs);
+
+error:
+    switch (r) {
+    case Z_STREAM_END:
         return 0;
     case Z_MEM_ERROR:
         (*log)(LOG_ERR, "zlib uncompress: %s", strerror(ENOMEM));
         return ENOMEM;
+    case Z_OK:
     case Z_BUF_ERROR:
         (*log)(LOG_ERR, "zlib uncompress: %s", "decompressed block is oversize");
         return EIO;
@@ -211,13 +510,23 @@ invalid:
  ****************************************************************************/
 
 static int
-zstd_compress(log_func_t *log, const void *input, size_t inlen, void **outputp, size_t *outlenp, void *levelp)
+zstd_compress(log_func_t *log, const void *input, size_t inlen, void **outputp, size_t *outlenp, void *levelp,
+    const struct comp_dict *dict)
 {
+    struct comp_thread *ct;
     u_long clen;
     void *cbuf;
     int level;
     int r;
 
+    // Get this thread's context
+    if ((ct = comp_get_thread(log)) == NULL)
+        return ENOMEM;
+    if (ct->zstd_cctx == NULL && (ct->zstd_cctx = ZSTD_createCCtx()) == NULL) {
+        (*log)(LOG_ERR, "zstd compress: %s", strerror(ENOMEM));
+        return ENOMEM;
+    }
+
     // Allocate buffer
     clen = ZSTD_compressBound(inlen);
     if ((cbuf = malloc(clen)) == NULL) {
@@ -230,7 +539,10 @@ zstd_compress(log_func_t *log, const void *input, size_t inlen, void **outputp,
     level = levelp != NULL ? *(int *)levelp : ZSTD_CLEVEL_DEFAULT;
 
     // Compress data
-    clen = ZSTD_compress(cbuf, clen, input, inlen, level);
+    if (dict != NULL)
+        clen = ZSTD_compress_usingCDict(ct->zstd_cctx, cbuf, clen, input, inlen, dict->cdict);
+    else
+        clen = ZSTD_compressCCtx(ct->zstd_cctx, cbuf, clen, input, inlen, level);
     if (ZSTD_isError(clen)) {
         (*log)(LOG_ERR, "zstd compress: error, %s", ZSTD_getErrorName(clen));
         free(cbuf);
@@ -244,12 +556,25 @@ zstd_compress(log_func_t *log, const void *input, size_t inlen, void **outputp,
 }
 
 static int
-zstd_decompress(log_func_t *log, const void *input, size_t inlen, void *output, size_t *outlenp)
+zstd_decompress(log_func_t *log, const void *input, size_t inlen, void *output, size_t *outlenp,
+    const struct comp_dict *dict)
 {
+    struct comp_thread *ct;
     size_t code;
 
+    // Get this thread's context
+    if ((ct = comp_get_thread(log)) == NULL)
+        return ENOMEM;
+    if (ct->zstd_dctx == NULL && (ct->zstd_dctx = ZSTD_createDCtx()) == NULL) {
+        (*log)(LOG_ERR, "zstd uncompress: %s", strerror(ENOMEM));
+        return ENOMEM;
+    }
+
     // Decompress
-    code = ZSTD_decompress(output, *outlenp, input, inlen);
+    if (dict != NULL)
+        code = ZSTD_decompress_usingDDict(ct->zstd_dctx, output, *outlenp, input, inlen, dict->ddict);
+    else
+        code = ZSTD_decompressDCtx(ct->zstd_dctx, output, *outlenp, input, inlen);
     if (ZSTD_isError(code)) {
         (*log)(LOG_ERR, "zstd uncompress: %s", ZSTD_getErrorName(code));
         return EIO;
@@ -282,12 +607,139 @@ invalid:
     warnx("invalid zstd compression level `%s'", string);
     return NULL;
 }
+
+static int
+zstd_dtrain(log_func_t *log, const void *samples, const size_t *sample_lens, u_int num_samples, void **dictp, size_t *dict_lenp)
+{
+    void *dict;
+    size_t len;
+    int r;
+
+    // Allocate buffer
+    if ((dict = malloc(COMP_DICT_MAX_SIZE)) == NULL) {
+        r = errno;
+        (*log)(LOG_ERR, "malloc: %s", strerror(r));
+        return r;
+    }
+
+    // Train dictionary
+    len = ZDICT_trainFromBuffer(dict, COMP_DICT_MAX_SIZE, samples, sample_lens, num_samples);
+    if (ZDICT_isError(len)) {
+        (*log)(LOG_ERR, "zstd dictionary training failed: %s", ZDICT_getErrorName(len));
+        free(dict);
+        return EINVAL;
+    }
+
+    // Done
+    *dictp = dict;
+    *dict_lenp = len;
+    return 0;
+}
+
+static struct comp_dict *
+zstd_dload(log_func_t *log, const void *data, size_t len, void *levelp)
+{
+    struct comp_dict *dict;
+    int level;
+    int r;
+
+    // Extract compression level
+    level = levelp != NULL ? *(int *)levelp : ZSTD_CLEVEL_DEFAULT;
+
+    // Create dictionary
+    if ((dict = calloc(1, sizeof(*dict))) == NULL) {
+        r = errno;
+        (*log)(LOG_ERR, "calloc: %s", strerror(r));
+        goto fail0;
+    }
+    if ((dict->id = ZDICT_getDictID(data, len)) == 0) {
+        (*log)(LOG_ERR, "zstd dictionary is invalid");
+        r = EINVAL;
+        goto fail1;
+    }
+    if ((dict->cdict = ZSTD_createCDict(data, len, level)) == NULL
+      || (dict->ddict = ZSTD_createDDict(data, len)) == NULL) {
+        (*log)(LOG_ERR, "zstd dictionary can't be loaded");
+        r = ENOMEM;
+        goto fail2;
+    }
+
+    // Done
+    return dict;
+
+fail2:
+    ZSTD_freeCDict(dict->cdict);                // OK if NULL
+fail1:
+    free(dict);
+fail0:
+    errno = r;
+    return NULL;
+}
+
+static void
+zstd_dfree(struct comp_dict *dict)
+{
+    if (dict == NULL)
+        return;
+    ZSTD_freeCDict(dict->cdict);
+    ZSTD_freeDDict(dict->ddict);
+    free(dict);
+}
+
+static uint32_t
+zstd_dneeds(const void *input, size_t inlen)
+{
+    return ZSTD_getDictID_fromFrame(input, inlen);
+}
 #endif
 
 /****************************************************************************
  *                          INTERNAL HELPERS                                *
  ****************************************************************************/
 
+/*
+ * Compute log2() of a positive integer as an 8.8 fixed point value.
+ *
+ * The fractional part is linearly interpolated, which is accurate to within 0.09 bits.
+ */
+static u_int
+comp_log2_fixed(u_int value)
+{
+    u_int bits = 0;
+
+    assert(value > 0);
+    while ((value >> bits) > 1)
+        bits++;
+    return (bits << 8) + (u_int)(((uint64_t)value << 8) >> bits) - 256;
+}
+
+/*
+ * Raise or lower the compression level depending on whether the CPU or the network is the bottleneck.
+ *
+ * This assumes the mutex is held.
+ */
+static void
+comp_adapt_adjust(struct comp_adapt *adapt)
+{
+    const struct comp_alg *const calg = adapt->calg;
+    int level = adapt->level;
+
+    // Compare time spent compressing a block with time spent uploading it
+    if (adapt->cpu_time > adapt->upload_time && level > calg->min_level)
+        level--;
+    else if (adapt->cpu_time * ADAPT_NETWORK_MARGIN < adapt->upload_time && level < calg->max_level)
+        level++;
+    adapt->count = 0;
+    if (level == adapt->level)
+        return;
+
+    // Switch to new level and start measuring it afresh
+    (*adapt->log)(LOG_DEBUG, "%s compression level %d -> %d (compress %.3f ms/block, upload %.3f ms/block)",
+      calg->name, adapt->level, level, adapt->cpu_time * 1000.0, adapt->upload_time * 1000.0);
+    adapt->level = level;
+    adapt->cpu_time = 0.0;
+}
+
 static int *
 parse_integer_level(const char *string)
 {
@@ -318,3 +770,63 @@ free_integer_level(void *levelp)
 {
     free(levelp);
 }
+
+/*
+ * Get the current thread's compression state, creating it on demand. Returns NULL (after logging) if that fails.
+ *
+ * The individual streams and contexts are created lazily by the functions that use them.
+ */
+static struct comp_thread *
+comp_get_thread(log_func_t *log)
+{
+    struct comp_thread *ct;
+    int r;
+
+    // Create key on first use
+    pthread_once(&comp_thread_once, comp_create_thread_key);
+    if ((r = comp_thread_key_error) != 0)
+        goto fail;
+
+    // Already created?
+    if ((ct = pthread_getspecific(comp_thread_key)) != NULL)
+        return ct;
+
+    // Create new state for this thread
+    if ((ct = calloc(1, sizeof(*ct))) == NULL) {
+        r = errno;
+        goto fail;
+    }
+    if ((r = pthread_setspecific(comp_thread_key, ct)) != 0) {
+        free(ct);
+        goto fail;
+    }
+
+    // Done
+    return ct;
+
+fail:
+    (*log)(LOG_ERR, "can't create compression state: %s", strerror(r));
+    return NULL;
+}
+
+static void
+comp_create_thread_key(void)
+{
+    comp_thread_key_error = pthread_key_create(&comp_thread_key, comp_free_thread);
+}
+
+static void
+comp_free_thread(void *arg)
+{
+    struct comp_thread *const ct = arg;
+
+    if (ct->deflate_valid)
+        (void)deflateEnd(&ct->deflate);
+    if (ct->inflate_valid)
+        (void)inflateEnd(&ct->inflate);
+#if ZSTD
+    ZSTD_freeCCtx(ct->zstd_cctx);               // OK if NULL
+    ZSTD_freeDCtx(ct->zstd_dctx);               // OK if NULL
+#endif
+    free(ct);
+}
@@ -34,6 +34,16 @@
  * also delete it here.
  */
 
+// Maximum size of a trained compression dictionary
+#define COMP_DICT_MAX_SIZE  (110 * 1024)
+
+// A compression dictionary that has been digested for use
+struct comp_dict {
+    uint32_t        id;                 // dictionary ID (never zero)
+    void            *cdict;             // algorithm-specific compression state
+    void            *ddict;             // algorithm-specific decompression state
+};
+
 /*
  * Compression function
  *
@@ -44,9 +54,11 @@
  * inlen - length of input
  * outputp - on successful return, points to compressed data in a malloc'd buffer
  * outlenp - on successful return, length of *outputp
- * level - compression level info from parse function, or NULL for default
+ * level - compression level info from parse function, or NULL for default (ignored if dict is not NULL)
+ * dict - dictionary to compress with, or NULL for none
  */
-typedef int         comp_cfunc_t(log_func_t *log, const void *input, size_t inlen, void **outputp, size_t *outlenp, void *level);
+typedef int         comp_cfunc_t(log_func_t *log, const void *input, size_t inlen, void **outputp, size_t *outlenp, void *level,
+                        const struct comp_dict *dict);
 
 /*
  * Decompression function
@@ -60,8 +72,10 @@ typedef int         comp_cfunc_t(log_func_t *log, const void *input, size_t inle
  * outlenp
  *      - on invocation, points to maximum possible/expected length of decompressed data
  *      - on successful return, points to the actual length of decompressed data
+ * dict - the dictionary identified by the compressed data (see comp_dneeds_t), or NULL for none
  */
-typedef int         comp_dfunc_t(log_func_t *log, const void *input, size_t inlen, void *output, size_t *outlenp);
+typedef int         comp_dfunc_t(log_func_t *log, const void *input, size_t inlen, void *output, size_t *outlenp,
+                        const struct comp_dict *dict);
 
 /*
  * Compression level parsing function.
@@ -83,6 +97,45 @@ typedef void        *comp_lparse_t(const char *string);
  */
 typedef void        comp_lfree_t(void *value);
 
+/*
+ * Dictionary training function.
+ *
+ * Returns 0 on success, otherwise (positive) error code.
+ *
+ * log - where to log errors
+ * samples - sample data, concatenated
+ * sample_lens - length of each sample
+ * num_samples - number of samples
+ * dictp - on successful return, points to the dictionary in a malloc'd buffer of at most COMP_DICT_MAX_SIZE bytes
+ * dict_lenp - on successful return, length of *dictp
+ */
+typedef int         comp_dtrain_t(log_func_t *log, const void *samples, const size_t *sample_lens, u_int num_samples,
+                        void **dictp, size_t *dict_lenp);
+
+/*
+ * Dictionary load function.
+ *
+ * Returns the digested dictionary on success, otherwise logs an error and returns NULL with errno set.
+ *
+ * log - where to log errors
+ * data - dictionary previously returned by comp_dtrain_t
+ * len - length of data
+ * level - compression level info from parse function, or NULL for default
+ */
+typedef struct comp_dict *comp_dload_t(log_func_t *log, const void *data, size_t len, void *level);
+
+/*
+ * Dictionary free function. Must gracefully handle NULL.
+ */
+typedef void        comp_dfree_t(struct comp_dict *dict);
+
+/*
+ * Dictionary identification function.
+ *
+ * Returns the ID of the dictionary required to decompress the given compressed data, or zero if none.
+ */
+typedef uint32_t    comp_dneeds_t(const void *input, size_t inlen);
+
 // Compression algorithms
 struct comp_alg {
     const char      *name;
@@ -90,11 +143,32 @@ struct comp_alg {
     comp_dfunc_t    *dfunc;
     comp_lparse_t   *lparse;
     comp_lfree_t    *lfree;
+
+    // Dictionary support (optional; these are all NULL if not supported)
+    comp_dtrain_t   *dtrain;
+    comp_dload_t    *dload;
+    comp_dfree_t    *dfree;
+    comp_dneeds_t   *dneeds;
+
+    // Range of integer levels for adaptive compression (zero max_level if not supported); level info must be an int *
+    int             min_level;
+    int             max_level;
+    int             default_level;
 };
 
+// Adaptive compression state (see comp_adapt_create())
+struct comp_adapt;
+
 // Globals
 extern const size_t num_comp_algs;
 extern const struct comp_alg comp_algs[];
 
 // Functions
 extern const struct comp_alg *comp_find(const char *name);
+extern int comp_probe_incompressible(const void *data, size_t len);
+extern struct comp_adapt *comp_adapt_create(log_func_t *log, const struct comp_alg *calg, void *level);
+extern void comp_adapt_destroy(struct comp_adapt *adapt);
+extern int comp_adapt_compress(struct comp_adapt *adapt, const void *input, size_t inlen, void **outputp, size_t *outlenp,
+    const struct comp_dict *dict);
+extern void comp_adapt_uploaded(struct comp_adapt *adapt, double secs);
+extern int comp_adapt_level(struct comp_adapt *adapt);
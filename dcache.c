@@ -39,6 +39,10 @@
 #include "dcache.h"
 #include "util.h"
 
+#if LIBURING
+#include <liburing.h>
+#endif
+
 /*
  * This file implements a simple on-disk storage area for cached blocks.
  * The file contains a header, a directory, and a data area. Each directory
@@ -60,12 +64,40 @@
  *  data slot #1
  *  ...
  *  data slot #N-1
+ *
+ * If config->use_mmap is set, the data area is memory mapped and block data is copied directly to/from
+ * the mapping instead of through pread(2)/pwrite(2). In that case the file is always extended to its full
+ * size (sparsely) so that every data slot is backed by the file.
+ *
+ * Updates that must reach the disk in a particular order (data, then fsync, then directory entry, or
+ * directory entry, then fsync) are described as a short chain of operations and performed together
+ * by s3b_dcache_perform(). If config->use_uring is set, each chain is submitted to a per-thread io_uring
+ * as a sequence of linked requests, so it costs one system call instead of one per step. Should anything
+ * go wrong partway through a chain, the remaining steps are redone the normal way.
+ *
+ * If config->use_index is set, a compact snapshot of the directory is written to a separate index file
+ * at close time, and the cache file header records the snapshot's generation number and sets the
+ * HDRFLG_INDEX_VALID flag. The next time the cache file is opened, if that flag is set, the generations
+ * match, and the snapshot's checksum is valid, the directory is reconstructed from the snapshot in one
+ * sequential read instead of by reading the entire directory. The flag is cleared as soon as the file is
+ * opened, before anything else changes, so a snapshot is never trusted after an unclean shutdown. Using a
+ * header flag also means older versions, which don't maintain the snapshot, refuse to open the file instead
+ * of modifying the directory and leaving behind a snapshot that appears valid.
+ *
+ * Synchronizing the file is done as a group commit: if one thread is already syncing, other threads
+ * wanting a sync wait for the next one, which is performed once on behalf of all of them. Optionally,
+ * the thread doing a sync first waits config->sync_delay microseconds to let more requests accumulate.
+ * Plain directory entry writes only go to the page cache, so it's the syncs that are expensive.
  */
 
 // Definitions
 #define DCACHE_SIGNATURE            0xe496f17b
+#define INDEX_SIGNATURE             0x3c81d5a9
+#define INDEX_SUFFIX                ".index"
 #define ROUNDUP2(x, y)              (((x) + (y) - 1) & ~((y) - 1))
 #define DIRECTORY_READ_CHUNK        1024
+#define MAX_DCACHE_OPS              3
+#define DCACHE_RING_DEPTH           8
 
 #define HDR_SIZE(flags)             (((flags) & HDRFLG_NEW_FORMAT) == 0 ? sizeof(struct ofile_header) : sizeof(struct file_header))
 #define DIR_ENTSIZE(flags)          (((flags) & HDRFLG_NEW_FORMAT) == 0 ? sizeof(struct odir_entry) : sizeof(struct dir_entry))
@@ -74,7 +106,8 @@
 
 // Bits for file_header.flags
 #define HDRFLG_NEW_FORMAT           0x00000001
-#define HDRFLG_MASK                 0x00000001
+#define HDRFLG_INDEX_VALID          0x00000002          // index snapshot is valid (older versions refuse the file)
+#define HDRFLG_MASK                 0x00000003
 
 // Bits for dir_entry.flags
 #define ENTFLG_DIRTY                0x00000001
@@ -103,7 +136,8 @@ struct file_header {
     uint32_t                        flags;
     u_int                           max_blocks;
     int32_t                         mount_token;
-    uint32_t                        spare[7];           // future expansion
+    uint32_t                        index_gen;          // generation of most recent index snapshot
+    uint32_t                        spare[6];           // future expansion
 } __attribute__ ((packed));
 
 // One directory entry (old format)
@@ -119,24 +153,77 @@ struct dir_entry {
     uint32_t                        flags;
 } __attribute__ ((packed));
 
+// Index snapshot file header
+struct index_header {
+    uint32_t                        signature;
+    uint32_t                        header_size;
+    uint32_t                        block_size;
+    uint32_t                        flags;              // copy of file_header.flags, minus HDRFLG_INDEX_VALID
+    u_int                           max_blocks;
+    u_int                           num_entries;
+    uint32_t                        generation;         // must match file_header.index_gen
+    uint32_t                        checksum;           // crc32 of the entries
+} __attribute__ ((packed));
+
+// Index snapshot entry, one for each non-empty directory entry in increasing dslot order
+struct index_entry {
+    u_int                           dslot;
+    struct dir_entry                entry;
+} __attribute__ ((packed));
+
 // Private structure
 struct s3b_dcache {
     int                             fd;
     log_func_t                      *log;
     char                            *filename;
+    char                            *index_filename;    // index snapshot file, or NULL if not maintaining one
+    uint32_t                        index_gen;          // generation of the most recent index snapshot
     u_int                           block_size;
     u_int                           max_blocks;
     u_int                           num_alloc;
     u_int                           fadvise;
-    uint32_t                        flags;              // copy of file_header.flags
+    u_int                           use_uring;          // submit ordered updates via io_uring
+#if LIBURING
+    pthread_key_t                   ring_key;           // each thread's struct io_uring
+#endif
+    uint32_t                        flags;              // copy of file_header.flags, minus HDRFLG_INDEX_VALID
     off_t                           data;
+    char                            *map;               // memory mapped data area, or NULL
+    size_t                          map_size;           // length of memory mapped data area
     u_int                           free_list_len;
     u_int                           free_list_alloc;
     s3b_block_t                     *free_list;
+    pthread_mutex_t                 sync_mutex;         // protects the following fields
+    pthread_cond_t                  sync_cond;          // signaled when a sync completes
+    uint64_t                        sync_requested;     // number of sync requests so far
+    uint64_t                        sync_completed;     // all requests up through this one are synced
+    u_int                           syncing;            // a sync is in progress
+    u_int                           sync_delay;         // group commit delay in microseconds
+    struct latency_hist             read_latency;       // pread(2) of block data
+    struct latency_hist             write_latency;      // pwrite(2) of block data or directory entries
+    struct latency_hist             fsync_latency;      // fdatasync(2) or fsync(2)
+};
+
+// One step in a chain of ordered cache file updates
+struct dcache_op {
+    u_int                           fsync;              // if true, fdatasync(); otherwise, write
+    off_t                           offset;             // write offset
+    const void                      *data;              // write data
+    size_t                          len;                // write length
 };
 
 // Internal functions
 static int s3b_dcache_write_entry(struct s3b_dcache *priv, u_int dslot, const struct dir_entry *entry);
+static void s3b_dcache_init_entry(struct s3b_dcache *priv, struct dir_entry *entry, s3b_block_t block_num, const u_char *etag);
+static int s3b_dcache_perform(struct s3b_dcache *priv, const struct dcache_op *ops, u_int num_ops);
+#if LIBURING
+static int s3b_dcache_init_uring(struct s3b_dcache *priv);
+static struct io_uring *s3b_dcache_get_ring(struct s3b_dcache *priv);
+static u_int s3b_dcache_perform_ring(struct s3b_dcache *priv, struct io_uring *ring, const struct dcache_op *ops, u_int num_ops);
+static void s3b_dcache_free_ring(void *arg);
+#endif
+static void s3b_dcache_advise(struct s3b_dcache *priv, u_int dslot);
+static void s3b_dcache_sync_file(struct s3b_dcache *priv);
 #ifndef NDEBUG
 static int s3b_dcache_entry_is_empty(struct s3b_dcache *priv, u_int dslot);
 static int s3b_dcache_entry_write_ok(struct s3b_dcache *priv, u_int dslot, s3b_block_t block_num, u_int dirty);
@@ -145,7 +232,12 @@ static int s3b_dcache_read_entry(struct s3b_dcache *priv, u_int dslot, struct di
 static int s3b_dcache_create_file(struct s3b_dcache *priv, int *fdp, const char *filename, u_int max_blocks,
             struct file_header *headerp);
 static int s3b_dcache_resize_file(struct s3b_dcache *priv, const struct file_header *header);
-static int s3b_dcache_init_free_list(struct s3b_dcache *priv, s3b_dcache_visit_t *visitor, void *arg, u_int visit_dirty);
+static int s3b_dcache_init_free_list(struct s3b_dcache *priv, s3b_dcache_visit_t *visitor, void *arg, u_int visit_dirty,
+            const struct index_entry *index, u_int index_len);
+static int s3b_dcache_read_index(struct s3b_dcache *priv, struct index_entry **indexp, u_int *index_lenp);
+static int s3b_dcache_write_index(struct s3b_dcache *priv);
+static int s3b_dcache_set_index_valid(struct s3b_dcache *priv, uint32_t generation);
+static int s3b_dcache_map_data(struct s3b_dcache *priv);
 static int s3b_dcache_push(struct s3b_dcache *priv, u_int dslot);
 static void s3b_dcache_pop(struct s3b_dcache *priv, u_int *dslotp);
 static int s3b_dcache_read(struct s3b_dcache *priv, off_t offset, void *data, size_t len);
@@ -183,16 +275,21 @@ s3b_dcache_open(struct s3b_dcache **dcachep, struct block_cache_conf *config,
     priv->block_size = config->block_size;
     priv->max_blocks = config->cache_size;
     priv->fadvise = config->fadvise;
+    priv->sync_delay = config->sync_delay;
     if ((priv->filename = strdup(config->cache_file)) == NULL) {
         r = errno;
         goto fail1;
     }
+    if ((r = pthread_mutex_init(&priv->sync_mutex, NULL)) != 0)
+        goto fail2;
+    if ((r = pthread_cond_init(&priv->sync_cond, NULL)) != 0)
+        goto fail3;
 
     // Create cache file if it doesn't already exist
     if (stat(priv->filename, &sb) == -1 && errno == ENOENT) {
         (*priv->log)(LOG_NOTICE, "creating new cache file `%s' with capacity %u blocks", priv->filename, priv->max_blocks);
         if ((r = s3b_dcache_create_file(priv, &priv->fd, priv->filename, priv->max_blocks, NULL)) != 0)
-            goto fail2;
+            goto fail4;
         (void)close(priv->fd);
         priv->fd = -1;
     }
@@ -203,13 +300,13 @@ retry:
     if ((priv->fd = open(priv->filename, O_RDWR|O_CLOEXEC, 0)) == -1) {
         r = errno;
         (*priv->log)(LOG_ERR, "can't open cache file `%s': %s", priv->filename, strerror(r));
-        goto fail2;
+        goto fail4;
     }
 
     // Get file info
     if (fstat(priv->fd, &sb) == -1) {
         r = errno;
-        goto fail3;
+        goto fail5;
     }
 
     // Read in header with backward compatible support for older header format
@@ -217,11 +314,11 @@ retry:
         (*priv->log)(LOG_ERR, "invalid cache file `%s': file is truncated (size %ju < %u)",
           priv->filename, (uintmax_t)sb.st_size, (u_int)sizeof(oheader));
         r = EINVAL;
-        goto fail3;
+        goto fail5;
     }
     if ((r = s3b_dcache_read(priv, (off_t)0, &oheader, sizeof(oheader))) != 0) {
         (*priv->log)(LOG_ERR, "can't read cache file `%s' header: %s", priv->filename, strerror(r));
-        goto fail3;
+        goto fail5;
     }
     switch (oheader.header_size) {
     case sizeof(oheader):                               // old format
@@ -231,13 +328,13 @@ retry:
     case sizeof(header):                                // new format
         if ((r = s3b_dcache_read(priv, (off_t)0, &header, sizeof(header))) != 0) {
             (*priv->log)(LOG_ERR, "can't read cache file `%s' header: %s", priv->filename, strerror(r));
-            goto fail3;
+            goto fail5;
         }
         break;
     default:
         (*priv->log)(LOG_ERR, "invalid cache file `%s': %s %d", priv->filename, "invalid header size", (int)oheader.header_size);
         r = EINVAL;
-        goto fail3;
+        goto fail5;
     }
 
     // Verify header - all but number of blocks
@@ -245,38 +342,38 @@ retry:
     if (header.signature != DCACHE_SIGNATURE) {
         (*priv->log)(LOG_ERR, "invalid cache file `%s': wrong signature %08x != %08x",
           priv->filename, header.signature, DCACHE_SIGNATURE);
-        goto fail3;
+        goto fail5;
     }
     if (header.header_size != HDR_SIZE(header.flags)) {
         (*priv->log)(LOG_ERR, "invalid cache file `%s': %s %d != %d",
           priv->filename, "invalid header size", (int)header.header_size, (int)HDR_SIZE(header.flags));
-        goto fail3;
+        goto fail5;
     }
     if (header.u_int_size != sizeof(u_int)) {
         (*priv->log)(LOG_ERR, "invalid cache file `%s': created with sizeof(u_int) %u != %u",
           priv->filename, header.u_int_size, (u_int)sizeof(u_int));
-        goto fail3;
+        goto fail5;
     }
     if (header.s3b_block_t_size != sizeof(s3b_block_t)) {
         (*priv->log)(LOG_ERR, "invalid cache file `%s': created with sizeof(s3b_block_t) %u != %u",
           priv->filename, header.s3b_block_t_size, (u_int)sizeof(s3b_block_t));
-        goto fail3;
+        goto fail5;
     }
     if (header.block_size != priv->block_size) {
         (*priv->log)(LOG_ERR, "invalid cache file `%s': created with block size %u != %u",
           priv->filename, header.block_size, priv->block_size);
-        goto fail3;
+        goto fail5;
     }
     if (header.data_align != getpagesize()) {
         (*priv->log)(LOG_ERR, "invalid cache file `%s': created with alignment %u != %u",
           priv->filename, header.data_align, getpagesize());
-        goto fail3;
+        goto fail5;
     }
     if ((header.flags & ~HDRFLG_MASK) != 0) {
         (*priv->log)(LOG_ERR, "invalid cache file `%s': %s", priv->filename, "unrecognized flags present");
-        goto fail3;
+        goto fail5;
     }
-    priv->flags = header.flags;
+    priv->flags = header.flags & ~HDRFLG_INDEX_VALID;
 
     // Check number of blocks, shrinking or expanding if necessary
     if (header.max_blocks != priv->max_blocks) {
@@ -284,7 +381,7 @@ retry:
           priv->filename, header.max_blocks, priv->max_blocks, header.max_blocks < priv->max_blocks ?
            "expanding" : "shrinking");
         if ((r = s3b_dcache_resize_file(priv, &header)) != 0)
-            goto fail3;
+            goto fail5;
         (*priv->log)(LOG_INFO, "successfully resized cache file `%s' from %u to %u blocks",
           priv->filename, header.max_blocks, priv->max_blocks);
         goto retry;
@@ -294,15 +391,60 @@ retry:
     if (sb.st_size < DIR_OFFSET(priv->flags, priv->max_blocks)) {
         (*priv->log)(LOG_ERR, "invalid cache file `%s': file is truncated (size %ju < %ju)",
           priv->filename, (uintmax_t)sb.st_size, (uintmax_t)DIR_OFFSET(priv->flags, priv->max_blocks));
-        goto fail3;
+        goto fail5;
     }
 
     // Compute offset of first data block
     priv->data = ROUNDUP2(DIR_OFFSET(priv->flags, priv->max_blocks), header.data_align);
 
-    // Read the directory to build the free list and visit allocated blocks
-    if (visitor != NULL && (r = s3b_dcache_init_free_list(priv, visitor, arg, visit_dirty)) != 0)
-        goto fail3;
+    // Read the directory to build the free list and visit allocated blocks, using the index snapshot if possible
+    if (visitor != NULL) {
+        struct index_entry *index = NULL;
+        u_int index_len = 0;
+
+        // Read index snapshot, if any
+        if ((priv->flags & HDRFLG_NEW_FORMAT) != 0) {
+            if (asprintf(&priv->index_filename, "%s%s", priv->filename, INDEX_SUFFIX) == -1) {
+                r = errno;
+                priv->index_filename = NULL;
+                goto fail5;
+            }
+            priv->index_gen = header.index_gen;
+            if ((header.flags & HDRFLG_INDEX_VALID) != 0
+              && config->use_index && s3b_dcache_read_index(priv, &index, &index_len) != 0)
+                index = NULL;
+        }
+
+        // Invalidate the snapshot before anything else changes
+        if (priv->index_filename != NULL) {
+            if ((header.flags & HDRFLG_INDEX_VALID) != 0 && (r = s3b_dcache_set_index_valid(priv, 0)) != 0) {
+                free(index);
+                goto fail5;
+            }
+            if (unlink(priv->index_filename) == -1 && errno != ENOENT)
+                (*priv->log)(LOG_WARNING, "can't remove index file `%s': %s", priv->index_filename, strerror(errno));
+            if (!config->use_index) {
+                free(priv->index_filename);
+                priv->index_filename = NULL;
+            }
+        }
+
+        // Build free list and visit blocks
+        r = s3b_dcache_init_free_list(priv, visitor, arg, visit_dirty, index, index_len);
+        free(index);
+        if (r != 0)
+            goto fail5;
+    }
+
+    // Memory map the data area if so configured
+    if (config->use_mmap && (r = s3b_dcache_map_data(priv)) != 0)
+        goto fail5;
+
+    // Set up io_uring if so configured; if it's not supported here, we just do without
+#if LIBURING
+    if (config->use_uring && s3b_dcache_init_uring(priv) == 0)
+        priv->use_uring = 1;
+#endif
 
 #if HAVE_SYS_STATVFS_H
 
@@ -330,8 +472,15 @@ retry:
     *dcachep = priv;
     return 0;
 
-fail3:
+fail5:
+    if (priv->map != NULL)
+        (void)munmap(priv->map, priv->map_size);
     close(priv->fd);
+    free(priv->index_filename);
+fail4:
+    pthread_cond_destroy(&priv->sync_cond);
+fail3:
+    pthread_mutex_destroy(&priv->sync_mutex);
 fail2:
     free(priv->filename);
 fail1:
@@ -375,12 +524,46 @@ s3b_dcache_set_mount_token(struct s3b_dcache *priv, int32_t *old_valuep, int32_t
 void
 s3b_dcache_close(struct s3b_dcache *priv)
 {
+    if (priv->index_filename != NULL)
+        (void)s3b_dcache_write_index(priv);
+    if (priv->map != NULL && munmap(priv->map, priv->map_size) == -1)
+        (*priv->log)(LOG_ERR, "error unmapping cache file `%s': %s", priv->filename, strerror(errno));
+#if LIBURING
+    if (priv->use_uring) {
+        struct io_uring *const ring = pthread_getspecific(priv->ring_key);
+
+        // Other threads' rings are freed when those threads exit
+        if (ring != NULL)
+            s3b_dcache_free_ring(ring);
+        (void)pthread_key_delete(priv->ring_key);
+    }
+#endif
     close(priv->fd);
+    pthread_cond_destroy(&priv->sync_cond);
+    pthread_mutex_destroy(&priv->sync_mutex);
+    free(priv->index_filename);
     free(priv->filename);
     free(priv->free_list);
     free(priv);
 }
 
+void
+s3b_dcache_get_stats(struct s3b_dcache *priv,
+  struct latency_hist *read_latency, struct latency_hist *write_latency, struct latency_hist *fsync_latency)
+{
+    latency_hist_copy(read_latency, &priv->read_latency);
+    latency_hist_copy(write_latency, &priv->write_latency);
+    latency_hist_copy(fsync_latency, &priv->fsync_latency);
+}
+
+void
+s3b_dcache_clear_stats(struct s3b_dcache *priv)
+{
+    latency_hist_clear(&priv->read_latency);
+    latency_hist_clear(&priv->write_latency);
+    latency_hist_clear(&priv->fsync_latency);
+}
+
 u_int
 s3b_dcache_size(struct s3b_dcache *priv)
 {
@@ -423,8 +606,8 @@ int
 s3b_dcache_record_block(struct s3b_dcache *priv, u_int dslot, s3b_block_t block_num, const u_char *etag)
 {
     const u_int dirty = etag == NULL;
+    struct dcache_op ops[2];
     struct dir_entry entry;
-    int r;
 
     // Sanity check
     assert(dslot < priv->max_blocks);
@@ -439,19 +622,62 @@ s3b_dcache_record_block(struct s3b_dcache *priv, u_int dslot, s3b_block_t block_
     }
 
     // Make sure any new data is written to disk before updating the directory
-    if ((r = s3b_dcache_fsync(priv)) != 0)
+    s3b_dcache_init_entry(priv, &entry, block_num, etag);
+    memset(ops, 0, sizeof(ops));
+    ops[0].fsync = 1;
+    ops[1].offset = DIR_OFFSET(priv->flags, dslot);
+    ops[1].data = &entry;
+    ops[1].len = DIR_ENTSIZE(priv->flags);
+    return s3b_dcache_perform(priv, ops, 2);
+}
+
+/*
+ * Write a block's data into a dslot and then record it in the directory. This is equivalent to
+ * s3b_dcache_write_block() for the entire block followed by s3b_dcache_record_block(), except
+ * the updates are performed as a single chain. A NULL src means the block is all zeroes.
+ *
+ * If this function returns an error, the directory entry is left empty (if possible).
+ *
+ * There MUST NOT be a directory entry for the block.
+ */
+int
+s3b_dcache_store_block(struct s3b_dcache *priv, u_int dslot, s3b_block_t block_num, const void *src, const u_char *etag)
+{
+    const u_int dirty = etag == NULL;
+    struct dcache_op ops[MAX_DCACHE_OPS];
+    struct dir_entry entry;
+    int r;
+
+    // Sanity check
+    assert(dslot < priv->max_blocks);
+    assert(s3b_dcache_entry_write_ok(priv, dslot, block_num, dirty));
+
+    // If the data doesn't go through the file descriptor, or the entry needs special handling, do it the normal way
+    if (priv->map != NULL || (dirty && (priv->flags & HDRFLG_NEW_FORMAT) == 0)) {
+        if ((r = s3b_dcache_write_block(priv, dslot, src, 0, priv->block_size)) != 0)
+            return r;
+        if ((r = s3b_dcache_record_block(priv, dslot, block_num, etag)) != 0)
+            (void)s3b_dcache_write_entry(priv, dslot, &zero_entry);
         return r;
+    }
 
-    // Update directory
-    memset(&entry, 0, sizeof(entry));
-    entry.block_num = block_num;
-    entry.flags = dirty ? ENTFLG_DIRTY : 0;
-    if (!dirty)
-        memcpy(&entry.etag, etag, MD5_DIGEST_LENGTH);
-    if ((r = s3b_dcache_write_entry(priv, dslot, &entry)) != 0)
+    // Write data, fsync, then update directory
+    s3b_dcache_init_entry(priv, &entry, block_num, etag);
+    memset(ops, 0, sizeof(ops));
+    ops[0].offset = DATA_OFFSET(priv, dslot);
+    ops[0].data = src != NULL ? src : zero_block;
+    ops[0].len = priv->block_size;
+    ops[1].fsync = 1;
+    ops[2].offset = DIR_OFFSET(priv->flags, dslot);
+    ops[2].data = &entry;
+    ops[2].len = DIR_ENTSIZE(priv->flags);
+    if ((r = s3b_dcache_perform(priv, ops, 3)) != 0) {
+        (void)s3b_dcache_write_entry(priv, dslot, &zero_entry);
         return r;
+    }
 
     // Done
+    s3b_dcache_advise(priv, dslot);
     return 0;
 }
 
@@ -466,21 +692,18 @@ s3b_dcache_record_block(struct s3b_dcache *priv, u_int dslot, s3b_block_t block_
 int
 s3b_dcache_erase_block(struct s3b_dcache *priv, u_int dslot)
 {
-    int r;
+    struct dcache_op ops[2];
 
     // Sanity check
     assert(dslot < priv->max_blocks);
 
-    // Update directory
-    if ((r = s3b_dcache_write_entry(priv, dslot, &zero_entry)) != 0)
-        return r;
-
-    // Make sure directory entry is written to disk before any new data is written
-    if ((r = s3b_dcache_fsync(priv)) != 0)
-        return r;
-
-    // Done
-    return 0;
+    // Update directory, and make sure directory entry is written to disk before any new data is written
+    memset(ops, 0, sizeof(ops));
+    ops[0].offset = DIR_OFFSET(priv->flags, dslot);
+    ops[0].data = &zero_entry;
+    ops[0].len = DIR_ENTSIZE(priv->flags);
+    ops[1].fsync = 1;
+    return s3b_dcache_perform(priv, ops, 2);
 }
 
 /*
@@ -522,17 +745,16 @@ s3b_dcache_read_block(struct s3b_dcache *priv, u_int dslot, void *dest, u_int of
     assert(len <= priv->block_size);
     assert(off + len <= priv->block_size);
 
-    // Read data
+    // Read data, directly from the mapping if we have one
+    if (priv->map != NULL) {
+        memcpy(dest, s3b_dcache_block_data(priv, dslot) + off, len);
+        return 0;
+    }
     if ((r = s3b_dcache_read(priv, DATA_OFFSET(priv, dslot) + off, dest, len)) != 0)
         return r;
 
-    // Advise the kernel to not cache this data block (note this may or may not work if transparent huge pages are being used)
-#if HAVE_DECL_POSIX_FADVISE
-    if (priv->fadvise && (r = posix_fadvise(priv->fd, DATA_OFFSET(priv, dslot), priv->block_size, POSIX_FADV_DONTNEED)) != 0)
-        (*priv->log)(LOG_WARNING, "posix_fadvise(\"%s\"): %s", priv->filename, strerror(r));
-#endif
-
     // Done
+    s3b_dcache_advise(priv, dslot);
     return 0;
 }
 
@@ -550,28 +772,95 @@ s3b_dcache_write_block(struct s3b_dcache *priv, u_int dslot, const void *src, u_
     assert(len <= priv->block_size);
     assert(off + len <= priv->block_size);
 
-    // Write data
+    // Write data, directly into the mapping if we have one
+    if (priv->map != NULL) {
+        if (src != NULL)
+            memcpy(s3b_dcache_block_data(priv, dslot) + off, src, len);
+        else
+            memset(s3b_dcache_block_data(priv, dslot) + off, 0, len);
+        return 0;
+    }
     if ((r = s3b_dcache_write(priv, DATA_OFFSET(priv, dslot) + off, src != NULL ? src : zero_block, len)) != 0)
         return r;
 
-    // Advise the kernel to not cache this data block (note this may or may not work if transparent huge pages are being used)
-#if HAVE_DECL_POSIX_FADVISE
-    if (priv->fadvise && (r = posix_fadvise(priv->fd, DATA_OFFSET(priv, dslot), priv->block_size, POSIX_FADV_DONTNEED)) != 0)
-        (*priv->log)(LOG_WARNING, "posix_fadvise(\"%s\"): %s", priv->filename, strerror(r));
-#endif
-
     // Done
+    s3b_dcache_advise(priv, dslot);
     return 0;
 }
 
+/*
+ * Get a pointer to the data for one dslot in the memory mapped data area.
+ *
+ * Returns NULL if the data area is not memory mapped.
+ */
+char *
+s3b_dcache_block_data(struct s3b_dcache *priv, u_int dslot)
+{
+    assert(dslot < priv->max_blocks);
+    if (priv->map == NULL)
+        return NULL;
+    return priv->map + (size_t)dslot * priv->block_size;
+}
+
 /*
  * Synchronize outstanding changes to persistent storage.
+ *
+ * All changes made prior to this function being invoked are synced by the time it returns,
+ * though the actual sync may be shared with other threads.
  */
 int
 s3b_dcache_fsync(struct s3b_dcache *priv)
 {
+    uint64_t ticket;
+    uint64_t target;
+
+    // Get in line
+    pthread_mutex_lock(&priv->sync_mutex);
+    ticket = ++priv->sync_requested;
+
+    // Wait for some sync that started after we got in line, volunteering to perform it if nobody else is
+    while (priv->sync_completed < ticket) {
+        if (priv->syncing) {
+            pthread_cond_wait(&priv->sync_cond, &priv->sync_mutex);
+            continue;
+        }
+        priv->syncing = 1;
+
+        // Give other threads a chance to join this sync
+        if (priv->sync_delay > 0) {
+            CHECK_RETURN(pthread_mutex_unlock(&priv->sync_mutex));
+            usleep(priv->sync_delay);
+            pthread_mutex_lock(&priv->sync_mutex);
+        }
+
+        // Sync everything requested so far
+        target = priv->sync_requested;
+        CHECK_RETURN(pthread_mutex_unlock(&priv->sync_mutex));
+        s3b_dcache_sync_file(priv);
+        pthread_mutex_lock(&priv->sync_mutex);
+        assert(target >= ticket);
+        priv->sync_completed = target;
+        priv->syncing = 0;
+        pthread_cond_broadcast(&priv->sync_cond);
+    }
+    CHECK_RETURN(pthread_mutex_unlock(&priv->sync_mutex));
+    return 0;
+}
+
+// Internal functions
+
+static void
+s3b_dcache_sync_file(struct s3b_dcache *priv)
+{
+    const uint64_t start_micros = latency_hist_micros();
     int r;
 
+    // Flush data written through the mapping (this is redundant on systems with a unified buffer cache)
+    if (priv->map != NULL && msync(priv->map, priv->map_size, MS_SYNC) == -1) {
+        r = errno;
+        (*priv->log)(LOG_ERR, "error msync'ing cache file `%s': %s", priv->filename, strerror(r));
+    }
+
 #if HAVE_DECL_FDATASYNC
     r = fdatasync(priv->fd);
 #else
@@ -580,12 +869,10 @@ s3b_dcache_fsync(struct s3b_dcache *priv)
     if (r == -1) {
         r = errno;
         (*priv->log)(LOG_ERR, "error fsync'ing cache file `%s': %s", priv->filename, strerror(r));
-    }
-    return 0;
+    } else
+        latency_hist_record(&priv->fsync_latency, latency_hist_micros() - start_micros);
 }
 
-// Internal functions
-
 #ifndef NDEBUG
 static int
 s3b_dcache_entry_is_empty(struct s3b_dcache *priv, u_int dslot)
@@ -629,6 +916,207 @@ s3b_dcache_write_entry(struct s3b_dcache *priv, u_int dslot, const struct dir_en
     return s3b_dcache_write(priv, DIR_OFFSET(priv->flags, dslot), entry, DIR_ENTSIZE(priv->flags));
 }
 
+static void
+s3b_dcache_init_entry(struct s3b_dcache *priv, struct dir_entry *entry, s3b_block_t block_num, const u_char *etag)
+{
+    memset(entry, 0, sizeof(*entry));
+    entry->block_num = block_num;
+    entry->flags = etag == NULL ? ENTFLG_DIRTY : 0;
+    if (etag != NULL)
+        memcpy(&entry->etag, etag, MD5_DIGEST_LENGTH);
+}
+
+/*
+ * Advise the kernel to not cache a data block (note this may or may not work if transparent huge pages are being used).
+ */
+static void
+s3b_dcache_advise(struct s3b_dcache *priv, u_int dslot)
+{
+#if HAVE_DECL_POSIX_FADVISE
+    int r;
+
+    if (priv->fadvise && (r = posix_fadvise(priv->fd, DATA_OFFSET(priv, dslot), priv->block_size, POSIX_FADV_DONTNEED)) != 0)
+        (*priv->log)(LOG_WARNING, "posix_fadvise(\"%s\"): %s", priv->filename, strerror(r));
+#endif
+}
+
+/*
+ * Perform a chain of cache file updates, in order.
+ *
+ * If we have an io_uring, the chain is first submitted there. Whatever did not complete successfully
+ * is then (re)done synchronously, which also takes care of reporting any error.
+ */
+static int
+s3b_dcache_perform(struct s3b_dcache *priv, const struct dcache_op *ops, u_int num_ops)
+{
+#if LIBURING
+    struct io_uring *ring;
+#endif
+    u_int i = 0;
+    int r;
+
+    // Sanity check
+    assert(num_ops <= MAX_DCACHE_OPS);
+
+    // Try io_uring first
+#if LIBURING
+    if (priv->use_uring && (ring = s3b_dcache_get_ring(priv)) != NULL)
+        i = s3b_dcache_perform_ring(priv, ring, ops, num_ops);
+#endif
+
+    // Do the rest synchronously
+    for ( ; i < num_ops; i++) {
+        const struct dcache_op *const op = &ops[i];
+
+        if ((r = op->fsync ? s3b_dcache_fsync(priv) : s3b_dcache_write(priv, op->offset, op->data, op->len)) != 0)
+            return r;
+    }
+
+    // Done
+    return 0;
+}
+
+#if LIBURING
+
+/*
+ * Initialize io_uring support.
+ *
+ * We also create the opening thread's ring right away, so that if the kernel doesn't support io_uring
+ * (or it's disabled) we find out now, once, rather than on every operation.
+ */
+static int
+s3b_dcache_init_uring(struct s3b_dcache *priv)
+{
+    struct io_uring *ring;
+    int r;
+
+    // Create thread-local key
+    if ((r = pthread_key_create(&priv->ring_key, s3b_dcache_free_ring)) != 0) {
+        (*priv->log)(LOG_WARNING, "can't create io_uring key for cache file `%s': %s", priv->filename, strerror(r));
+        return r;
+    }
+
+    // Verify we can create a ring
+    if ((ring = malloc(sizeof(*ring))) == NULL) {
+        r = errno;
+        goto fail1;
+    }
+    if ((r = -io_uring_queue_init(DCACHE_RING_DEPTH, ring, 0)) != 0)
+        goto fail2;
+    if ((r = pthread_setspecific(priv->ring_key, ring)) != 0)
+        goto fail3;
+
+    // Done
+    return 0;
+
+fail3:
+    io_uring_queue_exit(ring);
+fail2:
+    free(ring);
+fail1:
+    (*priv->log)(LOG_WARNING, "can't use io_uring for cache file `%s': %s", priv->filename, strerror(r));
+    (void)pthread_key_delete(priv->ring_key);
+    return r;
+}
+
+/*
+ * Get the current thread's ring, creating it on demand. Returns NULL if that fails.
+ */
+static struct io_uring *
+s3b_dcache_get_ring(struct s3b_dcache *priv)
+{
+    struct io_uring *ring;
+
+    // Already created?
+    if ((ring = pthread_getspecific(priv->ring_key)) != NULL)
+        return ring;
+
+    // Create a new ring for this thread
+    if ((ring = malloc(sizeof(*ring))) == NULL)
+        return NULL;
+    if (io_uring_queue_init(DCACHE_RING_DEPTH, ring, 0) != 0) {
+        free(ring);
+        return NULL;
+    }
+    if (pthread_setspecific(priv->ring_key, ring) != 0) {
+        s3b_dcache_free_ring(ring);
+        return NULL;
+    }
+
+    // Done
+    return ring;
+}
+
+/*
+ * Submit a chain of linked operations and wait for them all to complete.
+ *
+ * Returns the number of leading operations that completed successfully. A failed link causes all
+ * subsequent operations in the chain to be cancelled, so they will be retried by the caller.
+ */
+static u_int
+s3b_dcache_perform_ring(struct s3b_dcache *priv, struct io_uring *ring, const struct dcache_op *ops, u_int num_ops)
+{
+    struct io_uring_cqe *cqe;
+    u_int num_ok = num_ops;
+    u_int i;
+    int r;
+
+    // Queue up the chain; the ring is always empty between calls
+    for (i = 0; i < num_ops; i++) {
+        const struct dcache_op *const op = &ops[i];
+        struct io_uring_sqe *const sqe = io_uring_get_sqe(ring);
+
+        assert(sqe != NULL);
+        if (op->fsync)
+            io_uring_prep_fsync(sqe, priv->fd, IORING_FSYNC_DATASYNC);
+        else
+            io_uring_prep_write(sqe, priv->fd, op->data, op->len, op->offset);
+        if (i < num_ops - 1)
+            sqe->flags |= IOSQE_IO_LINK;
+        io_uring_sqe_set_data(sqe, (void *)(uintptr_t)i);
+    }
+
+    // Submit the chain and wait for completion
+    if ((r = io_uring_submit_and_wait(ring, num_ops)) < 0 || (u_int)r != num_ops)
+        goto broken;
+
+    // Reap completions, noting the first operation that didn't fully succeed
+    for (i = 0; i < num_ops; i++) {
+        u_int index;
+        int res;
+
+        if ((r = io_uring_wait_cqe(ring, &cqe)) != 0)
+            goto broken;
+        index = (u_int)(uintptr_t)io_uring_cqe_get_data(cqe);
+        res = cqe->res;
+        io_uring_cqe_seen(ring, cqe);
+        assert(index < num_ops);
+        if ((res < 0 || (!ops[index].fsync && (size_t)res != ops[index].len)) && index < num_ok)
+            num_ok = index;
+    }
+
+    // Done
+    return num_ok;
+
+broken:
+    // Something is seriously wrong with this ring, so discard it (this waits for anything in flight) and start over
+    (*priv->log)(LOG_WARNING, "io_uring failure for cache file `%s': %s", priv->filename, strerror(r < 0 ? -r : EIO));
+    (void)pthread_setspecific(priv->ring_key, NULL);
+    s3b_dcache_free_ring(ring);
+    return 0;
+}
+
+static void
+s3b_dcache_free_ring(void *arg)
+{
+    struct io_uring *const ring = arg;
+
+    io_uring_queue_exit(ring);
+    free(ring);
+}
+
+#endif  /* LIBURING */
+
 /*
  * Resize (and compress) an existing cache file. Upon successful return, priv->fd is closed
  * and the cache file must be re-opened.
@@ -811,30 +1299,47 @@ fail:
     return r;
 }
 
+/*
+ * Build the free list and visit allocated blocks.
+ *
+ * If "index" is not NULL, the directory contents are taken from the index snapshot instead of being read from the file.
+ */
 static int
-s3b_dcache_init_free_list(struct s3b_dcache *priv, s3b_dcache_visit_t *visitor, void *arg, u_int visit_dirty)
+s3b_dcache_init_free_list(struct s3b_dcache *priv, s3b_dcache_visit_t *visitor, void *arg, u_int visit_dirty,
+  const struct index_entry *index, u_int index_len)
 {
     off_t required_size;
     struct stat sb;
     u_int num_entries;
     u_int num_dslots_used;
     u_int base_dslot;
+    u_int next_index = 0;
     u_int i;
     int r;
 
     // Logging
-    (*priv->log)(LOG_INFO, "reading meta-data from cache file `%s'", priv->filename);
+    if (index != NULL)
+        (*priv->log)(LOG_INFO, "reading meta-data from index file `%s'", priv->index_filename);
+    else
+        (*priv->log)(LOG_INFO, "reading meta-data from cache file `%s'", priv->filename);
     assert(visitor != NULL);
 
     // Inspect all directory entries
     for (num_dslots_used = base_dslot = 0; base_dslot < priv->max_blocks; base_dslot += num_entries) {
         char buffer[DIRECTORY_READ_CHUNK * DIR_ENTSIZE(priv->flags)];
 
-        // Read in the next chunk of directory entries
+        // Get the next chunk of directory entries, from the index or the file
         num_entries = priv->max_blocks - base_dslot;
         if (num_entries > DIRECTORY_READ_CHUNK)
             num_entries = DIRECTORY_READ_CHUNK;
-        if ((r = s3b_dcache_read(priv, DIR_OFFSET(priv->flags, base_dslot), buffer, num_entries * DIR_ENTSIZE(priv->flags))) != 0) {
+        if (index != NULL) {
+            assert(DIR_ENTSIZE(priv->flags) == sizeof(struct dir_entry));
+            memset(buffer, 0, num_entries * sizeof(struct dir_entry));
+            for ( ; next_index < index_len && index[next_index].dslot < base_dslot + num_entries; next_index++) {
+                memcpy(buffer + (index[next_index].dslot - base_dslot) * sizeof(struct dir_entry),
+                  &index[next_index].entry, sizeof(struct dir_entry));
+            }
+        } else if ((r = s3b_dcache_read(priv, DIR_OFFSET(priv->flags, base_dslot), buffer, num_entries * DIR_ENTSIZE(priv->flags))) != 0) {
             (*priv->log)(LOG_ERR, "error reading cache file `%s' directory: %s", priv->filename, strerror(r));
             return r;
         }
@@ -905,6 +1410,222 @@ s3b_dcache_init_free_list(struct s3b_dcache *priv, s3b_dcache_visit_t *visitor,
     return 0;
 }
 
+/*
+ * Read and validate the index snapshot. Returns zero only if the snapshot is usable.
+ */
+static int
+s3b_dcache_read_index(struct s3b_dcache *priv, struct index_entry **indexp, u_int *index_lenp)
+{
+    struct index_header header;
+    struct index_entry *index;
+    struct stat sb;
+    size_t len;
+    ssize_t nread;
+    u_int i;
+    int fd;
+    int r;
+
+    // Open index file
+    if ((fd = open(priv->index_filename, O_RDONLY|O_CLOEXEC, 0)) == -1) {
+        r = errno;
+        if (r != ENOENT)
+            (*priv->log)(LOG_WARNING, "can't open index file `%s': %s", priv->index_filename, strerror(r));
+        return r;
+    }
+
+    // Read and verify header
+    r = EINVAL;
+    if (fstat(fd, &sb) == -1) {
+        r = errno;
+        (*priv->log)(LOG_WARNING, "can't read index file `%s': %s", priv->index_filename, strerror(r));
+        goto fail1;
+    }
+    if ((nread = pread(fd, &header, sizeof(header), 0)) != sizeof(header)) {
+        (*priv->log)(LOG_WARNING, "invalid index file `%s': %s", priv->index_filename, "truncated header");
+        goto fail1;
+    }
+    if (header.signature != INDEX_SIGNATURE
+      || header.header_size != sizeof(header)
+      || header.block_size != priv->block_size
+      || header.flags != priv->flags
+      || header.max_blocks != priv->max_blocks
+      || header.num_entries > priv->max_blocks) {
+        (*priv->log)(LOG_WARNING, "invalid index file `%s': %s", priv->index_filename, "header mismatch");
+        goto fail1;
+    }
+    if (header.generation != priv->index_gen) {
+        (*priv->log)(LOG_WARNING, "ignoring stale index file `%s' (generation %u != %u)",
+          priv->index_filename, header.generation, priv->index_gen);
+        goto fail1;
+    }
+    len = (size_t)header.num_entries * sizeof(*index);
+    if (sb.st_size != (off_t)(sizeof(header) + len)) {
+        (*priv->log)(LOG_WARNING, "invalid index file `%s': %s", priv->index_filename, "wrong length");
+        goto fail1;
+    }
+
+    // Read entries in one go
+    if ((index = malloc(len > 0 ? len : 1)) == NULL) {
+        r = errno;
+        goto fail1;
+    }
+    if ((nread = pread(fd, index, len, sizeof(header))) == -1 || (size_t)nread != len) {
+        (*priv->log)(LOG_WARNING, "can't read index file `%s': %s", priv->index_filename, nread == -1 ? strerror(errno) : "short read");
+        goto fail2;
+    }
+
+    // Verify checksum and entries
+    if ((uint32_t)crc32(crc32(0L, Z_NULL, 0), (const Bytef *)index, len) != header.checksum) {
+        (*priv->log)(LOG_WARNING, "invalid index file `%s': %s", priv->index_filename, "checksum mismatch");
+        goto fail2;
+    }
+    for (i = 0; i < header.num_entries; i++) {
+        if (index[i].dslot >= priv->max_blocks
+          || (i > 0 && index[i].dslot <= index[i - 1].dslot)
+          || (index[i].entry.flags & ~ENTFLG_MASK) != 0
+          || memcmp(&index[i].entry, &zero_entry, sizeof(zero_entry)) == 0) {
+            (*priv->log)(LOG_WARNING, "invalid index file `%s': %s", priv->index_filename, "bogus entry");
+            goto fail2;
+        }
+    }
+
+    // Done
+    (void)close(fd);
+    *indexp = index;
+    *index_lenp = header.num_entries;
+    return 0;
+
+fail2:
+    free(index);
+fail1:
+    (void)close(fd);
+    return r;
+}
+
+/*
+ * Write a snapshot of the directory to the index file, then record its generation in the cache file header.
+ */
+static int
+s3b_dcache_write_index(struct s3b_dcache *priv)
+{
+    struct index_header header;
+    struct index_entry *index = NULL;
+    struct index_entry *new_index;
+    u_int index_alloc = 0;
+    u_int num_entries;
+    u_int base_dslot;
+    uint32_t generation;
+    off_t offset;
+    u_int i;
+    int fd;
+    int r;
+
+    // Sanity check
+    assert(priv->index_filename != NULL);
+    assert((priv->flags & HDRFLG_NEW_FORMAT) != 0);
+
+    // Gather all non-empty directory entries
+    memset(&header, 0, sizeof(header));
+    for (base_dslot = 0; base_dslot < priv->max_blocks; base_dslot += num_entries) {
+        struct dir_entry buffer[DIRECTORY_READ_CHUNK];
+
+        num_entries = priv->max_blocks - base_dslot;
+        if (num_entries > DIRECTORY_READ_CHUNK)
+            num_entries = DIRECTORY_READ_CHUNK;
+        if ((r = s3b_dcache_read(priv, DIR_OFFSET(priv->flags, base_dslot), buffer, num_entries * sizeof(*buffer))) != 0)
+            goto fail1;
+        for (i = 0; i < num_entries; i++) {
+            if (memcmp(&buffer[i], &zero_entry, sizeof(zero_entry)) == 0)
+                continue;
+            if (header.num_entries == index_alloc) {
+                index_alloc = index_alloc == 0 ? 1024 : 2 * index_alloc;
+                if ((new_index = realloc(index, index_alloc * sizeof(*index))) == NULL) {
+                    r = errno;
+                    (*priv->log)(LOG_ERR, "realloc: %s", strerror(r));
+                    goto fail1;
+                }
+                index = new_index;
+            }
+            index[header.num_entries].dslot = base_dslot + i;
+            index[header.num_entries].entry = buffer[i];
+            header.num_entries++;
+        }
+    }
+
+    // Initialize header
+    generation = priv->index_gen + 1;
+    if (generation == 0)
+        generation++;
+    header.signature = INDEX_SIGNATURE;
+    header.header_size = sizeof(header);
+    header.block_size = priv->block_size;
+    header.flags = priv->flags;
+    header.max_blocks = priv->max_blocks;
+    header.generation = generation;
+    header.checksum = (uint32_t)crc32(crc32(0L, Z_NULL, 0), (const Bytef *)index, header.num_entries * sizeof(*index));
+
+    // Write index file
+    if ((fd = open(priv->index_filename, O_WRONLY|O_CREAT|O_TRUNC|O_CLOEXEC, 0644)) == -1) {
+        r = errno;
+        (*priv->log)(LOG_ERR, "can't create index file `%s': %s", priv->index_filename, strerror(r));
+        goto fail1;
+    }
+    offset = 0;
+    if ((r = s3b_dcache_write2(priv, fd, priv->index_filename, offset, &header, sizeof(header))) != 0)
+        goto fail2;
+    offset += sizeof(header);
+    if (header.num_entries > 0
+      && (r = s3b_dcache_write2(priv, fd, priv->index_filename, offset, index, header.num_entries * sizeof(*index))) != 0)
+        goto fail2;
+    if (fsync(fd) == -1) {
+        r = errno;
+        (*priv->log)(LOG_ERR, "error fsync'ing index file `%s': %s", priv->index_filename, strerror(r));
+        goto fail2;
+    }
+    (void)close(fd);
+
+    // Now the snapshot is safely on disk, mark it as valid
+    if ((r = s3b_dcache_set_index_valid(priv, generation)) != 0)
+        goto fail1;
+    priv->index_gen = generation;
+
+    // Done
+    (*priv->log)(LOG_INFO, "wrote index file `%s' with %u used blocks", priv->index_filename, header.num_entries);
+    free(index);
+    return 0;
+
+fail2:
+    (void)close(fd);
+    (void)unlink(priv->index_filename);
+fail1:
+    free(index);
+    return r;
+}
+
+/*
+ * Mark the index snapshot with the given generation as valid in the cache file header, or mark it invalid if zero.
+ */
+static int
+s3b_dcache_set_index_valid(struct s3b_dcache *priv, uint32_t generation)
+{
+    uint32_t flags;
+    int r;
+
+    // Sanity check
+    assert((priv->flags & HDRFLG_NEW_FORMAT) != 0);
+
+    // Update generation; if only the flag reaches the disk, the generation mismatch still invalidates the snapshot
+    if (generation != 0
+      && (r = s3b_dcache_write(priv, offsetof(struct file_header, index_gen), &generation, sizeof(generation))) != 0)
+        return r;
+
+    // Update flags
+    flags = priv->flags | (generation != 0 ? HDRFLG_INDEX_VALID : 0);
+    if ((r = s3b_dcache_write(priv, offsetof(struct file_header, flags), &flags, sizeof(flags))) != 0)
+        return r;
+    return s3b_dcache_fsync(priv);
+}
+
 /*
  * Push a dslot onto the free list.
  */
@@ -966,9 +1687,55 @@ s3b_dcache_pop(struct s3b_dcache *priv, u_int *dslotp)
     assert(priv->free_list_len <= priv->free_list_alloc);
 }
 
+/*
+ * Memory map the data area. The file is first extended (sparsely) to its full size,
+ * otherwise accessing a data slot beyond the end of the file would raise SIGBUS.
+ */
+static int
+s3b_dcache_map_data(struct s3b_dcache *priv)
+{
+    const off_t file_size = DATA_OFFSET(priv, priv->max_blocks);
+    struct stat sb;
+    void *map;
+    int r;
+
+    // Sanity check
+    assert(priv->map == NULL);
+    if ((uintmax_t)priv->max_blocks * priv->block_size > SIZE_MAX) {
+        (*priv->log)(LOG_ERR, "cache file `%s' is too large to memory map", priv->filename);
+        return EFBIG;
+    }
+
+    // Extend file if necessary
+    if (fstat(priv->fd, &sb) == -1) {
+        r = errno;
+        (*priv->log)(LOG_ERR, "error reading cache file `%s' length: %s", priv->filename, strerror(r));
+        return r;
+    }
+    if (sb.st_size < file_size && ftruncate(priv->fd, file_size) == -1) {
+        r = errno;
+        (*priv->log)(LOG_ERR, "error extending cache file `%s' to %ju bytes: %s",
+          priv->filename, (uintmax_t)file_size, strerror(r));
+        return r;
+    }
+
+    // Map the data area
+    priv->map_size = (size_t)priv->max_blocks * priv->block_size;
+    if ((map = mmap(NULL, priv->map_size, PROT_READ|PROT_WRITE, MAP_SHARED, priv->fd, priv->data)) == MAP_FAILED) {
+        r = errno;
+        (*priv->log)(LOG_ERR, "can't memory map cache file `%s': %s", priv->filename, strerror(r));
+        return r;
+    }
+    priv->map = map;
+
+    // Done
+    return 0;
+}
+
 static int
 s3b_dcache_read(struct s3b_dcache *priv, off_t offset, void *data, size_t len)
 {
+    const uint64_t start_micros = latency_hist_micros();
     size_t sofar;
     ssize_t r;
 
@@ -987,13 +1754,19 @@ s3b_dcache_read(struct s3b_dcache *priv, off_t offset, void *data, size_t len)
             return EINVAL;
         }
     }
+    latency_hist_record(&priv->read_latency, latency_hist_micros() - start_micros);
     return 0;
 }
 
 static int
 s3b_dcache_write(struct s3b_dcache *priv, off_t offset, const void *data, size_t len)
 {
-    return s3b_dcache_write2(priv, priv->fd, priv->filename, offset, data, len);
+    const uint64_t start_micros = latency_hist_micros();
+    int r;
+
+    if ((r = s3b_dcache_write2(priv, priv->fd, priv->filename, offset, data, len)) == 0)
+        latency_hist_record(&priv->write_latency, latency_hist_micros() - start_micros);
+    return r;
 }
 
 static int
@@ -56,11 +56,16 @@ extern void s3b_dcache_close(struct s3b_dcache *dcache);
 extern u_int s3b_dcache_size(struct s3b_dcache *dcache);
 extern int s3b_dcache_alloc_block(struct s3b_dcache *priv, u_int *dslotp);
 extern int s3b_dcache_record_block(struct s3b_dcache *priv, u_int dslot, s3b_block_t block_num, const u_char *etag);
+extern int s3b_dcache_store_block(struct s3b_dcache *priv, u_int dslot, s3b_block_t block_num, const void *src, const u_char *etag);
 extern int s3b_dcache_erase_block(struct s3b_dcache *priv, u_int dslot);
 extern int s3b_dcache_free_block(struct s3b_dcache *dcache, u_int dslot);
 extern int s3b_dcache_read_block(struct s3b_dcache *dcache, u_int dslot, void *dest, u_int off, u_int len);
 extern int s3b_dcache_write_block(struct s3b_dcache *dcache, u_int dslot, const void *src, u_int off, u_int len);
+extern char *s3b_dcache_block_data(struct s3b_dcache *dcache, u_int dslot);
 extern int s3b_dcache_fsync(struct s3b_dcache *dcache);
 extern int s3b_dcache_has_mount_token(struct s3b_dcache *priv);
 extern int s3b_dcache_set_mount_token(struct s3b_dcache *priv, int32_t *old_valuep, int32_t new_value);
+extern void s3b_dcache_get_stats(struct s3b_dcache *priv,
+  struct latency_hist *read_latency, struct latency_hist *write_latency, struct latency_hist *fsync_latency);
+extern void s3b_dcache_clear_stats(struct s3b_dcache *priv);
 
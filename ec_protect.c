@@ -33,12 +33,21 @@
  * this exception statement from all source files in the program, then
  * also delete it here.
  */
-
 #include "s3backer.h"
 #include "ec_protect.h"
 #include "hash.h"
 #include "util.h"
 
+// Definitions
+#define MIN_TABLE_BITS              10
+#define MAX_TABLE_BITS              31
+#define MAX_LOAD(alen)              ((alen) - ((alen) >> 3))       // max load factor is 7/8
+#define HASH_MULTIPLIER             0x9e3779b97f4a7c15ULL
+#define WRITTEN_EMPTY               0
+#define REBASE_MILLIS               (1U << 31)                      // rebase relative timestamps this often
+#define REBASE_KEEP_MILLIS          (1U << 30)                      // how far back relative timestamps reach after rebase
+#define WRITTEN_TIME(priv, when)    ((priv)->time_base + (when) - 1)
+
 /*
  * Written block information caching.
  *
@@ -71,15 +80,17 @@
  *      and no WRITTEN blocks have exipred yet, additional writes will block.
  *      Note if cache_time is zero (infinity), then this must be big enough to
  *      contain ALL of the blocks, otherwise you will eventually deadlock.
+ *  cache_file
+ *      Optional file in which to keep the table of WRITTEN blocks, instead of in memory.
  *
  * Blocks we are currently tracking can be in the following states:
  *
- * State    Meaning                  Hash table  List  Other invariants
- * -----    -------                  ----------  ----  ----------------
+ * State    Meaning                  Hash table  Written table  Other invariants
+ * -----    -------                  ----------  -------------  ----------------
  *
  * CLEAN    initial state            No          No
- * WRITING  currently being written  Yes         No    timestamp == 0, u.data valid
- * WRITTEN  written and ETag cached  Yes         Yes   timestamp != 0, u.etag valid
+ * WRITING  currently being written  Yes         No             data valid
+ * WRITTEN  written and ETag cached  No          Yes            when != 0, etag valid
  *
  * The steady state for a block is CLEAN. WRITING means the block is currently
  * being sent; concurrent attempts to write will simply sleep until the first one
@@ -99,23 +110,52 @@
  *
  * If we hit the 'cache_size' limit, we sleep a little while and then try again.
  *
- * We keep track of blocks in 'struct block_info' structures. These structures
- * are themselves tracked in both (a) a linked list and (b) a hash table.
+ * WRITING blocks are few (at most one per concurrent write), so we keep track of them in
+ * 'struct block_info' structures in a hash table keyed by block number.
  *
- * The hash table contains all structures, and is keyed by block number. This
- * is simply so we can quickly find the structure associated with a specific block.
+ * WRITTEN blocks can number in the millions when cache_time is infinite, so they are stored
+ * inline in a separate open addressing table of compact 24 byte entries with a 32 bit timestamp relative
+ * to 'time_base'. This table grows as needed, or if cache_file is configured, it is allocated up front
+ * in a memory-mapped file so that the kernel can page it out.
  *
- * The linked list contains WRITTEN blocks, and is sorted in increasing order by timestamp,
- * so the entries that will expire first are at the front of the list.
+ * When cache_time is not infinite, we also keep a FIFO of (block number, timestamp) pairs in the order
+ * in which blocks were written, so the entries that will expire first are at the front. FIFO entries
+ * whose timestamp no longer matches the block's entry in the written table are stale and are ignored.
  */
 struct block_info {
     s3b_block_t             block_num;          // block number - MUST BE FIRST
-    uint64_t                timestamp;          // time PUT/DELETE completed (if WRITTEN)
-    TAILQ_ENTRY(block_info) link;               // list entry link
-    union {
-        const void      *data;                  // block's actual content (if WRITING)
-        u_char          etag[MD5_DIGEST_LENGTH];// block's ETag (if WRITTEN)
-    } u;
+    const void              *data;              // block's actual content
+};
+
+// One WRITTEN block
+struct written_entry {
+    s3b_block_t             block_num;          // block number
+    uint32_t                when;               // time PUT/DELETE completed, relative to time_base, or zero if empty
+    u_char                  etag[MD5_DIGEST_LENGTH];// block's ETag
+};
+
+// Table of WRITTEN blocks (linear probing with backward shift deletion)
+struct written_table {
+    struct written_entry    *array;             // hash array
+    u_int                   bits;               // log2 of hash array length
+    u_int                   mask;               // hash array length minus one
+    u_int                   maxload;            // grow the hash array when count would exceed this
+    u_int                   count;              // number of WRITTEN blocks
+    size_t                  map_size;           // size of mapping if array is in cache_file, else zero
+};
+
+// One entry in the expiration FIFO
+struct written_fifo_entry {
+    s3b_block_t             block_num;          // block number
+    uint32_t                when;               // time PUT/DELETE completed, relative to time_base
+};
+
+// Expiration FIFO (circular buffer)
+struct written_fifo {
+    struct written_fifo_entry *array;           // entries
+    u_int                   size;               // array length (a power of two)
+    u_int                   head;               // index of oldest entry
+    u_int                   count;              // number of entries
 };
 
 // Internal state
@@ -123,9 +163,11 @@ struct ec_protect_private {
     struct ec_protect_conf      *config;
     struct s3backer_store       *inner;
     struct ec_protect_stats     stats;
-    struct s3b_hash             *hashtable;
+    struct s3b_hash             *hashtable;     // WRITING blocks
+    struct written_table        written;        // WRITTEN blocks
+    struct written_fifo         fifo;           // WRITTEN blocks in order of expiration (if cache_time > 0)
+    uint64_t                    time_base;      // base for relative timestamps (milliseconds)
     u_int                       num_sleepers;   // count of sleeping threads
-    TAILQ_HEAD(, block_info)    list;
     block_list_func_t           *survey_callback;// non-zero survey is running and this is the callback
     void                        *survey_arg;    // non-zero survey is running and this is the arg
     pthread_mutex_t             mutex;
@@ -150,10 +192,24 @@ static void ec_protect_destroy(struct s3backer_store *s3b);
 static uint64_t ec_protect_sleep_until(struct ec_protect_private *priv, pthread_cond_t *cond, uint64_t wake_time_millis);
 static void ec_protect_scrub_expired_writtens(struct ec_protect_private *priv, uint64_t current_time);
 static uint64_t ec_protect_get_time(void);
+static uint32_t ec_protect_relative_time(struct ec_protect_private *priv, uint64_t time);
+static void ec_protect_rebase(struct ec_protect_private *priv, uint64_t current_time);
 static int ec_protect_survey_non_zero(struct s3backer_store *s3b, block_list_func_t *callback, void *arg);
+static int ec_protect_block_status(struct s3backer_store *s3b, s3b_block_t block_num, u_int num_blocks, int *zerop, u_int *countp);
 static s3b_hash_visit_t ec_protect_append_block_list;
 static s3b_hash_visit_t ec_protect_free_one;
 
+// Written table and FIFO
+static int ec_protect_written_init(struct ec_protect_private *priv);
+static void ec_protect_written_free(struct ec_protect_private *priv);
+static int ec_protect_written_reserve(struct ec_protect_private *priv, u_int count);
+static int ec_protect_written_resize(struct written_table *table, u_int bits);
+static struct written_entry *ec_protect_written_find(struct written_table *table, s3b_block_t block_num);
+static void ec_protect_written_insert(struct written_table *table, const struct written_entry *entry);
+static void ec_protect_written_remove(struct written_table *table, struct written_entry *entry);
+static u_int ec_protect_written_index(struct written_table *table, s3b_block_t block_num);
+static int ec_protect_fifo_reserve(struct written_fifo *fifo, u_int count);
+
 // Invariants checking
 #ifndef NDEBUG
 static s3b_hash_visit_t ec_protect_check_one;
@@ -192,10 +248,13 @@ ec_protect_create(struct ec_protect_conf *config, struct s3backer_store *inner)
     s3b->meta_data = ec_protect_meta_data;
     s3b->set_mount_token = ec_protect_set_mount_token;
     s3b->read_block = ec_protect_read_block;
+    s3b->read_blocks = generic_read_blocks;
     s3b->write_block = ec_protect_write_block;
+    s3b->write_blocks = generic_write_blocks;
     s3b->bulk_zero = generic_bulk_zero;
     s3b->flush_blocks = ec_protect_flush_blocks;
     s3b->survey_non_zero = ec_protect_survey_non_zero;
+    s3b->block_status = ec_protect_block_status;
     s3b->shutdown = ec_protect_shutdown;
     s3b->destroy = ec_protect_destroy;
     if ((priv = calloc(1, sizeof(*priv))) == NULL) {
@@ -205,6 +264,7 @@ ec_protect_create(struct ec_protect_conf *config, struct s3backer_store *inner)
     }
     priv->config = config;
     priv->inner = inner;
+    priv->time_base = ec_protect_get_time();
     if ((r = pthread_mutex_init(&priv->mutex, NULL)) != 0)
         goto fail2;
     if ((r = pthread_cond_init(&priv->space_cond, NULL)) != 0)
@@ -213,9 +273,10 @@ ec_protect_create(struct ec_protect_conf *config, struct s3backer_store *inner)
         goto fail4;
     if ((r = pthread_cond_init(&priv->never_cond, NULL)) != 0)
         goto fail5;
-    TAILQ_INIT(&priv->list);
-    if ((r = s3b_hash_create(&priv->hashtable, config->cache_size)) != 0)
+    if ((r = s3b_hash_create(&priv->hashtable, 0)) != 0)
         goto fail6;
+    if ((r = ec_protect_written_init(priv)) != 0)
+        goto fail7;
     s3b->data = priv;
     memset(unknown_etag, 0xff, sizeof(unknown_etag));
 
@@ -223,6 +284,8 @@ ec_protect_create(struct ec_protect_conf *config, struct s3backer_store *inner)
     EC_PROTECT_CHECK_INVARIANTS(priv);
     return s3b;
 
+fail7:
+    s3b_hash_destroy(priv->hashtable);
 fail6:
     pthread_cond_destroy(&priv->never_cond);
 fail5:
@@ -314,6 +377,7 @@ ec_protect_destroy(struct s3backer_store *const s3b)
     pthread_cond_destroy(&priv->never_cond);
     s3b_hash_foreach(priv->hashtable, ec_protect_free_one, NULL);
     s3b_hash_destroy(priv->hashtable);
+    ec_protect_written_free(priv);
     free(priv);
     free(s3b);
 }
@@ -325,7 +389,7 @@ ec_protect_get_stats(struct s3backer_store *s3b, struct ec_protect_stats *stats)
 
     pthread_mutex_lock(&priv->mutex);
     memcpy(stats, &priv->stats, sizeof(*stats));
-    stats->current_cache_size = s3b_hash_size(priv->hashtable);
+    stats->current_cache_size = s3b_hash_size(priv->hashtable) + priv->written.count;
     CHECK_RETURN(pthread_mutex_unlock(&priv->mutex));
 }
 
@@ -344,6 +408,7 @@ ec_protect_survey_non_zero(struct s3backer_store *s3b, block_list_func_t *callba
 {
     struct ec_protect_private *const priv = s3b->data;
     struct block_list list;
+    u_int i;
     int r;
 
     // Lock mutex
@@ -358,6 +423,12 @@ ec_protect_survey_non_zero(struct s3backer_store *s3b, block_list_func_t *callba
     block_list_init(&list);
     if ((r = s3b_hash_foreach(priv->hashtable, ec_protect_append_block_list, &list)) != 0)
         goto done;
+    for (i = 0; i <= priv->written.mask; i++) {
+        const struct written_entry *const entry = &priv->written.array[i];
+
+        if (entry->when != WRITTEN_EMPTY && (r = block_list_append(&list, entry->block_num)) != 0)
+            goto done;
+    }
 
     // Unlock mutex
     CHECK_RETURN(pthread_mutex_unlock(&priv->mutex));
@@ -383,6 +454,15 @@ done:
     return r;
 }
 
+// Writes don't complete until the lower layer has them, so the lower layer is already up to date
+static int
+ec_protect_block_status(struct s3backer_store *s3b, s3b_block_t block_num, u_int num_blocks, int *zerop, u_int *countp)
+{
+    struct ec_protect_private *const priv = s3b->data;
+
+    return (*priv->inner->block_status)(priv->inner, block_num, num_blocks, zerop, countp);
+}
+
 static int
 ec_protect_append_block_list(void *arg, void *value)
 {
@@ -399,6 +479,7 @@ ec_protect_read_block(struct s3backer_store *const s3b, s3b_block_t block_num, v
     struct ec_protect_private *const priv = s3b->data;
     struct ec_protect_conf *const config = priv->config;
     u_char etag[MD5_DIGEST_LENGTH];
+    struct written_entry *entry;
     struct block_info *binfo;
 
     // Sanity check
@@ -413,40 +494,39 @@ again:
     // Scrub the list of WRITTENs
     ec_protect_scrub_expired_writtens(priv, ec_protect_get_time());
 
-    // Find info for this block
+    // In WRITING state: we have the data already!
     if ((binfo = s3b_hash_get(priv->hashtable, block_num)) != NULL) {
+        if (binfo->data == NULL)
+            memset(dest, 0, config->block_size);
+        else
+            memcpy(dest, binfo->data, config->block_size);
+        if (actual_etag != NULL)
+            memset(actual_etag, 0, MD5_DIGEST_LENGTH);          // we don't know it yet!
+        priv->stats.cache_data_hits++;
+        CHECK_RETURN(pthread_mutex_unlock(&priv->mutex));
+        return 0;
+    }
 
-        // In WRITING state: we have the data already!
-        if (binfo->timestamp == 0) {
-            if (binfo->u.data == NULL)
-                memset(dest, 0, config->block_size);
-            else
-                memcpy(dest, binfo->u.data, config->block_size);
-            if (actual_etag != NULL)
-                memset(actual_etag, 0, MD5_DIGEST_LENGTH);          // we don't know it yet!
-            priv->stats.cache_data_hits++;
-            CHECK_RETURN(pthread_mutex_unlock(&priv->mutex));
-            return 0;
-        }
+    // Find WRITTEN info for this block
+    if ((entry = ec_protect_written_find(&priv->written, block_num)) != NULL) {
+        const uint64_t settle_time = WRITTEN_TIME(priv, entry->when) + config->min_write_delay;
 
         // In WRITTEN state: special case: unknown ETag. Wait for settle time, then try again
-        if (memcmp(binfo->u.etag, unknown_etag, MD5_DIGEST_LENGTH) == 0) {
+        if (memcmp(entry->etag, unknown_etag, MD5_DIGEST_LENGTH) == 0) {
 
             // Have we waited long enough already? If so, reset block and try again
-            if (ec_protect_get_time() >= binfo->timestamp + config->min_write_delay) {
-                TAILQ_REMOVE(&priv->list, binfo, link);
-                s3b_hash_remove(priv->hashtable, binfo->block_num);
-                free(binfo);
+            if (ec_protect_get_time() >= settle_time) {
+                ec_protect_written_remove(&priv->written, entry);
                 goto again;
             }
 
             // Sleep to allow previous failed write to resolve, and then try again
-            ec_protect_sleep_until(priv, NULL, binfo->timestamp + config->min_write_delay);
+            ec_protect_sleep_until(priv, NULL, settle_time);
             goto again;
         }
 
         // In WRITTEN state: special case: zero block
-        if (memcmp(binfo->u.etag, zero_etag, MD5_DIGEST_LENGTH) == 0) {
+        if (memcmp(entry->etag, zero_etag, MD5_DIGEST_LENGTH) == 0) {
             if (expect_etag != NULL && strict && memcmp(expect_etag, zero_etag, MD5_DIGEST_LENGTH) != 0)
                 (*config->log)(LOG_ERR, "ec_protect_read_block(): impossible expected ETag?");
             memset(dest, 0, config->block_size);
@@ -458,7 +538,7 @@ again:
         }
 
         // In WRITTEN state: we know the expected ETag
-        memcpy(etag, binfo->u.etag, MD5_DIGEST_LENGTH);
+        memcpy(etag, entry->etag, MD5_DIGEST_LENGTH);
         if (expect_etag != NULL && strict && memcmp(etag, expect_etag, MD5_DIGEST_LENGTH) != 0)
             (*config->log)(LOG_ERR, "ec_protect_read_block(): impossible expected ETag?");
         expect_etag = etag;
@@ -479,9 +559,12 @@ ec_protect_write_block(struct s3backer_store *const s3b, s3b_block_t block_num,
     struct ec_protect_private *const priv = s3b->data;
     struct ec_protect_conf *const config = priv->config;
     u_char etag[MD5_DIGEST_LENGTH];
+    struct written_entry new_entry;
+    struct written_entry *entry;
     struct block_info *binfo;
     uint64_t current_time;
     uint64_t delay;
+    u_int num_tracked;
     int r;
 
     // Sanity check
@@ -505,26 +588,38 @@ again:
 
     // Find info for this block
     binfo = s3b_hash_get(priv->hashtable, block_num);
+    entry = binfo == NULL ? ec_protect_written_find(&priv->written, block_num) : NULL;
 
     // CLEAN case: add new entry in state WRITING and write the block
-    if (binfo == NULL) {
+    if (binfo == NULL && entry == NULL) {
 
         // If we have reached max cache capacity, wait until there's more room
-        if (s3b_hash_size(priv->hashtable) >= config->cache_size) {
+        num_tracked = s3b_hash_size(priv->hashtable) + priv->written.count;
+        if (num_tracked >= config->cache_size) {
 
             // Report deadlock situation
             if (config->cache_time == 0)
                 (*config->log)(LOG_ERR, "md5 cache is full, but timeout is infinite: you have write deadlock!");
 
             // Sleep until space becomes available
-            if ((binfo = TAILQ_FIRST(&priv->list)) != NULL && config->cache_time > 0)
-                delay = ec_protect_sleep_until(priv, &priv->space_cond, binfo->timestamp + config->cache_time);
-            else
+            if (priv->fifo.count > 0 && config->cache_time > 0) {
+                delay = ec_protect_sleep_until(priv, &priv->space_cond,
+                  WRITTEN_TIME(priv, priv->fifo.array[priv->fifo.head].when) + config->cache_time);
+            } else
                 delay = ec_protect_sleep_until(priv, &priv->space_cond, 0);         // sleep indefinitely...
             priv->stats.cache_full_delay += delay;
+            latency_hist_record(&priv->stats.cache_full_latency, delay * 1000);
             goto again;
         }
 
+        // Ensure there will be room to record this block as WRITTEN when the write completes
+        if ((r = ec_protect_written_reserve(priv, num_tracked + 1)) != 0) {
+            (*config->log)(LOG_ERR, "can't grow MD5 cache: %s", strerror(r));
+            priv->stats.out_of_memory_errors++;
+            CHECK_RETURN(pthread_mutex_unlock(&priv->mutex));
+            return r;
+        }
+
         // Create new entry in WRITING state
         if ((binfo = calloc(1, sizeof(*binfo))) == NULL) {
             r = errno;
@@ -534,10 +629,9 @@ again:
             return r;
         }
         binfo->block_num = block_num;
-        binfo->u.data = src;
+        binfo->data = src;
         s3b_hash_put_new(priv->hashtable, binfo);
 
-writeit:
         // Write the block
         CHECK_RETURN(pthread_mutex_unlock(&priv->mutex));
         r = (*priv->inner->write_block)(priv->inner, block_num, src, etag, check_cancel, check_cancel_arg);
@@ -558,9 +652,22 @@ writeit:
          * so mark the block as WRITTEN but with a special ETag value meaning "unknown".
          * We have to wait for min_write_delay before trying to read the block again.
          */
-        binfo->timestamp = ec_protect_get_time();
-        memcpy(binfo->u.etag, r == 0 ? etag : unknown_etag, MD5_DIGEST_LENGTH);
-        TAILQ_INSERT_TAIL(&priv->list, binfo, link);
+        s3b_hash_remove(priv->hashtable, block_num);
+        free(binfo);
+        current_time = ec_protect_get_time();
+        ec_protect_rebase(priv, current_time);
+        new_entry.block_num = block_num;
+        new_entry.when = ec_protect_relative_time(priv, current_time);
+        memcpy(new_entry.etag, r == 0 ? etag : unknown_etag, MD5_DIGEST_LENGTH);
+        ec_protect_written_insert(&priv->written, &new_entry);
+        if (config->cache_time > 0) {
+            struct written_fifo_entry *const fentry
+              = &priv->fifo.array[(priv->fifo.head + priv->fifo.count++) & (priv->fifo.size - 1)];
+
+            assert(priv->fifo.count <= priv->fifo.size);
+            fentry->block_num = block_num;
+            fentry->when = new_entry.when;
+        }
         CHECK_RETURN(pthread_mutex_unlock(&priv->mutex));
 
         // Copy expected ETag for caller
@@ -575,28 +682,29 @@ writeit:
      * anyway, we conservatively just wait exactly that long now. There may be an extra wakeup or two,
      * but that's OK.
      */
-    if (binfo->timestamp == 0) {
+    if (binfo != NULL) {
         delay = ec_protect_sleep_until(priv, NULL, current_time + config->min_write_delay);
         priv->stats.repeated_write_delay += delay;
+        latency_hist_record(&priv->stats.write_delay_latency, delay * 1000);
         goto again;
     }
 
     /*
      * WRITTEN case: wait until at least 'min_write_time' milliseconds has passed since previous write.
      */
-    if (current_time < binfo->timestamp + config->min_write_delay) {
-        delay = ec_protect_sleep_until(priv, NULL, binfo->timestamp + config->min_write_delay);
+    if (current_time < WRITTEN_TIME(priv, entry->when) + config->min_write_delay) {
+        delay = ec_protect_sleep_until(priv, NULL, WRITTEN_TIME(priv, entry->when) + config->min_write_delay);
         priv->stats.repeated_write_delay += delay;
+        latency_hist_record(&priv->stats.write_delay_latency, delay * 1000);
         goto again;
     }
 
     /*
-     * WRITTEN case: 'min_write_time' milliseconds have indeed passed, so go back to WRITING.
+     * WRITTEN case: 'min_write_time' milliseconds have indeed passed, so go back to CLEAN and then to WRITING.
+     * Any FIFO entry for the old write becomes stale. We still hold the mutex, so there will be room.
      */
-    binfo->timestamp = 0;
-    binfo->u.data = src;
-    TAILQ_REMOVE(&priv->list, binfo, link);
-    goto writeit;
+    ec_protect_written_remove(&priv->written, entry);
+    goto again;
 }
 
 /*
@@ -611,6 +719,52 @@ ec_protect_get_time(void)
     return (uint64_t)tv.tv_sec * 1000 + (uint64_t)tv.tv_usec / 1000;
 }
 
+/*
+ * Convert an absolute time in milliseconds to a (non-zero) relative timestamp.
+ */
+static uint32_t
+ec_protect_relative_time(struct ec_protect_private *priv, uint64_t time)
+{
+    return time > priv->time_base ? (uint32_t)(time - priv->time_base) + 1 : 1;
+}
+
+/*
+ * Advance the base for relative timestamps before they can overflow.
+ *
+ * Timestamps older than REBASE_KEEP_MILLIS are clamped, which only makes them look newer than they are;
+ * that's conservative, as it can only delay the expiration of those entries.
+ *
+ * This assumes the mutex is held.
+ */
+static void
+ec_protect_rebase(struct ec_protect_private *priv, uint64_t current_time)
+{
+    struct written_fifo *const fifo = &priv->fifo;
+    uint64_t shift;
+    u_int i;
+
+    // Time to rebase?
+    if (current_time < priv->time_base + REBASE_MILLIS)
+        return;
+    shift = current_time - priv->time_base - REBASE_KEEP_MILLIS;
+
+    // Adjust WRITTEN entries
+    for (i = 0; i <= priv->written.mask; i++) {
+        struct written_entry *const entry = &priv->written.array[i];
+
+        if (entry->when != WRITTEN_EMPTY)
+            entry->when = entry->when > shift ? entry->when - (uint32_t)shift : 1;
+    }
+
+    // Adjust FIFO entries the same way so they still match
+    for (i = 0; i < fifo->count; i++) {
+        struct written_fifo_entry *const fentry = &fifo->array[(fifo->head + i) & (fifo->size - 1)];
+
+        fentry->when = fentry->when > shift ? fentry->when - (uint32_t)shift : 1;
+    }
+    priv->time_base += shift;
+}
+
 /*
  * Remove expired WRITTEN entries from the list.
  * This assumes the mutex is held.
@@ -619,15 +773,23 @@ static void
 ec_protect_scrub_expired_writtens(struct ec_protect_private *priv, uint64_t current_time)
 {
     struct ec_protect_conf *const config = priv->config;
-    struct block_info *binfo;
+    struct written_fifo *const fifo = &priv->fifo;
+    struct written_fifo_entry *fentry;
+    struct written_entry *entry;
     int num_removed = 0;
 
+    ec_protect_rebase(priv, current_time);
     if (config->cache_time > 0) {
-        while ((binfo = TAILQ_FIRST(&priv->list)) != NULL && current_time >= binfo->timestamp + config->cache_time) {
-            TAILQ_REMOVE(&priv->list, binfo, link);
-            s3b_hash_remove(priv->hashtable, binfo->block_num);
-            free(binfo);
-            num_removed++;
+        while (fifo->count > 0) {
+            fentry = &fifo->array[fifo->head];
+            if (current_time < WRITTEN_TIME(priv, fentry->when) + config->cache_time)
+                break;
+            if ((entry = ec_protect_written_find(&priv->written, fentry->block_num)) != NULL && entry->when == fentry->when) {
+                ec_protect_written_remove(&priv->written, entry);
+                num_removed++;
+            }
+            fifo->head = (fifo->head + 1) & (fifo->size - 1);
+            fifo->count--;
         }
     }
     switch (num_removed) {
@@ -686,13 +848,217 @@ ec_protect_free_one(void *arg, void *value)
     return 0;
 }
 
+/****************************************************************************
+ *                      WRITTEN TABLE AND FIFO                              *
+ ****************************************************************************/
+
+/*
+ * Allocate the initial written table.
+ *
+ * If cache_file is configured, the table is sized for cache_size entries up front and mapped from the file;
+ * the file is unlinked immediately, so its space is reclaimed when we exit. Otherwise the table starts small
+ * and grows as needed.
+ */
+static int
+ec_protect_written_init(struct ec_protect_private *priv)
+{
+    struct ec_protect_conf *const config = priv->config;
+    struct written_table *const table = &priv->written;
+    void *map;
+    u_int bits;
+    int fd;
+    int r;
+
+    // Use memory?
+    if (config->cache_file == NULL)
+        return ec_protect_written_resize(table, MIN_TABLE_BITS);
+
+    // Size table for the maximum number of entries
+    for (bits = MIN_TABLE_BITS; MAX_LOAD(1U << bits) < config->cache_size; bits++) {
+        if (bits == MAX_TABLE_BITS)
+            return EINVAL;
+    }
+    table->map_size = sizeof(*table->array) << bits;
+
+    // Create and map file
+    if ((fd = open(config->cache_file, O_RDWR|O_CREAT|O_TRUNC|O_CLOEXEC, 0600)) == -1) {
+        r = errno;
+        (*config->log)(LOG_ERR, "can't create MD5 cache file `%s': %s", config->cache_file, strerror(r));
+        return r;
+    }
+    (void)unlink(config->cache_file);
+    if (ftruncate(fd, (off_t)table->map_size) == -1) {
+        r = errno;
+        (*config->log)(LOG_ERR, "error extending MD5 cache file `%s' to %ju bytes: %s",
+          config->cache_file, (uintmax_t)table->map_size, strerror(r));
+        close(fd);
+        return r;
+    }
+    if ((map = mmap(NULL, table->map_size, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0)) == MAP_FAILED) {
+        r = errno;
+        (*config->log)(LOG_ERR, "can't memory map MD5 cache file `%s': %s", config->cache_file, strerror(r));
+        close(fd);
+        return r;
+    }
+    close(fd);
+
+    // Done
+    table->array = map;
+    table->bits = bits;
+    table->mask = (1U << bits) - 1;
+    table->maxload = MAX_LOAD(1U << bits);
+    return 0;
+}
+
+static void
+ec_protect_written_free(struct ec_protect_private *priv)
+{
+    struct written_table *const table = &priv->written;
+
+    if (table->map_size != 0)
+        (void)munmap(table->array, table->map_size);
+    else
+        free(table->array);
+    free(priv->fifo.array);
+}
+
+/*
+ * Ensure the written table and FIFO can hold the given number of entries without allocating.
+ *
+ * This assumes the mutex is held.
+ */
+static int
+ec_protect_written_reserve(struct ec_protect_private *priv, u_int count)
+{
+    struct written_table *const table = &priv->written;
+    u_int bits;
+    int r;
+
+    // Grow table if needed (a mapped table is already big enough)
+    if (count > table->maxload && table->map_size == 0) {
+        for (bits = table->bits; MAX_LOAD(1U << bits) < count; bits++) {
+            if (bits == MAX_TABLE_BITS)
+                return ENOMEM;
+        }
+        if ((r = ec_protect_written_resize(table, bits)) != 0)
+            return r;
+    }
+
+    // Grow FIFO if needed; it may also contain stale entries, plus one entry for each block being written
+    if (priv->config->cache_time > 0
+      && (r = ec_protect_fifo_reserve(&priv->fifo, priv->fifo.count + s3b_hash_size(priv->hashtable) + 1)) != 0)
+        return r;
+
+    // Done
+    return 0;
+}
+
+static int
+ec_protect_written_resize(struct written_table *table, u_int bits)
+{
+    struct written_entry *const old_array = table->array;
+    const u_int old_alen = old_array != NULL ? table->mask + 1 : 0;
+    struct written_entry *new_array;
+    u_int i;
+
+    assert(table->map_size == 0);
+    if ((new_array = calloc((size_t)1 << bits, sizeof(*new_array))) == NULL)
+        return errno;
+    table->array = new_array;
+    table->bits = bits;
+    table->mask = (1U << bits) - 1;
+    table->maxload = MAX_LOAD(1U << bits);
+    table->count = 0;
+    for (i = 0; i < old_alen; i++) {
+        if (old_array[i].when != WRITTEN_EMPTY)
+            ec_protect_written_insert(table, &old_array[i]);
+    }
+    free(old_array);
+    return 0;
+}
+
+static u_int
+ec_protect_written_index(struct written_table *table, s3b_block_t block_num)
+{
+    return (u_int)(((uint64_t)block_num * HASH_MULTIPLIER) >> (64 - table->bits));
+}
+
+static struct written_entry *
+ec_protect_written_find(struct written_table *table, s3b_block_t block_num)
+{
+    u_int i;
+
+    for (i = ec_protect_written_index(table, block_num); table->array[i].when != WRITTEN_EMPTY; i = (i + 1) & table->mask) {
+        if (table->array[i].block_num == block_num)
+            return &table->array[i];
+    }
+    return NULL;
+}
+
+// The block must not already be in the table, and there must be room
+static void
+ec_protect_written_insert(struct written_table *table, const struct written_entry *entry)
+{
+    u_int i;
+
+    assert(entry->when != WRITTEN_EMPTY);
+    assert(table->count < table->maxload);
+    for (i = ec_protect_written_index(table, entry->block_num); table->array[i].when != WRITTEN_EMPTY; i = (i + 1) & table->mask)
+        assert(table->array[i].block_num != entry->block_num);
+    memcpy(&table->array[i], entry, sizeof(*entry));
+    table->count++;
+}
+
+// Remove entry by shifting back any following entries that would no longer be reachable
+static void
+ec_protect_written_remove(struct written_table *table, struct written_entry *entry)
+{
+    u_int hole = (u_int)(entry - table->array);
+    u_int home;
+    u_int i;
+
+    assert(entry->when != WRITTEN_EMPTY);
+    for (i = (hole + 1) & table->mask; table->array[i].when != WRITTEN_EMPTY; i = (i + 1) & table->mask) {
+        home = ec_protect_written_index(table, table->array[i].block_num);
+        if (((hole - home) & table->mask) < ((i - home) & table->mask)) {
+            memcpy(&table->array[hole], &table->array[i], sizeof(*table->array));
+            hole = i;
+        }
+    }
+    table->array[hole].when = WRITTEN_EMPTY;
+    table->count--;
+}
+
+static int
+ec_protect_fifo_reserve(struct written_fifo *fifo, u_int count)
+{
+    struct written_fifo_entry *new_array;
+    u_int new_size;
+    u_int i;
+
+    if (count <= fifo->size)
+        return 0;
+    for (new_size = fifo->size > 0 ? fifo->size : 1U << MIN_TABLE_BITS; new_size < count; new_size <<= 1) {
+        if (new_size >= 1U << MAX_TABLE_BITS)
+            return ENOMEM;
+    }
+    if ((new_array = malloc((size_t)new_size * sizeof(*new_array))) == NULL)
+        return errno;
+    for (i = 0; i < fifo->count; i++)
+        new_array[i] = fifo->array[(fifo->head + i) & (fifo->size - 1)];
+    free(fifo->array);
+    fifo->array = new_array;
+    fifo->size = new_size;
+    fifo->head = 0;
+    return 0;
+}
+
 #ifndef NDEBUG
 
 // Accounting structure
 struct check_info {
-    u_int   num_in_list;
-    u_int   written;
-    u_int   writing;
+    struct written_table    *written;
+    u_int                   writing;
 };
 
 static int
@@ -701,28 +1067,29 @@ ec_protect_check_one(void *arg, void *value)
     struct block_info *const binfo = value;
     struct check_info *const info = arg;
 
-    if (binfo->timestamp == 0)
-        info->writing++;
-    else
-        info->written++;
+    assert(ec_protect_written_find(info->written, binfo->block_num) == NULL);
+    info->writing++;
     return 0;
 }
 
 static void
 ec_protect_check_invariants(struct ec_protect_private *priv)
 {
-    struct block_info *binfo;
+    struct written_table *const table = &priv->written;
     struct check_info info;
+    u_int count = 0;
+    u_int i;
 
     memset(&info, 0, sizeof(info));
-    for (binfo = TAILQ_FIRST(&priv->list); binfo != NULL; binfo = TAILQ_NEXT(binfo, link)) {
-        assert(binfo->timestamp != 0);
-        assert(s3b_hash_get(priv->hashtable, binfo->block_num) == binfo);
-        info.num_in_list++;
-    }
+    info.written = table;
     s3b_hash_foreach(priv->hashtable, ec_protect_check_one, &info);
-    assert(info.written == info.num_in_list);
-    assert(info.written + info.writing == s3b_hash_size(priv->hashtable));
+    assert(info.writing == s3b_hash_size(priv->hashtable));
+    for (i = 0; i <= table->mask; i++) {
+        if (table->array[i].when != WRITTEN_EMPTY)
+            count++;
+    }
+    assert(count == table->count);
+    assert(table->count <= table->maxload);
+    assert(priv->fifo.count <= priv->fifo.size);
 }
 #endif
-
@@ -40,6 +40,7 @@ struct ec_protect_conf {
     u_int               min_write_delay;
     u_int               cache_time;
     u_int               cache_size;
+    const char          *cache_file;
     log_func_t          *log;
 };
 
@@ -50,6 +51,8 @@ struct ec_protect_stats {
     uint64_t            cache_full_delay;
     uint64_t            repeated_write_delay;
     u_int               out_of_memory_errors;
+    struct latency_hist cache_full_latency;         // individual waits for MD5 cache space
+    struct latency_hist write_delay_latency;        // individual waits for min_write_delay
 };
 
 // ec_protect.c
@@ -48,6 +48,7 @@
 #define BLOCKS_PER_DOT          0x100
 #define MAX_QUEUE_LENGTH        100000
 #define NUM_ERASURE_THREADS     25
+#define MAX_ERASURE_BATCH       1000                        // the most keys S3 accepts in one DeleteObjects request
 
 // Erasure state
 struct erase_state {
@@ -68,6 +69,7 @@ struct erase_state {
 // Internal functions
 static block_list_func_t erase_list_callback;
 static void *erase_thread_main(void *arg);
+static int erase_blocks(struct erase_state *priv, const s3b_block_t *block_nums, u_int num_blocks);
 
 int
 s3backer_erase(struct s3b_config *config)
@@ -113,7 +115,7 @@ s3backer_erase(struct s3b_config *config)
         warnx("pthread_cond_init: %s", strerror(r));
         goto fail3;
     }
-    if ((priv->seen = bitmap_init(config->num_blocks, 0)) == NULL) {
+    if ((priv->seen = bitmap_init(config->num_blocks, 0, 0)) == NULL) {
         r = errno;
         warnx("calloc: %s", strerror(r));
         goto fail4;
@@ -212,8 +214,9 @@ static void *
 erase_thread_main(void *arg)
 {
     struct erase_state *const priv = arg;
-    s3b_block_t block_num;
-    int r;
+    s3b_block_t batch[MAX_ERASURE_BATCH];
+    uintmax_t old_count;
+    u_int num_blocks;
 
     // Acquire lock
     pthread_mutex_lock(&priv->mutex);
@@ -224,27 +227,31 @@ erase_thread_main(void *arg)
         // Is there a block to erase?
         if (priv->qlen > 0) {
 
-            // Grab next bock
+            // Grab our share of the queue: a full batch when the listing is ahead of us, smaller ones when it's not,
+            // so that all threads stay busy whether or not the queue is deep
+            num_blocks = priv->qlen / NUM_ERASURE_THREADS;
+            if (num_blocks < 1)
+                num_blocks = 1;
+            else if (num_blocks > MAX_ERASURE_BATCH)
+                num_blocks = MAX_ERASURE_BATCH;
             if (priv->qlen == MAX_QUEUE_LENGTH)
                 pthread_cond_broadcast(&priv->queue_not_full);
-            block_num = priv->queue[--priv->qlen];
+            priv->qlen -= num_blocks;
+            memcpy(batch, priv->queue + priv->qlen, num_blocks * sizeof(*batch));
             if (priv->qlen == 0)
                 pthread_cond_signal(&priv->queue_empty);
 
             // Do block deletion
             CHECK_RETURN(pthread_mutex_unlock(&priv->mutex));
-            r = (*priv->s3b->write_block)(priv->s3b, block_num, NULL, NULL, NULL, NULL);
+            num_blocks = erase_blocks(priv, batch, num_blocks);
             pthread_mutex_lock(&priv->mutex);
 
-            // Check for error
-            if (r != 0) {
-                warnx("can't delete block %0*jx: %s", S3B_BLOCK_NUM_DIGITS, (uintmax_t)block_num, strerror(r));
-                continue;
-            }
-
-            // Update count and output a dot
-            if ((++priv->count % BLOCKS_PER_DOT) == 0 && !priv->quiet) {
-                fprintf(stderr, ".");
+            // Update count and output a dot for every BLOCKS_PER_DOT blocks
+            old_count = priv->count;
+            priv->count += num_blocks;
+            if (!priv->quiet && old_count / BLOCKS_PER_DOT != priv->count / BLOCKS_PER_DOT) {
+                for (old_count /= BLOCKS_PER_DOT; old_count < priv->count / BLOCKS_PER_DOT; old_count++)
+                    fprintf(stderr, ".");
                 fflush(stderr);
             }
 
@@ -265,3 +272,31 @@ erase_thread_main(void *arg)
     return NULL;
 }
 
+/*
+ * Delete a batch of blocks, using a single bulk delete if possible.
+ *
+ * If the bulk delete fails, fall back to deleting the blocks one at a time so we can report exactly which ones failed.
+ *
+ * Returns the number of blocks successfully deleted.
+ */
+static int
+erase_blocks(struct erase_state *priv, const s3b_block_t *block_nums, u_int num_blocks)
+{
+    u_int num_erased = 0;
+    u_int i;
+    int r;
+
+    // Try bulk delete first
+    if (num_blocks > 1 && (*priv->s3b->bulk_zero)(priv->s3b, block_nums, num_blocks) == 0)
+        return num_blocks;
+
+    // Delete individually
+    for (i = 0; i < num_blocks; i++) {
+        if ((r = (*priv->s3b->write_block)(priv->s3b, block_nums[i], NULL, NULL, NULL, NULL)) != 0) {
+            warnx("can't delete block %0*jx: %s", S3B_BLOCK_NUM_DIGITS, (uintmax_t)block_nums[i], strerror(r));
+            continue;
+        }
+        num_erased++;
+    }
+    return num_erased;
+}
@@ -421,11 +421,9 @@ fuse_op_read(const char *path, char *buf, size_t size, off_t offset, struct fuse
     calculate_boundary_info(&info, config->block_size, buf, size, offset);
     if (info.header.length > 0 && (r = block_part_read_block_part(priv->s3b, priv->block_part, &info.header)) != 0)
         return -r;
-    while (info.mid_block_count-- > 0) {
-        if ((r = (*priv->s3b->read_block)(priv->s3b, info.mid_block_start++, info.mid_data, NULL, NULL, 0)) != 0)
-            return -r;
-        info.mid_data += config->block_size;
-    }
+    if (info.mid_block_count > 0
+      && (r = (*priv->s3b->read_blocks)(priv->s3b, info.mid_block_start, (u_int)info.mid_block_count, info.mid_data)) != 0)
+        return -r;
     if (info.footer.length > 0 && (r = block_part_read_block_part(priv->s3b, priv->block_part, &info.footer)) != 0)
         return -r;
 
@@ -468,11 +466,9 @@ fuse_op_write(const char *path, const char *buf, size_t size, off_t offset, stru
     calculate_boundary_info(&info, config->block_size, buf, size, offset);
     if (info.header.length > 0 && (r = block_part_write_block_part(priv->s3b, priv->block_part, &info.header)) != 0)
         return -r;
-    while (info.mid_block_count-- > 0) {
-        if ((r = (*priv->s3b->write_block)(priv->s3b, info.mid_block_start++, info.mid_data, NULL, NULL, NULL)) != 0)
-            return -r;
-        info.mid_data += config->block_size;
-    }
+    if (info.mid_block_count > 0
+      && (r = (*priv->s3b->write_blocks)(priv->s3b, info.mid_block_start, (u_int)info.mid_block_count, info.mid_data)) != 0)
+        return -r;
     if (info.footer.length > 0 && (r = block_part_write_block_part(priv->s3b, priv->block_part, &info.footer)) != 0)
         return -r;
 
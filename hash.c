@@ -35,31 +35,53 @@
  */
 
 /*
- * This is a simple closed hash table implementation with linear probing.
- * We pre-allocate the hash array based on the expected maximum size.
+ * This is a closed hash table implementation using Robin Hood hashing with linear probing.
+ *
+ * Each slot in the hash array stores a copy of the value's key and its distance from its home slot next to the
+ * value pointer, so probing never has to dereference a value: a lookup scans a short run of adjacent slots, which
+ * typically lie in the same CPU cache line. Robin Hood insertion keeps probe sequences short and allows a failed
+ * lookup to stop as soon as it reaches a slot whose occupant is closer to home than the key being sought would be.
+ * Removal uses backward shifting, so there are no tombstones.
+ *
+ * The hash array length is always a power of two. We pre-allocate the hash array based on the expected maximum
+ * size and grow it automatically if that size is exceeded.
  */
 
 #include "s3backer.h"
 #include "hash.h"
 
 // Definitions
-#define LOAD_FACTOR                 0.666666
+#define MIN_ALEN_BITS               3
+#define MAX_ALEN_BITS               31
+#define MAX_LOAD(alen)              ((alen) - ((alen) >> 3))       // max load factor is 7/8
+#define HASH_MULTIPLIER             0x9e3779b97f4a7c15ULL
 #define FIRST(hash, key)            (s3b_hash_index((hash), (key)))
-#define NEXT(hash, index)           ((index) + 1 < (hash)->alen ? (index) + 1 : 0)
-#define EMPTY(value)                ((value) == NULL)
-#define VALUE(hash, index)          ((hash)->array[(index)])
+#define NEXT(hash, index)           (((index) + 1) & (hash)->mask)
+#define EMPTY(slot)                 ((slot)->dist == 0)
 #define KEY(value)                  (*(s3b_block_t *)(value))
 
+// One hash array slot
+struct s3b_hash_slot {
+    s3b_block_t                     key;            // copy of the value's key
+    uint32_t                        dist;           // distance from home slot plus one, or zero if empty
+    void                            *value;
+};
+
 // Hash table structure
 struct s3b_hash {
-    u_int       maxkeys;            // max capacity
-    u_int       numkeys;            // number of keys in table
-    u_int       alen;               // hash array length
-    void        *array[0];          // hash array
+    u_int                           numkeys;        // number of keys in table
+    u_int                           bits;           // log2 of hash array length
+    u_int                           mask;           // hash array length minus one
+    u_int                           maxload;        // grow the hash array when numkeys would exceed this
+    struct s3b_hash_slot            *array;         // hash array
 };
 
 // Declarations
 static u_int s3b_hash_index(struct s3b_hash *hash, s3b_block_t key);
+static struct s3b_hash_slot *s3b_hash_find(struct s3b_hash *hash, s3b_block_t key);
+static void s3b_hash_insert(struct s3b_hash *hash, s3b_block_t key, void *value);
+static int s3b_hash_resize(struct s3b_hash *hash, u_int bits);
+static void s3b_hash_reserve(struct s3b_hash *hash);
 
 // Public functions
 
@@ -67,15 +89,19 @@ int
 s3b_hash_create(struct s3b_hash **hashp, u_int maxkeys)
 {
     struct s3b_hash *hash;
-    u_int alen;
+    u_int bits;
+    int r;
 
-    if (maxkeys >= (u_int)(UINT_MAX * LOAD_FACTOR) - 1)
-        return EINVAL;
-    alen = (u_int)(maxkeys / LOAD_FACTOR) + 1;
-    if ((hash = calloc(1, sizeof(*hash) + alen * sizeof(*hash->array))) == NULL)
+    for (bits = MIN_ALEN_BITS; MAX_LOAD(1U << bits) < maxkeys; bits++) {
+        if (bits == MAX_ALEN_BITS)
+            return EINVAL;
+    }
+    if ((hash = calloc(1, sizeof(*hash))) == NULL)
         return ENOMEM;
-    hash->maxkeys = maxkeys;
-    hash->alen = alen;
+    if ((r = s3b_hash_resize(hash, bits)) != 0) {
+        free(hash);
+        return r;
+    }
     *hashp = hash;
     return 0;
 }
@@ -83,6 +109,7 @@ s3b_hash_create(struct s3b_hash **hashp, u_int maxkeys)
 void
 s3b_hash_destroy(struct s3b_hash *hash)
 {
+    free(hash->array);
     free(hash);
 }
 
@@ -95,43 +122,33 @@ s3b_hash_size(struct s3b_hash *hash)
 void *
 s3b_hash_get(struct s3b_hash *hash, s3b_block_t key)
 {
-    u_int i;
+    struct s3b_hash_slot *const slot = s3b_hash_find(hash, key);
 
-    for (i = FIRST(hash, key); 1; i = NEXT(hash, i)) {
-        void *const value = VALUE(hash, i);
-
-        if (EMPTY(value))
-            return NULL;
-        if (KEY(value) == key)
-            return value;
-    }
+    return slot != NULL ? slot->value : NULL;
 }
 
 /*
  * Add/replace entry.
  *
- * Note that the value being replaced (if any) is referenced by this function,
- * so it should not be free'd until after this function returns.
+ * Returns the value being replaced, if any.
  */
 void *
 s3b_hash_put(struct s3b_hash *hash, void *value)
 {
     const s3b_block_t key = KEY(value);
-    u_int i;
-
-    for (i = FIRST(hash, key); 1; i = NEXT(hash, i)) {
-        void *const value2 = VALUE(hash, i);
-
-        if (EMPTY(value))
-            break;
-        if (KEY(value2) == key) {
-            VALUE(hash, i) = value;         // replace existing value having the same key with new value
-            return value2;
-        }
+    struct s3b_hash_slot *slot;
+    void *value2;
+
+    // Replace existing value having the same key with new value, if any
+    if ((slot = s3b_hash_find(hash, key)) != NULL) {
+        value2 = slot->value;
+        slot->value = value;
+        return value2;
     }
-    assert(hash->numkeys < hash->maxkeys);
-    VALUE(hash, i) = value;
-    hash->numkeys++;
+
+    // Add new entry
+    s3b_hash_reserve(hash);
+    s3b_hash_insert(hash, key, value);
     return NULL;
 }
 
@@ -142,53 +159,32 @@ void
 s3b_hash_put_new(struct s3b_hash *hash, void *value)
 {
     const s3b_block_t key = KEY(value);
-    u_int i;
-
-    for (i = FIRST(hash, key); 1; i = NEXT(hash, i)) {
-        void *const value2 = VALUE(hash, i);
 
-        if (EMPTY(value2))
-            break;
-        assert(KEY(value2) != key);
-    }
-    assert(hash->numkeys < hash->maxkeys);
-    VALUE(hash, i) = value;
-    hash->numkeys++;
+    assert(s3b_hash_find(hash, key) == NULL);
+    s3b_hash_reserve(hash);
+    s3b_hash_insert(hash, key, value);
 }
 
 void
 s3b_hash_remove(struct s3b_hash *hash, s3b_block_t key)
 {
+    struct s3b_hash_slot *slot;
     u_int i;
     u_int j;
-    u_int k;
 
     // Find entry
-    for (i = FIRST(hash, key); 1; i = NEXT(hash, i)) {
-        void *const value = VALUE(hash, i);
-
-        if (EMPTY(value))               // no such entry
-            return;
-        if (KEY(value) == key)          // entry found
-            break;
-    }
-
-    // Repair subsequent entries as necessary
-    for (j = NEXT(hash, i); 1; j = NEXT(hash, j)) {
-        void *const value = VALUE(hash, j);
-
-        if (value == NULL)
-            break;
-        k = FIRST(hash, KEY(value));
-        if (j > i ? (k <= i || k > j) : (k <= i && k > j)) {
-            VALUE(hash, i) = value;
-            i = j;
-        }
+    if ((slot = s3b_hash_find(hash, key)) == NULL)      // no such entry
+        return;
+    i = slot - hash->array;
+
+    // Shift subsequent displaced entries back one slot
+    for (j = NEXT(hash, i); hash->array[j].dist > 1; i = j, j = NEXT(hash, j)) {
+        hash->array[i] = hash->array[j];
+        hash->array[i].dist--;
     }
 
     // Remove entry
-    assert(VALUE(hash, i) != NULL);
-    VALUE(hash, i) = NULL;
+    memset(&hash->array[i], 0, sizeof(hash->array[i]));
     hash->numkeys--;
 }
 
@@ -197,33 +193,116 @@ s3b_hash_foreach(struct s3b_hash *hash, s3b_hash_visit_t *visitor, void *arg)
 {
     u_int i;
 
-    for (i = 0; i < hash->alen; i++) {
-        void *const value = VALUE(hash, i);
+    for (i = 0; i <= hash->mask; i++) {
+        const struct s3b_hash_slot *const slot = &hash->array[i];
         int r;
 
-        if (value != NULL && (r = (*visitor)(arg, value)) != 0)
+        if (!EMPTY(slot) && (r = (*visitor)(arg, slot->value)) != 0)
             return r;
     }
     return 0;
 }
 
+// Internal functions
+
 /*
- * Jenkins one-at-a-time hash
+ * Fibonacci (multiplicative) hashing; the high bits of the product are the best mixed.
  */
 static u_int
 s3b_hash_index(struct s3b_hash *hash, s3b_block_t key)
 {
-    u_int value = 0;
-    int i;
+    return (u_int)(((uint64_t)key * HASH_MULTIPLIER) >> (64 - hash->bits));
+}
 
-    for (i = 0; i < sizeof(key); i++) {
-        value += ((u_char *)&key)[i];
-        value += (value << 10);
-        value ^= (value >> 6);
+static struct s3b_hash_slot *
+s3b_hash_find(struct s3b_hash *hash, s3b_block_t key)
+{
+    uint32_t dist;
+    u_int i;
+
+    for (i = FIRST(hash, key), dist = 1; 1; i = NEXT(hash, i), dist++) {
+        struct s3b_hash_slot *const slot = &hash->array[i];
+
+        if (slot->dist < dist)          // empty, or the key would have displaced this entry
+            return NULL;
+        if (slot->key == key)
+            return slot;
+    }
+}
+
+/*
+ * Insert a new entry. There must be room and no entry with the same key.
+ */
+static void
+s3b_hash_insert(struct s3b_hash *hash, s3b_block_t key, void *value)
+{
+    struct s3b_hash_slot entry;
+    u_int i;
+
+    // Sanity check
+    assert(value != NULL);
+    assert(hash->numkeys < hash->mask);
+
+    // Walk forward, swapping with any entry that is closer to its home slot than we are
+    entry.key = key;
+    entry.dist = 1;
+    entry.value = value;
+    for (i = FIRST(hash, key); 1; i = NEXT(hash, i), entry.dist++) {
+        struct s3b_hash_slot *const slot = &hash->array[i];
+
+        if (EMPTY(slot)) {
+            *slot = entry;
+            break;
+        }
+        if (slot->dist < entry.dist) {
+            const struct s3b_hash_slot temp = *slot;
+
+            *slot = entry;
+            entry = temp;
+        }
     }
-    value += (value << 3);
-    value ^= (value >> 11);
-    value += (value << 15);
-    return value % hash->alen;
+    hash->numkeys++;
+}
+
+/*
+ * Make room for one more entry, growing the hash array if needed.
+ *
+ * If we can't allocate a bigger array, we keep going with the current one, which still works
+ * (just more slowly) until it's completely full.
+ */
+static void
+s3b_hash_reserve(struct s3b_hash *hash)
+{
+    if (hash->numkeys < hash->maxload || hash->bits == MAX_ALEN_BITS)
+        return;
+    (void)s3b_hash_resize(hash, hash->bits + 1);
 }
 
+static int
+s3b_hash_resize(struct s3b_hash *hash, u_int bits)
+{
+    struct s3b_hash_slot *const old_array = hash->array;
+    const u_int old_alen = old_array != NULL ? hash->mask + 1 : 0;
+    struct s3b_hash_slot *new_array;
+    u_int i;
+
+    // Allocate new array
+    assert(bits >= MIN_ALEN_BITS && bits <= MAX_ALEN_BITS);
+    if ((new_array = calloc((size_t)1 << bits, sizeof(*new_array))) == NULL)
+        return ENOMEM;
+
+    // Re-insert existing entries
+    hash->array = new_array;
+    hash->bits = bits;
+    hash->mask = (1U << bits) - 1;
+    hash->maxload = MAX_LOAD(1U << bits);
+    hash->numkeys = 0;
+    for (i = 0; i < old_alen; i++) {
+        const struct s3b_hash_slot *const slot = &old_array[i];
+
+        if (!EMPTY(slot))
+            s3b_hash_insert(hash, slot->key, slot->value);
+    }
+    free(old_array);
+    return 0;
+}
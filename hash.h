@@ -41,7 +41,9 @@
  *
  * 1.  Keys are of type s3b_block_t
  * 2.  Values are structures in which the first field is the key
- * 3.  No attempts will be made to overload the table
+ * 3.  A value's key does not change while the value is in the table
+ *
+ * The "maxkeys" given to s3b_hash_create() is the expected maximum size; the table grows if it is exceeded.
  */
 
 // Definitions
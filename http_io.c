@@ -37,6 +37,7 @@
 #include "s3backer.h"
 #include "http_io.h"
 #include "compress.h"
+#include "pool.h"
 #include "util.h"
 
 // HTTP definitions
@@ -54,6 +55,7 @@
 #define HTTP_FORBIDDEN              403
 #define HTTP_NOT_FOUND              404
 #define HTTP_PRECONDITION_FAILED    412
+#define HTTP_SERVICE_UNAVAILABLE    503
 #define AUTH_HEADER                 "Authorization"
 #define CTYPE_HEADER                "Content-Type"
 #define CONTENT_ENCODING_HEADER     "Content-Encoding"
@@ -83,6 +85,22 @@
 #define MOUNT_TOKEN_FILE            "s3backer-mounted"
 #define MOUNT_TOKEN_FILE_MIME_TYPE  "text/plain"
 
+// Saved non-zero block survey file: a one line header followed by the zlib-compressed bitmap
+#define SURVEY_FILE                 "s3backer-survey"
+#define SURVEY_FILE_MIME_TYPE       "application/octet-stream"
+#define SURVEY_HEADER_PRINTF        "s3backer-survey-v1 token=%08x blocks=%ju blocksize=%u crc=%08x"
+#define SURVEY_HEADER_SCANF         "s3backer-survey-v1 token=%x blocks=%ju blocksize=%u crc=%x"
+#define SURVEY_HEADER_MAX           128
+#define SURVEY_REPLAY_BATCH         1024
+
+// Compression dictionary files: "s3backer-dict-ALG" names the current dictionary, "s3backer-dict-ALG-ID" holds each one
+#define DICT_FILE_PREFIX            "s3backer-dict-"
+#define DICT_FILE_NAME_MAX          64
+#define DICT_FILE_MIME_TYPE         "application/octet-stream"
+#define DICT_POINTER_MIME_TYPE      "text/plain"
+#define DICT_SAMPLE_MAX_SIZE        (64 * 1024)                 // we only sample the first part of large blocks
+#define DICT_SAMPLE_BUDGET          (100 * COMP_DICT_MAX_SIZE)  // total sample size recommended for training
+
 // HTTP `Date' and `x-amz-date' header formats
 #define HTTP_DATE_HEADER            "Date"
 #define AWS_DATE_HEADER             "x-amz-date"
@@ -98,6 +116,9 @@
                                       + strlen(BLOCK_HASH_PREFIX_SEPARATOR)     \
                                       + S3B_BLOCK_NUM_DIGITS + 2)
 
+// Size of the pooled buffers used for GET responses (compressed and/or encrypted data may be larger than a block)
+#define READ_BUF_SIZE(config)       (compressBound((config)->block_size) + 2 * EVP_MAX_IV_LENGTH)
+
 // Separator string used when "--blockHashPrefix" is in effect
 #define BLOCK_HASH_PREFIX_SEPARATOR "-"
 
@@ -125,6 +146,10 @@
 #define LIST_BLOCKS_CHUNK           1000
 #define DELETE_BLOCKS_CHUNK         1000
 
+// Block survey work distribution
+#define SURVEY_PARTITIONS_PER_THREAD 4                          // initial partitions of the name space per survey thread
+#define SURVEY_MIN_STEAL            (2 * LIST_BLOCKS_CHUNK)     // don't bother splitting ranges narrower than this
+
 // Maximum error payload size in bytes
 #define MAX_ERROR_PAYLOAD_SIZE      0x100000
 
@@ -146,6 +171,8 @@
 #define S3_SERVICE_NAME             "s3"
 #define SIGNATURE_TERMINATOR        "aws4_request"
 #define SECURITY_TOKEN_HEADER       "x-amz-security-token"
+#define UNSIGNED_PAYLOAD            "UNSIGNED-PAYLOAD"
+#define EMPTY_PAYLOAD_SHA256        "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855"
 
 // EC2 IAM info URL
 #define EC2_IAM_META_DATA_URLBASE   "http://169.254.169.254/latest/meta-data/iam/security-credentials/"
@@ -157,6 +184,30 @@
 #define TCP_KEEP_ALIVE_IDLE         200
 #define TCP_KEEP_ALIVE_INTERVAL     60
 
+// Connection pool parameters
+#define MIN_SHARED_CONNECTS         32                  // minimum size of the shared connection cache
+
+// cURL can share its connection cache between easy handles starting with version 7.57.0
+#define HTTP_IO_SHARE_CONNECTIONS   (LIBCURL_VERSION_NUM >= 0x073900)
+
+// Asynchronous engine parameters
+#define ASYNC_POLL_MILLIS           1000                // max time the event loop sleeps without checking for work
+#define ASYNC_READ_BATCH            128                 // max number of blocks read_blocks() requests at once
+
+// The asynchronous engine requires curl_multi_poll() and curl_multi_wakeup()
+#define HTTP_IO_ASYNC_SUPPORTED     (LIBCURL_VERSION_NUM >= 0x074400)
+
+// Encoder pool parameters
+#define WRITE_PIPELINE_BATCH        32                  // max number of blocks write_blocks() encodes ahead at once
+
+// Adaptive concurrency limit parameters
+#define LIMIT_DECREASE              0.5                 // factor by which the limit shrinks when S3 pushes back
+
+// Read hedging parameters
+#define HEDGE_LATENCY_BUCKETS       64                  // GET latency histogram buckets, each 2^(1/4) times wider than the last
+#define HEDGE_MIN_SAMPLES           100                 // don't hedge until we have seen this many GETs
+#define HEDGE_DECAY_SAMPLES         1000                // halve the histogram this often, so it tracks recent latency
+
 // Misc
 #define WHITESPACE                  " \t\v\f\r\n"
 #if MD5_DIGEST_LENGTH != 16
@@ -178,12 +229,38 @@ struct curl_holder {
     LIST_ENTRY(curl_holder)     link;
 };
 
+// One transfer handed to the asynchronous engine; "done" is invoked from the event loop thread and must not block
+struct http_io_async;
+typedef void http_io_async_done_t(struct http_io_async *req);
+struct http_io_async {
+    CURL                        *curl;
+    CURLcode                    curl_code;                      // result of the transfer
+    u_int                       limit_gen;                      // from http_io_limit_acquire()
+    http_io_async_done_t        *done;                          // completion callback
+    void                        *done_arg;                      // completion callback argument
+    TAILQ_ENTRY(http_io_async)  link;
+};
+
+// A group of transfers that some thread is waiting on
+struct http_io_batch {
+    struct http_io_private      *priv;
+    pthread_cond_t              done;                           // signaled when "remaining" reaches zero
+    u_int                       remaining;                      // the number of transfers not yet completed
+};
+
+// A compression dictionary that has been loaded
+struct http_io_dict {
+    const struct comp_alg       *calg;
+    struct comp_dict            *dict;
+};
+
 // Block survey per-thread info
 struct http_io_survey {
     struct http_io_private      *priv;
     pthread_t                   thread;
-    s3b_block_t                 min_name;
-    s3b_block_t                 max_name;
+    int                         active;                         // thread is scanning [min_name, max_name]; protected by mutex
+    s3b_block_t                 min_name;                       // the next name not yet scanned; protected by mutex
+    s3b_block_t                 max_name;                       // inclusive upper bound, may be lowered by stealing; ditto
     block_list_func_t           *callback;
     void                        *callback_arg;
 };
@@ -193,8 +270,11 @@ struct http_io_private {
     struct http_io_conf         *config;
     struct http_io_stats        stats;
     LIST_HEAD(, curl_holder)    curls;
+    CURLSH                      *share;                         // shared DNS, SSL session, and connection caches
+    pthread_mutex_t             share_locks[CURL_LOCK_DATA_LAST];
     pthread_mutex_t             mutex;
-    bitmap_t                    *non_zero;                      // config->nonzero_bitmap is moved to here
+    bitmap_t                    *non_zero;                      // config->nonzero_bitmap, saved survey, or completed survey
+    struct s3b_pool             *read_pool;                     // pool of GET response and decryption buffers
     pthread_t                   iam_thread;                     // IAM credentials refresh thread
     u_char                      iam_thread_alive;               // IAM thread was successfully created
     u_char                      iam_thread_shutdown;            // Flag to the IAM thread telling it to exit
@@ -206,12 +286,75 @@ struct http_io_private {
     pthread_cond_t              survey_done;                    // indicates last survey thread has finished
     volatile int                abort_survey;                   // set to 1 to abort block survey
     int                         survey_error;                   // error from any survey thread
+    bitmap_t                    *survey_non_zero;               // blocks found by the survey in progress, if saving it
+    s3b_block_t                 survey_last_name;               // the last possible name the survey may find
+    u_int                       survey_num_partitions;          // the number of initial partitions of the name space
+    u_int                       survey_next_partition;          // the next initial partition not yet claimed by a thread
+    int32_t                     mount_token;                    // the mount token we set when mounting, if any
+
+    // Asynchronous engine info
+    CURLM                       *multi;                         // multi handle, owned by the event loop thread
+    pthread_t                   async_thread;                   // event loop thread
+    u_char                      async_thread_alive;             // event loop thread was successfully created
+    u_char                      async_thread_shutdown;          // flag to the event loop thread telling it to exit
+    TAILQ_HEAD(, http_io_async) async_pending;                  // submitted transfers not yet added to "multi"
+    u_int                       async_active;                   // the number of transfers added to "multi"
+
+    // AWS version 4 signing key cache (protected by "mutex")
+    u_char                      sign_key[EVP_MAX_MD_SIZE];      // signing key derived from the secret key, date, and region
+    u_int                       sign_key_len;                   // length of "sign_key", or zero if none cached
+    char                        sign_key_date[9];               // the date (YYYYMMDD) "sign_key" is valid for
+    u_int                       sign_key_creds;                 // value of "creds_version" that "sign_key" was derived from
+    u_int                       creds_version;                  // incremented every time the credentials change
+
+    // Recent request trace (circular buffer), if any
+    struct http_io_trace        *trace;                         // "config->trace_size" entries
+    uint64_t                    trace_next;                     // total number of requests traced (updated atomically)
+
+    // Adaptive concurrency limit info
+    double                      limit;                          // current limit on the number of requests in flight
+    u_int                       limit_active;                   // the number of requests in flight
+    u_int                       limit_gen;                      // incremented every time a request starts
+    u_int                       limit_backoff_gen;              // value of "limit_gen" when the limit was last reduced
+    pthread_cond_t              limit_slot;                     // signaled when a request may be able to start
+
+    // Read hedging info
+    u_int                       hedge_hist[HEDGE_LATENCY_BUCKETS]; // histogram of recent successful GET latencies
+    u_int                       hedge_samples;                  // total of all "hedge_hist" counts
+
+    // Encoder pool info
+    pthread_t                   *encode_threads;                // threads that encode blocks for write_blocks()
+    u_int                       num_encode_threads;             // the number of encoder threads that are alive
+    u_char                      encode_shutdown;                // flag to the encoder threads telling them to exit
+    TAILQ_HEAD(, http_io_encode) encode_queue;                  // blocks waiting to be encoded
+    pthread_cond_t              encode_wakeup;                  // signaled when "encode_queue" has work or on shutdown
+
+    // Compression dictionary info
+    const struct comp_dict      *compress_dict;                 // dictionary for compressing new blocks, if any
+    struct http_io_dict         *dicts;                         // dictionaries loaded so far (never unloaded)
+    u_int                       num_dicts;                      // the number of dictionaries in "dicts"
+    u_char                      dict_sampling;                  // collecting samples to train a new dictionary
+    char                        *dict_samples;                  // concatenated samples collected so far
+    size_t                      *dict_sample_lens;              // length of each sample
+    u_int                       num_dict_samples;               // the number of samples collected so far
+    size_t                      dict_samples_size;              // total length of all samples
+
+    // Adaptive compression info
+    struct comp_adapt           *comp_adapt;                    // adaptive compression state, if enabled
 
     // Encryption info
     const EVP_CIPHER            *cipher;
     u_int                       keylen;                         // length of key and ivkey
     u_char                      key[EVP_MAX_KEY_LENGTH];        // key used to encrypt data
     u_char                      ivkey[EVP_MAX_KEY_LENGTH];      // key used to encrypt block number to get IV for data
+    pthread_key_t               cipher_key;                     // each thread's struct http_io_cipher
+};
+
+// Per-thread cipher contexts, keyed once and then reused for every block
+struct http_io_cipher {
+    EVP_CIPHER_CTX              *iv_ctx;                        // encrypts block number using "ivkey" to get IV
+    EVP_CIPHER_CTX              *enc_ctx;                       // encrypts data using "key"
+    EVP_CIPHER_CTX              *dec_ctx;                       // decrypts data using "key"
 };
 
 // I/O buffers
@@ -280,6 +423,29 @@ struct http_io {
     size_t              error_payload_len;      // error response length
 };
 
+// A hedged block read: up to two identical GETs, of which the first to complete is used
+struct http_io_hedge {
+    struct http_io_private      *priv;
+    pthread_cond_t              done;                           // signaled when the first transfer completes
+    int                         winner;                         // index of the first transfer to complete, or -1
+    u_int                       refs;                           // the caller, plus each transfer not yet completed
+    struct http_io_async        reqs[2];
+    struct http_io              ios[2];
+    char                        urlbufs[];                      // a URL buffer for each request
+};
+
+// One block being encoded by the encoder pool
+struct http_io_encode {
+    struct http_io              io;                             // the request, once built
+    struct http_io_batch        *batch;                         // the batch this block belongs to
+    s3b_block_t                 block_num;                      // block to write
+    const void                  *src;                           // block data
+    char                        *urlbuf;                        // URL buffer for "io"
+    void                        *encoded_buf;                   // compressed and/or encrypted data, if any
+    int                         result;                         // result from http_io_write_prepare()
+    TAILQ_ENTRY(http_io_encode) link;
+};
+
 // CURL prepper function type
 typedef void http_io_curl_prepper_t(CURL *curl, struct http_io *io);
 
@@ -289,11 +455,14 @@ static int http_io_meta_data(struct s3backer_store *s3b, off_t *file_sizep, u_in
 static int http_io_set_mount_token(struct s3backer_store *s3b, int32_t *old_valuep, int32_t new_value);
 static int http_io_read_block(struct s3backer_store *s3b, s3b_block_t block_num, void *dest,
   u_char *actual_etag, const u_char *expect_etag, int strict);
+static int http_io_read_blocks(struct s3backer_store *s3b, s3b_block_t block_num, u_int num_blocks, void *dest);
 static int http_io_write_block(struct s3backer_store *s3b, s3b_block_t block_num, const void *src, u_char *etag,
   check_cancel_t *check_cancel, void *check_cancel_arg);
+static int http_io_write_blocks(struct s3backer_store *s3b, s3b_block_t block_num, u_int num_blocks, const void *src);
 static int http_io_flush_blocks(struct s3backer_store *s3b, const s3b_block_t *block_nums, u_int num_blocks, long timeout);
 static int http_io_bulk_zero(struct s3backer_store *const s3b, const s3b_block_t *block_nums, u_int num_blocks);
 static int http_io_survey_non_zero(struct s3backer_store *s3b, block_list_func_t *callback, void *arg);
+static int http_io_block_status(struct s3backer_store *s3b, s3b_block_t block_num, u_int num_blocks, int *zerop, u_int *countp);
 static int http_io_shutdown(struct s3backer_store *s3b);
 static void http_io_destroy(struct s3backer_store *s3b);
 
@@ -307,6 +476,7 @@ static http_io_curl_prepper_t http_io_iamcreds_prepper;
 // S3 REST API functions
 static void http_io_get_block_url(char *buf, size_t bufsiz, struct http_io_conf *config, s3b_block_t block_num);
 static void http_io_get_mount_token_file_url(char *buf, size_t bufsiz, struct http_io_conf *config);
+static void http_io_get_meta_file_url(char *buf, size_t bufsiz, struct http_io_conf *config, const char *name);
 static int http_io_add_auth(struct http_io_private *priv, struct http_io *io, time_t now, const void *payload, size_t plen);
 static int http_io_add_auth2(struct http_io_private *priv, struct http_io *io, time_t now, const void *payload, size_t plen);
 static int http_io_add_auth4(struct http_io_private *priv, struct http_io *io, time_t now, const void *payload, size_t plen);
@@ -319,13 +489,63 @@ static int update_iam_credentials(struct http_io_private *priv);
 static char *parse_json_field(struct http_io_private *priv, const char *json, const char *field);
 
 // Block survey functions
-static int http_io_list_blocks_range(struct http_io_private *priv,
-    s3b_block_t min, s3b_block_t max, block_list_func_t *callback, void *arg);
+static int http_io_list_blocks_range(struct http_io_survey *info, s3b_block_t min);
+static int http_io_survey_next_range(struct http_io_private *priv, struct http_io_survey *info);
+static s3b_block_t http_io_survey_partition_end(struct http_io_private *priv, u_int partition);
 static void *http_io_list_blocks_worker_main(void *arg);
 static void http_io_list_blocks_elem_end(void *arg, const XML_Char *name);
 static block_list_func_t http_io_list_blocks_callback;
 static void http_io_wait_for_survey_threads_to_exit(struct http_io_private *const priv);
 
+// Saved block survey
+static int http_io_survey_replay(struct http_io_private *priv, block_list_func_t *callback, void *arg);
+static bitmap_t *http_io_survey_load(struct http_io_private *priv, int32_t old_mount_token);
+static int http_io_survey_claim(struct http_io_private *priv, int32_t old_mount_token);
+static int http_io_survey_save(struct http_io_private *priv);
+
+// Block read helpers
+static int http_io_read_empty(struct http_io_private *priv, s3b_block_t block_num, void *dest, u_char *actual_etag);
+static int http_io_read_prepare(struct http_io_private *priv, struct http_io *io, char *urlbuf, size_t urlbuf_size,
+  s3b_block_t block_num, const u_char *expect_etag, int strict);
+static int http_io_read_finish(struct http_io_private *priv, struct http_io *io, int r, void *dest,
+  u_char *actual_etag, const u_char *expect_etag, int strict);
+
+// Read hedging
+static u_int http_io_hedge_delay(struct http_io_private *priv);
+static void http_io_hedge_sample(struct http_io_private *priv, double curl_time);
+static uint64_t http_io_hedge_bucket_micros(u_int bucket);
+static int http_io_read_hedged(struct http_io_private *priv, s3b_block_t block_num, void *dest,
+  u_char *actual_etag, const u_char *expect_etag, int strict, u_int hedge_millis);
+static int http_io_hedge_start(struct http_io_private *priv, struct http_io_hedge *hedge, int index);
+static void http_io_hedge_discard(struct http_io_private *priv, struct http_io *io);
+static void http_io_hedge_release(struct http_io_hedge *hedge);
+static http_io_async_done_t http_io_hedge_done;
+
+// Block write helpers
+static int http_io_write_prepare(struct http_io_private *priv, struct http_io *io, char *urlbuf, size_t urlbuf_size,
+  s3b_block_t block_num, const void *src, void **encoded_bufp);
+static int http_io_write_finish(struct http_io_private *priv, struct http_io *io, int r, u_char *caller_etag);
+
+// Compression dictionaries
+static int http_io_dict_start(struct http_io_private *priv);
+static const struct comp_dict *http_io_dict_for_write(struct http_io_private *priv, const void *src);
+static void http_io_dict_train(struct http_io_private *priv, char *samples, size_t *sample_lens, u_int num_samples);
+static const struct comp_dict *http_io_dict_find(struct http_io_private *priv, const struct comp_alg *calg, uint32_t id);
+static struct comp_dict *http_io_dict_fetch(struct http_io_private *priv, const struct comp_alg *calg, uint32_t id);
+static const struct comp_dict *http_io_dict_add(struct http_io_private *priv, const struct comp_alg *calg,
+  struct comp_dict *dict);
+static int http_io_get_object(struct http_io_private *priv, const char *name, void *buf, size_t bufsiz, size_t *lenp);
+static int http_io_put_object(struct http_io_private *priv, const char *name, const void *data, size_t len,
+  const char *mime_type);
+static int http_io_delete_object(struct http_io_private *priv, const char *name);
+
+// Encoder pool
+static int http_io_encode_start(struct http_io_private *priv);
+static void http_io_encode_stop(struct http_io_private *priv);
+static u_int http_io_encode_submit(struct http_io_private *priv, struct http_io_batch *batch, struct http_io_encode *jobs,
+  char *urlbufs, s3b_block_t block_num, u_int num_blocks, const void *src);
+static void *http_io_encode_main(void *arg);
+
 // Bulk delete
 static void http_io_bulk_delete_elem_end(void *arg, const XML_Char *name);
 
@@ -340,6 +560,16 @@ static void http_io_xml_text(void *arg, const XML_Char *s, int len);
 
 // HTTP and curl functions
 static int http_io_perform_io(struct http_io_private *priv, struct http_io *io, http_io_curl_prepper_t *prepper);
+static void http_io_perform_ios(struct http_io_private *priv, struct http_io **ios, int *results, u_int num_ios,
+  http_io_curl_prepper_t *prepper);
+static CURL *http_io_start_attempt(struct http_io_private *priv, struct http_io *io, http_io_curl_prepper_t *prepper, int attempt);
+static int http_io_finish_attempt(struct http_io_private *priv, struct http_io *io, CURL *curl, CURLcode curl_code,
+  u_int total_pause);
+static int http_io_retry_pause(struct http_io_private *priv, u_int *retry_pausep, u_int total_pause);
+static void http_io_trace_record(struct http_io_private *priv, struct http_io *io, CURL *curl, CURLcode curl_code, long http_code);
+static CURLcode http_io_transfer(struct http_io_private *priv, CURL *curl);
+static int http_io_limit_acquire(struct http_io_private *priv, u_int *genp, int wait);
+static void http_io_limit_release(struct http_io_private *priv, u_int gen, CURL *curl, CURLcode curl_code);
 static size_t http_io_curl_reader(const void *ptr, size_t size, size_t nmemb, void *stream);
 static size_t http_io_curl_writer(void *ptr, size_t size, size_t nmemb, void *stream);
 static size_t http_io_curl_header(void *ptr, size_t size, size_t nmemb, void *stream);
@@ -348,17 +578,36 @@ static struct curl_slist *http_io_add_header(struct http_io_private *priv, struc
 static void http_io_add_date(struct http_io_private *priv, struct http_io *const io, time_t now);
 static CURL *http_io_acquire_curl(struct http_io_private *priv, struct http_io *io);
 static void http_io_release_curl(struct http_io_private *priv, CURL **curlp, int may_cache);
+static void http_io_curl_set_options(struct http_io_private *priv, CURL *curl);
+static void http_io_curl_clear_request(CURL *curl);
+static int http_io_share_init(struct http_io_private *priv);
+static void http_io_share_destroy(struct http_io_private *priv);
+static void http_io_share_lock(CURL *curl, curl_lock_data data, curl_lock_access access, void *arg);
+static void http_io_share_unlock(CURL *curl, curl_lock_data data, void *arg);
+static void http_io_warm_connections(struct http_io_private *priv);
 static int http_io_reader_error_check(struct http_io *const io, const void *ptr, size_t len);
 static void http_io_free_error_payload(struct http_io *const io);
 static void http_io_log_error_payload(struct http_io *const io);
 static int http_io_sockopt_callback(void *clientp, curl_socket_t curlfd, curlsocktype purpose);
 
+// Asynchronous engine functions
+static int http_io_async_start(struct http_io_private *priv);
+static void http_io_async_stop(struct http_io_private *priv);
+static int http_io_async_submit(struct http_io_private *priv, struct http_io_async *req);
+#if HTTP_IO_ASYNC_SUPPORTED
+static void *http_io_async_main(void *arg);
+#endif
+static http_io_async_done_t http_io_batch_done;
+
 // Misc
 static void http_io_openssl_locker(int mode, int i, const char *file, int line);
 static u_long http_io_openssl_ider(void);
 static void http_io_base64_encode(char *buf, size_t bufsiz, const void *data, size_t len);
 static u_int http_io_crypt(struct http_io_private *priv,
     s3b_block_t block_num, int enc, const u_char *src, u_int len, u_char *dst, u_int dmax);
+static struct http_io_cipher *http_io_get_cipher(struct http_io_private *priv);
+static int http_io_init_cipher(struct http_io_private *priv, struct http_io_cipher *cipher);
+static void http_io_free_cipher(void *arg);
 static void http_io_authsig(struct http_io_private *priv, s3b_block_t block_num, const u_char *src, u_int len, u_char *hmac);
 static void update_hmac_from_header(HMAC_CTX *ctx, struct http_io *io,
   const char *name, int value_only, char *sigbuf, size_t sigbuflen);
@@ -409,10 +658,13 @@ http_io_create(struct http_io_conf *config)
     s3b->meta_data = http_io_meta_data;
     s3b->set_mount_token = http_io_set_mount_token;
     s3b->read_block = http_io_read_block;
+    s3b->read_blocks = http_io_read_blocks;
     s3b->write_block = http_io_write_block;
+    s3b->write_blocks = http_io_write_blocks;
     s3b->bulk_zero = http_io_bulk_zero;
     s3b->flush_blocks = http_io_flush_blocks;
     s3b->survey_non_zero = http_io_survey_non_zero;
+    s3b->block_status = http_io_block_status;
     s3b->shutdown = http_io_shutdown;
     s3b->destroy = http_io_destroy;
     if ((priv = calloc(1, sizeof(*priv))) == NULL) {
@@ -425,18 +677,36 @@ http_io_create(struct http_io_conf *config)
     if ((r = pthread_cond_init(&priv->survey_done, NULL)) != 0) {
         goto fail3;
     }
+    if ((r = pthread_cond_init(&priv->limit_slot, NULL)) != 0) {
+        pthread_cond_destroy(&priv->survey_done);
+        goto fail3;
+    }
+    priv->limit = config->request_limit;
+    if ((r = s3b_pool_create(&priv->read_pool, READ_BUF_SIZE(config), 0, config->log)) != 0)
+        goto fail4;
+    if (config->compress_adaptive
+      && (priv->comp_adapt = comp_adapt_create(config->log, config->compress_alg, config->compress_level)) == NULL) {
+        r = errno;
+        goto fail5;
+    }
+    if (config->trace_size > 0 && (priv->trace = calloc(config->trace_size, sizeof(*priv->trace))) == NULL) {
+        r = errno;
+        goto fail5;
+    }
     LIST_INIT(&priv->curls);
+    TAILQ_INIT(&priv->async_pending);
+    TAILQ_INIT(&priv->encode_queue);
     s3b->data = priv;
 
     // Initialize openssl
     num_openssl_locks = CRYPTO_num_locks();
     if ((openssl_locks = malloc(num_openssl_locks * sizeof(*openssl_locks))) == NULL) {
         r = errno;
-        goto fail4;
+        goto fail5;
     }
     for (nlocks = 0; nlocks < num_openssl_locks; nlocks++) {
         if ((r = pthread_mutex_init(&openssl_locks[nlocks], NULL)) != 0)
-            goto fail5;
+            goto fail6;
     }
     CRYPTO_set_locking_callback(http_io_openssl_locker);
     CRYPTO_set_id_callback(http_io_openssl_ider);
@@ -461,14 +731,14 @@ http_io_create(struct http_io_conf *config)
         if ((priv->cipher = EVP_get_cipherbyname(config->encryption)) == NULL) {
             (*config->log)(LOG_ERR, "unknown encryption cipher `%s'", config->encryption);
             r = EINVAL;
-            goto fail5;
+            goto fail6;
         }
         cipher_key_len = EVP_CIPHER_key_length(priv->cipher);
         priv->keylen = config->key_length > 0 ? config->key_length : cipher_key_len;
         if (priv->keylen < cipher_key_len || priv->keylen > sizeof(priv->key)) {
             (*config->log)(LOG_ERR, "key length %u for cipher `%s' is out of range", priv->keylen, config->encryption);
             r = EINVAL;
-            goto fail5;
+            goto fail6;
         }
 
         // Sanity check cipher is a block cipher
@@ -478,7 +748,7 @@ http_io_create(struct http_io_conf *config)
             (*config->log)(LOG_ERR, "invalid cipher `%s' (block size %u, IV length %u); only block ciphers are supported",
               config->encryption, cipher_block_size, cipher_iv_length);
             r = EINVAL;
-            goto fail5;
+            goto fail6;
         }
 
         // Hash password to get bulk data encryption key
@@ -487,7 +757,7 @@ http_io_create(struct http_io_conf *config)
           (u_char *)saltbuf, strlen(saltbuf), PBKDF2_ITERATIONS, priv->keylen, priv->key)) != 1) {
             (*config->log)(LOG_ERR, "failed to create encryption key");
             r = EINVAL;
-            goto fail5;
+            goto fail6;
         }
 
         // Hash the bulk encryption key to get the IV encryption key
@@ -495,7 +765,7 @@ http_io_create(struct http_io_conf *config)
           priv->key, priv->keylen, PBKDF2_ITERATIONS, priv->keylen, priv->ivkey)) != 1) {
             (*config->log)(LOG_ERR, "failed to create encryption key");
             r = EINVAL;
-            goto fail5;
+            goto fail6;
         }
 
         // Encryption debug
@@ -508,14 +778,22 @@ http_io_create(struct http_io_conf *config)
         (*config->log)(LOG_DEBUG, "ENCRYPTION INIT: cipher=\"%s\" pass=\"%s\" salt=\"%s\" key=0x%s ivkey=0x%s", config->encryption, config->password, saltbuf, keybuf, ivkeybuf);
     }
 #endif
+
+        // Create thread-local key for cipher contexts
+        if ((r = pthread_key_create(&priv->cipher_key, http_io_free_cipher)) != 0) {
+            (*config->log)(LOG_ERR, "pthread_key_create: %s", strerror(r));
+            goto fail6;
+        }
     }
 
     // Initialize cURL
     curl_global_init(CURL_GLOBAL_ALL);
+    if ((r = http_io_share_init(priv)) != 0)
+        goto fail7;
 
     // Initialize IAM credentials
     if (config->ec2iam_role != NULL && (r = update_iam_credentials(priv)) != 0)
-        goto fail6;
+        goto fail8;
 
     // Take ownership of non-zero block bitmap
     priv->non_zero = config->nonzero_bitmap;
@@ -524,14 +802,18 @@ http_io_create(struct http_io_conf *config)
     // Done
     return s3b;
 
-fail6:
+fail8:
     while ((holder = LIST_FIRST(&priv->curls)) != NULL) {
         curl_easy_cleanup(holder->curl);
         LIST_REMOVE(holder, link);
         free(holder);
     }
+    http_io_share_destroy(priv);
+fail7:
     curl_global_cleanup();
-fail5:
+    if (config->encryption != NULL)
+        (void)pthread_key_delete(priv->cipher_key);
+fail6:
     CRYPTO_set_locking_callback(NULL);
     CRYPTO_set_id_callback(NULL);
     while (nlocks > 0)
@@ -539,7 +821,12 @@ fail5:
     free(openssl_locks);
     openssl_locks = NULL;
     num_openssl_locks = 0;
+fail5:
+    free(priv->trace);
+    comp_adapt_destroy(priv->comp_adapt);          // OK if NULL
+    s3b_pool_destroy(priv->read_pool);
 fail4:
+    pthread_cond_destroy(&priv->limit_slot);
     pthread_cond_destroy(&priv->survey_done);
 fail3:
     pthread_mutex_destroy(&priv->mutex);
@@ -576,12 +863,37 @@ http_io_destroy(struct s3backer_store *const s3b)
         LIST_REMOVE(holder, link);
         free(holder);
     }
+    http_io_share_destroy(priv);
     curl_global_cleanup();
 
+    // Clean up encryption; other threads' cipher contexts are freed when those threads exit
+    if (priv->config->encryption != NULL) {
+        struct http_io_cipher *const cipher = pthread_getspecific(priv->cipher_key);
+
+        if (cipher != NULL)
+            http_io_free_cipher(cipher);
+        (void)pthread_key_delete(priv->cipher_key);
+    }
+
+    // Free compression dictionaries
+    while (priv->num_dicts > 0) {
+        struct http_io_dict *const hdict = &priv->dicts[--priv->num_dicts];
+
+        (*hdict->calg->dfree)(hdict->dict);
+    }
+    free(priv->dicts);
+    free(priv->dict_samples);
+    free(priv->dict_sample_lens);
+
     // Free structures
+    pthread_cond_destroy(&priv->limit_slot);
     pthread_cond_destroy(&priv->survey_done);
     pthread_mutex_destroy(&priv->mutex);
     bitmap_free(&priv->non_zero);
+    bitmap_free(&priv->survey_non_zero);
+    comp_adapt_destroy(priv->comp_adapt);          // OK if NULL
+    s3b_pool_destroy(priv->read_pool);
+    free(priv->trace);
     free(priv);
     free(s3b);
 }
@@ -624,6 +936,12 @@ http_io_shutdown(struct s3backer_store *const s3b)
     // Unlock mutex
     CHECK_RETURN(pthread_mutex_unlock(&priv->mutex));
 
+    // Shut down encoder pool, if any
+    http_io_encode_stop(priv);
+
+    // Shut down asynchronous engine, if any; subsequent operations (e.g., clearing the mount token) are done directly
+    http_io_async_stop(priv);
+
     // Done
     return 0;
 }
@@ -635,7 +953,10 @@ http_io_get_stats(struct s3backer_store *s3b, struct http_io_stats *stats)
 
     pthread_mutex_lock(&priv->mutex);
     memcpy(stats, &priv->stats, sizeof(*stats));
+    stats->request_limit = (u_int)priv->limit;
     CHECK_RETURN(pthread_mutex_unlock(&priv->mutex));
+    if (priv->comp_adapt != NULL)
+        stats->compress_level = comp_adapt_level(priv->comp_adapt);
 }
 
 void
@@ -648,6 +969,30 @@ http_io_clear_stats(struct s3backer_store *s3b)
     CHECK_RETURN(pthread_mutex_unlock(&priv->mutex));
 }
 
+/*
+ * Copy out up to "max" of the most recently performed requests, oldest first, and return how many were copied.
+ *
+ * Requests are traced without locking, so an entry being overwritten at the same moment may appear garbled.
+ */
+u_int
+http_io_get_trace(struct s3backer_store *s3b, struct http_io_trace *trace, u_int max)
+{
+    struct http_io_private *const priv = s3b->data;
+    struct http_io_conf *const config = priv->config;
+    const uint64_t next = ATOMIC_LOAD(priv->trace_next);
+    u_int count;
+    u_int i;
+
+    if (priv->trace == NULL)
+        return 0;
+    count = next < config->trace_size ? (u_int)next : config->trace_size;
+    if (count > max)
+        count = max;
+    for (i = 0; i < count; i++)
+        memcpy(&trace[i], &priv->trace[(next - count + i) % config->trace_size], sizeof(*trace));
+    return count;
+}
+
 static int
 http_io_flush_blocks(struct s3backer_store *s3b, const s3b_block_t *block_nums, u_int num_blocks, long timeout)
 {
@@ -660,11 +1005,11 @@ http_io_survey_non_zero(struct s3backer_store *s3b, block_list_func_t *callback,
     struct http_io_private *const priv = s3b->data;
     struct http_io_conf *const config = priv->config;
     const int max_threads = config->list_blocks_threads;
-    s3b_block_t last_possible_name;
     int r = 0;
 
-    // Determine the last possible block name we need to scan for
-    last_possible_name = config->blockHashPrefix ? ~(s3b_block_t)0 : config->num_blocks - 1;
+    // If we already know which blocks are non-zero (e.g., from a saved survey), just report them
+    if (priv->non_zero != NULL)
+        return http_io_survey_replay(priv, callback, arg);
 
     // Lock mutex
     pthread_mutex_lock(&priv->mutex);
@@ -682,6 +1027,22 @@ http_io_survey_non_zero(struct s3backer_store *s3b, block_list_func_t *callback,
         goto done;
     }
 
+    // If saving the survey, record what it finds (and what gets written meanwhile) in a bitmap; normally
+    // http_io_survey_claim() has already created it, so blocks written before the survey started are included
+    if (config->list_blocks_save && priv->survey_non_zero == NULL
+      && (priv->survey_non_zero = bitmap_init(config->num_blocks, 0, 1)) == NULL) {
+        r = errno;
+        (*config->log)(LOG_ERR, "calloc: %s", strerror(r));
+        free(priv->survey_threads);
+        priv->survey_threads = NULL;
+        goto done;
+    }
+
+    // Divide the name space into more partitions than threads; threads claim them in order, then split each other's
+    priv->survey_last_name = config->blockHashPrefix ? ~(s3b_block_t)0 : config->num_blocks - 1;
+    priv->survey_num_partitions = max_threads * SURVEY_PARTITIONS_PER_THREAD;
+    priv->survey_next_partition = 0;
+
     // Initialize per-thread infos and start threads
     priv->survey_error = 0;
     while (priv->num_survey_threads < max_threads) {
@@ -693,20 +1054,6 @@ http_io_survey_non_zero(struct s3backer_store *s3b, block_list_func_t *callback,
         survey->callback = callback;
         survey->callback_arg = arg;
 
-        // Configure this thread's portion of the range, but being careful to handle weird corner cases
-        survey->min_name = thread_index > 0 ? survey[-1].max_name + 1 : (s3b_block_t)0;
-        if (survey->min_name > last_possible_name)
-            survey->min_name = last_possible_name;
-        if (thread_index == max_threads - 1)
-            survey->max_name = last_possible_name;
-        else {
-            survey->max_name = ((off_t)last_possible_name * (thread_index + 1)) / max_threads;
-            if (survey->max_name < survey->min_name)
-                survey->max_name = survey->min_name;
-            if (survey->max_name > last_possible_name)
-                survey->max_name = last_possible_name;
-        }
-
         // Start this thread
         if ((r = pthread_create(&survey->thread, NULL, http_io_list_blocks_worker_main, survey)) != 0) {
             (*config->log)(LOG_ERR, "pthread_create: %s", strerror(r));
@@ -722,6 +1069,12 @@ http_io_survey_non_zero(struct s3backer_store *s3b, block_list_func_t *callback,
     if (r == 0)
         r = priv->survey_error;
 
+    // If the survey completed, we now know exactly which blocks are non-zero; if not, keep recording for next time
+    if (priv->survey_non_zero != NULL && r == 0) {
+        priv->non_zero = priv->survey_non_zero;
+        priv->survey_non_zero = NULL;
+    }
+
 done:
     // Done
     CHECK_RETURN(pthread_mutex_unlock(&priv->mutex));
@@ -755,14 +1108,20 @@ http_io_list_blocks_worker_main(void *arg)
 {
     struct http_io_survey *const info = arg;
     struct http_io_private *const priv = info->priv;
+    s3b_block_t min;
     int r = 0;
 
-    // Scan my range (if non-empty)
-    if (info->min_name <= info->max_name)
-        r = http_io_list_blocks_range(priv, info->min_name, info->max_name, http_io_list_blocks_callback, info);
+    // Scan ranges until there's nothing left worth scanning
+    pthread_mutex_lock(&priv->mutex);
+    while (r == 0 && !priv->abort_survey && http_io_survey_next_range(priv, info)) {
+        min = info->min_name;
+        CHECK_RETURN(pthread_mutex_unlock(&priv->mutex));
+        r = http_io_list_blocks_range(info, min);
+        pthread_mutex_lock(&priv->mutex);
+        info->active = 0;
+    }
 
     // Finish up
-    pthread_mutex_lock(&priv->mutex);
     if (priv->survey_error == 0)
         priv->survey_error = r;
     if (priv->num_survey_threads > 0 && --priv->num_survey_threads == 0)
@@ -771,31 +1130,333 @@ http_io_list_blocks_worker_main(void *arg)
     return NULL;
 }
 
+/*
+ * Find the next range for a survey thread to scan and store it in info->min_name and info->max_name.
+ *
+ * Initial partitions are handed out first. After that, we steal the unscanned upper half of the widest range
+ * still being scanned by some other thread; that thread notices its lowered upper bound after its current page.
+ *
+ * Returns zero if there's nothing left worth scanning.
+ *
+ * This assumes the mutex is locked.
+ */
+static int
+http_io_survey_next_range(struct http_io_private *priv, struct http_io_survey *info)
+{
+    struct http_io_conf *const config = priv->config;
+    struct http_io_survey *victim = NULL;
+    s3b_block_t best_span = 0;
+    s3b_block_t mid;
+    int i;
+
+    // Claim the next non-empty initial partition, if any
+    while (priv->survey_next_partition < priv->survey_num_partitions) {
+        const u_int partition = priv->survey_next_partition++;
+
+        info->min_name = partition > 0 ? http_io_survey_partition_end(priv, partition - 1) + 1 : (s3b_block_t)0;
+        info->max_name = http_io_survey_partition_end(priv, partition);
+        if (info->min_name <= info->max_name) {
+            info->active = 1;
+            return 1;
+        }
+    }
+
+    // Find the widest range remaining
+    for (i = 0; i < priv->num_survey_threads; i++) {
+        struct http_io_survey *const other = &priv->survey_threads[i];
+
+        if (other == info || !other->active || other->min_name > other->max_name)
+            continue;
+        if (other->max_name - other->min_name >= SURVEY_MIN_STEAL && other->max_name - other->min_name > best_span) {
+            best_span = other->max_name - other->min_name;
+            victim = other;
+        }
+    }
+    if (victim == NULL)
+        return 0;
+
+    // Take the upper half
+    mid = victim->min_name + best_span / 2;
+    info->min_name = mid + 1;
+    info->max_name = victim->max_name;
+    victim->max_name = mid;
+    info->active = 1;
+    if (config->debug) {
+        (*config->log)(LOG_DEBUG, "list: thread %d took [%0*jx, %0*jx] from thread %d", (int)(info - priv->survey_threads),
+          S3B_BLOCK_NUM_DIGITS, (uintmax_t)info->min_name, S3B_BLOCK_NUM_DIGITS, (uintmax_t)info->max_name,
+          (int)(victim - priv->survey_threads));
+    }
+    return 1;
+}
+
+/*
+ * Get the last name (inclusive) in the given initial survey partition.
+ */
+static s3b_block_t
+http_io_survey_partition_end(struct http_io_private *priv, u_int partition)
+{
+    if (partition >= priv->survey_num_partitions - 1)
+        return priv->survey_last_name;
+    return (s3b_block_t)(((uintmax_t)priv->survey_last_name * (partition + 1)) / priv->survey_num_partitions);
+}
+
 static int
 http_io_list_blocks_callback(void *arg, const s3b_block_t *block_nums, u_int num_blocks)
 {
     struct http_io_survey *const info = arg;
+    struct http_io_private *const priv = info->priv;
+    u_int i;
 
-    if (info->priv->abort_survey)
+    if (priv->abort_survey)
         return ECANCELED;
+    if (priv->survey_non_zero != NULL) {
+        pthread_mutex_lock(&priv->mutex);
+        for (i = 0; i < num_blocks; i++)
+            bitmap_set(priv->survey_non_zero, block_nums[i], 1);
+        CHECK_RETURN(pthread_mutex_unlock(&priv->mutex));
+    }
     return (*info->callback)(info->callback_arg, block_nums, num_blocks);
 }
 
+/*
+ * Report the non-zero blocks in priv->non_zero as if they had been found by a survey.
+ */
+static int
+http_io_survey_replay(struct http_io_private *priv, block_list_func_t *callback, void *arg)
+{
+    struct http_io_conf *const config = priv->config;
+    s3b_block_t block_nums[SURVEY_REPLAY_BATCH];
+    s3b_block_t block_num = 0;
+    u_int num_found;
+    int r;
+
+    while (block_num < config->num_blocks) {
+
+        // Gather the next batch of non-zero blocks
+        pthread_mutex_lock(&priv->mutex);
+        for (num_found = 0; num_found < SURVEY_REPLAY_BATCH; num_found++) {
+            if ((block_num = bitmap_find_next(priv->non_zero, config->num_blocks, block_num, 1)) >= config->num_blocks)
+                break;
+            block_nums[num_found] = block_num++;
+        }
+        CHECK_RETURN(pthread_mutex_unlock(&priv->mutex));
+
+        // Report them
+        if (priv->abort_survey)
+            return ECANCELED;
+        if (num_found > 0 && (r = (*callback)(arg, block_nums, num_found)) != 0)
+            return r;
+    }
+    return 0;
+}
+
+/*
+ * Load the saved survey of non-zero blocks, if any.
+ *
+ * The survey is only valid if the filesystem was cleanly unmounted (no mount token), or if the mount token
+ * left behind is the one the survey was saved with, which means the previous mount saved it and then died
+ * before clearing its mount token; in both cases all of the blocks had been written by the time it was saved.
+ *
+ * Returns NULL if there is no valid saved survey.
+ */
+static bitmap_t *
+http_io_survey_load(struct http_io_private *priv, int32_t old_mount_token)
+{
+    struct http_io_conf *const config = priv->config;
+    const size_t nbytes = bitmap_export_size(config->num_blocks);
+    const size_t bufsiz = SURVEY_HEADER_MAX + compressBound(nbytes);
+    bitmap_t *bitmap = NULL;
+    u_char *bits = NULL;
+    uintmax_t num_blocks;
+    u_int block_size;
+    u_int mount_token;
+    u_int crc;
+    uLongf uclen;
+    char *buf;
+    size_t len;
+    char *eol;
+    int r;
+
+    // Read the saved survey
+    if ((buf = malloc(bufsiz)) == NULL) {
+        (*config->log)(LOG_ERR, "malloc: %s", strerror(errno));
+        return NULL;
+    }
+    switch ((r = http_io_get_object(priv, SURVEY_FILE, buf, bufsiz, &len))) {
+    case 0:
+        break;
+    case ENOENT:
+        (*config->log)(LOG_INFO, "no saved non-zero block survey found");
+        goto done;
+    default:
+        (*config->log)(LOG_ERR, "can't read saved non-zero block survey: %s", strerror(r));
+        goto done;
+    }
+
+    // Parse header
+    if ((eol = memchr(buf, '\n', len < SURVEY_HEADER_MAX ? len : SURVEY_HEADER_MAX)) == NULL) {
+        (*config->log)(LOG_ERR, "saved non-zero block survey is corrupt");
+        goto done;
+    }
+    *eol = '\0';
+    if (sscanf(buf, SURVEY_HEADER_SCANF, &mount_token, &num_blocks, &block_size, &crc) != 4) {
+        (*config->log)(LOG_ERR, "saved non-zero block survey is corrupt or has an unknown format");
+        goto done;
+    }
+    if (num_blocks != config->num_blocks || block_size != config->block_size) {
+        (*config->log)(LOG_INFO, "ignoring saved non-zero block survey: the block size or count has changed");
+        goto done;
+    }
+    if (old_mount_token != 0 && (u_int)old_mount_token != mount_token) {
+        (*config->log)(LOG_INFO, "ignoring saved non-zero block survey: the filesystem was not cleanly unmounted");
+        goto done;
+    }
+
+    // Decompress and verify the bitmap
+    if ((bits = malloc(nbytes)) == NULL) {
+        (*config->log)(LOG_ERR, "malloc: %s", strerror(errno));
+        goto done;
+    }
+    uclen = nbytes;
+    if (uncompress(bits, &uclen, (u_char *)eol + 1, len - (eol + 1 - buf)) != Z_OK
+      || uclen != nbytes
+      || crc32(0L, bits, nbytes) != crc) {
+        (*config->log)(LOG_ERR, "saved non-zero block survey is corrupt");
+        goto done;
+    }
+
+    // Convert to bitmap
+    if ((bitmap = bitmap_import(bits, config->num_blocks, 1)) == NULL) {
+        (*config->log)(LOG_ERR, "malloc: %s", strerror(errno));
+        goto done;
+    }
+    (*config->log)(LOG_INFO, "loaded saved non-zero block survey");
+
+done:
+    free(bits);
+    free(buf);
+    return bitmap;
+}
+
+/*
+ * When mounting read/write, load the saved survey (if desired) and then delete it.
+ *
+ * We always delete it, even if we're not using it, because it will no longer be accurate once we start writing blocks,
+ * and a later mount must not use it unless we save it again when we unmount.
+ */
+static int
+http_io_survey_claim(struct http_io_private *priv, int32_t old_mount_token)
+{
+    struct http_io_conf *const config = priv->config;
+    int r;
+
+    // Load the saved survey; if there isn't one, start recording writes now, before any worker threads can write blocks
+    if (config->list_blocks_save) {
+        assert(priv->non_zero == NULL);
+        priv->non_zero = http_io_survey_load(priv, old_mount_token);
+        if (priv->non_zero == NULL && priv->survey_non_zero == NULL) {
+            pthread_mutex_lock(&priv->mutex);
+            priv->survey_non_zero = bitmap_init(config->num_blocks, 0, 1);
+            CHECK_RETURN(pthread_mutex_unlock(&priv->mutex));
+            if (priv->survey_non_zero == NULL) {
+                r = errno;
+                (*config->log)(LOG_ERR, "calloc: %s", strerror(r));
+                return r;
+            }
+        }
+    }
+
+    // Delete it
+    if ((r = http_io_delete_object(priv, SURVEY_FILE)) != 0)
+        (*config->log)(LOG_ERR, "can't delete saved non-zero block survey: %s", strerror(r));
+    return r;
+}
+
+/*
+ * Save the current non-zero block bitmap as the saved survey, tagged with our mount token.
+ */
+static int
+http_io_survey_save(struct http_io_private *priv)
+{
+    struct http_io_conf *const config = priv->config;
+    const size_t nbytes = bitmap_export_size(config->num_blocks);
+    u_char *bits;
+    char *buf;
+    uLongf clen;
+    int hlen;
+    int r;
+
+    // Export bitmap
+    if ((bits = malloc(nbytes)) == NULL) {
+        r = errno;
+        (*config->log)(LOG_ERR, "malloc: %s", strerror(r));
+        goto fail0;
+    }
+    pthread_mutex_lock(&priv->mutex);
+    bitmap_export(priv->non_zero, config->num_blocks, bits);
+    CHECK_RETURN(pthread_mutex_unlock(&priv->mutex));
+
+    // Build header followed by compressed bitmap
+    clen = compressBound(nbytes);
+    if ((buf = malloc(SURVEY_HEADER_MAX + clen)) == NULL) {
+        r = errno;
+        (*config->log)(LOG_ERR, "malloc: %s", strerror(r));
+        goto fail1;
+    }
+    hlen = snvprintf(buf, SURVEY_HEADER_MAX, SURVEY_HEADER_PRINTF "\n",
+      (u_int)priv->mount_token, (uintmax_t)config->num_blocks, config->block_size, (u_int)crc32(0L, bits, nbytes));
+    if (compress2((u_char *)buf + hlen, &clen, bits, nbytes, Z_BEST_SPEED) != Z_OK) {
+        (*config->log)(LOG_ERR, "can't compress non-zero block survey");
+        r = EIO;
+        goto fail2;
+    }
+
+    // Write it
+    if ((r = http_io_put_object(priv, SURVEY_FILE, buf, hlen + clen, SURVEY_FILE_MIME_TYPE)) != 0) {
+        (*config->log)(LOG_ERR, "can't save non-zero block survey: %s", strerror(r));
+        goto fail2;
+    }
+    (*config->log)(LOG_INFO, "saved non-zero block survey (%lu bytes)", (u_long)(hlen + clen));
+
+    // Done
+    r = 0;
+
+fail2:
+    free(buf);
+fail1:
+    free(bits);
+fail0:
+    return r;
+}
+
 //
-// Scan blocks in the range "min" (inclusive) to "max" (inclusive).
+// Scan blocks in the range "min" (inclusive) to info->max_name (inclusive), reporting them via http_io_list_blocks_callback().
 //
 // Note "min" and "max" refer to the first S3B_BLOCK_NUM_DIGITS characters of the block's S3 object name (after any "--prefix"),
 // not necessarily the block number; these are different things when "--blockHashPrefix" is used, otherwise they are the same.
 //
+// After each page, we publish how far we've gotten in info->min_name, and pick up any reduction of info->max_name
+// made by another thread stealing the rest of our range; blocks we already received beyond the new bound are theirs.
+//
 static int
-http_io_list_blocks_range(struct http_io_private *priv, s3b_block_t min, s3b_block_t max, block_list_func_t *callback, void *arg)
+http_io_list_blocks_range(struct http_io_survey *info, s3b_block_t min)
 {
+    struct http_io_private *const priv = info->priv;
     struct http_io_conf *const config = priv->config;
-    char last_possible_path[strlen(config->prefix) + S3B_BLOCK_NUM_DIGITS + 1];
+    const size_t plen = strlen(config->prefix);
+    char last_possible_path[plen + S3B_BLOCK_NUM_DIGITS + 1];
     s3b_block_t block_list[LIST_BLOCKS_CHUNK];
+    s3b_block_t position;
+    s3b_block_t max;
     struct http_io io;
+    u_int i, j;
     int r;
 
+    // Get current upper bound
+    pthread_mutex_lock(&priv->mutex);
+    max = info->max_name;
+    CHECK_RETURN(pthread_mutex_unlock(&priv->mutex));
+
     // Initialize XML query
     if ((r = http_io_xml_io_init(priv, &io, HTTP_GET, NULL)) != 0)              // "url" is set below
         return r;
@@ -803,9 +1464,6 @@ http_io_list_blocks_range(struct http_io_private *priv, s3b_block_t min, s3b_blo
     io.min_name = min;
     io.max_name = max;
 
-    // Determine the last possible valid block name (or block hash prefix) we want to search for
-    snvprintf(last_possible_path, sizeof(last_possible_path), "%s%0*jx", config->prefix, S3B_BLOCK_NUM_DIGITS, (uintmax_t)max);
-
     // Initialize "io.start_after", which says where to continue listing names each time around the loop
     if (min == (s3b_block_t)0)
         r = asprintf(&io.start_after, "%s%0*jx%c", config->prefix, S3B_BLOCK_NUM_DIGITS - 1, (uintmax_t)0, '0' - 1);
@@ -841,14 +1499,33 @@ http_io_list_blocks_range(struct http_io_private *priv, s3b_block_t min, s3b_blo
         if ((r = http_io_xml_io_exec(priv, &io, http_io_list_blocks_elem_end)) != 0)
             break;
 
+        // Publish our progress and check whether another thread has taken over the rest of our range
+        pthread_mutex_lock(&priv->mutex);
+        if (strncmp(io.start_after, config->prefix, plen) == 0
+          && http_io_parse_hex_block_num(io.start_after + plen, &position) == 0)
+            info->min_name = position < info->max_name ? position + 1 : info->max_name;     // in the latter case we're done
+        max = info->max_name;
+        CHECK_RETURN(pthread_mutex_unlock(&priv->mutex));
+        if (max < io.max_name) {
+            for (i = j = 0; i < io.num_blocks; i++) {
+                const s3b_block_t block_num = block_list[i];
+
+                if ((config->blockHashPrefix ? http_io_block_hash_prefix(block_num) : block_num) <= max)
+                    block_list[j++] = block_num;
+            }
+            io.num_blocks = j;
+            io.max_name = max;
+        }
+
         // Invoke callback with the blocks we found
         if (io.num_blocks > 0) {
-            if ((r = (*callback)(arg, block_list, io.num_blocks)) != 0)
+            if ((r = http_io_list_blocks_callback(info, block_list, io.num_blocks)) != 0)
                 break;
             io.num_blocks = 0;
         }
 
         // Are we done?
+        snvprintf(last_possible_path, sizeof(last_possible_path), "%s%0*jx", config->prefix, S3B_BLOCK_NUM_DIGITS, (uintmax_t)max);
         if (!io.list_truncated || strcmp(io.start_after, last_possible_path) >= 0)
             break;
     }
@@ -1153,6 +1830,22 @@ http_io_create_threads(struct s3backer_store *s3b)
     }
     CHECK_RETURN(pthread_mutex_unlock(&priv->mutex));
 
+    // Start asynchronous engine if appropriate
+    if (r == 0 && config->async_http)
+        r = http_io_async_start(priv);
+
+    // Start encoder pool if appropriate
+    if (r == 0 && config->encode_threads > 0)
+        r = http_io_encode_start(priv);
+
+    // Load or start training compression dictionary if appropriate
+    if (r == 0 && config->compress_dict)
+        r = http_io_dict_start(priv);
+
+    // Pre-open connections so the first requests don't pay for the TCP and TLS handshakes
+    if (r == 0 && config->warm_connections > 0)
+        http_io_warm_connections(priv);
+
     // Done
     return r;
 }
@@ -1260,6 +1953,10 @@ http_io_set_mount_token(struct s3backer_store *s3b, int32_t *old_valuep, int32_t
         char md5buf[MD5_DIGEST_LENGTH * 2 + 1];
         MD5_CTX ctx;
 
+        // When cleanly unmounting, save the survey first so it's tagged with our (about to be cleared) mount token
+        if (new_value == 0 && config->list_blocks_save && priv->non_zero != NULL && priv->mount_token != 0)
+            (void)http_io_survey_save(priv);
+
         // Reset I/O info
         curl_slist_free_all(io.headers);
         http_io_init_io(priv, &io, new_value != 0 ? HTTP_PUT : HTTP_DELETE, urlbuf);
@@ -1311,7 +2008,14 @@ http_io_set_mount_token(struct s3backer_store *s3b, int32_t *old_valuep, int32_t
             goto done;
 
         // Perform operation to set or clear mount token
-        r = http_io_perform_io(priv, &io, http_io_write_prepper);
+        if ((r = http_io_perform_io(priv, &io, http_io_write_prepper)) != 0)
+            goto done;
+
+        // When mounting read/write, take over the saved survey (if any)
+        if (new_value > 0 && old_valuep != NULL) {
+            priv->mount_token = new_value;
+            r = http_io_survey_claim(priv, *old_valuep);
+        }
     }
 
 done:
@@ -1385,6 +2089,7 @@ update_iam_credentials(struct http_io_private *const priv)
     config->accessId = access_id;
     config->accessKey = access_key;
     config->iam_token = iam_token;
+    priv->creds_version++;
     CHECK_RETURN(pthread_mutex_unlock(&priv->mutex));
     (*config->log)(LOG_INFO, "successfully updated EC2 IAM credentials from %s", io.url);
     free(urlbuf);
@@ -1474,13 +2179,8 @@ http_io_read_block(struct s3backer_store *const s3b, s3b_block_t block_num, void
     struct http_io_private *const priv = s3b->data;
     struct http_io_conf *const config = priv->config;
     char urlbuf[URL_BUF_SIZE(config)];
-    char accept_encoding[128];
-    const time_t now = time(NULL);
-    int encrypted = 0;
     struct http_io io;
-    u_int did_read;
-    char *layer;
-    int i;
+    u_int hedge_millis;
     int r;
 
     // Sanity check
@@ -1488,38 +2188,161 @@ http_io_read_block(struct s3backer_store *const s3b, s3b_block_t block_num, void
         return EINVAL;
 
     // Read zero blocks when bitmap indicates empty until non-zero content is written
-    if (priv->non_zero != NULL) {
-        pthread_mutex_lock(&priv->mutex);
-        if (!bitmap_test(priv->non_zero, block_num)) {
-            priv->stats.empty_blocks_read++;
-            CHECK_RETURN(pthread_mutex_unlock(&priv->mutex));
-            memset(dest, 0, config->block_size);
-            if (actual_etag != NULL)
-                memset(actual_etag, 0, MD5_DIGEST_LENGTH);
-            return 0;
-        }
-        CHECK_RETURN(pthread_mutex_unlock(&priv->mutex));
-    }
+    if (http_io_read_empty(priv, block_num, dest, actual_etag))
+        return 0;
+
+    // Hedge against a slow response if configured
+    if ((hedge_millis = http_io_hedge_delay(priv)) > 0)
+        return http_io_read_hedged(priv, block_num, dest, actual_etag, expect_etag, strict, hedge_millis);
+
+    // Prepare request
+    if ((r = http_io_read_prepare(priv, &io, urlbuf, sizeof(urlbuf), block_num, expect_etag, strict)) != 0)
+        return r;
+
+    // Perform operation
+    r = http_io_perform_io(priv, &io, http_io_read_prepper);
+
+    // Process response
+    return http_io_read_finish(priv, &io, r, dest, actual_etag, expect_etag, strict);
+}
+
+/*
+ * Read a range of blocks, issuing the requests concurrently via the asynchronous engine if it's running.
+ */
+static int
+http_io_read_blocks(struct s3backer_store *const s3b, s3b_block_t block_num, u_int num_blocks, void *dest)
+{
+    struct http_io_private *const priv = s3b->data;
+    struct http_io_conf *const config = priv->config;
+    const size_t urlbuf_size = URL_BUF_SIZE(config);
+    struct http_io *ios = NULL;
+    struct http_io **iops = NULL;
+    char *urlbufs = NULL;
+    int *results = NULL;
+    int r = 0;
+
+    // Sanity check
+    if (config->block_size == 0 || block_num + num_blocks < block_num || block_num + num_blocks > config->num_blocks)
+        return EINVAL;
+
+    // If the asynchronous engine is not running, or there's nothing to parallelize, do it the simple way
+    if (priv->multi == NULL || num_blocks <= 1)
+        return generic_read_blocks(s3b, block_num, num_blocks, dest);
+
+    // Allocate per-request state
+    if ((ios = malloc(ASYNC_READ_BATCH * sizeof(*ios))) == NULL
+      || (iops = malloc(ASYNC_READ_BATCH * sizeof(*iops))) == NULL
+      || (results = malloc(ASYNC_READ_BATCH * sizeof(*results))) == NULL
+      || (urlbufs = malloc(ASYNC_READ_BATCH * urlbuf_size)) == NULL) {
+        (*config->log)(LOG_ERR, "malloc: %s", strerror(errno));
+        ATOMIC_ADD(priv->stats.out_of_memory_errors, 1);
+        r = ENOMEM;
+        goto done;
+    }
+
+    // Read blocks in batches
+    while (num_blocks > 0) {
+        const u_int batch_size = num_blocks < ASYNC_READ_BATCH ? num_blocks : ASYNC_READ_BATCH;
+        u_int num_ios = 0;
+        u_int i;
+        int r2;
+
+        // Prepare a request for each block that is not known to be empty
+        for (i = 0; i < batch_size; i++) {
+            char *const block_dest = (char *)dest + (size_t)i * config->block_size;
+
+            if (http_io_read_empty(priv, block_num + i, block_dest, NULL))
+                continue;
+            if ((r2 = http_io_read_prepare(priv, &ios[num_ios], urlbufs + num_ios * urlbuf_size,
+              urlbuf_size, block_num + i, NULL, 0)) != 0) {
+                if (r == 0)
+                    r = r2;
+                continue;
+            }
+            iops[num_ios] = &ios[num_ios];
+            num_ios++;
+        }
+
+        // Perform operations
+        if (num_ios > 0)
+            http_io_perform_ios(priv, iops, results, num_ios, http_io_read_prepper);
+
+        // Process responses
+        for (i = 0; i < num_ios; i++) {
+            char *const block_dest = (char *)dest + (size_t)(ios[i].block_num - block_num) * config->block_size;
+
+            if ((r2 = http_io_read_finish(priv, &ios[i], results[i], block_dest, NULL, NULL, 0)) != 0 && r == 0)
+                r = r2;
+        }
+
+        // Advance
+        block_num += batch_size;
+        num_blocks -= batch_size;
+        dest = (char *)dest + (size_t)batch_size * config->block_size;
+    }
+
+done:
+    // Clean up
+    free(urlbufs);
+    free(results);
+    free(iops);
+    free(ios);
+    return r;
+}
+
+/*
+ * If the non-zero block bitmap says "block_num" has never been written, zero "dest" and return 1.
+ */
+static int
+http_io_read_empty(struct http_io_private *priv, s3b_block_t block_num, void *dest, u_char *actual_etag)
+{
+    struct http_io_conf *const config = priv->config;
+
+    if (priv->non_zero == NULL && !config->list_blocks_save)
+        return 0;
+    pthread_mutex_lock(&priv->mutex);
+    if (priv->non_zero == NULL || bitmap_test(priv->non_zero, block_num)) {
+        CHECK_RETURN(pthread_mutex_unlock(&priv->mutex));
+        return 0;
+    }
+    priv->stats.empty_blocks_read++;
+    CHECK_RETURN(pthread_mutex_unlock(&priv->mutex));
+    memset(dest, 0, config->block_size);
+    if (actual_etag != NULL)
+        memset(actual_etag, 0, MD5_DIGEST_LENGTH);
+    return 1;
+}
+
+/*
+ * Initialize the GET request for a block. On failure, everything is cleaned up.
+ */
+static int
+http_io_read_prepare(struct http_io_private *priv, struct http_io *io, char *urlbuf, size_t urlbuf_size,
+  s3b_block_t block_num, const u_char *expect_etag, int strict)
+{
+    struct http_io_conf *const config = priv->config;
+    char accept_encoding[128];
+    const time_t now = time(NULL);
+    int i;
+    int r;
 
     // Initialize I/O info
-    http_io_init_io(priv, &io, HTTP_GET, urlbuf);
-    io.block_num = block_num;
+    http_io_init_io(priv, io, HTTP_GET, urlbuf);
+    io->block_num = block_num;
 
     // Allocate a buffer in case compressed and/or encrypted data is larger
-    io.buf_size = compressBound(config->block_size) + EVP_MAX_IV_LENGTH;
-    if ((io.dest = malloc(io.buf_size)) == NULL) {
+    io->buf_size = compressBound(config->block_size) + EVP_MAX_IV_LENGTH;
+    if ((io->dest = s3b_pool_alloc(priv->read_pool)) == NULL) {
         (*config->log)(LOG_ERR, "malloc: %s", strerror(errno));
-        pthread_mutex_lock(&priv->mutex);
-        priv->stats.out_of_memory_errors++;
-        CHECK_RETURN(pthread_mutex_unlock(&priv->mutex));
+        ATOMIC_ADD(priv->stats.out_of_memory_errors, 1);
         return ENOMEM;
     }
 
     // Construct URL for this block
-    http_io_get_block_url(urlbuf, sizeof(urlbuf), config, block_num);
+    http_io_get_block_url(urlbuf, urlbuf_size, config, block_num);
 
     // Add Date header
-    http_io_add_date(priv, &io, now);
+    http_io_add_date(priv, io, now);
 
     // Add If-Match or If-None-Match header as required
     if (expect_etag != NULL && memcmp(expect_etag, zero_etag, MD5_DIGEST_LENGTH) != 0) {
@@ -1530,10 +2353,10 @@ http_io_read_block(struct s3backer_store *const s3b, s3b_block_t block_num, void
             header = IF_MATCH_HEADER;
         else {
             header = IF_NONE_MATCH_HEADER;
-            io.expect_304 = 1;
+            io->expect_304 = 1;
         }
         http_io_prhex(etagbuf, expect_etag, MD5_DIGEST_LENGTH);
-        io.headers = http_io_add_header(priv, io.headers, "%s: \"%s\"", header, etagbuf);
+        io->headers = http_io_add_header(priv, io->headers, "%s: \"%s\"", header, etagbuf);
     }
 
     // Set Accept-Encoding header
@@ -1551,40 +2374,60 @@ http_io_read_block(struct s3backer_store *const s3b, s3b_block_t block_num, void
         snvprintf(accept_encoding + strlen(accept_encoding), sizeof(accept_encoding) - strlen(accept_encoding),
           "%s-%s", CONTENT_ENCODING_ENCRYPT, config->encryption);
     }
-    io.headers = http_io_add_header(priv, io.headers, "%s: %s", ACCEPT_ENCODING_HEADER, accept_encoding);
+    io->headers = http_io_add_header(priv, io->headers, "%s: %s", ACCEPT_ENCODING_HEADER, accept_encoding);
 
     // Add Authorization header
-    if ((r = http_io_add_auth(priv, &io, now, NULL, 0)) != 0)
-        goto fail;
+    if ((r = http_io_add_auth(priv, io, now, NULL, 0)) != 0) {
+        s3b_pool_free(priv->read_pool, io->dest);
+        curl_slist_free_all(io->headers);
+        return r;
+    }
 
-    // Perform operation
-    r = http_io_perform_io(priv, &io, http_io_read_prepper);
+    // Done
+    return 0;
+
+}
+
+/*
+ * Decode the response to a GET request for a block, check ETags, and clean up.
+ *
+ * The "r" is the result from performing the HTTP operation.
+ */
+static int
+http_io_read_finish(struct http_io_private *priv, struct http_io *io, int r, void *dest,
+  u_char *actual_etag, const u_char *expect_etag, int strict)
+{
+    struct http_io_conf *const config = priv->config;
+    const s3b_block_t block_num = io->block_num;
+    int encrypted = 0;
+    u_int did_read;
+    char *layer;
 
     // Verify an ETag was provided by server if caller wants it
     if (r == 0 && actual_etag != NULL)
-        r = http_io_verify_etag_provided(&io);
+        r = http_io_verify_etag_provided(io);
 
     // Determine how many bytes we read
-    did_read = io.buf_size - io.bufs.rdremain;
+    did_read = io->buf_size - io->bufs.rdremain;
 
     // Check Content-Encoding and decode if necessary
-    if (*io.content_encoding == '\0' && config->default_ce != NULL)
-        snvprintf(io.content_encoding, sizeof(io.content_encoding), "%s", config->default_ce);
-    for ( ; r == 0 && *io.content_encoding != '\0'; *layer = '\0') {
+    if (*io->content_encoding == '\0' && config->default_ce != NULL)
+        snvprintf(io->content_encoding, sizeof(io->content_encoding), "%s", config->default_ce);
+    for ( ; r == 0 && *io->content_encoding != '\0'; *layer = '\0') {
         const struct comp_alg *calg;
 
         // Find next encoding layer, starting from the end and working backwards, trimming any whitespace
-        if ((layer = strrchr(io.content_encoding, ',')) != NULL)
+        if ((layer = strrchr(io->content_encoding, ',')) != NULL)
             *layer++ = '\0';
         else
-            layer = io.content_encoding;
+            layer = io->content_encoding;
         while (isspace(*layer))
             layer++;
         while (*layer != '\0' && isspace(layer[strlen(layer) - 1]))
             layer[strlen(layer) - 1] = '\0';
 
         // Sanity check
-        if (io.dest == NULL)
+        if (io->dest == NULL)
             goto bad_encoding;
 
         // Check for encryption (which must have been applied after compression)
@@ -1611,14 +2454,14 @@ http_io_read_block(struct s3backer_store *const s3b, s3b_block_t block_num, void
             }
 
             // Verify block's signature
-            if (memcmp(io.hmac, zero_hmac, sizeof(io.hmac)) == 0) {
+            if (memcmp(io->hmac, zero_hmac, sizeof(io->hmac)) == 0) {
                 (*config->log)(LOG_ERR, "block %0*jx is encrypted, but no signature was found",
                   S3B_BLOCK_NUM_DIGITS, (uintmax_t)block_num);
                 r = EIO;
                 break;
             }
-            http_io_authsig(priv, block_num, io.dest, did_read, hmac);
-            if (memcmp(io.hmac, hmac, sizeof(hmac)) != 0) {
+            http_io_authsig(priv, block_num, io->dest, did_read, hmac);
+            if (memcmp(io->hmac, hmac, sizeof(hmac)) != 0) {
                 (*config->log)(LOG_ERR, "block %0*jx has an incorrect signature (did you provide the right password?)",
                   S3B_BLOCK_NUM_DIGITS, (uintmax_t)block_num);
                 r = EIO;
@@ -1627,19 +2470,18 @@ http_io_read_block(struct s3backer_store *const s3b, s3b_block_t block_num, void
 
             // Allocate buffer for the decrypted data
             decrypt_buflen = did_read + EVP_MAX_IV_LENGTH;
-            if ((buf = malloc(decrypt_buflen)) == NULL) {
+            assert(decrypt_buflen <= READ_BUF_SIZE(config));
+            if ((buf = s3b_pool_alloc(priv->read_pool)) == NULL) {
                 (*config->log)(LOG_ERR, "malloc: %s", strerror(errno));
-                pthread_mutex_lock(&priv->mutex);
-                priv->stats.out_of_memory_errors++;
-                CHECK_RETURN(pthread_mutex_unlock(&priv->mutex));
+                ATOMIC_ADD(priv->stats.out_of_memory_errors, 1);
                 r = ENOMEM;
                 break;
             }
 
             // Decrypt the block
-            did_read = http_io_crypt(priv, block_num, 0, io.dest, did_read, buf, decrypt_buflen);
-            memcpy(io.dest, buf, did_read);
-            free(buf);
+            did_read = http_io_crypt(priv, block_num, 0, io->dest, did_read, buf, decrypt_buflen);
+            memcpy(io->dest, buf, did_read);
+            s3b_pool_free(priv->read_pool, buf);
 
             // Proceed
             encrypted = 1;
@@ -1648,21 +2490,30 @@ http_io_read_block(struct s3backer_store *const s3b, s3b_block_t block_num, void
 
         // Check for compression
         if ((calg = comp_find(layer)) != NULL) {
+            const struct comp_dict *dict = NULL;
             size_t uclen = config->block_size;
+            uint32_t dict_id;
 
-            if ((r = (*calg->dfunc)(config->log, io.dest, did_read, dest, &uclen)) != 0)  {
-                if (r == ENOMEM) {
-                    pthread_mutex_lock(&priv->mutex);
-                    priv->stats.out_of_memory_errors++;
-                    CHECK_RETURN(pthread_mutex_unlock(&priv->mutex));
-                }
+            // Find the dictionary the block was compressed with, if any
+            if (calg->dneeds != NULL && (dict_id = (*calg->dneeds)(io->dest, did_read)) != 0
+              && (dict = http_io_dict_find(priv, calg, dict_id)) == NULL) {
+                (*config->log)(LOG_ERR, "read of block %0*jx requires %s dictionary %08x which is not available",
+                  S3B_BLOCK_NUM_DIGITS, (uintmax_t)block_num, calg->name, (u_int)dict_id);
+                r = EIO;
+                continue;
+            }
+
+            // Decompress
+            if ((r = (*calg->dfunc)(config->log, io->dest, did_read, dest, &uclen, dict)) != 0)  {
+                if (r == ENOMEM)
+                    ATOMIC_ADD(priv->stats.out_of_memory_errors, 1);
                 continue;
             }
 
             // Update data
             did_read = uclen;
-            free(io.dest);
-            io.dest = NULL;         // compression should have been first, so decompression should always be last
+            s3b_pool_free(priv->read_pool, io->dest);
+            io->dest = NULL;         // compression should have been first, so decompression should always be last
 
             // Proceed
             continue;
@@ -1690,22 +2541,20 @@ bad_encoding:
     }
 
     // Copy the data to the desination buffer (if we haven't already)
-    if (r == 0 && io.dest != NULL)
-        memcpy(dest, io.dest, config->block_size);
+    if (r == 0 && io->dest != NULL)
+        memcpy(dest, io->dest, config->block_size);
 
     // Update stats
-    pthread_mutex_lock(&priv->mutex);
     switch (r) {
     case 0:
-        priv->stats.normal_blocks_read++;
+        ATOMIC_ADD(priv->stats.normal_blocks_read, 1);
         break;
     case ENOENT:
-        priv->stats.zero_blocks_read++;
+        ATOMIC_ADD(priv->stats.zero_blocks_read, 1);
         break;
     default:
         break;
     }
-    CHECK_RETURN(pthread_mutex_unlock(&priv->mutex));
 
     // Check expected ETag
     if (expect_etag != NULL) {
@@ -1729,14 +2578,10 @@ bad_encoding:
         if (!strict) {
             switch (r) {
             case 0:
-                pthread_mutex_lock(&priv->mutex);
-                priv->stats.http_mismatch++;
-                CHECK_RETURN(pthread_mutex_unlock(&priv->mutex));
+                ATOMIC_ADD(priv->stats.http_mismatch, 1);
                 break;
             case EEXIST:
-                pthread_mutex_lock(&priv->mutex);
-                priv->stats.http_verified++;
-                CHECK_RETURN(pthread_mutex_unlock(&priv->mutex));
+                ATOMIC_ADD(priv->stats.http_verified, 1);
                 break;
             default:
                 break;
@@ -1752,16 +2597,276 @@ bad_encoding:
 
     // Copy actual ETag
     if (actual_etag != NULL)
-        memcpy(actual_etag, io.etag, MD5_DIGEST_LENGTH);
+        memcpy(actual_etag, io->etag, MD5_DIGEST_LENGTH);
 
-fail:
     //  Clean up
-    if (io.dest != NULL)
-        free(io.dest);
-    curl_slist_free_all(io.headers);
+    s3b_pool_free(priv->read_pool, io->dest);          // OK if NULL
+    curl_slist_free_all(io->headers);
+    return r;
+}
+
+/*
+ * Determine how long to wait for a block GET before hedging it with a second request.
+ *
+ * Returns zero if reads should not be hedged right now.
+ */
+static u_int
+http_io_hedge_delay(struct http_io_private *priv)
+{
+    struct http_io_conf *const config = priv->config;
+    uint64_t target;
+    uint64_t sum;
+    u_int millis = 0;
+    u_int i;
+
+    // Hedging requires the asynchronous engine
+    if (config->read_hedge == 0 || priv->multi == NULL)
+        return 0;
+
+    // Find the configured percentile of recent GET latency, once we have enough samples
+    pthread_mutex_lock(&priv->mutex);
+    if (priv->hedge_samples >= HEDGE_MIN_SAMPLES) {
+        target = ((uint64_t)priv->hedge_samples * config->read_hedge + 99) / 100;
+        for (i = 0, sum = 0; i < HEDGE_LATENCY_BUCKETS - 1 && (sum += priv->hedge_hist[i]) < target; i++)
+            ;
+        millis = (u_int)((http_io_hedge_bucket_micros(i) + 999) / 1000);
+    }
+    CHECK_RETURN(pthread_mutex_unlock(&priv->mutex));
+    return millis;
+}
+
+/*
+ * Record the latency of a successful GET.
+ *
+ * This assumes the mutex is held.
+ */
+static void
+http_io_hedge_sample(struct http_io_private *priv, double curl_time)
+{
+    const uint64_t micros = (uint64_t)(curl_time * 1e6);
+    u_int i;
+
+    // Add sample to histogram
+    for (i = 0; i < HEDGE_LATENCY_BUCKETS - 1 && micros > http_io_hedge_bucket_micros(i); i++)
+        ;
+    priv->hedge_hist[i]++;
+
+    // Decay older samples
+    if (++priv->hedge_samples >= HEDGE_DECAY_SAMPLES) {
+        priv->hedge_samples = 0;
+        for (i = 0; i < HEDGE_LATENCY_BUCKETS; i++) {
+            priv->hedge_hist[i] /= 2;
+            priv->hedge_samples += priv->hedge_hist[i];
+        }
+    }
+}
+
+/*
+ * Get the upper bound (in microseconds) of a GET latency histogram bucket. Bucket zero ends at one millisecond.
+ */
+static uint64_t
+http_io_hedge_bucket_micros(u_int bucket)
+{
+    static const uint64_t quarters[4] = { 1000, 1189, 1414, 1682 };        // 1000 * 2^(n/4)
+
+    return quarters[bucket % 4] << (bucket / 4);
+}
+
+/*
+ * Read a block, sending a second, identical GET if the first one has not completed after "hedge_millis".
+ *
+ * Whichever request completes first is used (and retried as usual if it failed). The other request is
+ * abandoned; its completion callback cleans it up whenever it completes.
+ */
+static int
+http_io_read_hedged(struct http_io_private *priv, s3b_block_t block_num, void *dest,
+  u_char *actual_etag, const u_char *expect_etag, int strict, u_int hedge_millis)
+{
+    struct http_io_conf *const config = priv->config;
+    const size_t urlbuf_size = URL_BUF_SIZE(config);
+    struct http_io_hedge *hedge;
+    struct timespec deadline;
+    struct http_io *io;
+    int winner;
+    int r;
+
+    // Allocate hedge state
+    if ((hedge = calloc(1, sizeof(*hedge) + 2 * urlbuf_size)) == NULL) {
+        r = errno;
+        (*config->log)(LOG_ERR, "calloc: %s", strerror(r));
+        ATOMIC_ADD(priv->stats.out_of_memory_errors, 1);
+        return r;
+    }
+    if ((r = pthread_cond_init(&hedge->done, NULL)) != 0) {
+        free(hedge);
+        return r;
+    }
+    hedge->priv = priv;
+    hedge->winner = -1;
+    hedge->refs = 1;
+
+    // Prepare and start the first request; if the asynchronous engine won't take it, just do it normally
+    if ((r = http_io_read_prepare(priv, &hedge->ios[0], hedge->urlbufs, urlbuf_size, block_num, expect_etag, strict)) != 0)
+        goto done;
+    if (http_io_hedge_start(priv, hedge, 0) != 0) {
+        r = http_io_perform_io(priv, &hedge->ios[0], http_io_read_prepper);
+        r = http_io_read_finish(priv, &hedge->ios[0], r, dest, actual_etag, expect_etag, strict);
+        goto done;
+    }
+
+    // Wait up to the hedge delay for it to complete
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += hedge_millis / 1000;
+    deadline.tv_nsec += (long)(hedge_millis % 1000) * 1000000;
+    if (deadline.tv_nsec >= 1000000000) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000;
+    }
+    pthread_mutex_lock(&priv->mutex);
+    while (hedge->winner == -1 && pthread_cond_timedwait(&hedge->done, &priv->mutex, &deadline) == 0)
+        ;
+    winner = hedge->winner;
+    CHECK_RETURN(pthread_mutex_unlock(&priv->mutex));
+
+    // If it's still not done, send the second request
+    if (winner == -1
+      && http_io_read_prepare(priv, &hedge->ios[1], hedge->urlbufs + urlbuf_size, urlbuf_size, block_num, expect_etag, strict) == 0) {
+        if (http_io_hedge_start(priv, hedge, 1) == 0)
+            ATOMIC_ADD(priv->stats.http_hedged_reads, 1);
+        else
+            http_io_hedge_discard(priv, &hedge->ios[1]);
+    }
+
+    // Wait for one of them to complete
+    pthread_mutex_lock(&priv->mutex);
+    while ((winner = hedge->winner) == -1)
+        pthread_cond_wait(&hedge->done, &priv->mutex);
+    if (winner == 1)
+        priv->stats.http_hedge_wins++;
+    CHECK_RETURN(pthread_mutex_unlock(&priv->mutex));
+
+    // Check the result, retrying the usual way if necessary, and process the response
+    io = &hedge->ios[winner];
+    io->curl = NULL;
+    if ((r = http_io_finish_attempt(priv, io, hedge->reqs[winner].curl, hedge->reqs[winner].curl_code, 0)) == -1)
+        r = http_io_perform_io(priv, io, http_io_read_prepper);
+    r = http_io_read_finish(priv, io, r, dest, actual_etag, expect_etag, strict);
+
+done:
+    // Release our reference
+    http_io_hedge_release(hedge);
     return r;
 }
 
+/*
+ * Start one of the requests of a hedged read via the asynchronous engine.
+ *
+ * On failure, the CURL instance (if any) is released, but the request is otherwise not cleaned up.
+ */
+static int
+http_io_hedge_start(struct http_io_private *priv, struct http_io_hedge *hedge, int index)
+{
+    struct http_io_conf *const config = priv->config;
+    struct http_io_async *const req = &hedge->reqs[index];
+    struct http_io *const io = &hedge->ios[index];
+    int r;
+
+    // Don't wait for the adaptive limit to send a hedge request; it would only add to the congestion
+    if ((r = http_io_limit_acquire(priv, &req->limit_gen, index == 0)) != 0)
+        return r;
+
+    // Debug
+    if (config->debug)
+        (*config->log)(LOG_DEBUG, "%s %s%s", io->method, io->url, index > 0 ? " (hedged)" : "");
+
+    // Acquire and initialize CURL instance
+    if ((req->curl = http_io_start_attempt(priv, io, http_io_read_prepper, 0)) == NULL) {
+        http_io_limit_release(priv, req->limit_gen, NULL, CURLE_OK);
+        return EIO;
+    }
+    io->curl = req->curl;
+    req->done = http_io_hedge_done;
+    req->done_arg = hedge;
+
+    // Submit it
+    pthread_mutex_lock(&priv->mutex);
+    hedge->refs++;
+    CHECK_RETURN(pthread_mutex_unlock(&priv->mutex));
+    if (http_io_async_submit(priv, req) != 0) {
+        http_io_limit_release(priv, req->limit_gen, NULL, CURLE_OK);
+        pthread_mutex_lock(&priv->mutex);
+        hedge->refs--;
+        CHECK_RETURN(pthread_mutex_unlock(&priv->mutex));
+        io->curl = NULL;
+        http_io_release_curl(priv, &req->curl, 0);
+        return ENOTCONN;
+    }
+    return 0;
+}
+
+/*
+ * Clean up a prepared block GET request whose response is not wanted.
+ */
+static void
+http_io_hedge_discard(struct http_io_private *priv, struct http_io *io)
+{
+    http_io_free_error_payload(io);
+    curl_slist_free_all(io->headers);
+    s3b_pool_free(priv->read_pool, io->dest);
+}
+
+/*
+ * Release one reference to a hedged read, freeing it if it was the last.
+ */
+static void
+http_io_hedge_release(struct http_io_hedge *hedge)
+{
+    struct http_io_private *const priv = hedge->priv;
+    u_int refs;
+
+    pthread_mutex_lock(&priv->mutex);
+    assert(hedge->refs > 0);
+    refs = --hedge->refs;
+    CHECK_RETURN(pthread_mutex_unlock(&priv->mutex));
+    if (refs == 0) {
+        pthread_cond_destroy(&hedge->done);
+        free(hedge);
+    }
+}
+
+/*
+ * Completion callback for the requests of a hedged read.
+ *
+ * The first request to complete is handed back to the waiting thread; any later one is discarded.
+ */
+static void
+http_io_hedge_done(struct http_io_async *req)
+{
+    struct http_io_hedge *const hedge = req->done_arg;
+    struct http_io_private *const priv = hedge->priv;
+    const int index = (int)(req - hedge->reqs);
+    int won;
+
+    // Account for completion
+    http_io_limit_release(priv, req->limit_gen, req->curl, req->curl_code);
+
+    // Are we first?
+    pthread_mutex_lock(&priv->mutex);
+    if ((won = hedge->winner == -1)) {
+        hedge->winner = index;
+        pthread_cond_signal(&hedge->done);
+    }
+    CHECK_RETURN(pthread_mutex_unlock(&priv->mutex));
+
+    // If not, the response is not wanted
+    if (!won) {
+        hedge->ios[index].curl = NULL;
+        http_io_release_curl(priv, &req->curl, 0);
+        http_io_hedge_discard(priv, &hedge->ios[index]);
+    }
+    http_io_hedge_release(hedge);
+}
+
 static void
 http_io_read_prepper(CURL *curl, struct http_io *io)
 {
@@ -1789,68 +2894,243 @@ http_io_write_block(struct s3backer_store *const s3b, s3b_block_t block_num, con
     struct http_io_private *const priv = s3b->data;
     struct http_io_conf *const config = priv->config;
     char urlbuf[URL_BUF_SIZE(config)];
-    char hmacbuf[SHA_DIGEST_LENGTH * 2 + 1];
-    u_char hmac[SHA_DIGEST_LENGTH];
-    u_char md5[MD5_DIGEST_LENGTH];
-    const time_t now = time(NULL);
     void *encoded_buf = NULL;
     struct http_io io;
-    int compressed = 0;
-    int encrypted = 0;
     int r;
 
     // Sanity check
     if (config->block_size == 0 || block_num >= config->num_blocks)
         return EINVAL;
 
-    // Detect zero blocks (if not done already by upper layer)
-    if (src != NULL && block_is_zeros(src))
-        src = NULL;
+    // Encode block and build request
+    switch ((r = http_io_write_prepare(priv, &io, urlbuf, sizeof(urlbuf), block_num, src, &encoded_buf))) {
+    case -1:
+        if (caller_etag != NULL)
+            memset(caller_etag, 0, MD5_DIGEST_LENGTH);
+        r = 0;
+        goto done;
+    case 0:
+        break;
+    default:
+        goto done;
+    }
+    io.check_cancel = check_cancel;
+    io.check_cancel_arg = check_cancel_arg;
 
-    // Don't write zero blocks when bitmap indicates empty until non-zero content is written
-    if (priv->non_zero != NULL) {
-        pthread_mutex_lock(&priv->mutex);
-        if (src == NULL) {
-            if (!bitmap_test(priv->non_zero, block_num)) {
-                priv->stats.empty_blocks_written++;
-                CHECK_RETURN(pthread_mutex_unlock(&priv->mutex));
-                if (caller_etag != NULL)
-                    memset(caller_etag, 0, MD5_DIGEST_LENGTH);
-                return 0;
-            }
-        } else
-            bitmap_set(priv->non_zero, block_num, 1);
+    // Perform operation
+    r = http_io_perform_io(priv, &io, http_io_write_prepper);
+    r = http_io_write_finish(priv, &io, r, caller_etag);
+
+done:
+    //  Clean up
+    curl_slist_free_all(io.headers);
+    free(encoded_buf);              // OK if NULL
+    return r;
+}
+
+/*
+ * Write a range of blocks, encoding them ahead of the network using the encoder pool.
+ *
+ * Blocks are handled in batches. While one batch is being transferred, the encoder threads are
+ * compressing, encrypting, and signing the next one.
+ */
+static int
+http_io_write_blocks(struct s3backer_store *const s3b, s3b_block_t block_num, u_int num_blocks, const void *src)
+{
+    struct http_io_private *const priv = s3b->data;
+    struct http_io_conf *const config = priv->config;
+    const size_t urlbuf_size = URL_BUF_SIZE(config);
+    struct http_io_encode *jobs = NULL;
+    struct http_io **iops = NULL;
+    struct http_io_batch batch[2];
+    char *urlbufs = NULL;
+    int *results = NULL;
+    u_int batch_size[2];
+    int cur = 0;
+    int r = 0;
+    u_int i;
+
+    // Sanity check
+    if (config->block_size == 0 || block_num + num_blocks < block_num || block_num + num_blocks > config->num_blocks)
+        return EINVAL;
+
+    // If the encoder pool is not running, or there's nothing to overlap, do it the simple way
+    if (priv->num_encode_threads == 0 || num_blocks <= 1)
+        return generic_write_blocks(s3b, block_num, num_blocks, src);
+
+    // Allocate per-request state for two batches
+    if ((jobs = calloc(2 * WRITE_PIPELINE_BATCH, sizeof(*jobs))) == NULL
+      || (iops = malloc(WRITE_PIPELINE_BATCH * sizeof(*iops))) == NULL
+      || (results = malloc(WRITE_PIPELINE_BATCH * sizeof(*results))) == NULL
+      || (urlbufs = malloc(2 * WRITE_PIPELINE_BATCH * urlbuf_size)) == NULL) {
+        (*config->log)(LOG_ERR, "malloc: %s", strerror(errno));
+        ATOMIC_ADD(priv->stats.out_of_memory_errors, 1);
+        r = ENOMEM;
+        goto done;
+    }
+    if ((r = pthread_cond_init(&batch[0].done, NULL)) != 0)
+        goto done;
+    if ((r = pthread_cond_init(&batch[1].done, NULL)) != 0) {
+        pthread_cond_destroy(&batch[0].done);
+        goto done;
+    }
+
+    // Start encoding the first batch
+    batch_size[cur] = http_io_encode_submit(priv, &batch[cur], jobs, urlbufs, block_num, num_blocks, src);
+    while (batch_size[cur] > 0) {
+        struct http_io_encode *const cur_jobs = jobs + cur * WRITE_PIPELINE_BATCH;
+        const u_int nblocks = batch_size[cur];
+        const int next = cur ^ 1;
+        u_int num_ios = 0;
+        int r2;
+
+        // Wait for the current batch to be encoded
+        pthread_mutex_lock(&priv->mutex);
+        while (batch[cur].remaining > 0)
+            pthread_cond_wait(&batch[cur].done, &priv->mutex);
         CHECK_RETURN(pthread_mutex_unlock(&priv->mutex));
+
+        // Advance
+        block_num += nblocks;
+        num_blocks -= nblocks;
+        src = (const char *)src + (size_t)nblocks * config->block_size;
+
+        // Start encoding the next batch while we transfer this one
+        batch_size[next] = http_io_encode_submit(priv, &batch[next],
+          jobs + next * WRITE_PIPELINE_BATCH, urlbufs + next * WRITE_PIPELINE_BATCH * urlbuf_size, block_num, num_blocks, src);
+
+        // Gather the blocks that need to be sent
+        for (i = 0; i < nblocks; i++) {
+            struct http_io_encode *const job = &cur_jobs[i];
+
+            switch (job->result) {
+            case -1:
+                break;
+            case 0:
+                iops[num_ios++] = &job->io;
+                break;
+            default:
+                if (r == 0)
+                    r = job->result;
+                break;
+            }
+        }
+
+        // Perform operations
+        if (num_ios > 0)
+            http_io_perform_ios(priv, iops, results, num_ios, http_io_write_prepper);
+
+        // Process responses
+        for (i = 0; i < num_ios; i++) {
+            if ((r2 = http_io_write_finish(priv, iops[i], results[i], NULL)) != 0 && r == 0)
+                r = r2;
+        }
+
+        // Clean up this batch
+        for (i = 0; i < nblocks; i++) {
+            struct http_io_encode *const job = &cur_jobs[i];
+
+            curl_slist_free_all(job->io.headers);
+            free(job->encoded_buf);             // OK if NULL
+            memset(job, 0, sizeof(*job));
+        }
+        cur = next;
     }
+    pthread_cond_destroy(&batch[1].done);
+    pthread_cond_destroy(&batch[0].done);
+
+done:
+    // Clean up
+    free(urlbufs);
+    free(results);
+    free(iops);
+    free(jobs);
+    return r;
+}
+
+/*
+ * Encode a block and build the request that writes it.
+ *
+ * This is the CPU half of a block write: zero detection, compression, encryption, checksums, and request signing.
+ * On return the caller must always free io->headers and *encoded_bufp (when not NULL).
+ *
+ * Returns zero if the request is ready, -1 if there's nothing to send (known empty block), or else an error code.
+ */
+static int
+http_io_write_prepare(struct http_io_private *priv, struct http_io *io, char *urlbuf, size_t urlbuf_size,
+    s3b_block_t block_num, const void *src, void **encoded_bufp)
+{
+    struct http_io_conf *const config = priv->config;
+    char hmacbuf[SHA_DIGEST_LENGTH * 2 + 1];
+    u_char hmac[SHA_DIGEST_LENGTH];
+    u_char md5[MD5_DIGEST_LENGTH];
+    const time_t now = time(NULL);
+    void *encoded_buf = NULL;
+    int compressed = 0;
+    int encrypted = 0;
+    int r;
 
     // Initialize I/O info
-    http_io_init_io(priv, &io, src != NULL ? HTTP_PUT : HTTP_DELETE, urlbuf);
-    io.src = src;
-    io.buf_size = config->block_size;
-    io.block_num = block_num;
-    io.check_cancel = check_cancel;
-    io.check_cancel_arg = check_cancel_arg;
+    *encoded_bufp = NULL;
+    http_io_init_io(priv, io, HTTP_PUT, urlbuf);
+
+    // Detect zero blocks (if not done already by upper layer)
+    if (src != NULL && block_is_zeros(src))
+        src = NULL;
+
+    // Don't write zero blocks when bitmap indicates empty until non-zero content is written
+    if (priv->non_zero != NULL || config->list_blocks_save) {
+        pthread_mutex_lock(&priv->mutex);
+        if (src != NULL && priv->survey_non_zero != NULL)
+            bitmap_set(priv->survey_non_zero, block_num, 1);
+        if (priv->non_zero != NULL) {
+            if (src == NULL) {
+                if (!bitmap_test(priv->non_zero, block_num)) {
+                    priv->stats.empty_blocks_written++;
+                    CHECK_RETURN(pthread_mutex_unlock(&priv->mutex));
+                    return -1;
+                }
+            } else
+                bitmap_set(priv->non_zero, block_num, 1);
+        }
+        CHECK_RETURN(pthread_mutex_unlock(&priv->mutex));
+    }
+
+    // Finish initializing I/O info
+    io->method = src != NULL ? HTTP_PUT : HTTP_DELETE;
+    io->src = src;
+    io->buf_size = config->block_size;
+    io->block_num = block_num;
 
-    // Compress block if desired
-    if (src != NULL && config->compress_alg != NULL) {
+    // Compress block if desired (in adaptive mode, don't bother with data that looks incompressible)
+    if (src != NULL && config->compress_alg != NULL
+      && (priv->comp_adapt == NULL || !comp_probe_incompressible(src, io->buf_size))) {
+        const struct comp_dict *const dict = config->compress_dict ? http_io_dict_for_write(priv, src) : NULL;
         size_t compress_len;
 
         // Compress data
-        if ((r = (*config->compress_alg->cfunc)(config->log, io.src,
-          io.buf_size, &encoded_buf, &compress_len, config->compress_level)) != 0) {
-            if (r == ENOMEM) {
-                pthread_mutex_lock(&priv->mutex);
-                priv->stats.out_of_memory_errors++;
-                CHECK_RETURN(pthread_mutex_unlock(&priv->mutex));
-            }
-            goto fail;
+        if (priv->comp_adapt != NULL)
+            r = comp_adapt_compress(priv->comp_adapt, io->src, io->buf_size, &encoded_buf, &compress_len, dict);
+        else {
+            r = (*config->compress_alg->cfunc)(config->log, io->src,
+              io->buf_size, &encoded_buf, &compress_len, config->compress_level, dict);
+        }
+        if (r != 0) {
+            if (r == ENOMEM)
+                ATOMIC_ADD(priv->stats.out_of_memory_errors, 1);
+            return r;
         }
 
-        // Update POST data
-        io.src = encoded_buf;
-        io.buf_size = compress_len;
-        compressed = 1;
+        // Update POST data (adaptive compression may have decided the data is better left uncompressed)
+        if (encoded_buf != NULL) {
+            *encoded_bufp = encoded_buf;
+            io->src = encoded_buf;
+            io->buf_size = compress_len;
+            compressed = 1;
+        }
     }
+    if (src != NULL && priv->comp_adapt != NULL && !compressed)
+        ATOMIC_ADD(priv->stats.compress_skipped, 1);
 
     // Encrypt data if desired
     if (src != NULL && config->encryption != NULL) {
@@ -1859,28 +3139,25 @@ http_io_write_block(struct s3backer_store *const s3b, s3b_block_t block_num, con
         u_int encrypt_buflen;
 
         // Allocate buffer
-        encrypt_buflen = io.buf_size + EVP_MAX_IV_LENGTH;
+        encrypt_buflen = io->buf_size + EVP_MAX_IV_LENGTH;
         if ((encrypt_buf = malloc(encrypt_buflen)) == NULL) {
             (*config->log)(LOG_ERR, "malloc: %s", strerror(errno));
-            pthread_mutex_lock(&priv->mutex);
-            priv->stats.out_of_memory_errors++;
-            CHECK_RETURN(pthread_mutex_unlock(&priv->mutex));
-            r = ENOMEM;
-            goto fail;
+            ATOMIC_ADD(priv->stats.out_of_memory_errors, 1);
+            return ENOMEM;
         }
 
         // Encrypt the block
-        encrypt_len = http_io_crypt(priv, block_num, 1, io.src, io.buf_size, encrypt_buf, encrypt_buflen);
+        encrypt_len = http_io_crypt(priv, block_num, 1, io->src, io->buf_size, encrypt_buf, encrypt_buflen);
 
         // Compute block signature
         http_io_authsig(priv, block_num, encrypt_buf, encrypt_len, hmac);
         http_io_prhex(hmacbuf, hmac, SHA_DIGEST_LENGTH);
 
         // Update POST data
-        io.src = encrypt_buf;
-        io.buf_size = encrypt_len;
+        io->src = encrypt_buf;
+        io->buf_size = encrypt_len;
         free(encoded_buf);              // OK if NULL
-        encoded_buf = encrypt_buf;
+        *encoded_bufp = encrypt_buf;
         encrypted = 1;
     }
 
@@ -1895,607 +3172,1683 @@ http_io_write_block(struct s3backer_store *const s3b, s3b_block_t block_num, con
             snvprintf(ebuf + strlen(ebuf), sizeof(ebuf) - strlen(ebuf), "%s%s-%s",
               compressed ? ", " : "", CONTENT_ENCODING_ENCRYPT, config->encryption);
         }
-        io.headers = http_io_add_header(priv, io.headers, "%s", ebuf);
+        io->headers = http_io_add_header(priv, io->headers, "%s", ebuf);
     }
 
     // Compute MD5 checksum
     if (src != NULL)
-        MD5(io.src, io.buf_size, md5);
+        MD5(io->src, io->buf_size, md5);
     else
         memset(md5, 0, MD5_DIGEST_LENGTH);
 
     // Construct URL for this block
-    http_io_get_block_url(urlbuf, sizeof(urlbuf), config, block_num);
+    http_io_get_block_url(urlbuf, urlbuf_size, config, block_num);
 
     // Add Date header
-    http_io_add_date(priv, &io, now);
+    http_io_add_date(priv, io, now);
 
     // Add PUT-only headers
     if (src != NULL) {
         char md5buf[(MD5_DIGEST_LENGTH * 4) / 3 + 4];
 
         // Add Content-Type header
-        io.headers = http_io_add_header(priv, io.headers, "%s: %s", CTYPE_HEADER, CONTENT_TYPE);
+        io->headers = http_io_add_header(priv, io->headers, "%s: %s", CTYPE_HEADER, CONTENT_TYPE);
 
         // Add Content-MD5 header
         http_io_base64_encode(md5buf, sizeof(md5buf), md5, MD5_DIGEST_LENGTH);
-        io.headers = http_io_add_header(priv, io.headers, "%s: %s", MD5_HEADER, md5buf);
+        io->headers = http_io_add_header(priv, io->headers, "%s: %s", MD5_HEADER, md5buf);
     }
 
     // Add ACL header (PUT only)
     if (src != NULL)
-        io.headers = http_io_add_header(priv, io.headers, "%s: %s", ACL_HEADER, config->accessType);
+        io->headers = http_io_add_header(priv, io->headers, "%s: %s", ACL_HEADER, config->accessType);
 
     // Add file size meta-data to zero'th block
     if (src != NULL && block_num == 0) {
-        io.headers = http_io_add_header(priv, io.headers, "%s: %u", BLOCK_SIZE_HEADER, config->block_size);
-        io.headers = http_io_add_header(priv, io.headers, "%s: %ju",
+        io->headers = http_io_add_header(priv, io->headers, "%s: %u", BLOCK_SIZE_HEADER, config->block_size);
+        io->headers = http_io_add_header(priv, io->headers, "%s: %ju",
           FILE_SIZE_HEADER, (uintmax_t)config->block_size * (uintmax_t)config->num_blocks);
     }
 
     // Add signature header (if encrypting)
     if (src != NULL && config->encryption != NULL)
-        io.headers = http_io_add_header(priv, io.headers, "%s: \"%s\"", HMAC_HEADER, hmacbuf);
+        io->headers = http_io_add_header(priv, io->headers, "%s: \"%s\"", HMAC_HEADER, hmacbuf);
 
     // Add Server Side Encryption header(s) (if needed)
     if (config->sse != NULL && src != NULL) {
-        io.headers = http_io_add_header(priv, io.headers, "%s: %s", SSE_HEADER, config->sse);
+        io->headers = http_io_add_header(priv, io->headers, "%s: %s", SSE_HEADER, config->sse);
         if (strcmp(config->sse, SSE_AWS_KMS) == 0)
-            io.headers = http_io_add_header(priv, io.headers, "%s: %s", SSE_KEY_ID_HEADER, config->sse_key_id);
+            io->headers = http_io_add_header(priv, io->headers, "%s: %s", SSE_KEY_ID_HEADER, config->sse_key_id);
     }
 
     // Add storage class header (if needed)
     if (config->storage_class != NULL)
-        io.headers = http_io_add_header(priv, io.headers, "%s: %s", STORAGE_CLASS_HEADER, config->storage_class);
+        io->headers = http_io_add_header(priv, io->headers, "%s: %s", STORAGE_CLASS_HEADER, config->storage_class);
 
     // Add Authorization header
-    if ((r = http_io_add_auth(priv, &io, now, io.src, io.buf_size)) != 0)
-        goto fail;
+    return http_io_add_auth(priv, io, now, io->src, io->buf_size);
+}
 
-    // Perform operation
-    r = http_io_perform_io(priv, &io, http_io_write_prepper);
+/*
+ * Check the result of a block write prepared by http_io_write_prepare() and update stats.
+ */
+static int
+http_io_write_finish(struct http_io_private *priv, struct http_io *io, int r, u_char *caller_etag)
+{
+    const int is_put = io->src != NULL;
 
     // Verify ETag was provided by server if we did a PUT and caller wants it
-    if (r == 0 && caller_etag != NULL && src != NULL)
-        r = http_io_verify_etag_provided(&io);
+    if (r == 0 && caller_etag != NULL && is_put)
+        r = http_io_verify_etag_provided(io);
 
     // Report ETag back to caller if requested
     if (r == 0 && caller_etag != NULL)
-        memcpy(caller_etag, src != NULL ? io.etag : zero_etag, MD5_DIGEST_LENGTH);
+        memcpy(caller_etag, is_put ? io->etag : zero_etag, MD5_DIGEST_LENGTH);
 
-    // Update stats
+    // Update stats; a deleted block is now known to be empty (a survey in progress stays conservative, though)
     if (r == 0) {
         pthread_mutex_lock(&priv->mutex);
-        if (src == NULL)
+        if (!is_put) {
             priv->stats.zero_blocks_written++;
-        else
+            if (priv->non_zero != NULL)
+                bitmap_set(priv->non_zero, io->block_num, 0);
+        } else
             priv->stats.normal_blocks_written++;
         CHECK_RETURN(pthread_mutex_unlock(&priv->mutex));
     }
-
-fail:
-    //  Clean up
-    curl_slist_free_all(io.headers);
-    if (encoded_buf != NULL)
-        free(encoded_buf);
     return r;
 }
 
+/*
+ * Load the current compression dictionary from the bucket, or if there isn't one, start sampling written blocks to train one.
+ */
 static int
-http_io_verify_etag_provided(struct http_io *const io)
+http_io_dict_start(struct http_io_private *priv)
 {
-    if (memcmp(io->etag, zero_etag, MD5_DIGEST_LENGTH) == 0) {
-        (*io->config->log)(LOG_ERR, "%s %s: missing %s header in response", io->method, io->url, ETAG_HEADER);
-        return EIO;
+    struct http_io_conf *const config = priv->config;
+    const struct comp_alg *const calg = config->compress_alg;
+    char name[DICT_FILE_NAME_MAX];
+    struct comp_dict *dict;
+    char buf[32];
+    size_t len;
+    u_int id;
+    int r;
+
+    // Sanity check
+    assert(calg != NULL && calg->dtrain != NULL);
+
+    // Read the dictionary pointer file
+    snvprintf(name, sizeof(name), "%s%s", DICT_FILE_PREFIX, calg->name);
+    switch ((r = http_io_get_object(priv, name, buf, sizeof(buf) - 1, &len))) {
+    case 0:
+        break;
+    case ENOENT:
+        goto sample;
+    default:
+        (*config->log)(LOG_ERR, "can't read %s compression dictionary pointer: %s", calg->name, strerror(r));
+        return r;
+    }
+    buf[len] = '\0';
+    if (sscanf(buf, "%x", &id) != 1 || id == 0) {
+        (*config->log)(LOG_ERR, "invalid %s compression dictionary pointer \"%s\"", calg->name, buf);
+        return EINVAL;
+    }
+
+    // Load the dictionary it points to
+    if ((dict = http_io_dict_fetch(priv, calg, id)) == NULL)
+        return errno;
+    pthread_mutex_lock(&priv->mutex);
+    priv->compress_dict = http_io_dict_add(priv, calg, dict);
+    CHECK_RETURN(pthread_mutex_unlock(&priv->mutex));
+    if (priv->compress_dict == NULL)
+        return ENOMEM;
+    (*config->log)(LOG_INFO, "using %s compression dictionary %08x", calg->name, id);
+    return 0;
+
+sample:
+    // Allocate sample buffers
+    if ((priv->dict_samples = malloc(DICT_SAMPLE_BUDGET)) == NULL
+      || (priv->dict_sample_lens = malloc(config->compress_dict_samples * sizeof(*priv->dict_sample_lens))) == NULL) {
+        r = errno;
+        (*config->log)(LOG_ERR, "malloc: %s", strerror(r));
+        free(priv->dict_samples);
+        priv->dict_samples = NULL;
+        return r;
     }
+    priv->dict_sampling = 1;
+    (*config->log)(LOG_INFO, "no %s compression dictionary found; will train one from the next %u blocks written",
+      calg->name, config->compress_dict_samples);
     return 0;
 }
 
-static void
-http_io_write_prepper(CURL *curl, struct http_io *io)
+/*
+ * Get the dictionary to use for compressing the given (non-zero) block.
+ *
+ * While we're sampling, the block is added to the sample set. The thread adding the final sample trains the dictionary.
+ */
+static const struct comp_dict *
+http_io_dict_for_write(struct http_io_private *priv, const void *src)
 {
-    memset(&io->bufs, 0, sizeof(io->bufs));
-    if (io->src != NULL) {
-        io->bufs.wrremain = io->buf_size;
-        io->bufs.wrdata = io->src;
+    struct http_io_conf *const config = priv->config;
+    const size_t len = config->block_size < DICT_SAMPLE_MAX_SIZE ? config->block_size : DICT_SAMPLE_MAX_SIZE;
+    const struct comp_dict *dict;
+    size_t *sample_lens;
+    char *samples;
+    u_int num_samples;
+
+    // Add sample, if still sampling
+    pthread_mutex_lock(&priv->mutex);
+    if ((dict = priv->compress_dict) != NULL || !priv->dict_sampling) {
+        CHECK_RETURN(pthread_mutex_unlock(&priv->mutex));
+        return dict;
     }
-    curl_easy_setopt(curl, CURLOPT_READFUNCTION, http_io_curl_writer);
-    curl_easy_setopt(curl, CURLOPT_READDATA, io);
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, http_io_curl_reader);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, io);
-    curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, http_io_curl_header);
-    curl_easy_setopt(curl, CURLOPT_HEADERDATA, io);
-    if (io->src != NULL) {
-        curl_easy_setopt(curl, CURLOPT_UPLOAD, 1);
-        curl_easy_setopt(curl, CURLOPT_INFILESIZE_LARGE, (curl_off_t)io->buf_size);
+    memcpy(priv->dict_samples + priv->dict_samples_size, src, len);
+    priv->dict_sample_lens[priv->num_dict_samples++] = len;
+    priv->dict_samples_size += len;
+
+    // Are we done sampling?
+    if (priv->num_dict_samples < config->compress_dict_samples && priv->dict_samples_size + len <= DICT_SAMPLE_BUDGET) {
+        CHECK_RETURN(pthread_mutex_unlock(&priv->mutex));
+        return NULL;
     }
-    curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, io->method);
-    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, io->headers);
-    http_io_curl_header_reset(io);
+
+    // Take the samples and stop sampling
+    samples = priv->dict_samples;
+    sample_lens = priv->dict_sample_lens;
+    num_samples = priv->num_dict_samples;
+    priv->dict_samples = NULL;
+    priv->dict_sample_lens = NULL;
+    priv->dict_sampling = 0;
+    CHECK_RETURN(pthread_mutex_unlock(&priv->mutex));
+
+    // Train and publish the new dictionary
+    http_io_dict_train(priv, samples, sample_lens, num_samples);
+
+    // Use it, if we got one
+    pthread_mutex_lock(&priv->mutex);
+    dict = priv->compress_dict;
+    CHECK_RETURN(pthread_mutex_unlock(&priv->mutex));
+    return dict;
 }
 
-static int
-http_io_bulk_zero(struct s3backer_store *const s3b, const s3b_block_t *block_nums, u_int num_blocks)
+/*
+ * Train a new compression dictionary from samples, store it in the bucket, and start using it.
+ *
+ * The dictionary itself is written before the pointer file, and both before any block is compressed with it,
+ * so every block that references a dictionary can always find it. On failure, we just carry on without one.
+ */
+static void
+http_io_dict_train(struct http_io_private *priv, char *samples, size_t *sample_lens, u_int num_samples)
 {
-    struct http_io_private *const priv = s3b->data;
     struct http_io_conf *const config = priv->config;
-    char urlbuf[URL_BUF_SIZE(config)];
-    size_t max_object_name;
-    struct http_io io;
-    char *buf = NULL;
+    const struct comp_alg *const calg = config->compress_alg;
+    char name[DICT_FILE_NAME_MAX];
+    struct comp_dict *dict;
+    char buf[32];
+    void *data;
+    size_t len;
     int r;
 
-    // Set URL
-    snvprintf(urlbuf, sizeof(urlbuf), "%s?delete", config->vhostURL);
+    // Train dictionary
+    (*config->log)(LOG_INFO, "training %s compression dictionary from %u samples", calg->name, num_samples);
+    r = (*calg->dtrain)(config->log, samples, sample_lens, num_samples, &data, &len);
+    free(sample_lens);
+    free(samples);
+    if (r != 0)
+        goto fail0;
 
-    // Initialize XML query
-    if ((r = http_io_xml_io_init(priv, &io, HTTP_POST, urlbuf)) != 0)
-        return r;
+    // Load it
+    if ((dict = (*calg->dload)(config->log, data, len, config->compress_level)) == NULL) {
+        r = errno;
+        goto fail1;
+    }
 
-    // Calculate the maximum length of one object name
-    max_object_name = strlen(config->prefix) + S3B_BLOCK_NUM_DIGITS
-      + strlen(BLOCK_HASH_PREFIX_SEPARATOR) + S3B_BLOCK_NUM_DIGITS + 1;           // [PREFIX]([HASH][SEPARATOR])?[BLOCK]
+    // Store the dictionary
+    snvprintf(name, sizeof(name), "%s%s-%08x", DICT_FILE_PREFIX, calg->name, (u_int)dict->id);
+    if ((r = http_io_put_object(priv, name, data, len, DICT_FILE_MIME_TYPE)) != 0)
+        goto fail2;
 
-    // Delete blocks in chunks of DELETE_BLOCKS_CHUNK
-    while (num_blocks > 0) {
-        const int count = num_blocks <= DELETE_BLOCKS_CHUNK ? num_blocks : DELETE_BLOCKS_CHUNK;
-        size_t max_object_elem;
-        size_t max_payload;
-        size_t payload_len;
-        char *new_buf;
-        u_int i;
+    // Point to it
+    snvprintf(name, sizeof(name), "%s%s", DICT_FILE_PREFIX, calg->name);
+    snvprintf(buf, sizeof(buf), "%08x\n", (u_int)dict->id);
+    if ((r = http_io_put_object(priv, name, buf, strlen(buf), DICT_POINTER_MIME_TYPE)) != 0)
+        goto fail2;
 
-        // Calculate upper bound on size of query payload
-        max_object_elem = strlen(DELETE_ELEM_OBJECT) + 2                                            // <Object>
-          + strlen(DELETE_ELEM_KEY) + 2 + max_object_name + strlen(DELETE_ELEM_KEY) + 3             //   <Key>xxx</Key>
-          + strlen(DELETE_ELEM_OBJECT) + 3;                                                         // </Object>
-        max_payload = strlen(DELETE_ELEM_DELETE) + 2                                                // <Delete>
-          + (count * max_object_elem)                                                               //   <Object>...
-          + strlen(DELETE_ELEM_DELETE) + 3                                                          // </Delete>
-          + 2;                                                                                      // nul byte, plus one extra
+    // Start using it
+    pthread_mutex_lock(&priv->mutex);
+    priv->compress_dict = http_io_dict_add(priv, calg, dict);
+    CHECK_RETURN(pthread_mutex_unlock(&priv->mutex));
+    (*config->log)(LOG_INFO, "using new %s compression dictionary %08x (%u bytes)", calg->name, (u_int)dict->id, (u_int)len);
+    free(data);
+    return;
 
-        // Allocate buffer
-        if ((new_buf = realloc(buf, max_payload)) == NULL) {
-            r = errno;
-            (*config->log)(LOG_ERR, "realloc: %s", strerror(r));
-            break;
-        }
-        buf = new_buf;
+fail2:
+    (*calg->dfree)(dict);
+fail1:
+    free(data);
+fail0:
+    (*config->log)(LOG_ERR, "failed to create %s compression dictionary: %s; continuing without one", calg->name, strerror(r));
+}
 
-        // Build XML payload
-        payload_len = snvprintf(buf, max_payload, "<%s>", DELETE_ELEM_DELETE);
-        for (i = 0; i < count; i++) {
-            const s3b_block_t block_num = block_nums[i];
-            char block_hash_buf[S3B_BLOCK_NUM_DIGITS + strlen(BLOCK_HASH_PREFIX_SEPARATOR) + 1];
-            char object_buf[max_object_name + 1];
+/*
+ * Find the given dictionary, loading it from the bucket if necessary. Returns NULL if that fails.
+ */
+static const struct comp_dict *
+http_io_dict_find(struct http_io_private *priv, const struct comp_alg *calg, uint32_t id)
+{
+    const struct comp_dict *result;
+    struct comp_dict *dict;
+    u_int i;
 
-            http_io_format_block_hash(config->blockHashPrefix, block_hash_buf, sizeof(block_hash_buf), block_num);
-            snvprintf(object_buf, sizeof(object_buf), "%s%s%0*jx",
-              config->prefix, block_hash_buf, S3B_BLOCK_NUM_DIGITS, (uintmax_t)block_num);
-            payload_len += snvprintf(buf + payload_len, max_payload - payload_len, "<%s><%s>%s</%s></%s>",
-              DELETE_ELEM_OBJECT, DELETE_ELEM_KEY, object_buf, DELETE_ELEM_KEY, DELETE_ELEM_OBJECT);
-        }
-        payload_len += snvprintf(buf + payload_len, max_payload - payload_len, "</%s>", DELETE_ELEM_DELETE);
+    // Already loaded?
+    pthread_mutex_lock(&priv->mutex);
+    for (i = 0; i < priv->num_dicts; i++) {
+        const struct http_io_dict *const hdict = &priv->dicts[i];
 
-        // Initialize buffer
-        io.bufs.wrdata = buf;
-        io.bufs.wrremain = payload_len;
+        if (hdict->calg == calg && hdict->dict->id == id) {
+            CHECK_RETURN(pthread_mutex_unlock(&priv->mutex));
+            return hdict->dict;
+        }
+    }
+    CHECK_RETURN(pthread_mutex_unlock(&priv->mutex));
 
-        // Perform operation
-        if ((r = http_io_xml_io_exec(priv, &io, http_io_bulk_delete_elem_end)) != 0)
-            break;
+    // Load it
+    if ((dict = http_io_dict_fetch(priv, calg, id)) == NULL)
+        return NULL;
 
-        // Advance
-        block_nums += count;
-        num_blocks -= count;
+    // Add it (if some other thread beat us to it, this will just return theirs)
+    pthread_mutex_lock(&priv->mutex);
+    result = http_io_dict_add(priv, calg, dict);
+    CHECK_RETURN(pthread_mutex_unlock(&priv->mutex));
+    return result;
+}
+
+/*
+ * Read the given dictionary from the bucket and load it. Returns NULL (with errno set) if that fails.
+ */
+static struct comp_dict *
+http_io_dict_fetch(struct http_io_private *priv, const struct comp_alg *calg, uint32_t id)
+{
+    struct http_io_conf *const config = priv->config;
+    char name[DICT_FILE_NAME_MAX];
+    struct comp_dict *dict;
+    void *data;
+    size_t len;
+    int r;
+
+    // Allocate buffer
+    if ((data = malloc(COMP_DICT_MAX_SIZE)) == NULL) {
+        r = errno;
+        (*config->log)(LOG_ERR, "malloc: %s", strerror(r));
+        goto fail0;
+    }
+
+    // Read dictionary
+    snvprintf(name, sizeof(name), "%s%s-%08x", DICT_FILE_PREFIX, calg->name, (u_int)id);
+    if ((r = http_io_get_object(priv, name, data, COMP_DICT_MAX_SIZE, &len)) != 0) {
+        (*config->log)(LOG_ERR, "can't read %s compression dictionary %08x: %s", calg->name, (u_int)id, strerror(r));
+        goto fail1;
+    }
+
+    // Load it and verify it's the one we asked for
+    if ((dict = (*calg->dload)(config->log, data, len, config->compress_level)) == NULL) {
+        r = errno;
+        goto fail1;
+    }
+    if (dict->id != id) {
+        (*config->log)(LOG_ERR, "%s compression dictionary %08x has the wrong ID %08x", calg->name, (u_int)id, (u_int)dict->id);
+        (*calg->dfree)(dict);
+        r = EINVAL;
+        goto fail1;
     }
 
     // Done
-    http_io_xml_io_destroy(priv, &io);
-    free(buf);
-    return r;
+    free(data);
+    return dict;
+
+fail1:
+    free(data);
+fail0:
+    errno = r;
+    return NULL;
 }
 
-static void
-http_io_bulk_delete_elem_end(void *arg, const XML_Char *name)
+/*
+ * Add a loaded dictionary, unless we already have one with the same ID, in which case the new one is freed.
+ *
+ * Returns the dictionary now in the list, or NULL if out of memory (the dictionary is freed in that case too).
+ * This assumes the mutex is held.
+ */
+static const struct comp_dict *
+http_io_dict_add(struct http_io_private *priv, const struct comp_alg *calg, struct comp_dict *dict)
 {
-    struct http_io *const io = (struct http_io *)arg;
-    struct http_io_conf *const config = io->config;
-    char **copy_ptr = NULL;
+    struct http_io_dict *new_dicts;
+    u_int i;
 
-    // If we are in an error state, just bail
-    if (io->xml_error != XML_ERROR_NONE || io->handler_error != 0)
-        return;
+    // Check for duplicate
+    for (i = 0; i < priv->num_dicts; i++) {
+        const struct http_io_dict *const hdict = &priv->dicts[i];
 
-    // Handle <DeleteResult>/<Error>/<Foo> tags
-    if (strcmp(io->xml_path, "/" DELETE_ELEM_DELETE_RESULT "/" DELETE_ELEM_ERROR "/" DELETE_ELEM_KEY) == 0)
-        copy_ptr = &io->bulk_delete_err_key;
-    else if (strcmp(io->xml_path, "/" DELETE_ELEM_DELETE_RESULT "/" DELETE_ELEM_ERROR "/" DELETE_ELEM_CODE) == 0)
-        copy_ptr = &io->bulk_delete_err_code;
-    else if (strcmp(io->xml_path, "/" DELETE_ELEM_DELETE_RESULT "/" DELETE_ELEM_ERROR "/" DELETE_ELEM_MESSAGE) == 0)
-        copy_ptr = &io->bulk_delete_err_msg;
-    if (copy_ptr != NULL) {
-        free(*copy_ptr);
-        if ((*copy_ptr = strdup(io->xml_text)) == NULL) {
-            io->handler_error = errno;
-            (*config->log)(LOG_ERR, "strdup: %s", strerror(errno));
+        if (hdict->calg == calg && hdict->dict->id == dict->id) {
+            (*calg->dfree)(dict);
+            return hdict->dict;
         }
-        goto done;
     }
 
-    // Handle end of <DeleteResult>/<Error>
-    if (strcmp(io->xml_path, "/" DELETE_ELEM_DELETE_RESULT "/" DELETE_ELEM_ERROR) == 0) {
-        (*config->log)(LOG_ERR, "bulk delete error: key=\"%s\" code=\"%s\" message=\"%s\"",
-          io->bulk_delete_err_key != NULL ? io->bulk_delete_err_key : "(none)",
-          io->bulk_delete_err_code != NULL ? io->bulk_delete_err_code : "(none)",
-          io->bulk_delete_err_msg != NULL ? io->bulk_delete_err_msg : "(none)");
-        io->handler_error = EIO;
-        goto done;
+    // Add to list
+    if ((new_dicts = realloc(priv->dicts, (priv->num_dicts + 1) * sizeof(*priv->dicts))) == NULL) {
+        (*priv->config->log)(LOG_ERR, "realloc: %s", strerror(errno));
+        priv->stats.out_of_memory_errors++;
+        (*calg->dfree)(dict);
+        return NULL;
     }
-
-done:
-    // Update current XML path
-    assert(strrchr(io->xml_path, '/') != NULL);
-    *strrchr(io->xml_path, '/') = '\0';
-
-    // Reset text buffer
-    io->xml_text[0] = '\0';
+    priv->dicts = new_dicts;
+    priv->dicts[priv->num_dicts].calg = calg;
+    priv->dicts[priv->num_dicts].dict = dict;
+    priv->num_dicts++;
+    return dict;
 }
 
+/*
+ * Read a (small) non-block object into the given buffer.
+ *
+ * Returns zero on success, ENOENT if the object doesn't exist, or other error code.
+ */
 static int
-http_io_xml_io_init(struct http_io_private *const priv, struct http_io *io, const char *method, char *url)
+http_io_get_object(struct http_io_private *priv, const char *name, void *buf, size_t bufsiz, size_t *lenp)
 {
     struct http_io_conf *const config = priv->config;
+    char urlbuf[URL_BUF_SIZE(config) + strlen(name)];
+    const time_t now = time(NULL);
+    struct http_io io;
     int r;
 
     // Initialize I/O info
-    http_io_init_io(priv, io, method, url);
-    io->xml_error = XML_ERROR_NONE;
+    http_io_init_io(priv, &io, HTTP_GET, urlbuf);
+    io.dest = buf;
+    io.buf_size = bufsiz;
 
-    // Create XML parser
-    if ((io->xml = XML_ParserCreate(NULL)) == NULL) {
-        (*config->log)(LOG_ERR, "failed to create XML parser");
-        r = ENOMEM;
-        goto fail;
-    }
+    // Construct URL for the object
+    http_io_get_meta_file_url(urlbuf, sizeof(urlbuf), config, name);
 
-    // Allocate buffers for XML path and tag text content
-    if ((io->xml_text = calloc(1, 1)) == NULL) {
-        (*config->log)(LOG_ERR, "calloc: %s", strerror(errno));
-        goto fail;
-    }
-    if ((io->xml_path = calloc(1, 1)) == NULL) {
-        (*config->log)(LOG_ERR, "calloc: %s", strerror(errno));
-        goto fail;
-    }
+    // Add Date header
+    http_io_add_date(priv, &io, now);
 
-    // OK
-    return 0;
+    // Add Authorization header
+    if ((r = http_io_add_auth(priv, &io, now, NULL, 0)) != 0)
+        goto done;
 
-fail:
-    // Update stats
-    if (r == ENOMEM) {
-        pthread_mutex_lock(&priv->mutex);
-        priv->stats.out_of_memory_errors++;
-        CHECK_RETURN(pthread_mutex_unlock(&priv->mutex));
-    }
+    // Perform operation
+    if ((r = http_io_perform_io(priv, &io, http_io_read_prepper)) == 0)
+        *lenp = io.buf_size - io.bufs.rdremain;
 
-    // Cleanup
-    http_io_xml_io_destroy(priv, io);
+done:
+    //  Clean up
+    curl_slist_free_all(io.headers);
     return r;
 }
 
+/*
+ * Write a (small) non-block object.
+ */
 static int
-http_io_xml_io_exec(struct http_io_private *const priv, struct http_io *io, void (*end_handler)(void *arg, const XML_Char *name))
+http_io_put_object(struct http_io_private *priv, const char *name, const void *data, size_t len, const char *mime_type)
 {
     struct http_io_conf *const config = priv->config;
+    char urlbuf[URL_BUF_SIZE(config) + strlen(name)];
+    char md5buf[(MD5_DIGEST_LENGTH * 4) / 3 + 4];
+    u_char md5[MD5_DIGEST_LENGTH];
     const time_t now = time(NULL);
+    struct http_io io;
     int r;
 
-    // Reset XML parser state
-    XML_ParserReset(io->xml, NULL);
-    XML_SetUserData(io->xml, io);
-    XML_SetElementHandler(io->xml, http_io_xml_elem_start, end_handler);
-    XML_SetCharacterDataHandler(io->xml, http_io_xml_text);
+    // Initialize I/O info
+    http_io_init_io(priv, &io, HTTP_PUT, urlbuf);
+    io.src = data;
+    io.buf_size = len;
+
+    // Construct URL for the object
+    http_io_get_meta_file_url(urlbuf, sizeof(urlbuf), config, name);
 
     // Add Date header
-    http_io_add_date(priv, io, now);
+    http_io_add_date(priv, &io, now);
+
+    // Add Content-Type header
+    io.headers = http_io_add_header(priv, io.headers, "%s: %s", CTYPE_HEADER, mime_type);
+
+    // Add Content-MD5 header
+    MD5(data, len, md5);
+    http_io_base64_encode(md5buf, sizeof(md5buf), md5, MD5_DIGEST_LENGTH);
+    io.headers = http_io_add_header(priv, io.headers, "%s: %s", MD5_HEADER, md5buf);
+
+    // Add ACL header
+    io.headers = http_io_add_header(priv, io.headers, "%s: %s", ACL_HEADER, config->accessType);
+
+    // Add Server Side Encryption header(s) (if needed)
+    if (config->sse != NULL) {
+        io.headers = http_io_add_header(priv, io.headers, "%s: %s", SSE_HEADER, config->sse);
+        if (strcmp(config->sse, SSE_AWS_KMS) == 0)
+            io.headers = http_io_add_header(priv, io.headers, "%s: %s", SSE_KEY_ID_HEADER, config->sse_key_id);
+    }
+
+    // Add storage class header (if needed)
+    if (config->storage_class != NULL)
+        io.headers = http_io_add_header(priv, io.headers, "%s: %s", STORAGE_CLASS_HEADER, config->storage_class);
 
     // Add Authorization header
-    if ((r = http_io_add_auth(priv, io, now, NULL, 0)) != 0)
-        return r;
+    if ((r = http_io_add_auth(priv, &io, now, io.src, io.buf_size)) != 0)
+        goto done;
 
     // Perform operation
-    r = http_io_perform_io(priv, io, http_io_xml_prepper);
+    r = http_io_perform_io(priv, &io, http_io_write_prepper);
 
-    // Clean up headers
-    curl_slist_free_all(io->headers);
-    io->headers = NULL;
+done:
+    //  Clean up
+    curl_slist_free_all(io.headers);
+    return r;
+}
 
-    // Check for error from curl
-    if (r != 0)
-        return r;
+/*
+ * Delete a non-block object. It's not an error if the object doesn't exist.
+ */
+static int
+http_io_delete_object(struct http_io_private *priv, const char *name)
+{
+    struct http_io_conf *const config = priv->config;
+    char urlbuf[URL_BUF_SIZE(config) + strlen(name)];
+    const time_t now = time(NULL);
+    struct http_io io;
+    int r;
 
-    // Check for error from handlers
-    if ((r = io->handler_error) != 0)
-        return r;
+    // Initialize I/O info
+    http_io_init_io(priv, &io, HTTP_DELETE, urlbuf);
 
-    // Finalize parse (if not already busted)
-    if (io->xml_error == XML_ERROR_NONE && XML_Parse(io->xml, NULL, 0, 1) != XML_STATUS_OK) {
-        io->xml_error = XML_GetErrorCode(io->xml);
-        io->xml_error_line = XML_GetCurrentLineNumber(io->xml);
-        io->xml_error_column = XML_GetCurrentColumnNumber(io->xml);
-    }
+    // Construct URL for the object
+    http_io_get_meta_file_url(urlbuf, sizeof(urlbuf), config, name);
 
-    // Check for XML error
-    if (io->xml_error != XML_ERROR_NONE) {
-        (*config->log)(LOG_ERR, "XML parse error: line %d col %d: %s",
-          io->xml_error_line, io->xml_error_column, XML_ErrorString(io->xml_error));
+    // Add Date header
+    http_io_add_date(priv, &io, now);
+
+    // Add Authorization header
+    if ((r = http_io_add_auth(priv, &io, now, NULL, 0)) != 0)
+        goto done;
+
+    // Perform operation; a missing object is not an error, even if the server reports one
+    if ((r = http_io_perform_io(priv, &io, http_io_write_prepper)) == ENOENT)
+        r = 0;
+
+done:
+    //  Clean up
+    curl_slist_free_all(io.headers);
+    return r;
+}
+
+static int
+http_io_verify_etag_provided(struct http_io *const io)
+{
+    if (memcmp(io->etag, zero_etag, MD5_DIGEST_LENGTH) == 0) {
+        (*io->config->log)(LOG_ERR, "%s %s: missing %s header in response", io->method, io->url, ETAG_HEADER);
         return EIO;
     }
-
-    // Done
     return 0;
 }
 
 static void
-http_io_xml_io_destroy(struct http_io_private *const priv, struct http_io *io)
+http_io_write_prepper(CURL *curl, struct http_io *io)
 {
-    if (io->xml != NULL) {
-        XML_ParserFree(io->xml);
-        io->xml = NULL;
+    memset(&io->bufs, 0, sizeof(io->bufs));
+    if (io->src != NULL) {
+        io->bufs.wrremain = io->buf_size;
+        io->bufs.wrdata = io->src;
     }
-    free(io->xml_path);
-    io->xml_path = NULL;
-    free(io->xml_text);
-    io->xml_text = NULL;
+    curl_easy_setopt(curl, CURLOPT_READFUNCTION, http_io_curl_writer);
+    curl_easy_setopt(curl, CURLOPT_READDATA, io);
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, http_io_curl_reader);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, io);
+    curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, http_io_curl_header);
+    curl_easy_setopt(curl, CURLOPT_HEADERDATA, io);
+    if (io->src != NULL) {
+        curl_easy_setopt(curl, CURLOPT_UPLOAD, 1);
+        curl_easy_setopt(curl, CURLOPT_INFILESIZE_LARGE, (curl_off_t)io->buf_size);
+    }
+    curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, io->method);
+    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, io->headers);
+    http_io_curl_header_reset(io);
 }
 
 /*
- * Perform HTTP operation.
+ * Answer from the non-zero block bitmap, if we have one.
  */
 static int
-http_io_perform_io(struct http_io_private *priv, struct http_io *io, http_io_curl_prepper_t *prepper)
+http_io_block_status(struct s3backer_store *s3b, s3b_block_t block_num, u_int num_blocks, int *zerop, u_int *countp)
 {
+    struct http_io_private *const priv = s3b->data;
     struct http_io_conf *const config = priv->config;
-    struct timespec delay;
-    CURLcode curl_code;
-    u_int retry_pause = 0;
-    u_int total_pause;
-    long http_code;
-    double clen;
-    int attempt;
-    CURL *curl;
+    s3b_block_t next;
 
-    // Debug
-    if (config->debug)
-        (*config->log)(LOG_DEBUG, "%s %s", io->method, io->url);
+    pthread_mutex_lock(&priv->mutex);
+    if (priv->non_zero == NULL) {
+        CHECK_RETURN(pthread_mutex_unlock(&priv->mutex));
+        return generic_block_status(s3b, block_num, num_blocks, zerop, countp);
+    }
+    *zerop = !bitmap_test(priv->non_zero, block_num);
+    next = bitmap_find_next(priv->non_zero, config->num_blocks, block_num, *zerop);
+    CHECK_RETURN(pthread_mutex_unlock(&priv->mutex));
+    *countp = next - block_num < num_blocks ? next - block_num : num_blocks;
+    return 0;
+}
+
+static int
+http_io_bulk_zero(struct s3backer_store *const s3b, const s3b_block_t *block_nums, u_int num_blocks)
+{
+    struct http_io_private *const priv = s3b->data;
+    struct http_io_conf *const config = priv->config;
+    char urlbuf[URL_BUF_SIZE(config)];
+    size_t max_object_name;
+    struct http_io io;
+    char *buf = NULL;
+    int r;
+
+    // Set URL
+    snvprintf(urlbuf, sizeof(urlbuf), "%s?delete", config->vhostURL);
+
+    // Initialize XML query
+    if ((r = http_io_xml_io_init(priv, &io, HTTP_POST, urlbuf)) != 0)
+        return r;
+
+    // Calculate the maximum length of one object name
+    max_object_name = strlen(config->prefix) + S3B_BLOCK_NUM_DIGITS
+      + strlen(BLOCK_HASH_PREFIX_SEPARATOR) + S3B_BLOCK_NUM_DIGITS + 1;           // [PREFIX]([HASH][SEPARATOR])?[BLOCK]
+
+    // Delete blocks in chunks of DELETE_BLOCKS_CHUNK
+    while (num_blocks > 0) {
+        const int count = num_blocks <= DELETE_BLOCKS_CHUNK ? num_blocks : DELETE_BLOCKS_CHUNK;
+        size_t max_object_elem;
+        size_t max_payload;
+        size_t payload_len;
+        char *new_buf;
+        u_int i;
+
+        // Calculate upper bound on size of query payload
+        max_object_elem = strlen(DELETE_ELEM_OBJECT) + 2                                            // <Object>
+          + strlen(DELETE_ELEM_KEY) + 2 + max_object_name + strlen(DELETE_ELEM_KEY) + 3             //   <Key>xxx</Key>
+          + strlen(DELETE_ELEM_OBJECT) + 3;                                                         // </Object>
+        max_payload = strlen(DELETE_ELEM_DELETE) + 2                                                // <Delete>
+          + (count * max_object_elem)                                                               //   <Object>...
+          + strlen(DELETE_ELEM_DELETE) + 3                                                          // </Delete>
+          + 2;                                                                                      // nul byte, plus one extra
+
+        // Allocate buffer
+        if ((new_buf = realloc(buf, max_payload)) == NULL) {
+            r = errno;
+            (*config->log)(LOG_ERR, "realloc: %s", strerror(r));
+            break;
+        }
+        buf = new_buf;
+
+        // Build XML payload
+        payload_len = snvprintf(buf, max_payload, "<%s>", DELETE_ELEM_DELETE);
+        for (i = 0; i < count; i++) {
+            const s3b_block_t block_num = block_nums[i];
+            char block_hash_buf[S3B_BLOCK_NUM_DIGITS + strlen(BLOCK_HASH_PREFIX_SEPARATOR) + 1];
+            char object_buf[max_object_name + 1];
+
+            http_io_format_block_hash(config->blockHashPrefix, block_hash_buf, sizeof(block_hash_buf), block_num);
+            snvprintf(object_buf, sizeof(object_buf), "%s%s%0*jx",
+              config->prefix, block_hash_buf, S3B_BLOCK_NUM_DIGITS, (uintmax_t)block_num);
+            payload_len += snvprintf(buf + payload_len, max_payload - payload_len, "<%s><%s>%s</%s></%s>",
+              DELETE_ELEM_OBJECT, DELETE_ELEM_KEY, object_buf, DELETE_ELEM_KEY, DELETE_ELEM_OBJECT);
+        }
+        payload_len += snvprintf(buf + payload_len, max_payload - payload_len, "</%s>", DELETE_ELEM_DELETE);
+
+        // Initialize buffer
+        io.bufs.wrdata = buf;
+        io.bufs.wrremain = payload_len;
+
+        // Perform operation
+        if ((r = http_io_xml_io_exec(priv, &io, http_io_bulk_delete_elem_end)) != 0)
+            break;
+
+        // Advance
+        block_nums += count;
+        num_blocks -= count;
+    }
+
+    // Done
+    http_io_xml_io_destroy(priv, &io);
+    free(buf);
+    return r;
+}
+
+static void
+http_io_bulk_delete_elem_end(void *arg, const XML_Char *name)
+{
+    struct http_io *const io = (struct http_io *)arg;
+    struct http_io_conf *const config = io->config;
+    char **copy_ptr = NULL;
+
+    // If we are in an error state, just bail
+    if (io->xml_error != XML_ERROR_NONE || io->handler_error != 0)
+        return;
+
+    // Handle <DeleteResult>/<Error>/<Foo> tags
+    if (strcmp(io->xml_path, "/" DELETE_ELEM_DELETE_RESULT "/" DELETE_ELEM_ERROR "/" DELETE_ELEM_KEY) == 0)
+        copy_ptr = &io->bulk_delete_err_key;
+    else if (strcmp(io->xml_path, "/" DELETE_ELEM_DELETE_RESULT "/" DELETE_ELEM_ERROR "/" DELETE_ELEM_CODE) == 0)
+        copy_ptr = &io->bulk_delete_err_code;
+    else if (strcmp(io->xml_path, "/" DELETE_ELEM_DELETE_RESULT "/" DELETE_ELEM_ERROR "/" DELETE_ELEM_MESSAGE) == 0)
+        copy_ptr = &io->bulk_delete_err_msg;
+    if (copy_ptr != NULL) {
+        free(*copy_ptr);
+        if ((*copy_ptr = strdup(io->xml_text)) == NULL) {
+            io->handler_error = errno;
+            (*config->log)(LOG_ERR, "strdup: %s", strerror(errno));
+        }
+        goto done;
+    }
+
+    // Handle end of <DeleteResult>/<Error>
+    if (strcmp(io->xml_path, "/" DELETE_ELEM_DELETE_RESULT "/" DELETE_ELEM_ERROR) == 0) {
+        (*config->log)(LOG_ERR, "bulk delete error: key=\"%s\" code=\"%s\" message=\"%s\"",
+          io->bulk_delete_err_key != NULL ? io->bulk_delete_err_key : "(none)",
+          io->bulk_delete_err_code != NULL ? io->bulk_delete_err_code : "(none)",
+          io->bulk_delete_err_msg != NULL ? io->bulk_delete_err_msg : "(none)");
+        io->handler_error = EIO;
+        goto done;
+    }
+
+done:
+    // Update current XML path
+    assert(strrchr(io->xml_path, '/') != NULL);
+    *strrchr(io->xml_path, '/') = '\0';
+
+    // Reset text buffer
+    io->xml_text[0] = '\0';
+}
+
+static int
+http_io_xml_io_init(struct http_io_private *const priv, struct http_io *io, const char *method, char *url)
+{
+    struct http_io_conf *const config = priv->config;
+    int r;
+
+    // Initialize I/O info
+    http_io_init_io(priv, io, method, url);
+    io->xml_error = XML_ERROR_NONE;
+
+    // Create XML parser
+    if ((io->xml = XML_ParserCreate(NULL)) == NULL) {
+        (*config->log)(LOG_ERR, "failed to create XML parser");
+        r = ENOMEM;
+        goto fail;
+    }
+
+    // Allocate buffers for XML path and tag text content
+    if ((io->xml_text = calloc(1, 1)) == NULL) {
+        (*config->log)(LOG_ERR, "calloc: %s", strerror(errno));
+        goto fail;
+    }
+    if ((io->xml_path = calloc(1, 1)) == NULL) {
+        (*config->log)(LOG_ERR, "calloc: %s", strerror(errno));
+        goto fail;
+    }
+
+    // OK
+    return 0;
+
+fail:
+    // Update stats
+    if (r == ENOMEM)
+        ATOMIC_ADD(priv->stats.out_of_memory_errors, 1);
+
+    // Cleanup
+    http_io_xml_io_destroy(priv, io);
+    return r;
+}
+
+static int
+http_io_xml_io_exec(struct http_io_private *const priv, struct http_io *io, void (*end_handler)(void *arg, const XML_Char *name))
+{
+    struct http_io_conf *const config = priv->config;
+    const time_t now = time(NULL);
+    int r;
+
+    // Reset XML parser state
+    XML_ParserReset(io->xml, NULL);
+    XML_SetUserData(io->xml, io);
+    XML_SetElementHandler(io->xml, http_io_xml_elem_start, end_handler);
+    XML_SetCharacterDataHandler(io->xml, http_io_xml_text);
+
+    // Add Date header
+    http_io_add_date(priv, io, now);
+
+    // Add Authorization header
+    if ((r = http_io_add_auth(priv, io, now, NULL, 0)) != 0)
+        return r;
+
+    // Perform operation
+    r = http_io_perform_io(priv, io, http_io_xml_prepper);
+
+    // Clean up headers
+    curl_slist_free_all(io->headers);
+    io->headers = NULL;
+
+    // Check for error from curl
+    if (r != 0)
+        return r;
+
+    // Check for error from handlers
+    if ((r = io->handler_error) != 0)
+        return r;
+
+    // Finalize parse (if not already busted)
+    if (io->xml_error == XML_ERROR_NONE && XML_Parse(io->xml, NULL, 0, 1) != XML_STATUS_OK) {
+        io->xml_error = XML_GetErrorCode(io->xml);
+        io->xml_error_line = XML_GetCurrentLineNumber(io->xml);
+        io->xml_error_column = XML_GetCurrentColumnNumber(io->xml);
+    }
+
+    // Check for XML error
+    if (io->xml_error != XML_ERROR_NONE) {
+        (*config->log)(LOG_ERR, "XML parse error: line %d col %d: %s",
+          io->xml_error_line, io->xml_error_column, XML_ErrorString(io->xml_error));
+        return EIO;
+    }
+
+    // Done
+    return 0;
+}
+
+static void
+http_io_xml_io_destroy(struct http_io_private *const priv, struct http_io *io)
+{
+    if (io->xml != NULL) {
+        XML_ParserFree(io->xml);
+        io->xml = NULL;
+    }
+    free(io->xml_path);
+    io->xml_path = NULL;
+    free(io->xml_text);
+    io->xml_text = NULL;
+}
+
+/*
+ * Perform HTTP operation.
+ */
+static int
+http_io_perform_io(struct http_io_private *priv, struct http_io *io, http_io_curl_prepper_t *prepper)
+{
+    struct http_io_conf *const config = priv->config;
+    CURLcode curl_code;
+    u_int retry_pause = 0;
+    u_int total_pause;
+    int attempt;
+    CURL *curl;
+    int r;
+
+    // Debug
+    if (config->debug)
+        (*config->log)(LOG_DEBUG, "%s %s", io->method, io->url);
+
+    // Make attempts
+    for (attempt = 0, total_pause = 0; 1; attempt++, total_pause += retry_pause) {
+
+        // Acquire and initialize CURL instance
+        if ((curl = http_io_start_attempt(priv, io, prepper, attempt)) == NULL)
+            return EIO;
+
+        // Perform HTTP operation
+        io->curl = curl;
+        curl_code = http_io_transfer(priv, curl);
+        io->curl = NULL;
+
+        // Check result
+        if ((r = http_io_finish_attempt(priv, io, curl, curl_code, total_pause)) != -1)
+            return r;
+
+        // Retry with exponential backoff up to max total pause limit
+        if (!http_io_retry_pause(priv, &retry_pause, total_pause))
+            break;
+    }
+
+    // Give up
+    (*config->log)(LOG_ERR, "giving up on: %s %s", io->method, io->url);
+    return EIO;
+}
+
+/*
+ * Perform several HTTP operations concurrently via the asynchronous engine.
+ *
+ * The outcome of each operation is stored in the corresponding "results" slot.
+ */
+static void
+http_io_perform_ios(struct http_io_private *priv, struct http_io **ios, int *results, u_int num_ios,
+  http_io_curl_prepper_t *prepper)
+{
+    struct http_io_conf *const config = priv->config;
+    struct http_io_batch batch;
+    struct http_io_async *reqs;
+    u_int retry_pause = 0;
+    u_int total_pause;
+    int num_retry;
+    int attempt;
+    u_int i;
+    int r;
+
+    // Allocate transfer structures; if we can't, fall back to doing one at a time
+    if ((reqs = calloc(num_ios, sizeof(*reqs))) == NULL
+      || (r = pthread_cond_init(&batch.done, NULL)) != 0) {
+        free(reqs);
+        for (i = 0; i < num_ios; i++)
+            results[i] = http_io_perform_io(priv, ios[i], prepper);
+        return;
+    }
+    batch.priv = priv;
+    batch.remaining = 0;
+
+    // Debug
+    for (i = 0; i < num_ios; i++) {
+        if (config->debug)
+            (*config->log)(LOG_DEBUG, "%s %s", ios[i]->method, ios[i]->url);
+        results[i] = -1;
+    }
+
+    // Make attempts
+    for (attempt = 0, total_pause = 0; 1; attempt++, total_pause += retry_pause) {
+
+        // Start transfers for all operations that are not yet finished
+        for (i = 0; i < num_ios; i++) {
+            struct http_io_async *const req = &reqs[i];
+
+            req->curl = NULL;
+            if (results[i] != -1)
+                continue;
+            if ((req->curl = http_io_start_attempt(priv, ios[i], prepper, attempt)) == NULL) {
+                results[i] = EIO;
+                continue;
+            }
+            ios[i]->curl = req->curl;
+            req->done = http_io_batch_done;
+            req->done_arg = &batch;
+            pthread_mutex_lock(&priv->mutex);
+            batch.remaining++;
+            CHECK_RETURN(pthread_mutex_unlock(&priv->mutex));
+            (void)http_io_limit_acquire(priv, &req->limit_gen, 1);
+            if (http_io_async_submit(priv, req) != 0) {
+                req->curl_code = curl_easy_perform(req->curl);
+                http_io_batch_done(req);
+            }
+        }
+
+        // Wait for all of them to complete
+        pthread_mutex_lock(&priv->mutex);
+        while (batch.remaining > 0)
+            pthread_cond_wait(&batch.done, &priv->mutex);
+        CHECK_RETURN(pthread_mutex_unlock(&priv->mutex));
+
+        // Check results
+        num_retry = 0;
+        for (i = 0; i < num_ios; i++) {
+            struct http_io_async *const req = &reqs[i];
+
+            if (req->curl == NULL)
+                continue;
+            ios[i]->curl = NULL;
+            if ((results[i] = http_io_finish_attempt(priv, ios[i], req->curl, req->curl_code, total_pause)) == -1)
+                num_retry++;
+        }
+        if (num_retry == 0)
+            goto done;
+
+        // Retry with exponential backoff up to max total pause limit
+        if (!http_io_retry_pause(priv, &retry_pause, total_pause))
+            break;
+    }
+
+    // Give up on whatever is left
+    for (i = 0; i < num_ios; i++) {
+        if (results[i] == -1) {
+            (*config->log)(LOG_ERR, "giving up on: %s %s", ios[i]->method, ios[i]->url);
+            results[i] = EIO;
+        }
+    }
+
+done:
+    // Clean up
+    pthread_cond_destroy(&batch.done);
+    free(reqs);
+}
+
+/*
+ * Acquire and initialize a CURL instance for the next attempt at an HTTP operation.
+ */
+static CURL *
+http_io_start_attempt(struct http_io_private *priv, struct http_io *io, http_io_curl_prepper_t *prepper, int attempt)
+{
+    struct http_io_conf *const config = priv->config;
+    CURL *curl;
+
+    // Acquire and initialize CURL instance
+    if ((curl = http_io_acquire_curl(priv, io)) == NULL)
+        return NULL;
+    (*prepper)(curl, io);
+
+    // Reset error payload capture
+    io->http_status = 0;
+    assert(io->error_payload == NULL);
+    assert(io->error_payload_len == 0);
+
+    // Log retries
+    if (attempt > 0)
+        (*config->log)(LOG_INFO, "retrying query (attempt #%d): %s %s", attempt + 1, io->method, io->url);
+    return curl;
+}
+
+/*
+ * Check the result of one attempt at an HTTP operation, and release the CURL instance.
+ *
+ * Returns zero or a (positive) errno value if the operation is done, or -1 if it should be retried.
+ */
+static int
+http_io_finish_attempt(struct http_io_private *priv, struct http_io *io, CURL *curl, CURLcode curl_code, u_int total_pause)
+{
+    struct http_io_conf *const config = priv->config;
+    long http_code;
+    double clen;
+    int r = 0;
+
+    // Find out what the HTTP result code was (if any)
+    switch (curl_code) {
+    case CURLE_HTTP_RETURNED_ERROR:                         // should never happen (we no longer use CURLOPT_FAILONERROR)
+    case 0:
+        if (curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &http_code) != 0)
+            http_code = 999;                                // this should never happen
+        break;
+    default:
+        http_code = -1;
+        break;
+    }
+
+    // Trace request
+    if (priv->trace != NULL)
+        http_io_trace_record(priv, io, curl, curl_code, http_code);
+
+    // Pretend like the CURLOPT_FAILONERROR option was used
+    if (curl_code == 0 && http_code >= HTTP_STATUS_ERROR_MINIMUM)
+        curl_code = CURLE_HTTP_RETURNED_ERROR;
+
+    // In the case of a DELETE, treat an HTTP_NOT_FOUND error as successful
+    if (curl_code == CURLE_HTTP_RETURNED_ERROR
+      && http_code == HTTP_NOT_FOUND
+      && strcmp(io->method, HTTP_DELETE) == 0)
+        curl_code = 0;
+
+    // Handle success
+    if (curl_code == 0) {
+        double curl_time;
+
+        // Discard any error payload (e.g., 404 Not Found from DELETE)
+        http_io_free_error_payload(io);
 
-    // Make attempts
-    for (attempt = 0, total_pause = 0; 1; attempt++, total_pause += retry_pause) {
+        // Extra debug logging
+        if (config->debug)
+            (*config->log)(LOG_DEBUG, "success: %s %s", io->method, io->url);
 
-        // Acquire and initialize CURL instance
-        if ((curl = http_io_acquire_curl(priv, io)) == NULL)
-            return EIO;
-        (*prepper)(curl, io);
+        // Extract timing info
+        if ((curl_code = curl_easy_getinfo(curl, CURLINFO_TOTAL_TIME, &curl_time)) != CURLE_OK) {
+            (*config->log)(LOG_ERR, "can't get cURL timing: %s", curl_easy_strerror(curl_code));
+            curl_time = 0.0;
+        }
+
+        // Extract content-length (if required)
+        if (io->content_lengthp != NULL) {
+            if ((curl_code = curl_easy_getinfo(curl, CURLINFO_CONTENT_LENGTH_DOWNLOAD, &clen)) == CURLE_OK)
+                *io->content_lengthp = (u_int)clen;
+            else {
+                (*config->log)(LOG_ERR, "can't get content-length: %s", curl_easy_strerror(curl_code));
+                r = ENXIO;
+            }
+        }
 
-        // Reset error payload capture
-        io->http_status = 0;
-        assert(io->error_payload == NULL);
-        assert(io->error_payload_len == 0);
+        // Update stats
+        pthread_mutex_lock(&priv->mutex);
+        if (strcmp(io->method, HTTP_GET) == 0) {
+            priv->stats.http_gets.count++;
+            priv->stats.http_gets.time += curl_time;
+            latency_hist_record(&priv->stats.http_gets.latency, (uint64_t)(curl_time * 1000000.0));
+            if (config->read_hedge != 0 && io->xml == NULL)
+                http_io_hedge_sample(priv, curl_time);
+        } else if (strcmp(io->method, HTTP_PUT) == 0) {
+            priv->stats.http_puts.count++;
+            priv->stats.http_puts.time += curl_time;
+            latency_hist_record(&priv->stats.http_puts.latency, (uint64_t)(curl_time * 1000000.0));
+            if (priv->comp_adapt != NULL)
+                comp_adapt_uploaded(priv->comp_adapt, curl_time);
+        } else if (strcmp(io->method, HTTP_DELETE) == 0) {
+            priv->stats.http_deletes.count++;
+            priv->stats.http_deletes.time += curl_time;
+            latency_hist_record(&priv->stats.http_deletes.latency, (uint64_t)(curl_time * 1000000.0));
+        } else if (strcmp(io->method, HTTP_HEAD) == 0) {
+            priv->stats.http_heads.count++;
+            priv->stats.http_heads.time += curl_time;
+            latency_hist_record(&priv->stats.http_heads.latency, (uint64_t)(curl_time * 1000000.0));
+        }
+        CHECK_RETURN(pthread_mutex_unlock(&priv->mutex));
 
-        // Perform HTTP operation and check result
-        if (attempt > 0)
-            (*config->log)(LOG_INFO, "retrying query (attempt #%d): %s %s", attempt + 1, io->method, io->url);
-        io->curl = curl;
-        curl_code = curl_easy_perform(curl);
-        io->curl = NULL;
+        // Done
+        http_io_release_curl(priv, &curl, r == 0);
+        return r;
+    }
+
+    // Free the curl handle (and ensure we don't try to re-use it)
+    http_io_release_curl(priv, &curl, 0);
 
-        // Find out what the HTTP result code was (if any)
+    // Handle errors
+    switch (curl_code) {
+    case CURLE_ABORTED_BY_CALLBACK:
+        if (config->debug)
+            (*config->log)(LOG_DEBUG, "write aborted: %s %s", io->method, io->url);
+        ATOMIC_ADD(priv->stats.http_canceled_writes, 1);
+        http_io_free_error_payload(io);
+        return ECONNABORTED;
+    case CURLE_OPERATION_TIMEDOUT:
+        (*config->log)(LOG_NOTICE, "operation timeout: %s %s", io->method, io->url);
+        ATOMIC_ADD(priv->stats.curl_timeouts, 1);
+        break;
+    case CURLE_HTTP_RETURNED_ERROR:                 // special handling for some specific HTTP codes
+        switch (http_code) {
+        case HTTP_NOT_FOUND:
+            if (config->debug)
+                (*config->log)(LOG_DEBUG, "rec'd %ld response: %s %s", http_code, io->method, io->url);
+            http_io_free_error_payload(io);
+            return ENOENT;
+        case HTTP_UNAUTHORIZED:
+            (*config->log)(LOG_ERR, "rec'd %ld response: %s %s", http_code, io->method, io->url);
+            ATOMIC_ADD(priv->stats.http_unauthorized, 1);
+            http_io_log_error_payload(io);
+            http_io_free_error_payload(io);
+            return EACCES;
+        case HTTP_FORBIDDEN:
+            (*config->log)(LOG_ERR, "rec'd %ld response: %s %s", http_code, io->method, io->url);
+            ATOMIC_ADD(priv->stats.http_forbidden, 1);
+            http_io_log_error_payload(io);
+            http_io_free_error_payload(io);
+            return EPERM;
+        case HTTP_PRECONDITION_FAILED:
+            (*config->log)(LOG_INFO, "rec'd stale content: %s %s", io->method, io->url);
+            ATOMIC_ADD(priv->stats.http_stale, 1);
+            break;
+        case HTTP_MOVED_PERMANENTLY:
+        case HTTP_FOUND:
+        case HTTP_TEMPORARY_REDIRECT:
+        case HTTP_PERMANENT_REDIRECT:
+            (*config->log)(LOG_ERR, "rec'd %ld redirect: %s %s", http_code, io->method, io->url);
+            (*config->log)(LOG_ERR, "hint: you may need the \"--vhost\" and/or \"--region\" flags");
+            ATOMIC_ADD(priv->stats.http_redirect, 1);
+            break;
+        case HTTP_NOT_MODIFIED:
+            if (io->expect_304) {
+                if (config->debug)
+                    (*config->log)(LOG_DEBUG, "rec'd %ld response: %s %s", http_code, io->method, io->url);
+                return EEXIST;
+            }
+            // FALLTHROUGH
+        default:
+            (*config->log)(LOG_ERR, "rec'd %ld response: %s %s", http_code, io->method, io->url);
+            pthread_mutex_lock(&priv->mutex);
+            switch (http_code / 100) {
+            case 3:
+                priv->stats.http_3xx_error++;
+                break;
+            case 4:
+                priv->stats.http_4xx_error++;
+                break;
+            case 5:
+                priv->stats.http_5xx_error++;
+                break;
+            default:
+                priv->stats.http_other_error++;
+                break;
+            }
+            CHECK_RETURN(pthread_mutex_unlock(&priv->mutex));
+            http_io_log_error_payload(io);
+            break;
+        }
+        break;
+    default:
+        (*config->log)(LOG_ERR, "operation failed: %s (%s)", curl_easy_strerror(curl_code),
+          total_pause >= config->max_retry_pause ? "final attempt" : "will retry");
+        pthread_mutex_lock(&priv->mutex);
         switch (curl_code) {
-        case CURLE_HTTP_RETURNED_ERROR:                         // should never happen (we no longer use CURLOPT_FAILONERROR)
-        case 0:
-            if (curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &http_code) != 0)
-                http_code = 999;                                // this should never happen
+        case CURLE_OUT_OF_MEMORY:
+            priv->stats.curl_out_of_memory++;
+            break;
+        case CURLE_COULDNT_CONNECT:
+            priv->stats.curl_connect_failed++;
+            break;
+        case CURLE_COULDNT_RESOLVE_HOST:
+            priv->stats.curl_host_unknown++;
             break;
         default:
-            http_code = -1;
+            priv->stats.curl_other_error++;
             break;
         }
+        CHECK_RETURN(pthread_mutex_unlock(&priv->mutex));
+        break;
+    }
 
-        // Pretend like the CURLOPT_FAILONERROR option was used
-        if (curl_code == 0 && http_code >= HTTP_STATUS_ERROR_MINIMUM)
-            curl_code = CURLE_HTTP_RETURNED_ERROR;
+    // Free any error payload
+    http_io_free_error_payload(io);
 
-        // In the case of a DELETE, treat an HTTP_NOT_FOUND error as successful
-        if (curl_code == CURLE_HTTP_RETURNED_ERROR
-          && http_code == HTTP_NOT_FOUND
-          && strcmp(io->method, HTTP_DELETE) == 0)
-            curl_code = 0;
+    // Retry
+    return -1;
+}
 
-        // Handle success
-        if (curl_code == 0) {
-            double curl_time;
-            int r = 0;
+/*
+ * Compute the next exponential backoff retry pause and sleep for that long.
+ *
+ * Returns zero if we have already paused for the maximum total time and should give up.
+ */
+static int
+http_io_retry_pause(struct http_io_private *priv, u_int *retry_pausep, u_int total_pause)
+{
+    struct http_io_conf *const config = priv->config;
+    u_int retry_pause = *retry_pausep;
+    struct timespec delay;
 
-            // Discard any error payload (e.g., 404 Not Found from DELETE)
-            http_io_free_error_payload(io);
+    // Have we paused long enough already?
+    if (total_pause >= config->max_retry_pause)
+        return 0;
 
-            // Extra debug logging
-            if (config->debug)
-                (*config->log)(LOG_DEBUG, "success: %s %s", io->method, io->url);
+    // Pause with exponential backoff, up to max total pause limit
+    retry_pause = retry_pause > 0 ? retry_pause * 2 : config->initial_retry_pause;
+    if (total_pause + retry_pause > config->max_retry_pause)
+        retry_pause = config->max_retry_pause - total_pause;
+    *retry_pausep = retry_pause;
 
-            // Extract timing info
-            if ((curl_code = curl_easy_getinfo(curl, CURLINFO_TOTAL_TIME, &curl_time)) != CURLE_OK) {
-                (*config->log)(LOG_ERR, "can't get cURL timing: %s", curl_easy_strerror(curl_code));
-                curl_time = 0.0;
-            }
+    // With the adaptive limit, add jitter so threads throttled together don't all retry together
+    if (config->request_limit != 0 && retry_pause > 1)
+        retry_pause = retry_pause / 2 + (u_int)(random() % (retry_pause / 2 + 1));
+    delay.tv_sec = retry_pause / 1000;
+    delay.tv_nsec = (retry_pause % 1000) * 1000000;
+    nanosleep(&delay, NULL);            // TODO: check for EINTR
 
-            // Extract content-length (if required)
-            if (io->content_lengthp != NULL) {
-                if ((curl_code = curl_easy_getinfo(curl, CURLINFO_CONTENT_LENGTH_DOWNLOAD, &clen)) == CURLE_OK)
-                    *io->content_lengthp = (u_int)clen;
-                else {
-                    (*config->log)(LOG_ERR, "can't get content-length: %s", curl_easy_strerror(curl_code));
-                    r = ENXIO;
-                }
-            }
+    // Update retry stats
+    pthread_mutex_lock(&priv->mutex);
+    priv->stats.num_retries++;
+    priv->stats.retry_delay += retry_pause;
+    CHECK_RETURN(pthread_mutex_unlock(&priv->mutex));
+    return 1;
+}
+
+/*
+ * Record a just-completed attempt in the trace buffer.
+ */
+static void
+http_io_trace_record(struct http_io_private *priv, struct http_io *io, CURL *curl, CURLcode curl_code, long http_code)
+{
+    struct http_io_conf *const config = priv->config;
+    struct http_io_trace *const entry = &priv->trace[(ATOMIC_ADD(priv->trace_next, 1) - 1) % config->trace_size];
+    const char *object;
+    double curl_time;
+
+    gettimeofday(&entry->when, NULL);
+    if (curl_easy_getinfo(curl, CURLINFO_TOTAL_TIME, &curl_time) != CURLE_OK)
+        curl_time = 0.0;
+    entry->micros = (u_int)(curl_time * 1000000.0);
+    entry->method = io->method;
+    object = (object = strrchr(io->url, '/')) != NULL ? object + 1 : io->url;
+    strncpy(entry->object, object, sizeof(entry->object) - 1);
+    entry->object[sizeof(entry->object) - 1] = '\0';
+    entry->http_code = (int)http_code;
+    entry->curl_code = (int)curl_code;
+}
+
+/*
+ * Perform one HTTP transfer, via the asynchronous engine if it's running, otherwise directly.
+ */
+static CURLcode
+http_io_transfer(struct http_io_private *priv, CURL *curl)
+{
+    struct http_io_batch batch;
+    struct http_io_async req;
+    CURLcode curl_code;
+
+    // Wait until we're allowed to start
+    memset(&req, 0, sizeof(req));
+    (void)http_io_limit_acquire(priv, &req.limit_gen, 1);
+
+    // Is the asynchronous engine running?
+    if (priv->multi == NULL || pthread_cond_init(&batch.done, NULL) != 0)
+        goto direct;
+
+    // Submit the transfer
+    req.curl = curl;
+    req.done = http_io_batch_done;
+    req.done_arg = &batch;
+    batch.priv = priv;
+    batch.remaining = 1;
+    if (http_io_async_submit(priv, &req) != 0) {
+        pthread_cond_destroy(&batch.done);
+        goto direct;
+    }
+
+    // Wait for it to complete
+    pthread_mutex_lock(&priv->mutex);
+    while (batch.remaining > 0)
+        pthread_cond_wait(&batch.done, &priv->mutex);
+    CHECK_RETURN(pthread_mutex_unlock(&priv->mutex));
+    pthread_cond_destroy(&batch.done);
+    return req.curl_code;
+
+direct:
+    // Do it in this thread
+    curl_code = curl_easy_perform(curl);
+    http_io_limit_release(priv, req.limit_gen, curl, curl_code);
+    return curl_code;
+}
+
+/*
+ * Account for a request about to start, first waiting until the adaptive concurrency limit (if any) allows it.
+ * If "wait" is zero and the limit has been reached, don't wait; return EAGAIN instead.
+ *
+ * On success, returns zero and sets *genp to the value to pass to http_io_limit_release() when the request completes.
+ */
+static int
+http_io_limit_acquire(struct http_io_private *priv, u_int *genp, int wait)
+{
+    struct http_io_conf *const config = priv->config;
+
+    *genp = 0;
+    if (config->request_limit == 0)
+        return 0;
+    pthread_mutex_lock(&priv->mutex);
+    while (priv->limit_active >= (u_int)priv->limit) {
+        if (!wait) {
+            CHECK_RETURN(pthread_mutex_unlock(&priv->mutex));
+            return EAGAIN;
+        }
+        pthread_cond_wait(&priv->limit_slot, &priv->mutex);
+    }
+    priv->limit_active++;
+    *genp = priv->limit_gen++;
+    CHECK_RETURN(pthread_mutex_unlock(&priv->mutex));
+    return 0;
+}
+
+/*
+ * Account for the completion of a request started via http_io_limit_acquire() and adjust the limit (AIMD).
+ *
+ * A 503 response (e.g., "SlowDown") or a timeout shrinks the limit, but only if the request started since
+ * the last time we shrank it; other requests failing in the same burst were already accounted for. Each
+ * success grows the limit by 1/limit, i.e., by one request per "window" of successful requests.
+ *
+ * If "curl" is NULL, the request was never performed and the limit is not adjusted.
+ */
+static void
+http_io_limit_release(struct http_io_private *priv, u_int gen, CURL *curl, CURLcode curl_code)
+{
+    struct http_io_conf *const config = priv->config;
+    long http_code = 0;
+    u_int old_limit;
+    int congested;
+
+    // Anything to do?
+    if (config->request_limit == 0)
+        return;
+
+    // Classify the result
+    if (curl != NULL && curl_code == CURLE_OK && curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &http_code) != CURLE_OK)
+        http_code = 0;
+    congested = curl != NULL && (curl_code == CURLE_OPERATION_TIMEDOUT || http_code == HTTP_SERVICE_UNAVAILABLE);
+
+    // Update limit
+    pthread_mutex_lock(&priv->mutex);
+    assert(priv->limit_active > 0);
+    priv->limit_active--;
+    old_limit = (u_int)priv->limit;
+    if (congested) {
+        if ((int)(gen - priv->limit_backoff_gen) >= 0) {
+            priv->limit *= LIMIT_DECREASE;
+            if (priv->limit < 1.0)
+                priv->limit = 1.0;
+            priv->limit_backoff_gen = priv->limit_gen;
+            priv->stats.request_limit_reductions++;
+        }
+    } else if (curl != NULL && curl_code == CURLE_OK) {
+        priv->limit += 1.0 / priv->limit;
+        if (priv->limit > config->request_limit)
+            priv->limit = config->request_limit;
+    }
+    if ((u_int)priv->limit > old_limit)
+        pthread_cond_broadcast(&priv->limit_slot);
+    else
+        pthread_cond_signal(&priv->limit_slot);
+    CHECK_RETURN(pthread_mutex_unlock(&priv->mutex));
+}
+
+/*
+ * Completion callback for transfers belonging to a "struct http_io_batch".
+ */
+static void
+http_io_batch_done(struct http_io_async *req)
+{
+    struct http_io_batch *const batch = req->done_arg;
+    struct http_io_private *const priv = batch->priv;
+
+    http_io_limit_release(priv, req->limit_gen, req->curl, req->curl_code);
+    pthread_mutex_lock(&priv->mutex);
+    assert(batch->remaining > 0);
+    if (--batch->remaining == 0)
+        pthread_cond_signal(&batch->done);
+    CHECK_RETURN(pthread_mutex_unlock(&priv->mutex));
+}
+
+/*
+ * Start the encoder pool.
+ */
+static int
+http_io_encode_start(struct http_io_private *priv)
+{
+    struct http_io_conf *const config = priv->config;
+    int r;
+
+    // Sanity check
+    assert(priv->encode_threads == NULL);
+
+    // Initialize
+    if ((priv->encode_threads = calloc(config->encode_threads, sizeof(*priv->encode_threads))) == NULL) {
+        r = errno;
+        (*config->log)(LOG_ERR, "calloc: %s", strerror(r));
+        return r;
+    }
+    if ((r = pthread_cond_init(&priv->encode_wakeup, NULL)) != 0) {
+        free(priv->encode_threads);
+        priv->encode_threads = NULL;
+        return r;
+    }
+
+    // Start encoder threads
+    while (priv->num_encode_threads < config->encode_threads) {
+        if ((r = pthread_create(&priv->encode_threads[priv->num_encode_threads], NULL, http_io_encode_main, priv)) != 0) {
+            (*config->log)(LOG_ERR, "failed to create encoder thread: %s", strerror(r));
+            http_io_encode_stop(priv);
+            return r;
+        }
+        priv->num_encode_threads++;
+    }
+    return 0;
+}
+
+/*
+ * Stop the encoder pool, if running.
+ */
+static void
+http_io_encode_stop(struct http_io_private *priv)
+{
+    struct http_io_conf *const config = priv->config;
+    int r;
+
+    // Anything to do?
+    if (priv->encode_threads == NULL)
+        return;
+
+    // Tell encoder threads to exit
+    pthread_mutex_lock(&priv->mutex);
+    priv->encode_shutdown = 1;
+    CHECK_RETURN(pthread_cond_broadcast(&priv->encode_wakeup));
+    CHECK_RETURN(pthread_mutex_unlock(&priv->mutex));
+
+    // Reap encoder threads
+    while (priv->num_encode_threads > 0) {
+        if ((r = pthread_join(priv->encode_threads[--priv->num_encode_threads], NULL)) != 0)
+            (*config->log)(LOG_ERR, "pthread_join: %s", strerror(r));
+    }
+
+    // Clean up
+    assert(TAILQ_EMPTY(&priv->encode_queue));
+    pthread_cond_destroy(&priv->encode_wakeup);
+    free(priv->encode_threads);
+    priv->encode_threads = NULL;
+}
+
+/*
+ * Hand up to WRITE_PIPELINE_BATCH blocks to the encoder pool as one batch.
+ *
+ * Returns the number of blocks submitted, which is zero if num_blocks is zero.
+ */
+static u_int
+http_io_encode_submit(struct http_io_private *priv, struct http_io_batch *batch, struct http_io_encode *jobs,
+  char *urlbufs, s3b_block_t block_num, u_int num_blocks, const void *src)
+{
+    struct http_io_conf *const config = priv->config;
+    const u_int count = num_blocks < WRITE_PIPELINE_BATCH ? num_blocks : WRITE_PIPELINE_BATCH;
+    const size_t urlbuf_size = URL_BUF_SIZE(config);
+    u_int i;
+
+    // Initialize batch
+    batch->priv = priv;
+    batch->remaining = count;
+    if (count == 0)
+        return 0;
+
+    // Enqueue blocks
+    pthread_mutex_lock(&priv->mutex);
+    for (i = 0; i < count; i++) {
+        struct http_io_encode *const job = &jobs[i];
+
+        job->batch = batch;
+        job->block_num = block_num + i;
+        job->src = (const char *)src + (size_t)i * config->block_size;
+        job->urlbuf = urlbufs + i * urlbuf_size;
+        TAILQ_INSERT_TAIL(&priv->encode_queue, job, link);
+    }
+    CHECK_RETURN(pthread_cond_broadcast(&priv->encode_wakeup));
+    CHECK_RETURN(pthread_mutex_unlock(&priv->mutex));
+    return count;
+}
+
+/*
+ * Encoder thread main loop.
+ *
+ * Idle threads simply take the next queued block, so work from all writers is spread across the pool.
+ */
+static void *
+http_io_encode_main(void *arg)
+{
+    struct http_io_private *const priv = arg;
+    const size_t urlbuf_size = URL_BUF_SIZE(priv->config);
+    struct http_io_encode *job;
+
+    pthread_mutex_lock(&priv->mutex);
+    while (1) {
+
+        // Wait for something to do
+        if ((job = TAILQ_FIRST(&priv->encode_queue)) == NULL) {
+            if (priv->encode_shutdown)
+                break;
+            pthread_cond_wait(&priv->encode_wakeup, &priv->mutex);
+            continue;
+        }
+        TAILQ_REMOVE(&priv->encode_queue, job, link);
+        CHECK_RETURN(pthread_mutex_unlock(&priv->mutex));
+
+        // Encode block and build request
+        job->result = http_io_write_prepare(priv, &job->io, job->urlbuf, urlbuf_size, job->block_num, job->src, &job->encoded_buf);
+
+        // Notify writer when its whole batch is ready; "job" may be freed as soon as we unlock
+        pthread_mutex_lock(&priv->mutex);
+        assert(job->batch->remaining > 0);
+        if (--job->batch->remaining == 0)
+            pthread_cond_signal(&job->batch->done);
+    }
+    CHECK_RETURN(pthread_mutex_unlock(&priv->mutex));
+    return NULL;
+}
+
+/*
+ * Start the event loop thread, which drives all transfers via a single cURL "multi" handle.
+ */
+static int
+http_io_async_start(struct http_io_private *priv)
+{
+    struct http_io_conf *const config = priv->config;
+#if HTTP_IO_ASYNC_SUPPORTED
+    int r;
+
+    // Sanity check
+    assert(!priv->async_thread_alive);
+    assert(priv->multi == NULL);
+
+    // Create multi handle
+    if ((priv->multi = curl_multi_init()) == NULL) {
+        (*config->log)(LOG_ERR, "curl_multi_init() failed");
+        return ENOMEM;
+    }
+    if (!config->http_11)
+        curl_multi_setopt(priv->multi, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+
+    // Start event loop thread
+    if ((r = pthread_create(&priv->async_thread, NULL, http_io_async_main, priv)) != 0) {
+        (*config->log)(LOG_ERR, "failed to create HTTP event loop thread: %s", strerror(r));
+        curl_multi_cleanup(priv->multi);
+        priv->multi = NULL;
+        return r;
+    }
+    priv->async_thread_alive = 1;
+    return 0;
+#else
+    (*config->log)(LOG_ERR, "`--asyncHttp' requires libcurl version 7.68.0 or later");
+    return ENOTSUP;
+#endif
+}
+
+/*
+ * Stop the event loop thread after it finishes any outstanding transfers.
+ */
+static void
+http_io_async_stop(struct http_io_private *priv)
+{
+#if HTTP_IO_ASYNC_SUPPORTED
+    struct http_io_conf *const config = priv->config;
+    int r;
+
+    // Anything to do?
+    if (!priv->async_thread_alive)
+        return;
+
+    // Tell event loop thread to exit
+    pthread_mutex_lock(&priv->mutex);
+    priv->async_thread_shutdown = 1;
+    CHECK_RETURN(pthread_mutex_unlock(&priv->mutex));
+    curl_multi_wakeup(priv->multi);
+
+    // Reap event loop thread
+    if ((r = pthread_join(priv->async_thread, NULL)) != 0)
+        (*config->log)(LOG_ERR, "pthread_join: %s", strerror(r));
+    priv->async_thread_alive = 0;
+
+    // Clean up
+    curl_multi_cleanup(priv->multi);
+    priv->multi = NULL;
+#endif
+}
+
+/*
+ * Submit a transfer to the asynchronous engine. Once the transfer completes, req->curl_code
+ * will be set and req->done will be invoked from the event loop thread.
+ *
+ * Returns zero on success, or ENOTCONN if the engine is not running.
+ */
+static int
+http_io_async_submit(struct http_io_private *priv, struct http_io_async *req)
+{
+#if HTTP_IO_ASYNC_SUPPORTED
+    pthread_mutex_lock(&priv->mutex);
+    if (!priv->async_thread_alive || priv->async_thread_shutdown) {
+        CHECK_RETURN(pthread_mutex_unlock(&priv->mutex));
+        return ENOTCONN;
+    }
+    TAILQ_INSERT_TAIL(&priv->async_pending, req, link);
+    CHECK_RETURN(pthread_mutex_unlock(&priv->mutex));
+    curl_multi_wakeup(priv->multi);
+    return 0;
+#else
+    return ENOTCONN;
+#endif
+}
 
-            // Update stats
-            pthread_mutex_lock(&priv->mutex);
-            if (strcmp(io->method, HTTP_GET) == 0) {
-                priv->stats.http_gets.count++;
-                priv->stats.http_gets.time += curl_time;
-            } else if (strcmp(io->method, HTTP_PUT) == 0) {
-                priv->stats.http_puts.count++;
-                priv->stats.http_puts.time += curl_time;
-            } else if (strcmp(io->method, HTTP_DELETE) == 0) {
-                priv->stats.http_deletes.count++;
-                priv->stats.http_deletes.time += curl_time;
-            } else if (strcmp(io->method, HTTP_HEAD) == 0) {
-                priv->stats.http_heads.count++;
-                priv->stats.http_heads.time += curl_time;
-            }
-            CHECK_RETURN(pthread_mutex_unlock(&priv->mutex));
+#if HTTP_IO_ASYNC_SUPPORTED
+static void *
+http_io_async_main(void *arg)
+{
+    struct http_io_private *const priv = arg;
+    struct http_io_conf *const config = priv->config;
+    struct http_io_async *req;
+    CURLMcode mcode;
+    CURLMsg *msg;
+    int num_running;
+    int num_msgs;
 
-            // Done
-            http_io_release_curl(priv, &curl, r == 0);
-            return r;
-        }
+    // Grab lock
+    pthread_mutex_lock(&priv->mutex);
 
-        // Free the curl handle (and ensure we don't try to re-use it)
-        http_io_release_curl(priv, &curl, 0);
+    // Loop until told to stop and no transfers remain
+    while (1) {
 
-        // Handle errors
-        switch (curl_code) {
-        case CURLE_ABORTED_BY_CALLBACK:
-            if (config->debug)
-                (*config->log)(LOG_DEBUG, "write aborted: %s %s", io->method, io->url);
-            pthread_mutex_lock(&priv->mutex);
-            priv->stats.http_canceled_writes++;
-            CHECK_RETURN(pthread_mutex_unlock(&priv->mutex));
-            http_io_free_error_payload(io);
-            return ECONNABORTED;
-        case CURLE_OPERATION_TIMEDOUT:
-            (*config->log)(LOG_NOTICE, "operation timeout: %s %s", io->method, io->url);
-            pthread_mutex_lock(&priv->mutex);
-            priv->stats.curl_timeouts++;
-            CHECK_RETURN(pthread_mutex_unlock(&priv->mutex));
-            break;
-        case CURLE_HTTP_RETURNED_ERROR:                 // special handling for some specific HTTP codes
-            switch (http_code) {
-            case HTTP_NOT_FOUND:
-                if (config->debug)
-                    (*config->log)(LOG_DEBUG, "rec'd %ld response: %s %s", http_code, io->method, io->url);
-                http_io_free_error_payload(io);
-                return ENOENT;
-            case HTTP_UNAUTHORIZED:
-                (*config->log)(LOG_ERR, "rec'd %ld response: %s %s", http_code, io->method, io->url);
-                pthread_mutex_lock(&priv->mutex);
-                priv->stats.http_unauthorized++;
+        // Add newly submitted transfers to the multi handle
+        while ((req = TAILQ_FIRST(&priv->async_pending)) != NULL) {
+            TAILQ_REMOVE(&priv->async_pending, req, link);
+            curl_easy_setopt(req->curl, CURLOPT_PRIVATE, req);
+            if ((mcode = curl_multi_add_handle(priv->multi, req->curl)) != CURLM_OK) {
+                (*config->log)(LOG_ERR, "curl_multi_add_handle: %s", curl_multi_strerror(mcode));
                 CHECK_RETURN(pthread_mutex_unlock(&priv->mutex));
-                http_io_log_error_payload(io);
-                http_io_free_error_payload(io);
-                return EACCES;
-            case HTTP_FORBIDDEN:
-                (*config->log)(LOG_ERR, "rec'd %ld response: %s %s", http_code, io->method, io->url);
-                pthread_mutex_lock(&priv->mutex);
-                priv->stats.http_forbidden++;
-                CHECK_RETURN(pthread_mutex_unlock(&priv->mutex));
-                http_io_log_error_payload(io);
-                http_io_free_error_payload(io);
-                return EPERM;
-            case HTTP_PRECONDITION_FAILED:
-                (*config->log)(LOG_INFO, "rec'd stale content: %s %s", io->method, io->url);
-                pthread_mutex_lock(&priv->mutex);
-                priv->stats.http_stale++;
-                CHECK_RETURN(pthread_mutex_unlock(&priv->mutex));
-                break;
-            case HTTP_MOVED_PERMANENTLY:
-            case HTTP_FOUND:
-            case HTTP_TEMPORARY_REDIRECT:
-            case HTTP_PERMANENT_REDIRECT:
-                (*config->log)(LOG_ERR, "rec'd %ld redirect: %s %s", http_code, io->method, io->url);
-                (*config->log)(LOG_ERR, "hint: you may need the \"--vhost\" and/or \"--region\" flags");
-                pthread_mutex_lock(&priv->mutex);
-                priv->stats.http_redirect++;
-                CHECK_RETURN(pthread_mutex_unlock(&priv->mutex));
-                break;
-            case HTTP_NOT_MODIFIED:
-                if (io->expect_304) {
-                    if (config->debug)
-                        (*config->log)(LOG_DEBUG, "rec'd %ld response: %s %s", http_code, io->method, io->url);
-                    return EEXIST;
-                }
-                // FALLTHROUGH
-            default:
-                (*config->log)(LOG_ERR, "rec'd %ld response: %s %s", http_code, io->method, io->url);
+                req->curl_code = CURLE_OUT_OF_MEMORY;
+                (*req->done)(req);
                 pthread_mutex_lock(&priv->mutex);
-                switch (http_code / 100) {
-                case 3:
-                    priv->stats.http_3xx_error++;
-                    break;
-                case 4:
-                    priv->stats.http_4xx_error++;
-                    break;
-                case 5:
-                    priv->stats.http_5xx_error++;
-                    break;
-                default:
-                    priv->stats.http_other_error++;
-                    break;
-                }
-                CHECK_RETURN(pthread_mutex_unlock(&priv->mutex));
-                http_io_log_error_payload(io);
-                break;
+                continue;
             }
+            priv->async_active++;
+        }
+
+        // Are we supposed to stop?
+        if (priv->async_thread_shutdown && priv->async_active == 0)
             break;
-        default:
-            (*config->log)(LOG_ERR, "operation failed: %s (%s)", curl_easy_strerror(curl_code),
-              total_pause >= config->max_retry_pause ? "final attempt" : "will retry");
+        CHECK_RETURN(pthread_mutex_unlock(&priv->mutex));
+
+        // Make progress on transfers
+        if ((mcode = curl_multi_perform(priv->multi, &num_running)) != CURLM_OK)
+            (*config->log)(LOG_ERR, "curl_multi_perform: %s", curl_multi_strerror(mcode));
+
+        // Report completed transfers
+        while ((msg = curl_multi_info_read(priv->multi, &num_msgs)) != NULL) {
+            char *private;
+
+            if (msg->msg != CURLMSG_DONE)
+                continue;
+            curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, &private);
+            req = (struct http_io_async *)private;
+            req->curl_code = msg->data.result;
+            curl_multi_remove_handle(priv->multi, req->curl);
             pthread_mutex_lock(&priv->mutex);
-            switch (curl_code) {
-            case CURLE_OUT_OF_MEMORY:
-                priv->stats.curl_out_of_memory++;
-                break;
-            case CURLE_COULDNT_CONNECT:
-                priv->stats.curl_connect_failed++;
-                break;
-            case CURLE_COULDNT_RESOLVE_HOST:
-                priv->stats.curl_host_unknown++;
-                break;
-            default:
-                priv->stats.curl_other_error++;
-                break;
-            }
+            priv->async_active--;
             CHECK_RETURN(pthread_mutex_unlock(&priv->mutex));
-            break;
+            (*req->done)(req);
         }
 
-        // Free any error payload
-        http_io_free_error_payload(io);
+        // Wait for network activity, timeouts, or newly submitted transfers
+        if ((mcode = curl_multi_poll(priv->multi, NULL, 0, ASYNC_POLL_MILLIS, NULL)) != CURLM_OK)
+            (*config->log)(LOG_ERR, "curl_multi_poll: %s", curl_multi_strerror(mcode));
 
-        // Retry with exponential backoff up to max total pause limit
-        if (total_pause >= config->max_retry_pause)
-            break;
-        retry_pause = retry_pause > 0 ? retry_pause * 2 : config->initial_retry_pause;
-        if (total_pause + retry_pause > config->max_retry_pause)
-            retry_pause = config->max_retry_pause - total_pause;
-        delay.tv_sec = retry_pause / 1000;
-        delay.tv_nsec = (retry_pause % 1000) * 1000000;
-        nanosleep(&delay, NULL);            // TODO: check for EINTR
-
-        // Update retry stats
+        // Grab lock
         pthread_mutex_lock(&priv->mutex);
-        priv->stats.num_retries++;
-        priv->stats.retry_delay += retry_pause;
-        CHECK_RETURN(pthread_mutex_unlock(&priv->mutex));
     }
 
-    // Give up
-    (*config->log)(LOG_ERR, "giving up on: %s %s", io->method, io->url);
-    return EIO;
+    // Done
+    CHECK_RETURN(pthread_mutex_unlock(&priv->mutex));
+    return NULL;
 }
+#endif
 
 /*
  * Compute S3 authorization hash using secret access key and add Authorization and SHA256 hash headers.
@@ -2647,6 +5000,9 @@ http_io_add_auth4(struct http_io_private *priv, struct http_io *const io, time_t
     u_int payload_hash_len;
     u_int creq_hash_len;
     u_int hmac_len;
+    u_char sign_key[EVP_MAX_MD_SIZE];
+    u_int sign_key_len;
+    u_int creds_version;
     char payload_hash_buf[EVP_MAX_MD_SIZE * 2 + 1];
     char creq_hash_buf[EVP_MAX_MD_SIZE * 2 + 1];
     char hmac_buf[EVP_MAX_MD_SIZE * 2 + 1];
@@ -2679,10 +5035,21 @@ http_io_add_auth4(struct http_io_private *priv, struct http_io *const io, time_t
     // Initialize
     hash_ctx = EVP_MD_CTX_new();
 
-    // Snapshot current credentials
+    // Format date
+    strftime(datebuf, sizeof(datebuf), AWS_DATE_BUF_FMT, gmtime_r(&now, &tm));
+
+    // Snapshot current credentials, and the signing key if we have already derived it for today
     pthread_mutex_lock(&priv->mutex);
     snvprintf(access_id, sizeof(access_id), "%s", config->accessId);
-    snvprintf(access_key, sizeof(access_key), "%s%s", ACCESS_KEY_PREFIX, config->accessKey);
+    if (priv->sign_key_len != 0 && priv->sign_key_creds == priv->creds_version
+      && strncmp(priv->sign_key_date, datebuf, 8) == 0) {
+        memcpy(sign_key, priv->sign_key, priv->sign_key_len);
+        sign_key_len = priv->sign_key_len;
+    } else {
+        snvprintf(access_key, sizeof(access_key), "%s%s", ACCESS_KEY_PREFIX, config->accessKey);
+        sign_key_len = 0;
+    }
+    creds_version = priv->creds_version;
     if (config->iam_token != NULL && (iam_token = strdup(config->iam_token)) == NULL) {
         r = errno;
         CHECK_RETURN(pthread_mutex_unlock(&priv->mutex));
@@ -2709,16 +5076,19 @@ http_io_add_auth4(struct http_io_private *priv, struct http_io *const io, time_t
         query_params_len = 0;
     }
 
-    // Format date
-    strftime(datebuf, sizeof(datebuf), AWS_DATE_BUF_FMT, gmtime_r(&now, &tm));
-
 /****** Hash Payload and Add Header ******/
 
-    EVP_DigestInit_ex(hash_ctx, EVP_sha256(), NULL);
-    if (payload != NULL)
+    // The hash of an empty payload is a constant, and over HTTPS we can optionally skip hashing altogether
+    if (payload == NULL || plen == 0)
+        snvprintf(payload_hash_buf, sizeof(payload_hash_buf), "%s", EMPTY_PAYLOAD_SHA256);
+    else if (config->unsigned_payload)
+        snvprintf(payload_hash_buf, sizeof(payload_hash_buf), "%s", UNSIGNED_PAYLOAD);
+    else {
+        EVP_DigestInit_ex(hash_ctx, EVP_sha256(), NULL);
         EVP_DigestUpdate(hash_ctx, payload, plen);
-    EVP_DigestFinal_ex(hash_ctx, payload_hash, &payload_hash_len);
-    http_io_prhex(payload_hash_buf, payload_hash, payload_hash_len);
+        EVP_DigestFinal_ex(hash_ctx, payload_hash, &payload_hash_len);
+        http_io_prhex(payload_hash_buf, payload_hash, payload_hash_len);
+    }
 
     io->headers = http_io_add_header(priv, io->headers, "%s: %s", CONTENT_SHA256_HEADER, payload_hash_buf);
 
@@ -2773,56 +5143,47 @@ http_io_add_auth4(struct http_io_private *priv, struct http_io *const io, time_t
     snvprintf(sigbuf + strlen(sigbuf), sizeof(sigbuf) - strlen(sigbuf), "%.*s\n", (int)query_params_len, query_params);
 #endif
 
-    // Canonical headers
-    header_names_length = 0;
+    // Canonical headers; build the lowercase signed header names list at the same time, and digest
+    // each name in one piece from there
+    for (header_names_length = 1, i = 0; i < num_sorted_hdrs; i++)
+        header_names_length += strlen(sorted_hdrs[i]) + 1;
+    if ((header_names = malloc(header_names_length)) == NULL) {
+        r = errno;
+        goto fail;
+    }
+    p = header_names;
     for (i = 0; i < num_sorted_hdrs; i++) {
-        const char *value = sorted_hdrs[i];
-        const char *s;
-        char lcase;
+        const char *s = sorted_hdrs[i];
+        char *name;
 
-        s = value;
-        do {
+        if (p > header_names)
+            *p++ = ';';
+        for (name = p; *s != ':'; s++) {
             if (*s == '\0') {
                 r = EINVAL;
                 goto fail;
             }
-            lcase = tolower(*s);
-            EVP_DigestUpdate(hash_ctx, (const u_char *)&lcase, 1);
-#if DEBUG_AUTHENTICATION
-            snvprintf(sigbuf + strlen(sigbuf), sizeof(sigbuf) - strlen(sigbuf), "%c", lcase);
-#endif
-            header_names_length++;
-        } while (*s++ != ':');
+            *p++ = tolower(*s);
+        }
+        EVP_DigestUpdate(hash_ctx, (const u_char *)name, p - name);
+        EVP_DigestUpdate(hash_ctx, (const u_char *)":", 1);
+        s++;
         while (isspace(*s))
             s++;
         EVP_DigestUpdate(hash_ctx, (const u_char *)s, strlen(s));
         EVP_DigestUpdate(hash_ctx, (const u_char *)"\n", 1);
 #if DEBUG_AUTHENTICATION
-        snvprintf(sigbuf + strlen(sigbuf), sizeof(sigbuf) - strlen(sigbuf), "%s\n", s);
+        snvprintf(sigbuf + strlen(sigbuf), sizeof(sigbuf) - strlen(sigbuf), "%.*s:%s\n", (int)(p - name), name, s);
 #endif
     }
+    *p++ = '\0';
+    assert(p <= header_names + header_names_length);
     EVP_DigestUpdate(hash_ctx, (const u_char *)"\n", 1);
 #if DEBUG_AUTHENTICATION
     snvprintf(sigbuf + strlen(sigbuf), sizeof(sigbuf) - strlen(sigbuf), "\n");
 #endif
 
     // Signed headers
-    if ((header_names = malloc(header_names_length)) == NULL) {
-        r = errno;
-        goto fail;
-    }
-    p = header_names;
-    for (i = 0; i < num_sorted_hdrs; i++) {
-        const char *value = sorted_hdrs[i];
-        const char *s;
-
-        if (p > header_names)
-            *p++ = ';';
-        for (s = value; *s != '\0' && *s != ':'; s++)
-            *p++ = tolower(*s);
-    }
-    *p++ = '\0';
-    assert(p <= header_names + header_names_length);
     EVP_DigestUpdate(hash_ctx, (const u_char *)header_names, strlen(header_names));
     EVP_DigestUpdate(hash_ctx, (const u_char *)"\n", 1);
 #if DEBUG_AUTHENTICATION
@@ -2846,48 +5207,65 @@ http_io_add_auth4(struct http_io_private *priv, struct http_io *const io, time_t
 
 /****** Derive Signing Key ******/
 
-    // Do nested HMAC's
+    // The signing key only depends on the secret key, date, and region, so it is derived once a day and cached
     hmac_ctx = HMAC_CTX_new();
     assert(NULL != hmac_ctx);
-    HMAC_Init_ex(hmac_ctx, access_key, strlen(access_key), EVP_sha256(), NULL);
+    if (sign_key_len == 0) {
+
+        // Do nested HMAC's
+        HMAC_Init_ex(hmac_ctx, access_key, strlen(access_key), EVP_sha256(), NULL);
 #if DEBUG_AUTHENTICATION
-    (*config->log)(LOG_DEBUG, "auth: access_key = \"%s\"", access_key);
+        (*config->log)(LOG_DEBUG, "auth: access_key = \"%s\"", access_key);
 #endif
-    HMAC_Update(hmac_ctx, (const u_char *)datebuf, 8);
-    HMAC_Final(hmac_ctx, hmac, &hmac_len);
-    assert(hmac_len <= sizeof(hmac));
+        HMAC_Update(hmac_ctx, (const u_char *)datebuf, 8);
+        HMAC_Final(hmac_ctx, hmac, &hmac_len);
+        assert(hmac_len <= sizeof(hmac));
 #if DEBUG_AUTHENTICATION
-    http_io_prhex(hmac_buf, hmac, hmac_len);
-    (*config->log)(LOG_DEBUG, "auth: HMAC[%.8s] = %s", datebuf, hmac_buf);
+        http_io_prhex(hmac_buf, hmac, hmac_len);
+        (*config->log)(LOG_DEBUG, "auth: HMAC[%.8s] = %s", datebuf, hmac_buf);
 #endif
-    HMAC_Init_ex(hmac_ctx, hmac, hmac_len, EVP_sha256(), NULL);
-    HMAC_Update(hmac_ctx, (const u_char *)config->region, strlen(config->region));
-    HMAC_Final(hmac_ctx, hmac, &hmac_len);
+        HMAC_Init_ex(hmac_ctx, hmac, hmac_len, EVP_sha256(), NULL);
+        HMAC_Update(hmac_ctx, (const u_char *)config->region, strlen(config->region));
+        HMAC_Final(hmac_ctx, hmac, &hmac_len);
 #if DEBUG_AUTHENTICATION
-    http_io_prhex(hmac_buf, hmac, hmac_len);
-    (*config->log)(LOG_DEBUG, "auth: HMAC[%s] = %s", config->region, hmac_buf);
+        http_io_prhex(hmac_buf, hmac, hmac_len);
+        (*config->log)(LOG_DEBUG, "auth: HMAC[%s] = %s", config->region, hmac_buf);
 #endif
-    HMAC_Init_ex(hmac_ctx, hmac, hmac_len, EVP_sha256(), NULL);
-    HMAC_Update(hmac_ctx, (const u_char *)S3_SERVICE_NAME, strlen(S3_SERVICE_NAME));
-    HMAC_Final(hmac_ctx, hmac, &hmac_len);
+        HMAC_Init_ex(hmac_ctx, hmac, hmac_len, EVP_sha256(), NULL);
+        HMAC_Update(hmac_ctx, (const u_char *)S3_SERVICE_NAME, strlen(S3_SERVICE_NAME));
+        HMAC_Final(hmac_ctx, hmac, &hmac_len);
 #if DEBUG_AUTHENTICATION
-    http_io_prhex(hmac_buf, hmac, hmac_len);
-    (*config->log)(LOG_DEBUG, "auth: HMAC[%s] = %sn", S3_SERVICE_NAME, hmac_buf);
+        http_io_prhex(hmac_buf, hmac, hmac_len);
+        (*config->log)(LOG_DEBUG, "auth: HMAC[%s] = %sn", S3_SERVICE_NAME, hmac_buf);
 #endif
-    HMAC_Init_ex(hmac_ctx, hmac, hmac_len, EVP_sha256(), NULL);
-    HMAC_Update(hmac_ctx, (const u_char *)SIGNATURE_TERMINATOR, strlen(SIGNATURE_TERMINATOR));
-    HMAC_Final(hmac_ctx, hmac, &hmac_len);
+        HMAC_Init_ex(hmac_ctx, hmac, hmac_len, EVP_sha256(), NULL);
+        HMAC_Update(hmac_ctx, (const u_char *)SIGNATURE_TERMINATOR, strlen(SIGNATURE_TERMINATOR));
+        HMAC_Final(hmac_ctx, hmac, &hmac_len);
 #if DEBUG_AUTHENTICATION
-    http_io_prhex(hmac_buf, hmac, hmac_len);
-    (*config->log)(LOG_DEBUG, "auth: HMAC[%s] = %s", SIGNATURE_TERMINATOR, hmac_buf);
+        http_io_prhex(hmac_buf, hmac, hmac_len);
+        (*config->log)(LOG_DEBUG, "auth: HMAC[%s] = %s", SIGNATURE_TERMINATOR, hmac_buf);
 #endif
 
+        // Cache the key, unless the credentials changed in the meantime
+        memcpy(sign_key, hmac, hmac_len);
+        sign_key_len = hmac_len;
+        pthread_mutex_lock(&priv->mutex);
+        if (priv->creds_version == creds_version) {
+            memcpy(priv->sign_key, sign_key, sign_key_len);
+            priv->sign_key_len = sign_key_len;
+            memcpy(priv->sign_key_date, datebuf, 8);
+            priv->sign_key_date[8] = '\0';
+            priv->sign_key_creds = creds_version;
+        }
+        CHECK_RETURN(pthread_mutex_unlock(&priv->mutex));
+    }
+
 /****** Sign the String To Sign ******/
 
 #if DEBUG_AUTHENTICATION
     *sigbuf = '\0';
 #endif
-    HMAC_Init_ex(hmac_ctx, hmac, hmac_len, EVP_sha256(), NULL);
+    HMAC_Init_ex(hmac_ctx, sign_key, sign_key_len, EVP_sha256(), NULL);
     HMAC_Update(hmac_ctx, (const u_char *)SIGNATURE_ALGORITHM, strlen(SIGNATURE_ALGORITHM));
     HMAC_Update(hmac_ctx, (const u_char *)"\n", 1);
 #if DEBUG_AUTHENTICATION
@@ -3003,11 +5381,20 @@ http_io_get_block_url(char *buf, size_t bufsiz, struct http_io_conf *config, s3b
  */
 static void
 http_io_get_mount_token_file_url(char *buf, size_t bufsiz, struct http_io_conf *config)
+{
+    http_io_get_meta_file_url(buf, bufsiz, config, MOUNT_TOKEN_FILE);
+}
+
+/*
+ * Get the URL for a non-block object (mount token, dictionary, etc.) stored alongside the blocks.
+ */
+static void
+http_io_get_meta_file_url(char *buf, size_t bufsiz, struct http_io_conf *config, const char *name)
 {
     if (config->vhost)
-        snvprintf(buf, bufsiz, "%s%s%s", config->baseURL, config->prefix, MOUNT_TOKEN_FILE);
+        snvprintf(buf, bufsiz, "%s%s%s", config->baseURL, config->prefix, name);
     else
-        snvprintf(buf, bufsiz, "%s%s/%s%s", config->baseURL, config->bucket, config->prefix, MOUNT_TOKEN_FILE);
+        snvprintf(buf, bufsiz, "%s%s/%s%s", config->baseURL, config->bucket, config->prefix, name);
 }
 
 /*
@@ -3060,7 +5447,7 @@ http_io_acquire_curl(struct http_io_private *priv, struct http_io *io)
         priv->stats.curl_handles_reused++;
         CHECK_RETURN(pthread_mutex_unlock(&priv->mutex));
         free(holder);
-        curl_easy_reset(curl);
+        http_io_curl_clear_request(curl);
     } else {
         priv->stats.curl_handles_created++;             // optimistic
         CHECK_RETURN(pthread_mutex_unlock(&priv->mutex));
@@ -3072,8 +5459,31 @@ http_io_acquire_curl(struct http_io_private *priv, struct http_io *io)
             (*config->log)(LOG_ERR, "curl_easy_init() failed");
             return NULL;
         }
+        http_io_curl_set_options(priv, curl);
     }
     curl_easy_setopt(curl, CURLOPT_URL, io->url);
+    if (!config->http_11 && priv->multi != NULL) {
+        curl_easy_setopt(curl, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_2TLS);
+        curl_easy_setopt(curl, CURLOPT_PIPEWAIT, (long)1);            // prefer multiplexing over a new connection
+    }
+    return curl;
+}
+
+/*
+ * Configure the options of a newly created CURL instance that are the same for every request.
+ *
+ * These survive when the instance is reused, so we don't need to set them again.
+ */
+static void
+http_io_curl_set_options(struct http_io_private *priv, CURL *curl)
+{
+    struct http_io_conf *const config = priv->config;
+    long max_connects;
+
+    if (priv->share != NULL)
+        curl_easy_setopt(curl, CURLOPT_SHARE, priv->share);
+    max_connects = config->warm_connections > MIN_SHARED_CONNECTS ? config->warm_connections : MIN_SHARED_CONNECTS;
+    curl_easy_setopt(curl, CURLOPT_MAXCONNECTS, max_connects);
     curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1);
     curl_easy_setopt(curl, CURLOPT_NOSIGNAL, (long)1);
     curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, (long)1);
@@ -3087,17 +5497,188 @@ http_io_acquire_curl(struct http_io_private *priv, struct http_io *io)
         curl_easy_setopt(curl, CURLOPT_MAX_SEND_SPEED_LARGE, (curl_off_t)(config->max_speed[HTTP_UPLOAD] / 8));
     if (config->max_speed[HTTP_DOWNLOAD] != 0)
         curl_easy_setopt(curl, CURLOPT_MAX_RECV_SPEED_LARGE, (curl_off_t)(config->max_speed[HTTP_DOWNLOAD] / 8));
-    if (strncmp(io->url, "https", 5) == 0) {
-        if (config->insecure)
-            curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, (long)0);
-        if (config->cacert != NULL)
-            curl_easy_setopt(curl, CURLOPT_CAINFO, config->cacert);
-    }
+    if (config->insecure)                                               // these only affect https:// URLs
+        curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, (long)0);
+    if (config->cacert != NULL)
+        curl_easy_setopt(curl, CURLOPT_CAINFO, config->cacert);
     if (config->debug_http)
         curl_easy_setopt(curl, CURLOPT_VERBOSE, 1);
     if (config->http_11)
         curl_easy_setopt(curl, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_1_1);
-    return curl;
+}
+
+/*
+ * Restore the per-request options of a reused CURL instance to their defaults.
+ *
+ * Every option set by an http_io_curl_prepper_t or by the asynchronous engine must be cleared here.
+ */
+static void
+http_io_curl_clear_request(CURL *curl)
+{
+    curl_easy_setopt(curl, CURLOPT_HTTPGET, (long)1);                   // also clears CURLOPT_NOBODY and CURLOPT_UPLOAD
+    curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, NULL);
+    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, NULL);
+    curl_easy_setopt(curl, CURLOPT_READFUNCTION, NULL);
+    curl_easy_setopt(curl, CURLOPT_READDATA, NULL);
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, NULL);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, NULL);
+    curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, NULL);
+    curl_easy_setopt(curl, CURLOPT_HEADERDATA, NULL);
+    curl_easy_setopt(curl, CURLOPT_INFILESIZE_LARGE, (curl_off_t)-1);
+    curl_easy_setopt(curl, CURLOPT_MAXFILESIZE_LARGE, (curl_off_t)0);
+    curl_easy_setopt(curl, CURLOPT_ENCODING, NULL);
+    curl_easy_setopt(curl, CURLOPT_HTTP_CONTENT_DECODING, (long)1);
+    curl_easy_setopt(curl, CURLOPT_PRIVATE, NULL);
+}
+
+/*
+ * Create the cURL share handle through which all of our CURL instances share DNS lookups,
+ * SSL sessions, and (if supported) open connections.
+ *
+ * Failure to create the share handle is not fatal; we just don't share anything.
+ */
+static int
+http_io_share_init(struct http_io_private *priv)
+{
+    struct http_io_conf *const config = priv->config;
+    int nlocks;
+    int r;
+
+    // Initialize locks
+    for (nlocks = 0; nlocks < CURL_LOCK_DATA_LAST; nlocks++) {
+        if ((r = pthread_mutex_init(&priv->share_locks[nlocks], NULL)) != 0)
+            goto fail;
+    }
+
+    // Create share handle
+    if ((priv->share = curl_share_init()) == NULL) {
+        (*config->log)(LOG_WARNING, "curl_share_init() failed; connections will not be shared");
+        return 0;
+    }
+    curl_share_setopt(priv->share, CURLSHOPT_LOCKFUNC, http_io_share_lock);
+    curl_share_setopt(priv->share, CURLSHOPT_UNLOCKFUNC, http_io_share_unlock);
+    curl_share_setopt(priv->share, CURLSHOPT_USERDATA, priv);
+    curl_share_setopt(priv->share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+    curl_share_setopt(priv->share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+#if HTTP_IO_SHARE_CONNECTIONS
+    curl_share_setopt(priv->share, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+#endif
+    return 0;
+
+fail:
+    while (nlocks > 0)
+        pthread_mutex_destroy(&priv->share_locks[--nlocks]);
+    return r;
+}
+
+/*
+ * Destroy the cURL share handle. All CURL instances using it must have been cleaned up already.
+ */
+static void
+http_io_share_destroy(struct http_io_private *priv)
+{
+    int i;
+
+    if (priv->share != NULL) {
+        curl_share_cleanup(priv->share);
+        priv->share = NULL;
+    }
+    for (i = 0; i < CURL_LOCK_DATA_LAST; i++)
+        pthread_mutex_destroy(&priv->share_locks[i]);
+}
+
+static void
+http_io_share_lock(CURL *curl, curl_lock_data data, curl_lock_access access, void *arg)
+{
+    struct http_io_private *const priv = arg;
+
+    pthread_mutex_lock(&priv->share_locks[data]);
+}
+
+static void
+http_io_share_unlock(CURL *curl, curl_lock_data data, void *arg)
+{
+    struct http_io_private *const priv = arg;
+
+    CHECK_RETURN(pthread_mutex_unlock(&priv->share_locks[data]));
+}
+
+/*
+ * Open config->warm_connections connections to the server in parallel and leave them in the pool.
+ *
+ * We do this by issuing unauthenticated HEAD requests; the response doesn't matter, only the connection.
+ */
+static void
+http_io_warm_connections(struct http_io_private *priv)
+{
+    struct http_io_conf *const config = priv->config;
+    char urlbuf[URL_BUF_SIZE(config) + sizeof(MOUNT_TOKEN_FILE)];
+    u_int num_warmed = 0;
+    struct http_io io;
+    CURLMcode mcode;
+    CURLMsg *msg;
+    CURLM *multi;
+    CURL **curls;
+    u_int num_curls;
+    int num_running;
+    int num_msgs;
+    u_int i;
+
+    // Create temporary multi handle
+    if ((curls = calloc(config->warm_connections, sizeof(*curls))) == NULL)
+        return;
+    if ((multi = curl_multi_init()) == NULL) {
+        (*config->log)(LOG_WARNING, "curl_multi_init() failed; not pre-opening connections");
+        free(curls);
+        return;
+    }
+
+    // Start HEAD requests
+    http_io_get_mount_token_file_url(urlbuf, sizeof(urlbuf), config);
+    http_io_init_io(priv, &io, HTTP_HEAD, urlbuf);
+    for (num_curls = 0; num_curls < config->warm_connections; num_curls++) {
+        if ((curls[num_curls] = http_io_acquire_curl(priv, &io)) == NULL)
+            break;
+        curl_easy_setopt(curls[num_curls], CURLOPT_NOBODY, 1);
+        curl_easy_setopt(curls[num_curls], CURLOPT_PIPEWAIT, (long)0);      // we want distinct connections
+        if (curl_multi_add_handle(multi, curls[num_curls]) != CURLM_OK) {
+            http_io_release_curl(priv, &curls[num_curls], 0);
+            break;
+        }
+    }
+
+    // Run them to completion and put the CURL instances into the pool
+    do {
+        if ((mcode = curl_multi_perform(multi, &num_running)) != CURLM_OK) {
+            (*config->log)(LOG_ERR, "curl_multi_perform: %s", curl_multi_strerror(mcode));
+            break;
+        }
+        while ((msg = curl_multi_info_read(multi, &num_msgs)) != NULL) {
+            if (msg->msg != CURLMSG_DONE)
+                continue;
+            for (i = 0; i < num_curls && curls[i] != msg->easy_handle; i++)
+                ;
+            assert(i < num_curls);
+            curl_multi_remove_handle(multi, curls[i]);
+            if (msg->data.result == CURLE_OK)
+                num_warmed++;
+            else if (config->debug)
+                (*config->log)(LOG_DEBUG, "connection warm-up failed: %s", curl_easy_strerror(msg->data.result));
+            http_io_release_curl(priv, &curls[i], msg->data.result == CURLE_OK);
+        }
+    } while (num_running > 0 && curl_multi_wait(multi, NULL, 0, ASYNC_POLL_MILLIS, NULL) == CURLM_OK);
+
+    // Clean up
+    for (i = 0; i < num_curls; i++) {
+        if (curls[i] != NULL) {
+            curl_multi_remove_handle(multi, curls[i]);
+            http_io_release_curl(priv, &curls[i], 0);
+        }
+    }
+    curl_multi_cleanup(multi);
+    free(curls);
+    if (config->debug)
+        (*config->log)(LOG_DEBUG, "pre-opened %u of %u connection(s)", num_warmed, config->warm_connections);
 }
 
 static size_t
@@ -3220,9 +5801,7 @@ http_io_release_curl(struct http_io_private *priv, CURL **curlp, int may_cache)
     }
     if ((holder = calloc(1, sizeof(*holder))) == NULL) {
         curl_easy_cleanup(curl);
-        pthread_mutex_lock(&priv->mutex);
-        priv->stats.out_of_memory_errors++;
-        CHECK_RETURN(pthread_mutex_unlock(&priv->mutex));
+        ATOMIC_ADD(priv->stats.out_of_memory_errors, 1);
         return;
     }
     holder->curl = curl;
@@ -3334,6 +5913,8 @@ static u_int
 http_io_crypt(struct http_io_private *priv, s3b_block_t block_num, int enc, const u_char *src, u_int len, u_char *dest, u_int dmax)
 {
     u_char ivec[EVP_MAX_IV_LENGTH];
+    struct http_io_cipher *cipher;
+    struct http_io_cipher temp;
     EVP_CIPHER_CTX* ctx;
     u_int total_len;
     char blockbuf[EVP_MAX_IV_LENGTH];
@@ -3348,16 +5929,20 @@ http_io_crypt(struct http_io_private *priv, s3b_block_t block_num, int enc, cons
     // Sanity check
     assert(EVP_MAX_IV_LENGTH >= MD5_DIGEST_LENGTH);
 
-    // Initialize cipher context
-    ctx = EVP_CIPHER_CTX_new();
-    EVP_CIPHER_CTX_init(ctx);
+    // Get this thread's cipher contexts; if that fails, fall back to one-time contexts
+    if ((cipher = http_io_get_cipher(priv)) == NULL) {
+        r = http_io_init_cipher(priv, &temp);
+        assert(r == 0);
+        cipher = &temp;
+    }
 
     // Generate initialization vector by encrypting the block number using previously generated IV
     memset(blockbuf, 0, sizeof(blockbuf));
     snvprintf(blockbuf, sizeof(blockbuf), "%0*jx", S3B_BLOCK_NUM_DIGITS, (uintmax_t)block_num);
 
-    // Initialize cipher for IV generation
-    r = EVP_EncryptInit_ex(ctx, priv->cipher, NULL, priv->ivkey, priv->ivkey);
+    // Reset cipher for IV generation (the key schedule is retained)
+    ctx = cipher->iv_ctx;
+    r = EVP_EncryptInit_ex(ctx, NULL, NULL, NULL, priv->ivkey);
     assert(r == 1);
     EVP_CIPHER_CTX_set_padding(ctx, 0);
 
@@ -3367,9 +5952,10 @@ http_io_crypt(struct http_io_private *priv, s3b_block_t block_num, int enc, cons
     r = EVP_EncryptFinal_ex(ctx, NULL, &clen);
     assert(r == 1 && clen == 0);
 
-    // Re-initialize cipher for bulk data encryption
+    // Reset cipher for bulk data encryption/decryption using the new IV
+    ctx = enc ? cipher->enc_ctx : cipher->dec_ctx;
     assert(EVP_CIPHER_CTX_block_size(ctx) == EVP_CIPHER_CTX_iv_length(ctx));
-    r = EVP_CipherInit_ex(ctx, priv->cipher, NULL, priv->key, ivec, enc);
+    r = EVP_CipherInit_ex(ctx, NULL, NULL, NULL, ivec, enc);
     assert(r == 1);
     EVP_CIPHER_CTX_set_padding(ctx, 1);
 
@@ -3398,10 +5984,77 @@ http_io_crypt(struct http_io_private *priv, s3b_block_t block_num, int enc, cons
     }
 
     // Done
-    EVP_CIPHER_CTX_free(ctx);
+    if (cipher == &temp) {
+        EVP_CIPHER_CTX_free(temp.iv_ctx);
+        EVP_CIPHER_CTX_free(temp.enc_ctx);
+        EVP_CIPHER_CTX_free(temp.dec_ctx);
+    }
     return total_len;
 }
 
+/*
+ * Get the current thread's cipher contexts, creating them on demand. Returns NULL if that fails.
+ */
+static struct http_io_cipher *
+http_io_get_cipher(struct http_io_private *priv)
+{
+    struct http_io_cipher *cipher;
+
+    // Already created?
+    if ((cipher = pthread_getspecific(priv->cipher_key)) != NULL)
+        return cipher;
+
+    // Create new contexts for this thread
+    if ((cipher = malloc(sizeof(*cipher))) == NULL)
+        return NULL;
+    if (http_io_init_cipher(priv, cipher) != 0) {
+        free(cipher);
+        return NULL;
+    }
+    if (pthread_setspecific(priv->cipher_key, cipher) != 0) {
+        http_io_free_cipher(cipher);
+        return NULL;
+    }
+
+    // Done
+    return cipher;
+}
+
+/*
+ * Create and key a set of cipher contexts. Subsequent uses only need to supply the IV.
+ */
+static int
+http_io_init_cipher(struct http_io_private *priv, struct http_io_cipher *cipher)
+{
+    memset(cipher, 0, sizeof(*cipher));
+    if ((cipher->iv_ctx = EVP_CIPHER_CTX_new()) == NULL
+      || (cipher->enc_ctx = EVP_CIPHER_CTX_new()) == NULL
+      || (cipher->dec_ctx = EVP_CIPHER_CTX_new()) == NULL)
+        goto fail;
+    if (EVP_EncryptInit_ex(cipher->iv_ctx, priv->cipher, NULL, priv->ivkey, priv->ivkey) != 1
+      || EVP_CipherInit_ex(cipher->enc_ctx, priv->cipher, NULL, priv->key, NULL, 1) != 1
+      || EVP_CipherInit_ex(cipher->dec_ctx, priv->cipher, NULL, priv->key, NULL, 0) != 1)
+        goto fail;
+    return 0;
+
+fail:
+    EVP_CIPHER_CTX_free(cipher->iv_ctx);            // OK if NULL
+    EVP_CIPHER_CTX_free(cipher->enc_ctx);
+    EVP_CIPHER_CTX_free(cipher->dec_ctx);
+    return ENOMEM;
+}
+
+static void
+http_io_free_cipher(void *arg)
+{
+    struct http_io_cipher *const cipher = arg;
+
+    EVP_CIPHER_CTX_free(cipher->iv_ctx);
+    EVP_CIPHER_CTX_free(cipher->enc_ctx);
+    EVP_CIPHER_CTX_free(cipher->dec_ctx);
+    free(cipher);
+}
+
 static void
 http_io_authsig(struct http_io_private *priv, s3b_block_t block_num, const u_char *src, u_int len, u_char *hmac)
 {
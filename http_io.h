@@ -79,17 +79,28 @@ struct http_io_conf {
     int                     debug;
     int                     debug_http;
     int                     http_11;                    // restrict to HTTP 1.1
+    int                     async_http;                 // perform transfers via curl_multi event loop thread
+    u_int                   read_hedge;                 // GET latency percentile after which reads are hedged (zero = never)
+    u_int                   request_limit;              // max adaptive limit on concurrent HTTP requests (zero = unlimited)
+    u_int                   trace_size;                 // number of recent HTTP requests to remember (zero = none)
+    u_int                   encode_threads;             // size of encoder pool for write_blocks() (zero = disabled)
     int                     quiet;
     const struct comp_alg   *compress_alg;              // compression algorithm, or NULL for none
     void                    *compress_level;            // compression level info
+    int                     compress_dict;              // compress using a trained dictionary stored in the bucket
+    u_int                   compress_dict_samples;      // number of written blocks to sample when training a dictionary
+    int                     compress_adaptive;          // skip incompressible blocks and pick level by CPU vs. upload time
     int                     vhost;                      // use virtual host style URL
     bitmap_t                *nonzero_bitmap;            // is set to NULL by http_io_create()
     int                     blockHashPrefix;
     int                     insecure;
+    int                     unsigned_payload;           // sign requests with UNSIGNED-PAYLOAD instead of hashing the body
     u_int                   block_size;
     s3b_block_t             num_blocks;
     int                     list_blocks_threads;
+    int                     list_blocks_save;           // save the block survey at unmount and reuse it at the next mount
     u_int                   timeout;
+    u_int                   warm_connections;           // number of connections to pre-open at startup
     u_int                   initial_retry_pause;
     u_int                   max_retry_pause;
     uintmax_t               max_speed[2];
@@ -102,6 +113,18 @@ struct http_io_conf {
 struct http_io_evst {
     u_int               count;                      // number of occurrences
     double              time;                       // total time taken
+    struct latency_hist latency;                    // distribution of time taken
+};
+
+// One recently performed HTTP request (see "trace_size")
+#define HTTP_IO_TRACE_OBJECT_MAX    40
+struct http_io_trace {
+    struct timeval      when;                       // when the request finished
+    u_int               micros;                     // how long it took
+    const char          *method;                    // HTTP method
+    char                object[HTTP_IO_TRACE_OBJECT_MAX];  // last component of the URL (possibly truncated)
+    int                 http_code;                  // HTTP response code, or -1 if none
+    int                 curl_code;                  // cURL result code
 };
 
 struct http_io_stats {
@@ -130,6 +153,10 @@ struct http_io_stats {
     u_int               http_3xx_error;
     u_int               http_other_error;
     u_int               http_canceled_writes;
+    u_int               http_hedged_reads;          // duplicate GETs sent because the first was slow
+    u_int               http_hedge_wins;            // duplicate GETs that completed first
+    u_int               request_limit;              // current adaptive limit on concurrent requests
+    u_int               request_limit_reductions;   // times the limit was reduced due to 503's or timeouts
 
     // CURL stats
     u_int               curl_handles_created;
@@ -144,6 +171,10 @@ struct http_io_stats {
     u_int               num_retries;
     uint64_t            retry_delay;
 
+    // Adaptive compression stats
+    u_int               compress_skipped;           // blocks written uncompressed because they wouldn't compress
+    int                 compress_level;             // current adaptive compression level
+
     // Misc
     u_int               out_of_memory_errors;
 };
@@ -152,6 +183,7 @@ struct http_io_stats {
 extern struct s3backer_store *http_io_create(struct http_io_conf *config);
 extern void http_io_get_stats(struct s3backer_store *s3b, struct http_io_stats *stats);
 extern void http_io_clear_stats(struct s3backer_store *s3b);
+extern u_int http_io_get_trace(struct s3backer_store *s3b, struct http_io_trace *trace, u_int max);
 extern int http_io_parse_block(const char *prefix, s3b_block_t num_blocks,
     int blockHashPrefix, const char *name, s3b_block_t *hash_valuep, s3b_block_t *block_nump);
 extern void http_io_format_block_hash(int blockHashPrefix, char *block_hash_buf, size_t bufsiz, s3b_block_t block_num);
@@ -81,9 +81,13 @@ static int64_t s3b_nbd_plugin_get_size(void *handle);
 static int s3b_nbd_plugin_pread(void *handle, void *bufp, uint32_t size, uint64_t offset, uint32_t flags);
 static int s3b_nbd_plugin_pwrite(void *handle, const void *bufp, uint32_t size, uint64_t offset, uint32_t flags);
 static int s3b_nbd_plugin_trim(void *handle, uint32_t size, uint64_t offset, uint32_t flags);
+static int s3b_nbd_plugin_extents(void *handle, uint32_t size, uint64_t offset, uint32_t flags, struct nbdkit_extents *extents);
+static int s3b_nbd_plugin_can_extents(void *handle);
 static int s3b_nbd_plugin_can_multi_conn(void *handle);
 static int s3b_nbd_plugin_can_fua(void *handle);
 static int s3b_nbd_plugin_can_cache(void *handle);
+static int s3b_nbd_plugin_cache(void *handle, uint32_t size, uint64_t offset, uint32_t flags);
+static int s3b_nbd_plugin_can_fast_zero(void *handle);
 static void s3b_nbd_plugin_unload(void);
 
 #define PLUGIN_HELP                                                                                                 \
@@ -109,8 +113,8 @@ static struct nbdkit_plugin plugin = {
     .can_flush=             NULL,
     .can_trim=              NULL,
     .can_zero=              NULL,
-    .can_fast_zero=         NULL,
-    .can_extents=           NULL,
+    .can_fast_zero=         s3b_nbd_plugin_can_fast_zero,
+    .can_extents=           s3b_nbd_plugin_can_extents,
     .can_fua=               s3b_nbd_plugin_can_fua,
     .can_cache=             s3b_nbd_plugin_can_cache,
     .is_rotational=         NULL,
@@ -132,8 +136,8 @@ static struct nbdkit_plugin plugin = {
     .pread=                 s3b_nbd_plugin_pread,
     .pwrite=                s3b_nbd_plugin_pwrite,
     .trim=                  s3b_nbd_plugin_trim,
-    .cache=                 NULL,
-    .extents=               NULL,
+    .cache=                 s3b_nbd_plugin_cache,
+    .extents=               s3b_nbd_plugin_extents,
     .zero=                  s3b_nbd_plugin_trim,    // for us, "trim" and "zero" are the same thing
     .close=                 NULL,
 
@@ -344,14 +348,12 @@ s3b_nbd_plugin_pread(void *handle, void *buf, uint32_t size, uint64_t offset, ui
         nbdkit_set_error(r);
         return -1;
     }
-    while (info.mid_block_count-- > 0) {
-        if ((r = (*fuse_priv->s3b->read_block)(fuse_priv->s3b, info.mid_block_start, info.mid_data, NULL, NULL, 0)) != 0) {
-            nbdkit_error("error reading block %0*jx: %m", S3B_BLOCK_NUM_DIGITS, (uintmax_t)info.mid_block_start);
-            nbdkit_set_error(r);
-            return -1;
-        }
-        info.mid_block_start++;
-        info.mid_data += config->block_size;
+    if (info.mid_block_count > 0
+      && (r = (*fuse_priv->s3b->read_blocks)(fuse_priv->s3b, info.mid_block_start, (u_int)info.mid_block_count, info.mid_data)) != 0) {
+        nbdkit_error("error reading blocks %0*jx-%0*jx: %m", S3B_BLOCK_NUM_DIGITS, (uintmax_t)info.mid_block_start,
+          S3B_BLOCK_NUM_DIGITS, (uintmax_t)(info.mid_block_start + info.mid_block_count - 1));
+        nbdkit_set_error(r);
+        return -1;
     }
     if (info.footer.length > 0 && (r = block_part_read_block_part(fuse_priv->s3b, fuse_priv->block_part, &info.footer)) != 0) {
         nbdkit_error("error reading block %0*jx: %m", S3B_BLOCK_NUM_DIGITS, (uintmax_t)info.footer.block);
@@ -367,7 +369,6 @@ static int
 s3b_nbd_plugin_pwrite(void *handle, const void *buf, uint32_t size, uint64_t offset, uint32_t flags)
 {
     struct boundary_info info;
-    size_t i;
     int r;
 
     // Calculate what bits to write, then write them
@@ -376,14 +377,11 @@ s3b_nbd_plugin_pwrite(void *handle, const void *buf, uint32_t size, uint64_t off
         nbdkit_error("error writing block %0*jx: %m", S3B_BLOCK_NUM_DIGITS, (uintmax_t)info.header.block);
         goto fail;
     }
-    for (i = 0; i < info.mid_block_count; i++) {
-        const s3b_block_t block_num = info.mid_block_start + i;
-
-        if ((r = (*fuse_priv->s3b->write_block)(fuse_priv->s3b, block_num, info.mid_data, NULL, NULL, NULL)) != 0) {
-            nbdkit_error("error writing block %0*jx: %m", S3B_BLOCK_NUM_DIGITS, (uintmax_t)block_num);
-            goto fail;
-        }
-        info.mid_data += config->block_size;
+    if (info.mid_block_count > 0
+      && (r = (*fuse_priv->s3b->write_blocks)(fuse_priv->s3b, info.mid_block_start, (u_int)info.mid_block_count, info.mid_data)) != 0) {
+        nbdkit_error("error writing blocks %0*jx-%0*jx: %m", S3B_BLOCK_NUM_DIGITS, (uintmax_t)info.mid_block_start,
+          S3B_BLOCK_NUM_DIGITS, (uintmax_t)(info.mid_block_start + info.mid_block_count - 1));
+        goto fail;
     }
     if (info.footer.length > 0 && (r = block_part_write_block_part(fuse_priv->s3b, fuse_priv->block_part, &info.footer)) != 0) {
         nbdkit_error("error writing block %0*jx: %m", S3B_BLOCK_NUM_DIGITS, (uintmax_t)info.footer.block);
@@ -453,6 +451,38 @@ fail:
     return -1;
 }
 
+// Report which blocks are known to be zero, using only what we already know locally
+static int
+s3b_nbd_plugin_extents(void *handle, uint32_t size, uint64_t offset, uint32_t flags, struct nbdkit_extents *extents)
+{
+    s3b_block_t block_num = offset / config->block_size;
+    const s3b_block_t end = (offset + size + config->block_size - 1) / config->block_size;
+    u_int count;
+    int zero;
+    int r;
+
+    while (block_num < end) {
+        if ((r = (*fuse_priv->s3b->block_status)(fuse_priv->s3b, block_num, end - block_num, &zero, &count)) != 0) {
+            nbdkit_error("error getting status of block %0*jx: %s", S3B_BLOCK_NUM_DIGITS, (uintmax_t)block_num, strerror(r));
+            nbdkit_set_error(r);
+            return -1;
+        }
+        if (nbdkit_add_extent(extents, (uint64_t)block_num * config->block_size, (uint64_t)count * config->block_size,
+          zero ? NBDKIT_EXTENT_HOLE | NBDKIT_EXTENT_ZERO : 0) == -1)
+            return -1;
+        if ((flags & NBDKIT_FLAG_REQ_ONE) != 0)
+            break;
+        block_num += count;
+    }
+    return 0;
+}
+
+static int
+s3b_nbd_plugin_can_extents(void *handle)
+{
+    return 1;
+}
+
 static int
 s3b_nbd_plugin_can_fua(void *handle)
 {
@@ -463,7 +493,31 @@ s3b_nbd_plugin_can_fua(void *handle)
 static int
 s3b_nbd_plugin_can_cache(void *handle)
 {
-    return config->block_cache.cache_size > 0 ? NBDKIT_CACHE_EMULATE : NBDKIT_CACHE_NONE;
+    return fuse_priv->s3b->prefetch_blocks != NULL ? NBDKIT_CACHE_NATIVE : NBDKIT_CACHE_NONE;
+}
+
+// Queue the blocks to be loaded into the block cache, without waiting for them or copying any data
+static int
+s3b_nbd_plugin_cache(void *handle, uint32_t size, uint64_t offset, uint32_t flags)
+{
+    const s3b_block_t block_num = offset / config->block_size;
+    const s3b_block_t end = (offset + size + config->block_size - 1) / config->block_size;
+    int r;
+
+    if (end > block_num && (r = (*fuse_priv->s3b->prefetch_blocks)(fuse_priv->s3b, block_num, end - block_num)) != 0) {
+        nbdkit_error("error prefetching blocks %0*jx-%0*jx: %s", S3B_BLOCK_NUM_DIGITS, (uintmax_t)block_num,
+          S3B_BLOCK_NUM_DIGITS, (uintmax_t)(end - 1), strerror(r));
+        nbdkit_set_error(r);
+        return -1;
+    }
+    return 0;
+}
+
+// Zeroing deletes whole blocks instead of writing them, so it's never slower than writing zeros
+static int
+s3b_nbd_plugin_can_fast_zero(void *handle)
+{
+    return 1;
 }
 
 // Since we have no per-connection state, the same client may open multiple connections
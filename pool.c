@@ -0,0 +1,228 @@
+
+/*
+ * s3backer - FUSE-based single file backing store via Amazon S3
+ *
+ * Copyright 2008-2020 Archie L. Cobbs <archie.cobbs@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ *
+ * In addition, as a special exception, the copyright holders give
+ * permission to link the code of portions of this program with the
+ * OpenSSL library under certain conditions as described in each
+ * individual source file, and distribute linked combinations including
+ * the two.
+ *
+ * You must obey the GNU General Public License in all respects for all
+ * of the code used other than OpenSSL. If you modify file(s) with this
+ * exception, you may extend this exception to your version of the
+ * file(s), but you are not obligated to do so. If you do not wish to do
+ * so, delete this exception statement from your version. If you delete
+ * this exception statement from all source files in the program, then
+ * also delete it here.
+ */
+
+/*
+ * Simple slab allocator for fixed-size objects.
+ *
+ * Each slab is a single anonymous memory mapping holding some whole number of objects. Objects are handed out
+ * from the most recent slab in address order, so untouched parts of a slab cost nothing; freed objects are kept
+ * on a singly linked list threaded through the objects themselves and are reused first. Memory is never handed back to the system
+ * until the pool is destroyed, so the memory footprint of a pool tracks its high water mark, and allocating
+ * or freeing an object is just a couple of pointer operations under the pool mutex.
+ *
+ * Slabs are sized in multiples of HUGE_PAGE_SIZE. If huge pages are requested, we first try an explicit huge
+ * page mapping (MAP_HUGETLB), which only works if the administrator has reserved huge pages; otherwise we fall
+ * back to a normal mapping and ask for transparent huge pages via madvise(2).
+ */
+
+#include "s3backer.h"
+#include "pool.h"
+
+// Definitions
+#define HUGE_PAGE_SIZE              (2 * 1024 * 1024)
+#define OBJECT_ALIGN                16
+#define ROUNDUP2(x, y)              (((x) + (y) - 1) & ~((size_t)(y) - 1))
+
+// A free object
+struct pool_free {
+    struct pool_free                *next;
+};
+
+// One slab
+struct pool_slab {
+    struct pool_slab                *next;
+    void                            *base;          // start of mapping
+    size_t                          length;         // length of mapping
+};
+
+// Pool structure
+struct s3b_pool {
+    log_func_t                      *log;
+    size_t                          size;           // object size (rounded up to OBJECT_ALIGN)
+    size_t                          slab_size;      // length of each slab mapping
+    u_int                           per_slab;       // objects per slab
+    int                             huge_pages;     // try to use huge pages
+    struct pool_slab                *slabs;         // all slabs
+    struct pool_free                *free_list;     // freed objects
+    char                            *fresh;         // next never-used object in the most recent slab
+    u_int                           fresh_left;     // number of never-used objects remaining there
+    pthread_mutex_t                 mutex;
+};
+
+// Declarations
+static int s3b_pool_grow(struct s3b_pool *pool);
+
+// Public functions
+
+int
+s3b_pool_create(struct s3b_pool **poolp, size_t size, int huge_pages, log_func_t *log)
+{
+    struct s3b_pool *pool;
+    int r;
+
+    // Sanity check
+    if (size == 0)
+        return EINVAL;
+
+    // Initialize structure
+    if ((pool = calloc(1, sizeof(*pool))) == NULL)
+        return errno;
+    pool->log = log;
+    pool->size = ROUNDUP2(size, OBJECT_ALIGN);
+    pool->slab_size = ROUNDUP2(pool->size, HUGE_PAGE_SIZE);
+    pool->per_slab = pool->slab_size / pool->size;
+    pool->huge_pages = huge_pages;
+    if ((r = pthread_mutex_init(&pool->mutex, NULL)) != 0) {
+        free(pool);
+        return r;
+    }
+
+    // Done
+    *poolp = pool;
+    return 0;
+}
+
+void
+s3b_pool_destroy(struct s3b_pool *pool)
+{
+    struct pool_slab *slab;
+
+    if (pool == NULL)
+        return;
+    while ((slab = pool->slabs) != NULL) {
+        pool->slabs = slab->next;
+        (void)munmap(slab->base, slab->length);
+        free(slab);
+    }
+    pthread_mutex_destroy(&pool->mutex);
+    free(pool);
+}
+
+/*
+ * Allocate an object. The object's contents are uninitialized.
+ *
+ * Returns NULL and sets errno on failure.
+ */
+void *
+s3b_pool_alloc(struct s3b_pool *pool)
+{
+    struct pool_free *obj;
+    int r;
+
+    pthread_mutex_lock(&pool->mutex);
+
+    // Reuse a freed object if possible
+    if ((obj = pool->free_list) != NULL) {
+        pool->free_list = obj->next;
+        goto done;
+    }
+
+    // Carve out a new object, adding a new slab if necessary
+    if (pool->fresh_left == 0 && (r = s3b_pool_grow(pool)) != 0) {
+        CHECK_RETURN(pthread_mutex_unlock(&pool->mutex));
+        errno = r;
+        return NULL;
+    }
+    obj = (struct pool_free *)pool->fresh;
+    pool->fresh += pool->size;
+    pool->fresh_left--;
+
+done:
+    CHECK_RETURN(pthread_mutex_unlock(&pool->mutex));
+    return obj;
+}
+
+/*
+ * Return an object to the pool. It's OK if ptr is NULL.
+ */
+void
+s3b_pool_free(struct s3b_pool *pool, void *ptr)
+{
+    struct pool_free *const obj = ptr;
+
+    if (obj == NULL)
+        return;
+    pthread_mutex_lock(&pool->mutex);
+    obj->next = pool->free_list;
+    pool->free_list = obj;
+    CHECK_RETURN(pthread_mutex_unlock(&pool->mutex));
+}
+
+// Internal functions
+
+/*
+ * Add a new slab to the pool. This assumes the pool mutex is held.
+ */
+static int
+s3b_pool_grow(struct s3b_pool *pool)
+{
+    struct pool_slab *slab;
+    void *base = MAP_FAILED;
+    int r;
+
+    // Allocate slab descriptor
+    if ((slab = malloc(sizeof(*slab))) == NULL)
+        return errno;
+
+    // Map memory, preferring huge pages if so configured
+#ifdef MAP_HUGETLB
+    if (pool->huge_pages)
+        base = mmap(NULL, pool->slab_size, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS|MAP_HUGETLB, -1, 0);
+#endif
+    if (base == MAP_FAILED) {
+        if ((base = mmap(NULL, pool->slab_size, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0)) == MAP_FAILED) {
+            r = errno;
+            (*pool->log)(LOG_ERR, "can't allocate %ju byte slab: %s", (uintmax_t)pool->slab_size, strerror(r));
+            free(slab);
+            return r;
+        }
+#ifdef MADV_HUGEPAGE
+        if (pool->huge_pages)
+            (void)madvise(base, pool->slab_size, MADV_HUGEPAGE);
+#endif
+    }
+    slab->base = base;
+    slab->length = pool->slab_size;
+    slab->next = pool->slabs;
+    pool->slabs = slab;
+
+    // Allocate new objects from this slab
+    pool->fresh = base;
+    pool->fresh_left = pool->per_slab;
+
+    // Done
+    return 0;
+}
@@ -0,0 +1,52 @@
+
+/*
+ * s3backer - FUSE-based single file backing store via Amazon S3
+ *
+ * Copyright 2008-2020 Archie L. Cobbs <archie.cobbs@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ *
+ * In addition, as a special exception, the copyright holders give
+ * permission to link the code of portions of this program with the
+ * OpenSSL library under certain conditions as described in each
+ * individual source file, and distribute linked combinations including
+ * the two.
+ *
+ * You must obey the GNU General Public License in all respects for all
+ * of the code used other than OpenSSL. If you modify file(s) with this
+ * exception, you may extend this exception to your version of the
+ * file(s), but you are not obligated to do so. If you do not wish to do
+ * so, delete this exception statement from your version. If you delete
+ * this exception statement from all source files in the program, then
+ * also delete it here.
+ */
+
+/*
+ * Fixed-size object pools.
+ *
+ * Objects are carved out of large slabs obtained directly from mmap(2), optionally backed by huge pages,
+ * and are recycled through a free list. Slabs are only returned to the system when the pool is destroyed.
+ * All functions are thread safe.
+ */
+
+// Declarations
+struct s3b_pool;
+
+// pool.c
+extern int s3b_pool_create(struct s3b_pool **poolp, size_t size, int huge_pages, log_func_t *log);
+extern void s3b_pool_destroy(struct s3b_pool *pool);
+extern void *s3b_pool_alloc(struct s3b_pool *pool);
+extern void s3b_pool_free(struct s3b_pool *pool, void *ptr);
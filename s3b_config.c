@@ -81,11 +81,20 @@
 #define S3BACKER_DEFAULT_BLOCK_CACHE_WRITE_DELAY    250             // 250ms
 #define S3BACKER_DEFAULT_BLOCK_CACHE_TIMEOUT        0
 #define S3BACKER_DEFAULT_BLOCK_CACHE_MAX_DIRTY      0
+#define S3BACKER_DEFAULT_BLOCK_CACHE_NUM_SHARDS     1
+#define S3BACKER_DEFAULT_BLOCK_CACHE_SYNC_DELAY     0               // disabled
+#define S3BACKER_MAX_BLOCK_CACHE_SYNC_DELAY         100000          // 100ms
+#define S3BACKER_MAX_BLOCK_CACHE_WRITE_COALESCE     256
 #define S3BACKER_DEFAULT_READ_AHEAD                 4
 #define S3BACKER_DEFAULT_READ_AHEAD_TRIGGER         2
+#define S3BACKER_DEFAULT_READ_AHEAD_MAX             64
 #define S3BACKER_DEFAULT_COMPRESSION                "deflate"
 #define S3BACKER_DEFAULT_ENCRYPTION                 "AES-128-CBC"
+#define S3BACKER_DEFAULT_COMPRESS_DICT_SAMPLES      1000
 #define S3BACKER_DEFAULT_LIST_BLOCKS_THREADS        16
+#define S3BACKER_DEFAULT_ENCODE_THREADS             0               // disabled
+#define S3BACKER_MAX_ENCODE_THREADS                 256
+#define S3BACKER_MAX_STATS_TRACE_SIZE               100000
 
 // Macro for quoting stuff
 #define s3bquote0(x)                    #x
@@ -104,6 +113,8 @@
  ****************************************************************************/
 
 static print_stats_t s3b_config_print_stats;
+static void s3b_config_print_latency(void *prarg, printer_t *printer, const char *name, const struct latency_hist *hist);
+static void s3b_config_print_trace(void *prarg, printer_t *printer);
 static clear_stats_t s3b_config_clear_stats;
 
 static void insert_fuse_arg(int pos, const char *arg);
@@ -169,6 +180,8 @@ static struct s3b_config config = {
         .initial_retry_pause=   S3BACKER_DEFAULT_INITIAL_RETRY_PAUSE,
         .max_retry_pause=       S3BACKER_DEFAULT_MAX_RETRY_PAUSE,
         .list_blocks_threads=   S3BACKER_DEFAULT_LIST_BLOCKS_THREADS,
+        .encode_threads=        S3BACKER_DEFAULT_ENCODE_THREADS,
+        .compress_dict_samples= S3BACKER_DEFAULT_COMPRESS_DICT_SAMPLES,
     },
 
     // "Eventual consistency" protection config
@@ -182,11 +195,14 @@ static struct s3b_config config = {
     .block_cache= {
         .cache_size=            S3BACKER_DEFAULT_BLOCK_CACHE_SIZE,
         .num_threads=           S3BACKER_DEFAULT_BLOCK_CACHE_NUM_THREADS,
+        .num_shards=            S3BACKER_DEFAULT_BLOCK_CACHE_NUM_SHARDS,
+        .sync_delay=            S3BACKER_DEFAULT_BLOCK_CACHE_SYNC_DELAY,
         .write_delay=           S3BACKER_DEFAULT_BLOCK_CACHE_WRITE_DELAY,
         .max_dirty=             S3BACKER_DEFAULT_BLOCK_CACHE_MAX_DIRTY,
         .timeout=               S3BACKER_DEFAULT_BLOCK_CACHE_TIMEOUT,
         .read_ahead=            S3BACKER_DEFAULT_READ_AHEAD,
         .read_ahead_trigger=    S3BACKER_DEFAULT_READ_AHEAD_TRIGGER,
+        .read_ahead_max=        S3BACKER_DEFAULT_READ_AHEAD_MAX,
     },
 
     // FUSE operations config
@@ -250,6 +266,11 @@ static const struct fuse_opt option_list[] = {
         .offset=    offsetof(struct s3b_config, list_blocks),
         .value=     1
     },
+    {
+        .templ=     "--listBlocksSave",
+        .offset=    offsetof(struct s3b_config, http_io.list_blocks_save),
+        .value=     1
+    },
     {
         .templ=     "--listBlocksThreads=%d",
         .offset=    offsetof(struct s3b_config, http_io.list_blocks_threads),
@@ -283,10 +304,18 @@ static const struct fuse_opt option_list[] = {
         .templ=     "--blockCacheThreads=%u",
         .offset=    offsetof(struct s3b_config, block_cache.num_threads),
     },
+    {
+        .templ=     "--blockCacheShards=%u",
+        .offset=    offsetof(struct s3b_config, block_cache.num_shards),
+    },
     {
         .templ=     "--blockCacheTimeout=%u",
         .offset=    offsetof(struct s3b_config, block_cache.timeout),
     },
+    {
+        .templ=     "--blockCacheWriteCoalesce=%u",
+        .offset=    offsetof(struct s3b_config, block_cache.write_coalesce),
+    },
     {
         .templ=     "--blockCacheWriteDelay=%u",
         .offset=    offsetof(struct s3b_config, block_cache.write_delay),
@@ -308,6 +337,10 @@ static const struct fuse_opt option_list[] = {
         .templ=     "--readAheadTrigger=%u",
         .offset=    offsetof(struct s3b_config, block_cache.read_ahead_trigger),
     },
+    {
+        .templ=     "--readAheadMax=%u",
+        .offset=    offsetof(struct s3b_config, block_cache.read_ahead_max),
+    },
     {
         .templ=     "--blockCacheNumProtected=%u",
         .offset=    offsetof(struct s3b_config, block_cache.num_protected),
@@ -321,11 +354,45 @@ static const struct fuse_opt option_list[] = {
         .offset=    offsetof(struct s3b_config, block_cache.no_verify),
         .value=     1
     },
+    {
+        .templ=     "--blockCachePartialWrites",
+        .offset=    offsetof(struct s3b_config, block_cache.partial_writes),
+        .value=     1
+    },
+    {
+        .templ=     "--blockCacheScanResistant",
+        .offset=    offsetof(struct s3b_config, block_cache.scan_resistant),
+        .value=     1
+    },
     {
         .templ=     "--blockCacheFileAdvise",
         .offset=    offsetof(struct s3b_config, block_cache.fadvise),
         .value=     1
     },
+    {
+        .templ=     "--blockCacheFileMmap",
+        .offset=    offsetof(struct s3b_config, block_cache.use_mmap),
+        .value=     1
+    },
+    {
+        .templ=     "--blockCacheFileUring",
+        .offset=    offsetof(struct s3b_config, block_cache.use_uring),
+        .value=     1
+    },
+    {
+        .templ=     "--blockCacheFileIndex",
+        .offset=    offsetof(struct s3b_config, block_cache.use_index),
+        .value=     1
+    },
+    {
+        .templ=     "--blockCacheHugePages",
+        .offset=    offsetof(struct s3b_config, block_cache.huge_pages),
+        .value=     1
+    },
+    {
+        .templ=     "--blockCacheFileSyncDelay=%u",
+        .offset=    offsetof(struct s3b_config, block_cache.sync_delay),
+    },
     {
         .templ=     "--blockSize=%s",
         .offset=    offsetof(struct s3b_config, block_size_str),
@@ -338,6 +405,10 @@ static const struct fuse_opt option_list[] = {
         .templ=     "--maxDownloadSpeed=%s",
         .offset=    offsetof(struct s3b_config, max_speed_str[HTTP_DOWNLOAD]),
     },
+    {
+        .templ=     "--md5CacheFile=%s",
+        .offset=    offsetof(struct s3b_config, ec_protect.cache_file),
+    },
     {
         .templ=     "--md5CacheSize=%u",
         .offset=    offsetof(struct s3b_config, ec_protect.cache_size),
@@ -361,6 +432,11 @@ static const struct fuse_opt option_list[] = {
         .offset=    offsetof(struct s3b_config, http_io.http_11),
         .value=     1
     },
+    {
+        .templ=     "--asyncHttp",
+        .offset=    offsetof(struct s3b_config, http_io.async_http),
+        .value=     1
+    },
     {
         .templ=     "--quiet",
         .offset=    offsetof(struct s3b_config, quiet),
@@ -442,6 +518,10 @@ static const struct fuse_opt option_list[] = {
         .templ=     "--statsFilename=%s",
         .offset=    offsetof(struct s3b_config, fuse_ops.stats_filename),
     },
+    {
+        .templ=     "--statsTraceSize=%u",
+        .offset=    offsetof(struct s3b_config, http_io.trace_size),
+    },
     {
         .templ=     "--storageClass=%s",
         .offset=    offsetof(struct s3b_config, http_io.storage_class),
@@ -451,6 +531,11 @@ static const struct fuse_opt option_list[] = {
         .offset=    offsetof(struct s3b_config, ssl),
         .value=     1
     },
+    {
+        .templ=     "--unsignedPayload",
+        .offset=    offsetof(struct s3b_config, http_io.unsigned_payload),
+        .value=     1
+    },
     {
         .templ=     "--cacert=%s",
         .offset=    offsetof(struct s3b_config, http_io.cacert),
@@ -473,6 +558,20 @@ static const struct fuse_opt option_list[] = {
         .templ=     "--compress-level=%s",
         .offset=    offsetof(struct s3b_config, compress_level),
     },
+    {
+        .templ=     "--compressAdaptive",
+        .offset=    offsetof(struct s3b_config, http_io.compress_adaptive),
+        .value=     1
+    },
+    {
+        .templ=     "--compressDict",
+        .offset=    offsetof(struct s3b_config, http_io.compress_dict),
+        .value=     1
+    },
+    {
+        .templ=     "--compressDictSamples=%u",
+        .offset=    offsetof(struct s3b_config, http_io.compress_dict_samples),
+    },
     {
         .templ=     "--encrypt",
         .offset=    offsetof(struct s3b_config, encrypt),
@@ -514,10 +613,38 @@ static const struct fuse_opt option_list[] = {
         .offset=    offsetof(struct s3b_config, test_io.discard_data),
         .value=     1
     },
+    {
+        .templ=     "--test-latency=%u",
+        .offset=    offsetof(struct s3b_config, test_io.latency),
+    },
+    {
+        .templ=     "--test-bandwidth=%u",
+        .offset=    offsetof(struct s3b_config, test_io.bandwidth),
+    },
+    {
+        .templ=     "--test-error-percent=%u",
+        .offset=    offsetof(struct s3b_config, test_io.error_percent),
+    },
     {
         .templ=     "--timeout=%u",
         .offset=    offsetof(struct s3b_config, http_io.timeout),
     },
+    {
+        .templ=     "--warmConnections=%u",
+        .offset=    offsetof(struct s3b_config, http_io.warm_connections),
+    },
+    {
+        .templ=     "--readHedgePercentile=%u",
+        .offset=    offsetof(struct s3b_config, http_io.read_hedge),
+    },
+    {
+        .templ=     "--requestLimit=%u",
+        .offset=    offsetof(struct s3b_config, http_io.request_limit),
+    },
+    {
+        .templ=     "--encodeThreads=%u",
+        .offset=    offsetof(struct s3b_config, http_io.encode_threads),
+    },
     {
         .templ=     "--directIO",
         .offset=    offsetof(struct s3b_config, fuse_ops.direct_io),
@@ -831,6 +958,7 @@ s3b_cleanup(void)
     FORCE_FREE(config.http_io.sse);
     FORCE_FREE(config.http_io.sse_key_id);
     FORCE_FREE(config.block_cache.cache_file);
+    FORCE_FREE(config.ec_protect.cache_file);
     FORCE_FREE(config.block_size_str);
     FORCE_FREE(config.max_speed_str[HTTP_UPLOAD]);
     FORCE_FREE(config.max_speed_str[HTTP_DOWNLOAD]);
@@ -905,6 +1033,10 @@ s3b_config_print_stats(void *prarg, printer_t *printer)
             (*printer)(prarg, "%-28s %u\n", "http_empty_blocks_read", http_io_stats.empty_blocks_read);
             (*printer)(prarg, "%-28s %u\n", "http_empty_blocks_written", http_io_stats.empty_blocks_written);
         }
+        if (config.http_io.compress_adaptive) {
+            (*printer)(prarg, "%-28s %u\n", "http_compress_skipped", http_io_stats.compress_skipped);
+            (*printer)(prarg, "%-28s %d\n", "http_compress_level", http_io_stats.compress_level);
+        }
         (*printer)(prarg, "%-28s %u\n", "http_gets", http_io_stats.http_gets.count);
         (*printer)(prarg, "%-28s %u\n", "http_puts", http_io_stats.http_puts.count);
         (*printer)(prarg, "%-28s %u\n", "http_deletes", http_io_stats.http_deletes.count);
@@ -914,6 +1046,9 @@ s3b_config_print_stats(void *prarg, printer_t *printer)
           http_io_stats.http_puts.time / http_io_stats.http_puts.count : 0.0);
         (*printer)(prarg, "%-28s %.3f sec\n", "http_avg_delete_time", http_io_stats.http_deletes.count > 0 ?
           http_io_stats.http_deletes.time / http_io_stats.http_deletes.count : 0.0);
+        s3b_config_print_latency(prarg, printer, "http_get_latency", &http_io_stats.http_gets.latency);
+        s3b_config_print_latency(prarg, printer, "http_put_latency", &http_io_stats.http_puts.latency);
+        s3b_config_print_latency(prarg, printer, "http_delete_latency", &http_io_stats.http_deletes.latency);
         (*printer)(prarg, "%-28s %u\n", "http_unauthorized", http_io_stats.http_unauthorized);
         (*printer)(prarg, "%-28s %u\n", "http_forbidden", http_io_stats.http_forbidden);
         (*printer)(prarg, "%-28s %u\n", "http_stale", http_io_stats.http_stale);
@@ -925,6 +1060,14 @@ s3b_config_print_stats(void *prarg, printer_t *printer)
         (*printer)(prarg, "%-28s %u\n", "http_3xx_error", http_io_stats.http_3xx_error);
         (*printer)(prarg, "%-28s %u\n", "http_other_error", http_io_stats.http_other_error);
         (*printer)(prarg, "%-28s %u\n", "http_canceled_writes", http_io_stats.http_canceled_writes);
+        if (config.http_io.read_hedge != 0) {
+            (*printer)(prarg, "%-28s %u\n", "http_hedged_reads", http_io_stats.http_hedged_reads);
+            (*printer)(prarg, "%-28s %u\n", "http_hedge_wins", http_io_stats.http_hedge_wins);
+        }
+        if (config.http_io.request_limit != 0) {
+            (*printer)(prarg, "%-28s %u\n", "http_request_limit", http_io_stats.request_limit);
+            (*printer)(prarg, "%-28s %u\n", "http_request_limit_reductions", http_io_stats.request_limit_reductions);
+        }
         (*printer)(prarg, "%-28s %u\n", "http_num_retries", http_io_stats.num_retries);
         (*printer)(prarg, "%-28s %ju.%03u sec\n", "http_total_retry_delay",
           (uintmax_t)(http_io_stats.retry_delay / 1000), (u_int)(http_io_stats.retry_delay % 1000));
@@ -962,6 +1105,16 @@ s3b_config_print_stats(void *prarg, printer_t *printer)
         (*printer)(prarg, "%-28s %.8f\n", "block_cache_write_hit_ratio", write_hit_ratio);
         (*printer)(prarg, "%-28s %u\n", "block_cache_verified", block_cache_stats.verified);
         (*printer)(prarg, "%-28s %u\n", "block_cache_mismatch", block_cache_stats.mismatch);
+        s3b_config_print_latency(prarg, printer, "block_cache_hit_latency", &block_cache_stats.hit_latency);
+        s3b_config_print_latency(prarg, printer, "block_cache_miss_latency", &block_cache_stats.miss_latency);
+        s3b_config_print_latency(prarg, printer, "block_cache_space_wait", &block_cache_stats.space_wait_latency);
+        if (config.block_cache.max_dirty != 0)
+            s3b_config_print_latency(prarg, printer, "block_cache_dirty_wait", &block_cache_stats.dirty_wait_latency);
+        if (config.block_cache.cache_file != NULL) {
+            s3b_config_print_latency(prarg, printer, "block_cache_file_read", &block_cache_stats.dcache_read_latency);
+            s3b_config_print_latency(prarg, printer, "block_cache_file_write", &block_cache_stats.dcache_write_latency);
+            s3b_config_print_latency(prarg, printer, "block_cache_file_fsync", &block_cache_stats.dcache_fsync_latency);
+        }
         total_oom += block_cache_stats.out_of_memory_errors;
     }
     if (zero_cache_store != NULL) {
@@ -976,9 +1129,51 @@ s3b_config_print_stats(void *prarg, printer_t *printer)
           (uintmax_t)(ec_protect_stats.cache_full_delay / 1000), (u_int)(ec_protect_stats.cache_full_delay % 1000));
         (*printer)(prarg, "%-28s %ju.%03u sec\n", "md5_cache_write_delays",
           (uintmax_t)(ec_protect_stats.repeated_write_delay / 1000), (u_int)(ec_protect_stats.repeated_write_delay % 1000));
+        s3b_config_print_latency(prarg, printer, "md5_cache_full_wait", &ec_protect_stats.cache_full_latency);
+        s3b_config_print_latency(prarg, printer, "md5_cache_write_wait", &ec_protect_stats.write_delay_latency);
         total_oom += ec_protect_stats.out_of_memory_errors;
     }
     (*printer)(prarg, "%-28s %u\n", "out_of_memory_errors", total_oom);
+
+    // Print recent requests
+    if (http_io_store != NULL && config.http_io.trace_size > 0)
+        s3b_config_print_trace(prarg, printer);
+}
+
+static void
+s3b_config_print_latency(void *prarg, printer_t *printer, const char *name, const struct latency_hist *hist)
+{
+    (*printer)(prarg, "%-28s p50 %.3f p99 %.3f p999 %.3f ms (%u)\n", name,
+      latency_hist_percentile(hist, 50.0) / 1000.0, latency_hist_percentile(hist, 99.0) / 1000.0,
+      latency_hist_percentile(hist, 99.9) / 1000.0, latency_hist_count(hist));
+}
+
+static void
+s3b_config_print_trace(void *prarg, printer_t *printer)
+{
+    struct http_io_trace *trace;
+    char timebuf[32];
+    struct tm tm;
+    u_int count;
+    u_int i;
+
+    if ((trace = malloc(config.http_io.trace_size * sizeof(*trace))) == NULL) {
+        (*printer)(prarg, "can't allocate trace buffer: %s\n", strerror(errno));
+        return;
+    }
+    count = http_io_get_trace(http_io_store, trace, config.http_io.trace_size);
+    (*printer)(prarg, "\n%-15s %-6s %-*s %4s %4s %10s\n", "time", "method", HTTP_IO_TRACE_OBJECT_MAX - 1, "object",
+      "http", "curl", "millis");
+    for (i = 0; i < count; i++) {
+        const struct http_io_trace *const entry = &trace[i];
+        const time_t when = entry->when.tv_sec;
+
+        strftime(timebuf, sizeof(timebuf), "%H:%M:%S", localtime_r(&when, &tm));
+        (*printer)(prarg, "%s.%06u %-6s %-*s %4d %4d %10.3f\n", timebuf, (u_int)entry->when.tv_usec,
+          entry->method != NULL ? entry->method : "?", HTTP_IO_TRACE_OBJECT_MAX - 1, entry->object,
+          entry->http_code, entry->curl_code, entry->micros / 1000.0);
+    }
+    free(trace);
 }
 
 static void
@@ -1356,6 +1551,14 @@ validate_config(int parse_only)
         warnx("non-SSL `--baseURL' conflicts with `--ssl'");
         return -1;
     }
+    if (config.http_io.unsigned_payload && strncmp(config.http_io.baseURL, "https://", 8) != 0) {
+        warnx("`--unsignedPayload' requires SSL");
+        return -1;
+    }
+    if (config.http_io.unsigned_payload && strcmp(config.http_io.authVersion, AUTH_VERSION_AWS4) != 0) {
+        warnx("`--unsignedPayload' requires `--authVersion=%s'", AUTH_VERSION_AWS4);
+        return -1;
+    }
 
     // Construct the virtual host style URL (prefix hostname with bucket name)
     {
@@ -1490,6 +1693,34 @@ validate_config(int parse_only)
         config.http_io.compress_level = level;
     }
 
+    // Check adaptive compression settings
+    if (config.http_io.compress_adaptive) {
+        if (config.http_io.compress_alg == NULL) {
+            warnx("the `--compressAdaptive' flag requires `--compress'");
+            return -1;
+        }
+        if (config.http_io.compress_alg->max_level == 0) {
+            warnx("the `--compressAdaptive' flag is not supported by `%s' compression", config.http_io.compress_alg->name);
+            return -1;
+        }
+    }
+
+    // Check compression dictionary settings
+    if (config.http_io.compress_dict) {
+        if (config.http_io.compress_alg == NULL || config.http_io.compress_alg->dtrain == NULL) {
+            warnx("the `--compressDict' flag requires a compression algorithm that supports dictionaries, e.g., `--compress=zstd'");
+            return -1;
+        }
+        if (config.http_io.encryption != NULL) {
+            warnx("the `--compressDict' flag is incompatible with `--encrypt'");
+            return -1;
+        }
+        if (config.http_io.compress_dict_samples < 1) {
+            warnx("invalid compressDictSamples %u", config.http_io.compress_dict_samples);
+            return -1;
+        }
+    }
+
     // Disable md5 cache when in read only mode
     if (config.fuse_ops.read_only) {
         config.ec_protect.cache_size = 0;
@@ -1554,6 +1785,11 @@ validate_config(int parse_only)
         warnx("invalid block cache thread pool size %u", config.block_cache.num_threads);
         return -1;
     }
+    if (config.block_cache.cache_size > 0
+      && (config.block_cache.num_shards <= 0 || config.block_cache.num_shards > config.block_cache.cache_size)) {
+        warnx("invalid block cache shard count %u", config.block_cache.num_shards);
+        return -1;
+    }
     if (config.block_cache.write_delay > 0 && config.block_cache.synchronous) {
         warnx("`--blockCacheSync' requires setting `--blockCacheWriteDelay=0'");
         return -1;
@@ -1568,10 +1804,61 @@ validate_config(int parse_only)
             return -1;
         }
     }
+    if (config.block_cache.use_mmap && config.block_cache.fadvise) {
+        warnx("`--blockCacheFileMmap' and `--blockCacheFileAdvise' are mutually exclusive");
+        return -1;
+    }
+    if (config.http_io.read_hedge >= 100) {
+        warnx("`--readHedgePercentile' must be less than 100");
+        return -1;
+    }
+    if (config.http_io.read_hedge != 0 && !config.http_io.async_http) {
+        warnx("`--readHedgePercentile' requires `--asyncHttp'");
+        return -1;
+    }
+    if (config.http_io.encode_threads > S3BACKER_MAX_ENCODE_THREADS) {
+        warnx("`--encodeThreads' must be at most %u", S3BACKER_MAX_ENCODE_THREADS);
+        return -1;
+    }
+    if (config.http_io.trace_size > S3BACKER_MAX_STATS_TRACE_SIZE) {
+        warnx("`--statsTraceSize' must be at most %u", S3BACKER_MAX_STATS_TRACE_SIZE);
+        return -1;
+    }
+    if (config.test_io.error_percent > 100) {
+        warnx("`--test-error-percent' must be at most 100");
+        return -1;
+    }
+    if (config.block_cache.sync_delay > S3BACKER_MAX_BLOCK_CACHE_SYNC_DELAY) {
+        warnx("`--blockCacheFileSyncDelay' must be at most %u microseconds", S3BACKER_MAX_BLOCK_CACHE_SYNC_DELAY);
+        return -1;
+    }
+#if !LIBURING
+    if (config.block_cache.use_uring) {
+        warnx("`--blockCacheFileUring' is not supported (s3backer was built without liburing)");
+        return -1;
+    }
+#endif
     if (config.block_cache.cache_file == NULL && config.block_cache.recover_dirty_blocks) {
         warnx("`--blockCacheRecoverDirtyBlocks' requires specifying `--blockCacheFile'");
         return -1;
     }
+    if (config.block_cache.write_coalesce > S3BACKER_MAX_BLOCK_CACHE_WRITE_COALESCE) {
+        warnx("`--blockCacheWriteCoalesce' must be at most %u", S3BACKER_MAX_BLOCK_CACHE_WRITE_COALESCE);
+        return -1;
+    }
+    if (config.block_cache.cache_file != NULL && config.block_cache.write_coalesce > 1) {
+        warnx("`--blockCacheWriteCoalesce' is incompatible with `--blockCacheFile'");
+        return -1;
+    }
+    if (config.block_cache.write_coalesce > 1
+      && (config.test || config.http_io.encode_threads == 0 || !config.http_io.async_http || config.ec_protect.cache_size > 0)) {
+        warnx("`--blockCacheWriteCoalesce' requires `--encodeThreads' and `--asyncHttp' and a zero `--md5CacheSize'");
+        return -1;
+    }
+    if (config.block_cache.cache_file != NULL && config.block_cache.partial_writes) {
+        warnx("`--blockCachePartialWrites' is incompatible with `--blockCacheFile'");
+        return -1;
+    }
     if (config.block_cache.num_protected > config.block_cache.cache_size)
         warnx("`--blockCacheNumProtected' is larger than cache size; this may cause performance problems");
 
@@ -1592,6 +1879,10 @@ validate_config(int parse_only)
     }
 
     // Check list blocks threads
+    if (config.http_io.list_blocks_save && !config.list_blocks) {
+        warnx("the `--listBlocksSave' flag requires `--listBlocks'");
+        return -1;
+    }
     if (config.list_blocks && config.http_io.list_blocks_threads < 1) {
         warnx("invalid listBlocksThreads %u", config.http_io.list_blocks_threads);
         return -1;
@@ -1902,6 +2193,7 @@ dump_config(const struct s3b_config *const c)
     (*c->log)(LOG_DEBUG, "%24s: %s", "accessType", c->http_io.accessType);
     (*c->log)(LOG_DEBUG, "%24s: \"%s\"", "ec2iam_role", c->http_io.ec2iam_role != NULL ? c->http_io.ec2iam_role : "");
     (*c->log)(LOG_DEBUG, "%24s: %s", "authVersion", c->http_io.authVersion);
+    (*c->log)(LOG_DEBUG, "%24s: %s", "unsigned_payload", c->http_io.unsigned_payload ? "true" : "false");
     (*c->log)(LOG_DEBUG, "%24s: \"%s\"", "baseURL", c->http_io.baseURL);
     (*c->log)(LOG_DEBUG, "%24s: \"%s\"", "region", c->http_io.region);
     (*c->log)(LOG_DEBUG, "%24s: \"%s\"", c->test ? "testdir" : "bucket", c->bucket);
@@ -1910,16 +2202,21 @@ dump_config(const struct s3b_config *const c)
     (*c->log)(LOG_DEBUG, "%24s: \"%s\"", "defaultContentEncoding",
       c->http_io.default_ce != NULL ? c->http_io.default_ce : "(none)");
     (*c->log)(LOG_DEBUG, "%24s: %s", "list_blocks", c->list_blocks ? "true" : "false");
+    (*c->log)(LOG_DEBUG, "%24s: %s", "list_blocks_save", c->http_io.list_blocks_save ? "true" : "false");
     (*c->log)(LOG_DEBUG, "%24s: %d", "list_blocks_threads", c->http_io.list_blocks_threads);
     (*c->log)(LOG_DEBUG, "%24s: \"%s\"", "mount", c->mount);
     (*c->log)(LOG_DEBUG, "%24s: \"%s\"", "filename", c->fuse_ops.filename);
     (*c->log)(LOG_DEBUG, "%24s: \"%s\"", "stats_filename", c->fuse_ops.stats_filename);
+    (*c->log)(LOG_DEBUG, "%24s: %u", "stats_trace_size", c->http_io.trace_size);
     (*c->log)(LOG_DEBUG, "%24s: %s (%u)", "block_size", c->block_size_str != NULL ? c->block_size_str : "-", c->block_size);
     (*c->log)(LOG_DEBUG, "%24s: %s (%jd)", "file_size", c->file_size_str != NULL ? c->file_size_str : "-", (intmax_t)c->file_size);
     (*c->log)(LOG_DEBUG, "%24s: %jd", "num_blocks", (intmax_t)c->num_blocks);
     (*c->log)(LOG_DEBUG, "%24s: 0%o", "file_mode", c->fuse_ops.file_mode);
     (*c->log)(LOG_DEBUG, "%24s: %s", "read_only", c->fuse_ops.read_only ? "true" : "false");
     (*c->log)(LOG_DEBUG, "%24s: %s", "compress", c->http_io.compress_alg ? c->http_io.compress_alg->name : "(none)");
+    (*c->log)(LOG_DEBUG, "%24s: %s", "compress_adaptive", c->http_io.compress_adaptive ? "true" : "false");
+    (*c->log)(LOG_DEBUG, "%24s: %s", "compress_dict", c->http_io.compress_dict ? "true" : "false");
+    (*c->log)(LOG_DEBUG, "%24s: %u", "compress_dict_samples", c->http_io.compress_dict_samples);
     (*c->log)(LOG_DEBUG, "%24s: %s", "encryption", c->http_io.encryption != NULL ? c->http_io.encryption : "(none)");
     (*c->log)(LOG_DEBUG, "%24s: %u", "key_length", c->http_io.key_length);
     (*c->log)(LOG_DEBUG, "%24s: \"%s\"", "password", c->http_io.password != NULL ? "****" : "");
@@ -1930,7 +2227,12 @@ dump_config(const struct s3b_config *const c)
       c->max_speed_str[HTTP_DOWNLOAD] != NULL ? c->max_speed_str[HTTP_DOWNLOAD] : "-",
       c->http_io.max_speed[HTTP_DOWNLOAD]);
     (*c->log)(LOG_DEBUG, "%24s: %s", "http_11", c->http_io.http_11 ? "true" : "false");
+    (*c->log)(LOG_DEBUG, "%24s: %s", "async_http", c->http_io.async_http ? "true" : "false");
+    (*c->log)(LOG_DEBUG, "%24s: %u", "read_hedge_percentile", c->http_io.read_hedge);
+    (*c->log)(LOG_DEBUG, "%24s: %u", "request_limit", c->http_io.request_limit);
     (*c->log)(LOG_DEBUG, "%24s: %us", "timeout", c->http_io.timeout);
+    (*c->log)(LOG_DEBUG, "%24s: %u", "warm_connections", c->http_io.warm_connections);
+    (*c->log)(LOG_DEBUG, "%24s: %u", "encode_threads", c->http_io.encode_threads);
     (*c->log)(LOG_DEBUG, "%24s: \"%s\"", "sse", c->http_io.sse);
     (*c->log)(LOG_DEBUG, "%24s: \"%s\"", "sse-key-id", c->http_io.sse_key_id);
     (*c->log)(LOG_DEBUG, "%24s: %ums", "initial_retry_pause", c->http_io.initial_retry_pause);
@@ -1938,19 +2240,30 @@ dump_config(const struct s3b_config *const c)
     (*c->log)(LOG_DEBUG, "%24s: %ums", "min_write_delay", c->ec_protect.min_write_delay);
     (*c->log)(LOG_DEBUG, "%24s: %ums", "md5_cache_time", c->ec_protect.cache_time);
     (*c->log)(LOG_DEBUG, "%24s: %u entries", "md5_cache_size", c->ec_protect.cache_size);
+    (*c->log)(LOG_DEBUG, "%24s: \"%s\"", "md5_cache_file", c->ec_protect.cache_file != NULL ? c->ec_protect.cache_file : "");
     (*c->log)(LOG_DEBUG, "%24s: %u entries", "block_cache_size", c->block_cache.cache_size);
     (*c->log)(LOG_DEBUG, "%24s: %u threads", "block_cache_threads", c->block_cache.num_threads);
+    (*c->log)(LOG_DEBUG, "%24s: %u", "block_cache_shards", c->block_cache.num_shards);
     (*c->log)(LOG_DEBUG, "%24s: %ums", "block_cache_timeout", c->block_cache.timeout);
     (*c->log)(LOG_DEBUG, "%24s: %ums", "block_cache_write_delay", c->block_cache.write_delay);
+    (*c->log)(LOG_DEBUG, "%24s: %u blocks", "block_cache_write_coalesce", c->block_cache.write_coalesce);
     (*c->log)(LOG_DEBUG, "%24s: %u blocks", "block_cache_max_dirty", c->block_cache.max_dirty);
     (*c->log)(LOG_DEBUG, "%24s: %s", "block_cache_sync", c->block_cache.synchronous ? "true" : "false");
     (*c->log)(LOG_DEBUG, "%24s: %s", "recover_dirty_blocks", c->block_cache.recover_dirty_blocks ? "true" : "false");
     (*c->log)(LOG_DEBUG, "%24s: %u blocks", "read_ahead", c->block_cache.read_ahead);
     (*c->log)(LOG_DEBUG, "%24s: %u blocks", "read_ahead_trigger", c->block_cache.read_ahead_trigger);
+    (*c->log)(LOG_DEBUG, "%24s: %u blocks", "read_ahead_max", c->block_cache.read_ahead_max);
     (*c->log)(LOG_DEBUG, "%24s: \"%s\"", "block_cache_cache_file",
       c->block_cache.cache_file != NULL ? c->block_cache.cache_file : "");
     (*c->log)(LOG_DEBUG, "%24s: %s", "block_cache_no_verify", c->block_cache.no_verify ? "true" : "false");
+    (*c->log)(LOG_DEBUG, "%24s: %s", "block_cache_partial_writes", c->block_cache.partial_writes ? "true" : "false");
+    (*c->log)(LOG_DEBUG, "%24s: %s", "block_cache_scan_resistant", c->block_cache.scan_resistant ? "true" : "false");
     (*c->log)(LOG_DEBUG, "%24s: %s", "fadvise", c->block_cache.fadvise ? "true" : "false");
+    (*c->log)(LOG_DEBUG, "%24s: %s", "block_cache_mmap", c->block_cache.use_mmap ? "true" : "false");
+    (*c->log)(LOG_DEBUG, "%24s: %s", "block_cache_uring", c->block_cache.use_uring ? "true" : "false");
+    (*c->log)(LOG_DEBUG, "%24s: %uus", "block_cache_sync_delay", c->block_cache.sync_delay);
+    (*c->log)(LOG_DEBUG, "%24s: %s", "block_cache_index", c->block_cache.use_index ? "true" : "false");
+    (*c->log)(LOG_DEBUG, "%24s: %s", "block_cache_huge_pages", c->block_cache.huge_pages ? "true" : "false");
     if (!c->nbd) {
         (*c->log)(LOG_DEBUG, "fuse_main arguments:");
         for (i = 0; i < c->fuse_args.argc; i++)
@@ -1985,26 +2298,40 @@ usage(void)
         fprintf(stderr, "%s%s", sptr != s3_auth_types ? ", " : "  ", *sptr);
     fprintf(stderr, "\n");
     fprintf(stderr, "\t--%-27s %s\n", "accessEC2IAM=ROLE", "Acquire S3 credentials from EC2 machine via IAM role");
+    fprintf(stderr, "\t--%-27s %s\n", "asyncHttp", "Multiplex HTTP transfers through an event loop thread");
     fprintf(stderr, "\t--%-27s %s\n", "baseURL=URL", "Base URL for all requests");
     fprintf(stderr, "\t--%-27s %s\n", "blockCacheFile=FILE", "Block cache persistent file");
     fprintf(stderr, "\t--%-27s %s\n", "blockCacheMaxDirty=NUM", "Block cache maximum number of dirty blocks");
     fprintf(stderr, "\t--%-27s %s\n", "blockCacheNoVerify", "Disable verification of data loaded from cache file");
     fprintf(stderr, "\t--%-27s %s\n", "blockCacheFileAdvise", "Use posix_fadvise(2) after reading from cache file");
+    fprintf(stderr, "\t--%-27s %s\n", "blockCacheFileMmap", "Access cache file data via mmap(2)");
+    fprintf(stderr, "\t--%-27s %s\n", "blockCacheFileUring", "Submit ordered cache file updates via io_uring");
+    fprintf(stderr, "\t--%-27s %s\n", "blockCacheFileSyncDelay=MICROS", "Cache file group commit delay");
+    fprintf(stderr, "\t--%-27s %s\n", "blockCacheFileIndex", "Snapshot cache file directory at shutdown for fast startup");
+    fprintf(stderr, "\t--%-27s %s\n", "blockCacheHugePages", "Use huge pages for block cache memory");
+    fprintf(stderr, "\t--%-27s %s\n", "blockCacheShards=NUM", "Number of independently locked block cache shards");
     fprintf(stderr, "\t--%-27s %s\n", "blockCacheSize=NUM", "Block cache size (in number of blocks)");
     fprintf(stderr, "\t--%-27s %s\n", "blockCacheSync", "Block cache performs all writes synchronously");
+    fprintf(stderr, "\t--%-27s %s\n", "blockCachePartialWrites", "Don't read blocks before caching partial writes to them");
     fprintf(stderr, "\t--%-27s %s\n", "blockCacheRecoverDirtyBlocks", "Recover dirty cache file blocks on startup");
+    fprintf(stderr, "\t--%-27s %s\n", "blockCacheScanResistant", "Protect re-used blocks from eviction by sequential scans");
     fprintf(stderr, "\t--%-27s %s\n", "blockCacheThreads=NUM", "Block cache write-back thread pool size");
     fprintf(stderr, "\t--%-27s %s\n", "blockCacheTimeout=MILLIS", "Block cache entry timeout (zero = infinite)");
+    fprintf(stderr, "\t--%-27s %s\n", "blockCacheWriteCoalesce=NUM", "Write back up to NUM consecutive dirty blocks together");
     fprintf(stderr, "\t--%-27s %s\n", "blockCacheWriteDelay=MILLIS", "Block cache maximum write-back delay");
     fprintf(stderr, "\t--%-27s %s\n", "blockCacheNumProtected=NUM", "Preferentially retain NUM blocks in the block cache");
     fprintf(stderr, "\t--%-27s %s\n", "blockSize=SIZE", "Block size (with optional suffix 'K', 'M', 'G', etc.)");
     fprintf(stderr, "\t--%-27s %s\n", "blockHashPrefix", "Prepend hash to block names for even distribution");
     fprintf(stderr, "\t--%-27s %s\n", "cacert=FILE", "Specify SSL certificate authority file");
     fprintf(stderr, "\t--%-27s %s\n", "compress[=LEVEL]", "Enable block compression, with 1=fast up to 9=small");
+    fprintf(stderr, "\t--%-27s %s\n", "compressAdaptive", "Skip incompressible blocks and pick level by CPU vs. upload time");
+    fprintf(stderr, "\t--%-27s %s\n", "compressDict", "Compress using a dictionary trained from written blocks");
+    fprintf(stderr, "\t--%-27s %s\n", "compressDictSamples=NUM", "Number of written blocks to train the dictionary from");
     fprintf(stderr, "\t--%-27s %s\n", "configFile=FILE", "Substitute command line flags and arguments read from FILE");
     fprintf(stderr, "\t--%-27s %s\n", "debug", "Enable logging of debug messages");
     fprintf(stderr, "\t--%-27s %s\n", "debug-http", "Print HTTP headers to standard output");
     fprintf(stderr, "\t--%-27s %s\n", "directIO", "Disable kernel caching of the backed file");
+    fprintf(stderr, "\t--%-27s %s\n", "encodeThreads=NUM", "Compress and encrypt multi-block writes ahead using NUM threads");
     fprintf(stderr, "\t--%-27s %s\n", "encrypt[=CIPHER]", "Enable encryption (implies `--compress')");
     fprintf(stderr, "\t--%-27s %s\n", "erase", "Erase all blocks in the filesystem");
     fprintf(stderr, "\t--%-27s %s\n", "fileMode=MODE", "Permissions of backed file in filesystem");
@@ -2016,10 +2343,12 @@ usage(void)
     fprintf(stderr, "\t--%-27s %s\n", "insecure", "Don't verify SSL server identity");
     fprintf(stderr, "\t--%-27s %s\n", "keyLength", "Override generated cipher key length");
     fprintf(stderr, "\t--%-27s %s\n", "listBlocks", "Auto-detect non-empty blocks at startup");
+    fprintf(stderr, "\t--%-27s %s\n", "listBlocksSave", "Save block list at unmount and reuse it at next mount");
     fprintf(stderr, "\t--%-27s %s\n", "listBlocksThreads", "List blocks in parallel using this many threads");
     fprintf(stderr, "\t--%-27s %s\n", "maxDownloadSpeed=BITSPERSEC", "Max download bandwidth for a single read");
     fprintf(stderr, "\t--%-27s %s\n", "maxRetryPause=MILLIS", "Max total pause after stale data or server error");
     fprintf(stderr, "\t--%-27s %s\n", "maxUploadSpeed=BITSPERSEC", "Max upload bandwidth for a single write");
+    fprintf(stderr, "\t--%-27s %s\n", "md5CacheFile=FILE", "File for MD5 cache table instead of memory");
     fprintf(stderr, "\t--%-27s %s\n", "md5CacheSize=NUM", "Max size of MD5 cache (zero = disabled)");
     fprintf(stderr, "\t--%-27s %s\n", "md5CacheTime=MILLIS", "Expire time for MD5 cache (zero = infinite)");
     fprintf(stderr, "\t--%-27s %s\n", "minWriteDelay=MILLIS", "Minimum time between same block writes");
@@ -2031,35 +2360,48 @@ usage(void)
     fprintf(stderr, "\t--%-27s %s\n", "defaultContentEncoding=STRING", "Default HTTP Content-Encoding if none given");
     fprintf(stderr, "\t--%-27s %s\n", "quiet", "Omit progress output at startup");
     fprintf(stderr, "\t--%-27s %s\n", "readAhead=NUM", "Number of blocks to read-ahead");
+    fprintf(stderr, "\t--%-27s %s\n", "readAheadMax=NUM", "Max # of blocks to read-ahead as read-ahead adapts");
     fprintf(stderr, "\t--%-27s %s\n", "readAheadTrigger=NUM", "# of sequentially read blocks to trigger read-ahead");
+    fprintf(stderr, "\t--%-27s %s\n", "readHedgePercentile=NUM", "Re-send GETs slower than this latency percentile");
     fprintf(stderr, "\t--%-27s %s\n", "readOnly", "Return `Read-only file system' error for write attempts");
     fprintf(stderr, "\t--%-27s %s\n", "region=region", "Specify AWS region");
+    fprintf(stderr, "\t--%-27s %s\n", "requestLimit=NUM", "Adapt # of concurrent HTTP requests up to NUM");
     fprintf(stderr, "\t--%-27s %s\n", "reset-mounted-flag", "Reset `already mounted' flag in the filesystem");
     fprintf(stderr, "\t--%-27s %s\n", "size=SIZE", "File size (with optional suffix 'K', 'M', 'G', etc.)");
     fprintf(stderr, "\t--%-27s %s\n", "sse=TYPE", "Specify server side encryption ('" SSE_AES256 "' or '" SSE_AWS_KMS "')");
     fprintf(stderr, "\t--%-27s %s\n", "ss-key-id=ID", "Specify server side encryption customer key ID");
     fprintf(stderr, "\t--%-27s %s\n", "ssl", "Enable SSL");
     fprintf(stderr, "\t--%-27s %s\n", "statsFilename=NAME", "Name of statistics file in filesystem");
+    fprintf(stderr, "\t--%-27s %s\n", "statsTraceSize=NUM", "Show the last NUM HTTP requests in statistics file");
     fprintf(stderr, "\t--%-27s %s\n", "storageClass=TYPE", "Specify storage class for written blocks");
     fprintf(stderr, "\t--%-27s %s\n", "test", "Run in local test mode (bucket is a directory)");
+    fprintf(stderr, "\t--%-27s %s\n", "test-bandwidth=KBPS", "In test mode, limit each I/O operation to KBPS kilobytes/sec");
     fprintf(stderr, "\t--%-27s %s\n", "test-delays", "In test mode, introduce random I/O delays");
     fprintf(stderr, "\t--%-27s %s\n", "test-discard", "In test mode, discard data and perform no I/O operations");
+    fprintf(stderr, "\t--%-27s %s\n", "test-error-percent=NUM", "In test mode, fail NUM percent of I/O operations");
     fprintf(stderr, "\t--%-27s %s\n", "test-errors", "In test mode, introduce random I/O errors");
+    fprintf(stderr, "\t--%-27s %s\n", "test-latency=MILLIS", "In test mode, add I/O latency averaging MILLIS");
     fprintf(stderr, "\t--%-27s %s\n", "timeout=SECONDS", "Max time allowed for one HTTP operation");
     fprintf(stderr, "\t--%-27s %s\n", "timeout=SECONDS", "Specify HTTP operation timeout");
+    fprintf(stderr, "\t--%-27s %s\n", "unsignedPayload", "Don't include a hash of the data in request signatures");
     fprintf(stderr, "\t--%-27s %s\n", "version", "Show version information and exit");
     fprintf(stderr, "\t--%-27s %s\n", "vhost", "Use virtual host bucket style URL for all requests");
+    fprintf(stderr, "\t--%-27s %s\n", "warmConnections=NUM", "Pre-open this many HTTP connections at startup");
     fprintf(stderr, "Default values:\n");
     fprintf(stderr, "\t--%-27s \"%s\"\n", "accessFile", "$HOME/" S3BACKER_DEFAULT_PWD_FILE);
     fprintf(stderr, "\t--%-27s %s\n", "accessId", "The first one listed in `accessFile'");
     fprintf(stderr, "\t--%-27s \"%s\"\n", "accessType", S3BACKER_DEFAULT_ACCESS_TYPE);
     fprintf(stderr, "\t--%-27s \"%s\"\n", "authVersion", S3BACKER_DEFAULT_AUTH_VERSION);
     fprintf(stderr, "\t--%-27s \"%s\"\n", "baseURL", "http://s3." S3_DOMAIN "/");
+    fprintf(stderr, "\t--%-27s %u\n", "blockCacheFileSyncDelay", S3BACKER_DEFAULT_BLOCK_CACHE_SYNC_DELAY);
+    fprintf(stderr, "\t--%-27s %u\n", "blockCacheShards", S3BACKER_DEFAULT_BLOCK_CACHE_NUM_SHARDS);
     fprintf(stderr, "\t--%-27s %u\n", "blockCacheSize", S3BACKER_DEFAULT_BLOCK_CACHE_SIZE);
     fprintf(stderr, "\t--%-27s %u\n", "blockCacheThreads", S3BACKER_DEFAULT_BLOCK_CACHE_NUM_THREADS);
     fprintf(stderr, "\t--%-27s %u\n", "blockCacheTimeout", S3BACKER_DEFAULT_BLOCK_CACHE_TIMEOUT);
     fprintf(stderr, "\t--%-27s %u\n", "blockCacheWriteDelay", S3BACKER_DEFAULT_BLOCK_CACHE_WRITE_DELAY);
     fprintf(stderr, "\t--%-27s %d\n", "blockSize", S3BACKER_DEFAULT_BLOCKSIZE);
+    fprintf(stderr, "\t--%-27s %u\n", "compressDictSamples", S3BACKER_DEFAULT_COMPRESS_DICT_SAMPLES);
+    fprintf(stderr, "\t--%-27s %u\n", "encodeThreads", S3BACKER_DEFAULT_ENCODE_THREADS);
     fprintf(stderr, "\t--%-27s \"%s\"\n", "filename", S3BACKER_DEFAULT_FILENAME);
     fprintf(stderr, "\t--%-27s %u\n", "initialRetryPause", S3BACKER_DEFAULT_INITIAL_RETRY_PAUSE);
     fprintf(stderr, "\t--%-27s %u\n", "listBlocksThreads", S3BACKER_DEFAULT_LIST_BLOCKS_THREADS);
@@ -2071,6 +2413,7 @@ usage(void)
     fprintf(stderr, "\t--%-27s %u\n", "minWriteDelay", S3BACKER_DEFAULT_MIN_WRITE_DELAY);
     fprintf(stderr, "\t--%-27s \"%s\"\n", "prefix", S3BACKER_DEFAULT_PREFIX);
     fprintf(stderr, "\t--%-27s %u\n", "readAhead", S3BACKER_DEFAULT_READ_AHEAD);
+    fprintf(stderr, "\t--%-27s %u\n", "readAheadMax", S3BACKER_DEFAULT_READ_AHEAD_MAX);
     fprintf(stderr, "\t--%-27s %u\n", "readAheadTrigger", S3BACKER_DEFAULT_READ_AHEAD_TRIGGER);
     fprintf(stderr, "\t--%-27s \"%s\"\n", "region", S3BACKER_DEFAULT_REGION);
     fprintf(stderr, "\t--%-27s \"%s\"\n", "statsFilename", S3BACKER_DEFAULT_STATS_FILENAME);
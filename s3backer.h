@@ -42,6 +42,7 @@
 #include <sys/statvfs.h>
 #endif
 #include <sys/queue.h>
+#include <sys/mman.h>
 #include <sys/wait.h>
 
 // Add some queue.h definitions missing on Linux
@@ -78,6 +79,7 @@
 #include <time.h>
 #include <unistd.h>
 #include <limits.h>
+#include <math.h>
 #include <signal.h>
 
 #include <openssl/bio.h>
@@ -112,8 +114,8 @@
 // Integral type for holding a block number
 typedef uint32_t    s3b_block_t;
 
-// Integral type used for bitmaps
-typedef uintptr_t   bitmap_t;
+// Bitmap type (opaque)
+typedef struct bitmap bitmap_t;
 
 /*
  * How many hex digits we will use to print a block number.
@@ -129,6 +131,19 @@ typedef int         block_list_func_t(void *arg, const s3b_block_t *block_nums,
 // Block write cancel check function type
 typedef int         check_cancel_t(void *arg, s3b_block_t block_num);
 
+/*
+ * Latency histogram, in microseconds. Each power of two range is divided into LATENCY_HIST_SUB_BUCKETS
+ * linear buckets, so percentiles are accurate to within 1/LATENCY_HIST_SUB_BUCKETS (12.5%). Counts are
+ * updated atomically, so latency_hist_record() may be invoked without holding any lock.
+ */
+#define LATENCY_HIST_SUB_BITS       3
+#define LATENCY_HIST_SUB_BUCKETS    (1 << LATENCY_HIST_SUB_BITS)
+#define LATENCY_HIST_MAX_BITS       40                                  // 2^40 microseconds is about 12 days
+#define LATENCY_HIST_BUCKETS        ((LATENCY_HIST_MAX_BITS - LATENCY_HIST_SUB_BITS + 1) << LATENCY_HIST_SUB_BITS)
+struct latency_hist {
+    u_int           counts[LATENCY_HIST_BUCKETS];
+};
+
 // Backing store instance structure
 struct s3backer_store {
 
@@ -218,6 +233,33 @@ struct s3backer_store {
      */
     int         (*read_block_part)(struct s3backer_store *s3b, s3b_block_t block_num, u_int off, u_int len, void *dest);
 
+    /*
+     * Read a range of consecutive blocks into a single buffer, which must have room for num_blocks blocks.
+     *
+     * This is equivalent to invoking read_block() (with no ETags) on each block in turn, except that the
+     * implementation is free to read the blocks in any order, including concurrently, in order to reduce
+     * the overall latency of large reads. If an error occurs, the contents of *dest are undefined.
+     *
+     * Implementations that have nothing better to offer may use generic_read_blocks().
+     *
+     * Returns zero on success or a (positive) errno value on error.
+     * May return ENOTCONN if create_threads() has not yet been invoked.
+     */
+    int         (*read_blocks)(struct s3backer_store *s3b, s3b_block_t block_num, u_int num_blocks, void *dest);
+
+    /*
+     * Start loading a range of consecutive blocks into a cache in the background, so that later reads are fast.
+     *
+     * This is an optional function; if not supported, this hook may be null.
+     *
+     * This does not wait for the blocks to be read; it's only a hint, and the implementation may ignore some or all
+     * of the blocks (for example, if there are more than would fit in the cache). Read errors are not reported.
+     *
+     * Returns zero on success or a (positive) errno value on error.
+     * May return ENOTCONN if create_threads() has not yet been invoked.
+     */
+    int         (*prefetch_blocks)(struct s3backer_store *s3b, s3b_block_t block_num, u_int num_blocks);
+
     /*
      * Write one block.
      *
@@ -245,6 +287,20 @@ struct s3backer_store {
      */
     int         (*write_block_part)(struct s3backer_store *s3b, s3b_block_t block_num, u_int off, u_int len, const void *src);
 
+    /*
+     * Write a range of consecutive blocks from a single buffer containing num_blocks blocks of data.
+     *
+     * This is equivalent to invoking write_block() (with no ETag or cancel callback) on each block in turn,
+     * except that the implementation may handle the blocks as a batch. If an error occurs, some of the blocks
+     * may have been written and others not.
+     *
+     * Implementations that have nothing better to offer may use generic_write_blocks().
+     *
+     * Returns zero on success or a (positive) errno value on error.
+     * May return ENOTCONN if create_threads() has not yet been invoked.
+     */
+    int         (*write_blocks)(struct s3backer_store *s3b, s3b_block_t block_num, u_int num_blocks, const void *src);
+
     /*
      * Bulk block zeroing (i.e., deletion).
      *
@@ -285,6 +341,19 @@ struct s3backer_store {
      */
     int         (*survey_non_zero)(struct s3backer_store *s3b, block_list_func_t *callback, void *arg);
 
+    /*
+     * Determine whether the blocks starting at "block_num" are known to be zero, without performing any network I/O.
+     *
+     * Upon return, *zerop is set to 1 if block "block_num" is known to be zero, or 0 if it could possibly be non-zero,
+     * and *countp is set to the number of consecutive blocks starting at "block_num" having the same status, which
+     * will be at least one and at most "num_blocks" (which must be greater than zero).
+     *
+     * Implementations that have nothing better to offer may use generic_block_status().
+     *
+     * Returns zero on success or a (positive) errno value on error.
+     */
+    int         (*block_status)(struct s3backer_store *s3b, s3b_block_t block_num, u_int num_blocks, int *zerop, u_int *countp);
+
     /*
      * Shutdown this instance. Sync any dirty data to the underlying data store (as required).
      *
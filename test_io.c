@@ -64,6 +64,10 @@ static int test_io_survey_non_zero(struct s3backer_store *s3b, block_list_func_t
 static int test_io_shutdown(struct s3backer_store *s3b);
 static void test_io_destroy(struct s3backer_store *s3b);
 
+// Internal functions
+static void test_io_inject_delay(struct test_io_conf *config, u_int num_bytes);
+static int test_io_inject_error(struct test_io_conf *config);
+
 /*
  * Constructor
  *
@@ -83,10 +87,13 @@ test_io_create(struct test_io_conf *config)
     s3b->meta_data = test_io_meta_data;
     s3b->set_mount_token = test_io_set_mount_token;
     s3b->read_block = test_io_read_block;
+    s3b->read_blocks = generic_read_blocks;
     s3b->write_block = test_io_write_block;
+    s3b->write_blocks = generic_write_blocks;
     s3b->bulk_zero = generic_bulk_zero;
     s3b->flush_blocks = test_io_flush_blocks;
     s3b->survey_non_zero = test_io_survey_non_zero;
+    s3b->block_status = generic_block_status;
     s3b->shutdown = test_io_shutdown;
     s3b->destroy = test_io_destroy;
     if ((priv = calloc(1, sizeof(*priv))) == NULL) {
@@ -97,11 +104,11 @@ test_io_create(struct test_io_conf *config)
     s3b->data = priv;
 
     // Initialize bitmaps and mutex
-    if ((priv->blocks_reading = bitmap_init(config->num_blocks, 0)) == NULL) {
+    if ((priv->blocks_reading = bitmap_init(config->num_blocks, 0, 0)) == NULL) {
         r = errno;
         goto fail2;
     }
-    if ((priv->blocks_writing = bitmap_init(config->num_blocks, 0)) == NULL) {
+    if ((priv->blocks_writing = bitmap_init(config->num_blocks, 0, 0)) == NULL) {
         r = errno;
         goto fail3;
     }
@@ -109,7 +116,7 @@ test_io_create(struct test_io_conf *config)
         goto fail4;
 
     // Random initialization
-    if (config->random_delays || config->random_errors)
+    if (config->random_delays || config->random_errors || config->latency != 0 || config->error_percent != 0)
         srandom((u_int)time(NULL));
 
     // Done
@@ -229,8 +236,7 @@ test_io_read_block(struct s3backer_store *const s3b, s3b_block_t block_num, void
         (*config->log)(LOG_DEBUG, "test_io: read %0*jx started", S3B_BLOCK_NUM_DIGITS, (uintmax_t)block_num);
 
     // Random delay
-    if (config->random_delays)
-        usleep((random() % 200) * 1000);
+    test_io_inject_delay(config, config->block_size);
 
     // Detect overlapping reads and/or writes
     pthread_mutex_lock(&priv->mutex);
@@ -245,7 +251,7 @@ test_io_read_block(struct s3backer_store *const s3b, s3b_block_t block_num, void
     }
 
     // Random error
-    if (config->random_errors && (random() % 100) < RANDOM_ERROR_PERCENT) {
+    if (test_io_inject_error(config)) {
         (*config->log)(LOG_ERR, "test_io: random failure reading %0*jx", S3B_BLOCK_NUM_DIGITS, (uintmax_t)block_num);
         r = EAGAIN;
         goto done;
@@ -409,8 +415,7 @@ test_io_write_block(struct s3backer_store *const s3b, s3b_block_t block_num, con
     }
 
     // Random delay
-    if (config->random_delays)
-        usleep((random() % 200) * 1000);
+    test_io_inject_delay(config, src != NULL ? config->block_size : 0);
 
     // Detect overlapping reads and/or writes
     pthread_mutex_lock(&priv->mutex);
@@ -425,7 +430,7 @@ test_io_write_block(struct s3backer_store *const s3b, s3b_block_t block_num, con
     }
 
     // Random error
-    if (config->random_errors && (random() % 100) < RANDOM_ERROR_PERCENT) {
+    if (test_io_inject_error(config)) {
         (*config->log)(LOG_ERR, "test_io: random failure writing %0*jx", S3B_BLOCK_NUM_DIGITS, (uintmax_t)block_num);
         r = EAGAIN;
         goto done;
@@ -538,3 +543,46 @@ test_io_survey_non_zero(struct s3backer_store *s3b, block_list_func_t *callback,
     // Done
     return r;
 }
+
+/*
+ * Simulate the latency of an S3 request transferring the given number of bytes.
+ *
+ * The fixed part of the latency is exponentially distributed, which gives a long tail similar to
+ * what is seen with real S3, and the transfer time is determined by the configured bandwidth.
+ */
+static void
+test_io_inject_delay(struct test_io_conf *config, u_int num_bytes)
+{
+    struct timespec delay;
+    uint64_t micros = 0;
+
+    // Legacy random delay
+    if (config->random_delays)
+        micros += (uint64_t)(random() % 200) * 1000;
+
+    // Exponentially distributed latency
+    if (config->latency != 0)
+        micros += (uint64_t)(-log((random() + 1.0) / (RAND_MAX + 2.0)) * config->latency * 1000.0);
+
+    // Transfer time
+    if (config->bandwidth != 0)
+        micros += (uint64_t)num_bytes * 1000000 / ((uint64_t)config->bandwidth * 1024);
+
+    // Sleep
+    if (micros == 0)
+        return;
+    delay.tv_sec = micros / 1000000;
+    delay.tv_nsec = (micros % 1000000) * 1000;
+    nanosleep(&delay, NULL);
+}
+
+/*
+ * Determine whether to simulate a failed request.
+ */
+static int
+test_io_inject_error(struct test_io_conf *config)
+{
+    const u_int percent = config->error_percent != 0 ? config->error_percent : config->random_errors ? RANDOM_ERROR_PERCENT : 0;
+
+    return percent > 0 && (random() % 100) < percent;
+}
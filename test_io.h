@@ -44,6 +44,9 @@ struct test_io_conf {
     int                 blockHashPrefix;
     int                 random_errors;
     int                 random_delays;
+    u_int               latency;
+    u_int               bandwidth;
+    u_int               error_percent;
     int                 discard_data;
     int                 debug;
 };
@@ -51,6 +51,59 @@
 #define READ_FACTOR     2
 #define ZERO_FACTOR     3
 
+// Benchmark defaults and limits
+#define BENCH_DEFAULT_SECONDS           30
+#define BENCH_DEFAULT_READ_PERCENT      50
+#define BENCH_DEFAULT_IO_BLOCKS         1
+#define BENCH_DEFAULT_SEED              1
+#define BENCH_DEFAULT_ZIPF_THETA        0.99
+#define BENCH_MAX_THREADS               1024
+
+// Macro for quoting stuff
+#define s3bquote0(x)                    #x
+#define s3bquote(x)                     s3bquote0(x)
+
+// Benchmark access patterns
+enum bench_pattern {
+    BENCH_SEQUENTIAL,
+    BENCH_RANDOM,
+    BENCH_ZIPF
+};
+
+static const char *const bench_pattern_names[] = { "sequential", "random", "zipf" };
+
+// Benchmark configuration (from the "--bench*" flags, which are consumed here and not passed on)
+struct bench_conf {
+    int                 enabled;
+    enum bench_pattern  pattern;
+    u_int               threads;
+    u_int               seconds;
+    u_int               read_percent;
+    u_int               io_blocks;
+    u_long              seed;
+    double              zipf_theta;
+};
+
+// Benchmark results
+struct bench_stats {
+    uint64_t            reads;
+    uint64_t            writes;
+    uint64_t            read_errors;
+    uint64_t            write_errors;
+    struct latency_hist read_latency;
+    struct latency_hist write_latency;
+};
+
+// Pre-computed Zipfian distribution parameters
+struct bench_zipf {
+    s3b_block_t         n;
+    double              theta;
+    double              alpha;
+    double              zetan;
+    double              zeta2;
+    double              eta;
+};
+
 // Block states
 struct block_state {
     u_int               writing;        // block is currently being written by a thread
@@ -63,6 +116,17 @@ static void *test_thread_main(void *arg);
 static void logit(int id, const char *fmt, ...) __attribute__ ((__format__ (__printf__, 2, 3)));
 static void catch_signal(int sig);
 static uint64_t get_time(void);
+static int bench_parse_args(int argc, char **argv);
+static int bench_run(void);
+static void *bench_thread_main(void *arg);
+static s3b_block_t bench_next_block(uint64_t *state, s3b_block_t *cursor);
+static uint64_t bench_random(uint64_t *state);
+static double bench_uniform(uint64_t *state);
+static void bench_zipf_init(struct bench_zipf *zipf, s3b_block_t n, double theta);
+static s3b_block_t bench_zipf_next(const struct bench_zipf *zipf, uint64_t *state);
+static void bench_print_latency(const char *name, const struct latency_hist *hist);
+static void bench_stats_printer(void *prarg, const char *fmt, ...) __attribute__ ((__format__ (__printf__, 2, 3)));
+static void bench_usage(void);
 
 // Internal variables
 static pthread_mutex_t mutex;
@@ -72,6 +136,19 @@ static struct s3backer_store *store;
 static struct block_state *blocks;
 static uint64_t start_time;
 static volatile int stop_threads;
+static FILE *log_file;
+static struct bench_conf bench = {
+    .pattern=       BENCH_RANDOM,
+    .threads=       NUM_THREADS,
+    .seconds=       BENCH_DEFAULT_SECONDS,
+    .read_percent=  BENCH_DEFAULT_READ_PERCENT,
+    .io_blocks=     BENCH_DEFAULT_IO_BLOCKS,
+    .seed=          BENCH_DEFAULT_SEED,
+    .zipf_theta=    BENCH_DEFAULT_ZIPF_THETA,
+};
+static struct bench_stats bench_stats;
+static struct bench_zipf bench_zipf;
+static s3b_block_t bench_span;
 
 int
 main(int argc, char **argv)
@@ -84,10 +161,14 @@ main(int argc, char **argv)
     int r;
 
     // Get configuration
+    log_file = stdout;
+    argc = bench_parse_args(argc, argv);
     if ((config = s3backer_get_config(argc, argv, 0, 0)) == NULL)
         exit(1);
     if (config->block_size < sizeof(u_int))
         err(1, "block size too small");
+    if (bench.enabled && bench.io_blocks > config->num_blocks)
+        errx(1, "`--bench-io-blocks' must be at most the number of blocks (%ju)", (uintmax_t)config->num_blocks);
 
     // Open store
     logit(-1, "creating s3backer store");
@@ -99,6 +180,10 @@ main(int argc, char **argv)
     if ((r = (*store->create_threads)(store)) != 0)
         err(1, "create_threads");
 
+    // Run benchmark instead?
+    if (bench.enabled)
+        return bench_run();
+
     // Allocate block states
     if ((blocks = calloc(config->num_blocks, sizeof(*blocks))) == NULL)
         err(1, "calloc");
@@ -250,13 +335,13 @@ logit(int id, const char *fmt, ...)
 
     pthread_mutex_lock(&log_mutex);
     if (id == -1)
-        printf("%u.%03u [--] ", (u_int)(timestamp / 1000), (u_int)(timestamp % 1000));
+        fprintf(log_file, "%u.%03u [--] ", (u_int)(timestamp / 1000), (u_int)(timestamp % 1000));
     else
-        printf("%u.%03u [%02d] ", (u_int)(timestamp / 1000), (u_int)(timestamp % 1000), id);
+        fprintf(log_file, "%u.%03u [%02d] ", (u_int)(timestamp / 1000), (u_int)(timestamp % 1000), id);
     va_start(args, fmt);
-    vfprintf(stdout, fmt, args);
-    printf("\n");
-    fflush(stdout);
+    vfprintf(log_file, fmt, args);
+    fprintf(log_file, "\n");
+    fflush(log_file);
     va_end(args);
     CHECK_RETURN(pthread_mutex_unlock(&log_mutex));
 }
@@ -275,3 +360,349 @@ catch_signal(int sig)
 {
     // do nothing
 }
+
+/****************************************************************************
+ *                              BENCHMARK MODE                              *
+ ****************************************************************************/
+
+/*
+ * Extract and remove the "--bench*" flags from the command line.
+ *
+ * Returns the new argument count.
+ */
+static int
+bench_parse_args(int argc, char **argv)
+{
+    const int num_patterns = sizeof(bench_pattern_names) / sizeof(*bench_pattern_names);
+    const char *value;
+    char *eptr;
+    int num_args = 1;
+    int i;
+    int j;
+
+    for (i = 1; i < argc; i++) {
+        const char *const arg = argv[i];
+
+        // Not one of ours?
+        if (strncmp(arg, "--bench", 7) != 0) {
+            argv[num_args++] = argv[i];
+            continue;
+        }
+
+        // Parse it
+        if ((value = strchr(arg, '=')) == NULL)
+            bench_usage();
+        value++;
+        bench.enabled = 1;
+        if (strncmp(arg, "--bench=", 8) == 0) {
+            for (j = 0; j < num_patterns && strcmp(value, bench_pattern_names[j]) != 0; j++)
+                ;
+            if (j == num_patterns)
+                bench_usage();
+            bench.pattern = (enum bench_pattern)j;
+            continue;
+        }
+        if (strncmp(arg, "--bench-zipf-theta=", 19) == 0) {
+            bench.zipf_theta = strtod(value, &eptr);
+            if (*value == '\0' || *eptr != '\0' || !(bench.zipf_theta > 0.0 && bench.zipf_theta < 1.0))
+                errx(1, "`--bench-zipf-theta' must be greater than zero and less than one");
+            continue;
+        }
+        if (strncmp(arg, "--bench-seed=", 13) == 0) {
+            bench.seed = strtoul(value, &eptr, 10);
+            if (*value == '\0' || *eptr != '\0')
+                bench_usage();
+            continue;
+        }
+        {
+            u_long num;
+
+            num = strtoul(value, &eptr, 10);
+            if (*value == '\0' || *eptr != '\0' || num > UINT_MAX)
+                bench_usage();
+            if (strncmp(arg, "--bench-threads=", 16) == 0) {
+                if (num < 1 || num > BENCH_MAX_THREADS)
+                    errx(1, "`--bench-threads' must be between 1 and %u", BENCH_MAX_THREADS);
+                bench.threads = (u_int)num;
+            } else if (strncmp(arg, "--bench-seconds=", 16) == 0) {
+                if (num < 1)
+                    errx(1, "`--bench-seconds' must be at least one");
+                bench.seconds = (u_int)num;
+            } else if (strncmp(arg, "--bench-read-percent=", 21) == 0) {
+                if (num > 100)
+                    errx(1, "`--bench-read-percent' must be at most 100");
+                bench.read_percent = (u_int)num;
+            } else if (strncmp(arg, "--bench-io-blocks=", 18) == 0) {
+                if (num < 1)
+                    errx(1, "`--bench-io-blocks' must be at least one");
+                bench.io_blocks = (u_int)num;
+            } else
+                bench_usage();
+        }
+    }
+    argv[num_args] = NULL;
+    return num_args;
+}
+
+static void
+bench_usage(void)
+{
+    fprintf(stderr, "Benchmark flags (any of these enables benchmark mode):\n");
+    fprintf(stderr, "\t--%-27s %s\n", "bench=PATTERN", "Access pattern: sequential, random, or zipf (default random)");
+    fprintf(stderr, "\t--%-27s %s\n", "bench-io-blocks=NUM", "Number of blocks per read or write (default " s3bquote(BENCH_DEFAULT_IO_BLOCKS) ")");
+    fprintf(stderr, "\t--%-27s %s\n", "bench-read-percent=NUM", "Percentage of operations that are reads (default " s3bquote(BENCH_DEFAULT_READ_PERCENT) ")");
+    fprintf(stderr, "\t--%-27s %s\n", "bench-seconds=NUM", "Duration of the benchmark (default " s3bquote(BENCH_DEFAULT_SECONDS) ")");
+    fprintf(stderr, "\t--%-27s %s\n", "bench-seed=NUM", "Random seed for the workload (default " s3bquote(BENCH_DEFAULT_SEED) ")");
+    fprintf(stderr, "\t--%-27s %s\n", "bench-threads=NUM", "Number of concurrent threads (default " s3bquote(NUM_THREADS) ")");
+    fprintf(stderr, "\t--%-27s %s\n", "bench-zipf-theta=NUM", "Skew of the zipf pattern (default " s3bquote(BENCH_DEFAULT_ZIPF_THETA) ")");
+    fprintf(stderr, "Results are written to standard output as a single line of JSON.\n");
+    exit(1);
+}
+
+/*
+ * Run the benchmark against the configured store and print the results.
+ *
+ * Any combination of --test-latency, --test-bandwidth, and --test-error-percent may be used
+ * to make the local test store behave more like S3.
+ */
+static int
+bench_run(void)
+{
+    pthread_t *threads;
+    uint64_t begin_time;
+    uint64_t run_time;
+    uint64_t shutdown_time;
+    double seconds;
+    double mbytes;
+    u_int i;
+    int r;
+
+    // Log to stderr so stdout only has the results
+    log_file = stderr;
+    start_time = get_time();
+
+    // Initialize
+    bench_span = config->num_blocks - bench.io_blocks + 1;
+    if (bench.pattern == BENCH_ZIPF) {
+        logit(-1, "computing zipf distribution for %ju blocks", (uintmax_t)bench_span);
+        bench_zipf_init(&bench_zipf, bench_span, bench.zipf_theta);
+    }
+    if ((threads = calloc(bench.threads, sizeof(*threads))) == NULL)
+        err(1, "calloc");
+
+    // Run benchmark threads
+    logit(-1, "running %s benchmark with %u threads for %u seconds",
+      bench_pattern_names[bench.pattern], bench.threads, bench.seconds);
+    begin_time = get_time();
+    for (i = 0; i < bench.threads; i++) {
+        if ((r = pthread_create(&threads[i], NULL, bench_thread_main, (void *)(intptr_t)i)) != 0)
+            errx(1, "pthread_create: %s", strerror(r));
+    }
+    sleep(bench.seconds);
+    stop_threads = 1;
+    for (i = 0; i < bench.threads; i++)
+        pthread_join(threads[i], NULL);
+    run_time = get_time() - begin_time;
+    free(threads);
+
+    // Shutdown the store, which includes writing back any dirty blocks
+    logit(-1, "shutting down store");
+    begin_time = get_time();
+    if ((r = (*store->shutdown)(store)) != 0)
+        logit(-1, "store shutdown failed: %s", strerror(r));
+    shutdown_time = get_time() - begin_time;
+
+    // Print results
+    seconds = run_time / 1000.0;
+    mbytes = (double)config->block_size * bench.io_blocks / (1024.0 * 1024.0);
+    printf("{\"pattern\":\"%s\",\"threads\":%u,\"block_size\":%u,\"io_blocks\":%u,\"read_percent\":%u,\"seed\":%lu,",
+      bench_pattern_names[bench.pattern], bench.threads, config->block_size, bench.io_blocks, bench.read_percent, bench.seed);
+    if (bench.pattern == BENCH_ZIPF)
+        printf("\"zipf_theta\":%.3f,", bench.zipf_theta);
+    printf("\"seconds\":%.3f,\"shutdown_seconds\":%.3f,", seconds, shutdown_time / 1000.0);
+    printf("\"reads\":%ju,\"writes\":%ju,\"read_errors\":%ju,\"write_errors\":%ju,",
+      (uintmax_t)bench_stats.reads, (uintmax_t)bench_stats.writes,
+      (uintmax_t)bench_stats.read_errors, (uintmax_t)bench_stats.write_errors);
+    printf("\"ops_per_sec\":%.1f,\"read_mb_per_sec\":%.3f,\"write_mb_per_sec\":%.3f,",
+      (bench_stats.reads + bench_stats.writes) / seconds,
+      bench_stats.reads * mbytes / seconds, bench_stats.writes * mbytes / seconds);
+    bench_print_latency("read_latency_ms", &bench_stats.read_latency);
+    printf(",");
+    bench_print_latency("write_latency_ms", &bench_stats.write_latency);
+    printf("}\n");
+    fflush(stdout);
+
+    // Dump per-layer statistics
+    (*config->fuse_ops.print_stats)(stderr, bench_stats_printer);
+
+    // Done
+    logit(-1, "done");
+    return (bench_stats.read_errors + bench_stats.write_errors) != 0 ? 1 : 0;
+}
+
+static void *
+bench_thread_main(void *arg)
+{
+    const int id = (int)(intptr_t)arg;
+    const size_t io_size = (size_t)config->block_size * bench.io_blocks;
+    s3b_block_t cursor = (s3b_block_t)((uintmax_t)bench_span * id / bench.threads);
+    s3b_block_t block_num;
+    uint64_t state;
+    uint64_t begin;
+    u_char *rdata;
+    u_char *data;
+    u_int count = 0;
+    size_t i;
+    int r;
+
+    // Seed this thread's generator; each thread gets its own so the workload is reproducible
+    state = (bench.seed + 1) * 0x9e3779b97f4a7c15ULL + (uint64_t)id * 0xbf58476d1ce4e5b9ULL;
+    if (state == 0)
+        state = 1;
+
+    // Initialize write data with non-zero content
+    if ((data = malloc(io_size)) == NULL || (rdata = malloc(io_size)) == NULL)
+        err(1, "malloc");
+    for (i = 0; i < io_size; i++)
+        data[i] = (u_char)(bench_random(&state) | 1);
+
+    // Loop
+    while (!stop_threads) {
+        block_num = bench_next_block(&state, &cursor);
+        if (bench_random(&state) % 100 < bench.read_percent) {
+            begin = latency_hist_micros();
+            r = (*store->read_blocks)(store, block_num, bench.io_blocks, rdata);
+            latency_hist_record(&bench_stats.read_latency, latency_hist_micros() - begin);
+            ATOMIC_ADD(bench_stats.reads, 1);
+            if (r != 0) {
+                ATOMIC_ADD(bench_stats.read_errors, 1);
+                logit(id, "read %0*jx failed: %s", S3B_BLOCK_NUM_DIGITS, (uintmax_t)block_num, strerror(r));
+            }
+        } else {
+
+            // Make each block's content unique so all writes are real writes
+            count++;
+            for (i = 0; i < bench.io_blocks; i++)
+                memcpy(data + i * config->block_size, &count, sizeof(count));
+            begin = latency_hist_micros();
+            r = (*store->write_blocks)(store, block_num, bench.io_blocks, data);
+            latency_hist_record(&bench_stats.write_latency, latency_hist_micros() - begin);
+            ATOMIC_ADD(bench_stats.writes, 1);
+            if (r != 0) {
+                ATOMIC_ADD(bench_stats.write_errors, 1);
+                logit(id, "write %0*jx failed: %s", S3B_BLOCK_NUM_DIGITS, (uintmax_t)block_num, strerror(r));
+            }
+        }
+    }
+
+    // Done
+    free(rdata);
+    free(data);
+    return NULL;
+}
+
+/*
+ * Choose the first block of the next operation.
+ */
+static s3b_block_t
+bench_next_block(uint64_t *state, s3b_block_t *cursor)
+{
+    s3b_block_t block_num;
+
+    switch (bench.pattern) {
+    case BENCH_SEQUENTIAL:
+        block_num = *cursor;
+        if ((*cursor += bench.io_blocks) >= bench_span)
+            *cursor = 0;
+        return block_num;
+    case BENCH_RANDOM:
+        return (s3b_block_t)(bench_random(state) % bench_span);
+    case BENCH_ZIPF:
+        return bench_zipf_next(&bench_zipf, state);
+    default:
+        assert(0);
+        return 0;
+    }
+}
+
+/*
+ * Per-thread pseudo-random number generator (xorshift64*).
+ */
+static uint64_t
+bench_random(uint64_t *state)
+{
+    uint64_t x = *state;
+
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    *state = x;
+    return x * 0x2545f4914f6cdd1dULL;
+}
+
+// Returns a uniformly distributed value in the range [0, 1)
+static double
+bench_uniform(uint64_t *state)
+{
+    return (bench_random(state) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+/*
+ * Zipfian generator from Gray et al., "Quickly Generating Billion-Record Synthetic Databases".
+ *
+ * Computing zeta(n) is O(n), so it is done once up front.
+ */
+static void
+bench_zipf_init(struct bench_zipf *zipf, s3b_block_t n, double theta)
+{
+    s3b_block_t i;
+
+    memset(zipf, 0, sizeof(*zipf));
+    zipf->n = n;
+    zipf->theta = theta;
+    zipf->alpha = 1.0 / (1.0 - theta);
+    for (i = 1; i <= n; i++)
+        zipf->zetan += 1.0 / pow((double)i, theta);
+    zipf->zeta2 = 1.0 + pow(0.5, theta);
+    zipf->eta = (1.0 - pow(2.0 / n, 1.0 - theta)) / (1.0 - zipf->zeta2 / zipf->zetan);
+}
+
+static s3b_block_t
+bench_zipf_next(const struct bench_zipf *zipf, uint64_t *state)
+{
+    const double u = bench_uniform(state);
+    const double uz = u * zipf->zetan;
+    uint64_t rank;
+
+    // Get the popularity rank
+    if (uz < 1.0)
+        rank = 0;
+    else if (uz < zipf->zeta2)
+        rank = 1;
+    else if ((rank = (uint64_t)(zipf->n * pow(zipf->eta * u - zipf->eta + 1.0, zipf->alpha))) >= zipf->n)
+        rank = zipf->n - 1;
+
+    // Scatter the popular blocks across the device so they are not all adjacent
+    rank = (rank + 1) * 0x9e3779b97f4a7c15ULL;
+    rank ^= rank >> 31;
+    return (s3b_block_t)(rank % zipf->n);
+}
+
+static void
+bench_print_latency(const char *name, const struct latency_hist *hist)
+{
+    printf("\"%s\":{\"p50\":%.3f,\"p99\":%.3f,\"p999\":%.3f}", name,
+      latency_hist_percentile(hist, 50.0) / 1000.0,
+      latency_hist_percentile(hist, 99.0) / 1000.0,
+      latency_hist_percentile(hist, 99.9) / 1000.0);
+}
+
+static void
+bench_stats_printer(void *prarg, const char *fmt, ...)
+{
+    va_list args;
+
+    va_start(args, fmt);
+    vfprintf((FILE *)prarg, fmt, args);
+    va_end(args);
+}
@@ -44,9 +44,42 @@
 #include "s3b_config.h"
 #include "util.h"
 
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#define ZEROS_X86               1
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#define ZEROS_NEON              1
+#endif
+
 // Definitions
 #define MAX_CHILD_PROCESSES     10
 
+// Bitmap chunks
+#define BITMAP_WORD_BITS        ((u_int)sizeof(bitmap_word_t) * 8)
+#define BITMAP_CHUNK_BITS       ((u_int)1 << 16)
+#define BITMAP_CHUNK_WORDS      (BITMAP_CHUNK_BITS / BITMAP_WORD_BITS)
+#define BITMAP_ONES             ((struct bitmap_chunk *)(void *)&bitmap_ones)      // marks a chunk of all ones
+
+// Zero block detection: check one block, or copy one block and check it, returning non-zero if all zeros
+typedef int zeros_check_t(const void *data, size_t len);
+typedef int zeros_copy_t(void *dest, const void *src, size_t len);
+
+// Bitmap word
+typedef uintptr_t bitmap_word_t;
+
+// Bitmap (see bitmap_init())
+struct bitmap_chunk {
+    u_int               count;                          // number of bits set
+    bitmap_word_t       words[BITMAP_CHUNK_WORDS];
+};
+struct bitmap {
+    s3b_block_t         num_blocks;
+    size_t              num_chunks;
+    int                 safe;                           // value bits fall back to if we run out of memory
+    struct bitmap_chunk *chunks[];                      // NULL = all zeros, BITMAP_ONES = all ones, else dense
+};
+
 // Size suffixes
 struct size_suffix {
     const char  *suffix;
@@ -95,6 +128,13 @@ int daemonized;
 const void *zero_block;
 static size_t zero_block_size;
 
+// Zero block detection implementations, chosen at startup based on CPU support
+static zeros_check_t *zeros_check;
+static zeros_copy_t *zeros_copy;
+
+// Address used to mark bitmap chunks that are all ones
+static char bitmap_ones;
+
 // stderr logging mutex
 static pthread_mutex_t stderr_log_mutex = PTHREAD_MUTEX_INITIALIZER;
 
@@ -104,6 +144,24 @@ static int num_child_procs;
 
 // Internal functions
 static pid_t fork_off(const char *executable, char **argv);
+static u_int bitmap_chunk_bits(const bitmap_t *bitmap, size_t index);
+static struct bitmap_chunk *bitmap_chunk_alloc(const bitmap_t *bitmap, size_t index, int value);
+static struct bitmap_chunk *bitmap_chunk_copy(const struct bitmap_chunk *chunk);
+static void bitmap_chunk_fill(bitmap_t *bitmap, size_t index, int value);
+static void bitmap_chunk_settle(bitmap_t *bitmap, size_t index);
+static void bitmap_chunk_trim(const bitmap_t *bitmap, size_t index, struct bitmap_chunk *chunk);
+static u_int bitmap_chunk_popcount(const struct bitmap_chunk *chunk);
+static zeros_check_t zeros_check_generic;
+static zeros_copy_t zeros_copy_generic;
+#if ZEROS_X86
+static zeros_check_t zeros_check_avx2;
+static zeros_copy_t zeros_copy_avx2;
+static zeros_check_t zeros_check_avx512;
+static zeros_copy_t zeros_copy_avx512;
+#elif ZEROS_NEON
+static zeros_check_t zeros_check_neon;
+static zeros_copy_t zeros_copy_neon;
+#endif
 
 /****************************************************************************
  *                      PUBLIC FUNCTION DEFINITIONS                         *
@@ -191,90 +249,300 @@ find_string_in_table(const char *const *table, const char *value)
     return 0;
 }
 
-// Returns the number of bitmap_t's in a bitmap big enough to hold num_blocks bits
-size_t
-bitmap_size(s3b_block_t num_blocks)
-{
-    const size_t bits_per_word = sizeof(bitmap_t) * 8;
-    const size_t nwords = (num_blocks + bits_per_word - 1) / bits_per_word;
-
-    return nwords;
-}
-
+/*
+ * Bitmaps are stored in two levels: an array of pointers to fixed size chunks, where chunks that
+ * are entirely zeros or entirely ones are not allocated at all. Dense chunks track their population
+ * count, and collapse back into one of the two uniform forms whenever they become uniform again.
+ *
+ * This keeps large, mostly uniform bitmaps small, and lets whole-bitmap operations and searches
+ * skip over uniform chunks in constant time.
+ *
+ * Changing a bit in a uniform chunk requires allocating a dense chunk. If that allocation fails,
+ * rather than fail the operation we fall back to the bitmap's "safe" value: that is, the bitmap
+ * errs in the direction which the owner has declared to be harmless (for example, "unknown").
+ * So if the new bit value is the safe value, the entire chunk is set to it; otherwise, the bit
+ * is left unchanged (it already has the safe value).
+ */
 bitmap_t *
-bitmap_init(s3b_block_t num_blocks, int value)
+bitmap_init(s3b_block_t num_blocks, int value, int safe)
 {
+    const size_t num_chunks = ((size_t)num_blocks + BITMAP_CHUNK_BITS - 1) / BITMAP_CHUNK_BITS;
     bitmap_t *bitmap;
-    size_t nbytes;
+    size_t i;
 
-    if (value == 0)
-        bitmap = calloc(bitmap_size(num_blocks), sizeof(*bitmap));
-    else {
-        nbytes = bitmap_size(num_blocks) * sizeof(*bitmap);
-        if ((bitmap = malloc(nbytes)) != NULL)
-            memset(bitmap, 0xff, nbytes);
-    }
+    if ((bitmap = malloc(sizeof(*bitmap) + num_chunks * sizeof(*bitmap->chunks))) == NULL)
+        return NULL;
+    bitmap->num_blocks = num_blocks;
+    bitmap->num_chunks = num_chunks;
+    bitmap->safe = safe != 0;
+    for (i = 0; i < num_chunks; i++)
+        bitmap->chunks[i] = value ? BITMAP_ONES : NULL;
     return bitmap;
 }
 
 void
 bitmap_free(bitmap_t **bitmapp)
 {
-    free(*bitmapp);
+    bitmap_t *const bitmap = *bitmapp;
+    size_t i;
+
+    if (bitmap == NULL)
+        return;
+    for (i = 0; i < bitmap->num_chunks; i++)
+        bitmap_chunk_fill(bitmap, i, 0);
+    free(bitmap);
     *bitmapp = NULL;
 }
 
 int
 bitmap_test(const bitmap_t *bitmap, s3b_block_t block_num)
 {
-    const int bits_per_word = sizeof(*bitmap) * 8;
-    const int index = block_num / bits_per_word;
-    const bitmap_t bit = (bitmap_t)1 << (block_num % bits_per_word);
+    const struct bitmap_chunk *const chunk = bitmap->chunks[block_num / BITMAP_CHUNK_BITS];
+    const u_int offset = block_num % BITMAP_CHUNK_BITS;
 
-    return (bitmap[index] & bit) != 0;
+    if (chunk == NULL || chunk == BITMAP_ONES)
+        return chunk != NULL;
+    return (chunk->words[offset / BITMAP_WORD_BITS] & ((bitmap_word_t)1 << (offset % BITMAP_WORD_BITS))) != 0;
 }
 
 void
 bitmap_set(bitmap_t *bitmap, s3b_block_t block_num, int value)
 {
-    const int bits_per_word = sizeof(*bitmap) * 8;
-    const int index = block_num / bits_per_word;
-    const bitmap_t bit = (bitmap_t)1 << (block_num % bits_per_word);
+    const size_t index = block_num / BITMAP_CHUNK_BITS;
+    const u_int offset = block_num % BITMAP_CHUNK_BITS;
+    const bitmap_word_t bit = (bitmap_word_t)1 << (offset % BITMAP_WORD_BITS);
+    struct bitmap_chunk *chunk = bitmap->chunks[index];
+    bitmap_word_t *word;
+
+    // Check for no change
+    value = value != 0;
+    if (chunk == (value ? BITMAP_ONES : NULL))
+        return;
+
+    // Convert uniform chunk to a dense chunk
+    if (chunk == NULL || chunk == BITMAP_ONES) {
+        if ((chunk = bitmap_chunk_alloc(bitmap, index, !value)) == NULL) {
+            if (value == bitmap->safe)
+                bitmap_chunk_fill(bitmap, index, value);
+            return;
+        }
+        bitmap->chunks[index] = chunk;
+    }
 
-    if (value)
-        bitmap[index] |= bit;
-    else
-        bitmap[index] &= ~bit;
+    // Update bit
+    word = &chunk->words[offset / BITMAP_WORD_BITS];
+    if (((*word & bit) != 0) == value)
+        return;
+    if (value) {
+        *word |= bit;
+        chunk->count++;
+    } else {
+        *word &= ~bit;
+        chunk->count--;
+    }
+    bitmap_chunk_settle(bitmap, index);
 }
 
 void
 bitmap_and(bitmap_t *dst, const bitmap_t *src, s3b_block_t num_blocks)
 {
-    const size_t nwords = bitmap_size(num_blocks);
     size_t i;
+    u_int j;
 
-    for (i = 0; i < nwords; i++)
-        dst[i] &= src[i];
+    assert(dst->num_blocks == num_blocks && src->num_blocks == num_blocks);
+    for (i = 0; i < dst->num_chunks; i++) {
+        const struct bitmap_chunk *const schunk = src->chunks[i];
+        struct bitmap_chunk *const dchunk = dst->chunks[i];
+
+        if (schunk == BITMAP_ONES || dchunk == NULL)
+            continue;
+        if (schunk == NULL) {
+            bitmap_chunk_fill(dst, i, 0);
+            continue;
+        }
+        if (dchunk == BITMAP_ONES) {
+            if ((dst->chunks[i] = bitmap_chunk_copy(schunk)) == NULL)
+                dst->chunks[i] = dst->safe ? BITMAP_ONES : NULL;
+            continue;
+        }
+        for (j = 0; j < BITMAP_CHUNK_WORDS; j++)
+            dchunk->words[j] &= schunk->words[j];
+        dchunk->count = bitmap_chunk_popcount(dchunk);
+        bitmap_chunk_settle(dst, i);
+    }
 }
 
 void
 bitmap_or(bitmap_t *dst, const bitmap_t *src, s3b_block_t num_blocks)
 {
-    const size_t nwords = bitmap_size(num_blocks);
     size_t i;
+    u_int j;
+
+    assert(dst->num_blocks == num_blocks && src->num_blocks == num_blocks);
+    for (i = 0; i < dst->num_chunks; i++) {
+        const struct bitmap_chunk *const schunk = src->chunks[i];
+        struct bitmap_chunk *const dchunk = dst->chunks[i];
 
-    for (i = 0; i < nwords; i++)
-        dst[i] |= src[i];
+        if (schunk == NULL || dchunk == BITMAP_ONES)
+            continue;
+        if (schunk == BITMAP_ONES) {
+            bitmap_chunk_fill(dst, i, 1);
+            continue;
+        }
+        if (dchunk == NULL) {
+            if ((dst->chunks[i] = bitmap_chunk_copy(schunk)) == NULL)
+                dst->chunks[i] = dst->safe ? BITMAP_ONES : NULL;
+            continue;
+        }
+        for (j = 0; j < BITMAP_CHUNK_WORDS; j++)
+            dchunk->words[j] |= schunk->words[j];
+        dchunk->count = bitmap_chunk_popcount(dchunk);
+        bitmap_chunk_settle(dst, i);
+    }
 }
 
 void
 bitmap_not(bitmap_t *bitmap, s3b_block_t num_blocks)
 {
-    const size_t nwords = bitmap_size(num_blocks);
     size_t i;
+    u_int j;
+
+    assert(bitmap->num_blocks == num_blocks);
+    for (i = 0; i < bitmap->num_chunks; i++) {
+        struct bitmap_chunk *const chunk = bitmap->chunks[i];
+
+        if (chunk == NULL || chunk == BITMAP_ONES) {
+            bitmap->chunks[i] = chunk == NULL ? BITMAP_ONES : NULL;
+            continue;
+        }
+        for (j = 0; j < BITMAP_CHUNK_WORDS; j++)
+            chunk->words[j] = ~chunk->words[j];
+        bitmap_chunk_trim(bitmap, i, chunk);
+        chunk->count = bitmap_chunk_bits(bitmap, i) - chunk->count;
+    }
+}
+
+/*
+ * Find the first bit equal to "value" at or after "block_num", or return "num_blocks" if there is none.
+ */
+s3b_block_t
+bitmap_find_next(const bitmap_t *bitmap, s3b_block_t num_blocks, s3b_block_t block_num, int value)
+{
+    const bitmap_word_t flip = value ? 0 : ~(bitmap_word_t)0;
+    uintmax_t pos = block_num;
+
+    assert(bitmap->num_blocks == num_blocks);
+    while (pos < num_blocks) {
+        const size_t index = pos / BITMAP_CHUNK_BITS;
+        const struct bitmap_chunk *const chunk = bitmap->chunks[index];
+        u_int offset = pos % BITMAP_CHUNK_BITS;
+        bitmap_word_t word;
+
+        // Handle uniform chunks
+        if (chunk == (value ? BITMAP_ONES : NULL))
+            return (s3b_block_t)pos;
+        if (chunk == NULL || chunk == BITMAP_ONES) {
+            pos = (uintmax_t)(index + 1) * BITMAP_CHUNK_BITS;
+            continue;
+        }
+
+        // Scan dense chunk (bits past the end of the bitmap are always zero, so they can match when value is zero)
+        word = (chunk->words[offset / BITMAP_WORD_BITS] ^ flip) & (~(bitmap_word_t)0 << (offset % BITMAP_WORD_BITS));
+        for (offset /= BITMAP_WORD_BITS; word == 0 && ++offset < BITMAP_CHUNK_WORDS; )
+            word = chunk->words[offset] ^ flip;
+        if (word != 0) {
+            pos = (uintmax_t)index * BITMAP_CHUNK_BITS + offset * BITMAP_WORD_BITS + __builtin_ctzl(word);
+            return pos < num_blocks ? (s3b_block_t)pos : num_blocks;
+        }
+        pos = (uintmax_t)(index + 1) * BITMAP_CHUNK_BITS;
+    }
+    return num_blocks;
+}
+
+/*
+ * Get the size of the portable form of a bitmap, which is one bit per block, eight blocks per byte, LSB first.
+ */
+size_t
+bitmap_export_size(s3b_block_t num_blocks)
+{
+    return ((size_t)num_blocks + 7) / 8;
+}
+
+/*
+ * Convert a bitmap into portable form (see bitmap_export_size()).
+ */
+void
+bitmap_export(const bitmap_t *bitmap, s3b_block_t num_blocks, u_char *buf)
+{
+    size_t i;
+    u_int j;
+
+    assert(bitmap->num_blocks == num_blocks);
+    for (i = 0; i < bitmap->num_chunks; i++) {
+        const struct bitmap_chunk *const chunk = bitmap->chunks[i];
+        const u_int nbits = bitmap_chunk_bits(bitmap, i);
+        const u_int nbytes = (nbits + 7) / 8;
+        u_char *const cbuf = buf + i * (BITMAP_CHUNK_BITS / 8);
+
+        if (chunk == NULL || chunk == BITMAP_ONES) {
+            memset(cbuf, chunk != NULL ? 0xff : 0x00, nbytes);
+            if (chunk != NULL && nbits % 8 != 0)
+                cbuf[nbytes - 1] = (1 << (nbits % 8)) - 1;
+            continue;
+        }
+        for (j = 0; j < nbytes; j++)
+            cbuf[j] = (u_char)(chunk->words[j / sizeof(bitmap_word_t)] >> ((j % sizeof(bitmap_word_t)) * 8));
+    }
+}
+
+/*
+ * Create a bitmap from its portable form (see bitmap_export_size()).
+ *
+ * Returns NULL with errno set on failure.
+ */
+bitmap_t *
+bitmap_import(const u_char *buf, s3b_block_t num_blocks, int safe)
+{
+    bitmap_t *bitmap;
+    size_t i;
+    u_int j;
+
+    if ((bitmap = bitmap_init(num_blocks, 0, safe)) == NULL)
+        return NULL;
+    for (i = 0; i < bitmap->num_chunks; i++) {
+        const u_int nbits = bitmap_chunk_bits(bitmap, i);
+        const u_int nbytes = (nbits + 7) / 8;
+        const u_char *const cbuf = buf + i * (BITMAP_CHUNK_BITS / 8);
+        const u_char last = nbits % 8 != 0 ? (1 << (nbits % 8)) - 1 : 0xff;
+        struct bitmap_chunk *chunk;
+        int zeros = 1;
+        int ones = 1;
+
+        // Check for uniform chunk
+        for (j = 0; j < nbytes && (zeros || ones); j++) {
+            const u_char mask = j == nbytes - 1 ? last : 0xff;
+
+            zeros &= (cbuf[j] & mask) == 0;
+            ones &= (cbuf[j] & mask) == mask;
+        }
+        if (zeros || ones) {
+            bitmap->chunks[i] = ones && !zeros ? BITMAP_ONES : NULL;
+            continue;
+        }
 
-    for (i = 0; i < nwords; i++)
-        bitmap[i] = ~bitmap[i];
+        // Build dense chunk
+        if ((chunk = bitmap_chunk_alloc(bitmap, i, 0)) == NULL) {
+            bitmap_free(&bitmap);
+            errno = ENOMEM;
+            return NULL;
+        }
+        for (j = 0; j < nbytes; j++)
+            chunk->words[j / sizeof(bitmap_word_t)] |= (bitmap_word_t)cbuf[j] << ((j % sizeof(bitmap_word_t)) * 8);
+        bitmap_chunk_trim(bitmap, i, chunk);
+        chunk->count = bitmap_chunk_popcount(chunk);
+        bitmap->chunks[i] = chunk;
+    }
+    return bitmap;
 }
 
 int
@@ -284,15 +552,46 @@ init_zero_block(u_int block_size)
     if ((zero_block = calloc(1, block_size)) == NULL)
         return -1;
     zero_block_size = block_size;
+
+    // Pick the fastest zero detection the CPU supports
+    zeros_check = zeros_check_generic;
+    zeros_copy = zeros_copy_generic;
+#if ZEROS_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        zeros_check = zeros_check_avx512;
+        zeros_copy = zeros_copy_avx512;
+    } else if (__builtin_cpu_supports("avx2")) {
+        zeros_check = zeros_check_avx2;
+        zeros_copy = zeros_copy_avx2;
+    }
+#elif ZEROS_NEON
+    zeros_check = zeros_check_neon;
+    zeros_copy = zeros_copy_neon;
+#endif
     return 0;
 }
 
+/*
+ * Determine if a block contains only zeros. Stops at the first non-zero chunk.
+ */
 int
 block_is_zeros(const void *data)
 {
     assert(zero_block != NULL);
     assert(zero_block_size > 0);
-    return memcmp(data, zero_block, zero_block_size) == 0;
+    return (*zeros_check)(data, zero_block_size);
+}
+
+/*
+ * Copy a block and determine if it contains only zeros, touching the data only once.
+ */
+int
+block_copy_is_zeros(void *dest, const void *src)
+{
+    assert(zero_block != NULL);
+    assert(zero_block_size > 0);
+    return (*zeros_copy)(dest, src, zero_block_size);
 }
 
 void
@@ -325,6 +624,134 @@ block_list_free(struct block_list *list)
     memset(list, 0, sizeof(*list));
 }
 
+/*
+ * Get a monotonic timestamp in microseconds, for measuring latencies to give to latency_hist_record().
+ */
+uint64_t
+latency_hist_micros(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + (uint64_t)ts.tv_nsec / 1000;
+}
+
+void
+latency_hist_record(struct latency_hist *hist, uint64_t micros)
+{
+    u_int bucket;
+    int bits;
+
+    if (micros < LATENCY_HIST_SUB_BUCKETS)
+        bucket = (u_int)micros;
+    else if ((bits = 63 - __builtin_clzll(micros)) >= LATENCY_HIST_MAX_BITS)
+        bucket = LATENCY_HIST_BUCKETS - 1;
+    else {
+        bucket = ((bits - LATENCY_HIST_SUB_BITS + 1) << LATENCY_HIST_SUB_BITS)
+          | ((u_int)(micros >> (bits - LATENCY_HIST_SUB_BITS)) & (LATENCY_HIST_SUB_BUCKETS - 1));
+    }
+    __atomic_add_fetch(&hist->counts[bucket], 1, __ATOMIC_RELAXED);
+}
+
+void
+latency_hist_copy(struct latency_hist *dst, const struct latency_hist *src)
+{
+    u_int i;
+
+    for (i = 0; i < LATENCY_HIST_BUCKETS; i++)
+        dst->counts[i] = __atomic_load_n(&src->counts[i], __ATOMIC_RELAXED);
+}
+
+void
+latency_hist_clear(struct latency_hist *hist)
+{
+    u_int i;
+
+    for (i = 0; i < LATENCY_HIST_BUCKETS; i++)
+        __atomic_store_n(&hist->counts[i], 0, __ATOMIC_RELAXED);
+}
+
+u_int
+latency_hist_count(const struct latency_hist *hist)
+{
+    u_int total = 0;
+    u_int i;
+
+    for (i = 0; i < LATENCY_HIST_BUCKETS; i++)
+        total += hist->counts[i];
+    return total;
+}
+
+/*
+ * Get the given percentile (e.g., 99.9) of the recorded latencies, in microseconds.
+ *
+ * The result is the largest value falling in the same bucket, so it errs on the high side.
+ */
+uint64_t
+latency_hist_percentile(const struct latency_hist *hist, double percentile)
+{
+    const u_int total = latency_hist_count(hist);
+    const double target = total * percentile / 100.0;
+    uint64_t rank;
+    uint64_t sofar = 0;
+    u_int bucket;
+    u_int shift;
+
+    // Find the bucket containing the sample with the desired rank
+    if (total == 0)
+        return 0;
+    if ((rank = (uint64_t)target) < target || rank < 1)
+        rank++;
+    for (bucket = 0; bucket < LATENCY_HIST_BUCKETS - 1; bucket++) {
+        if ((sofar += hist->counts[bucket]) >= rank)
+            break;
+    }
+
+    // Return the largest value in that bucket
+    if (bucket < LATENCY_HIST_SUB_BUCKETS)
+        return bucket;
+    shift = (bucket >> LATENCY_HIST_SUB_BITS) - 1;
+    return ((uint64_t)((bucket & (LATENCY_HIST_SUB_BUCKETS - 1)) | LATENCY_HIST_SUB_BUCKETS) << shift)
+      + ((uint64_t)1 << shift) - 1;
+}
+
+int
+generic_read_blocks(struct s3backer_store *s3b, s3b_block_t block_num, u_int num_blocks, void *dest)
+{
+    int r;
+
+    assert(zero_block_size > 0);
+    while (num_blocks-- > 0) {
+        if ((r = (s3b->read_block)(s3b, block_num++, dest, NULL, NULL, 0)) != 0)
+            return r;
+        dest = (char *)dest + zero_block_size;
+    }
+    return 0;
+}
+
+int
+generic_write_blocks(struct s3backer_store *s3b, s3b_block_t block_num, u_int num_blocks, const void *src)
+{
+    int r;
+
+    assert(zero_block_size > 0);
+    while (num_blocks-- > 0) {
+        if ((r = (s3b->write_block)(s3b, block_num++, src, NULL, NULL, NULL)) != 0)
+            return r;
+        src = (const char *)src + zero_block_size;
+    }
+    return 0;
+}
+
+int
+generic_block_status(struct s3backer_store *s3b, s3b_block_t block_num, u_int num_blocks, int *zerop, u_int *countp)
+{
+    assert(num_blocks > 0);
+    *zerop = 0;
+    *countp = num_blocks;
+    return 0;
+}
+
 int
 generic_bulk_zero(struct s3backer_store *s3b, const s3b_block_t *block_nums, u_int num_blocks)
 {
@@ -793,3 +1220,274 @@ set_config_log(struct s3b_config *config, log_func_t *log)
     config->fuse_ops.log = log;
     config->test_io.log = log;
 }
+
+/****************************************************************************
+ *                        ZERO BLOCK DETECTION                              *
+ ****************************************************************************/
+
+/*
+ * These scan 64 bytes per round (128 or 256 bytes for the vector versions), OR'ing words together
+ * and only testing the result once per round. The check functions return as soon as a round is
+ * non-zero; the copy functions must see all of the data anyway, so they only test at the end.
+ *
+ * The vector versions handle whole rounds and leave any remainder to the generic versions.
+ * Loads and stores are unaligned because callers' buffers may come from anywhere.
+ */
+
+static int
+zeros_check_generic(const void *data, size_t len)
+{
+    const u_char *ptr = data;
+    uint64_t w[8];
+    size_t off;
+
+    for (off = 0; off + sizeof(w) <= len; off += sizeof(w)) {
+        memcpy(w, ptr + off, sizeof(w));
+        if ((w[0] | w[1] | w[2] | w[3] | w[4] | w[5] | w[6] | w[7]) != 0)
+            return 0;
+    }
+    for (; off < len; off++) {
+        if (ptr[off] != 0)
+            return 0;
+    }
+    return 1;
+}
+
+static int
+zeros_copy_generic(void *dest, const void *src, size_t len)
+{
+    const u_char *sptr = src;
+    u_char *dptr = dest;
+    uint64_t bits = 0;
+    uint64_t w[8];
+    size_t off;
+
+    for (off = 0; off + sizeof(w) <= len; off += sizeof(w)) {
+        memcpy(w, sptr + off, sizeof(w));
+        memcpy(dptr + off, w, sizeof(w));
+        bits |= w[0] | w[1] | w[2] | w[3] | w[4] | w[5] | w[6] | w[7];
+    }
+    for (; off < len; off++)
+        bits |= (dptr[off] = sptr[off]);
+    return bits == 0;
+}
+
+#if ZEROS_X86
+
+__attribute__ ((__target__ ("avx2")))
+static int
+zeros_check_avx2(const void *data, size_t len)
+{
+    const u_char *ptr = data;
+    __m256i v;
+    size_t off;
+
+    for (off = 0; off + 4 * sizeof(v) <= len; off += 4 * sizeof(v)) {
+        v = _mm256_or_si256(
+          _mm256_or_si256(_mm256_loadu_si256((const __m256i *)(ptr + off)),
+            _mm256_loadu_si256((const __m256i *)(ptr + off + 32))),
+          _mm256_or_si256(_mm256_loadu_si256((const __m256i *)(ptr + off + 64)),
+            _mm256_loadu_si256((const __m256i *)(ptr + off + 96))));
+        if (!_mm256_testz_si256(v, v))
+            return 0;
+    }
+    return zeros_check_generic(ptr + off, len - off);
+}
+
+__attribute__ ((__target__ ("avx2")))
+static int
+zeros_copy_avx2(void *dest, const void *src, size_t len)
+{
+    const u_char *sptr = src;
+    u_char *dptr = dest;
+    __m256i bits = _mm256_setzero_si256();
+    __m256i v0, v1, v2, v3;
+    size_t off;
+
+    for (off = 0; off + 4 * sizeof(v0) <= len; off += 4 * sizeof(v0)) {
+        v0 = _mm256_loadu_si256((const __m256i *)(sptr + off));
+        v1 = _mm256_loadu_si256((const __m256i *)(sptr + off + 32));
+        v2 = _mm256_loadu_si256((const __m256i *)(sptr + off + 64));
+        v3 = _mm256_loadu_si256((const __m256i *)(sptr + off + 96));
+        _mm256_storeu_si256((__m256i *)(dptr + off), v0);
+        _mm256_storeu_si256((__m256i *)(dptr + off + 32), v1);
+        _mm256_storeu_si256((__m256i *)(dptr + off + 64), v2);
+        _mm256_storeu_si256((__m256i *)(dptr + off + 96), v3);
+        bits = _mm256_or_si256(bits, _mm256_or_si256(_mm256_or_si256(v0, v1), _mm256_or_si256(v2, v3)));
+    }
+    return zeros_copy_generic(dptr + off, sptr + off, len - off) && _mm256_testz_si256(bits, bits);
+}
+
+__attribute__ ((__target__ ("avx512f")))
+static int
+zeros_check_avx512(const void *data, size_t len)
+{
+    const u_char *ptr = data;
+    __m512i v;
+    size_t off;
+
+    for (off = 0; off + 4 * sizeof(v) <= len; off += 4 * sizeof(v)) {
+        v = _mm512_or_si512(
+          _mm512_or_si512(_mm512_loadu_si512(ptr + off), _mm512_loadu_si512(ptr + off + 64)),
+          _mm512_or_si512(_mm512_loadu_si512(ptr + off + 128), _mm512_loadu_si512(ptr + off + 192)));
+        if (_mm512_test_epi64_mask(v, v) != 0)
+            return 0;
+    }
+    return zeros_check_generic(ptr + off, len - off);
+}
+
+__attribute__ ((__target__ ("avx512f")))
+static int
+zeros_copy_avx512(void *dest, const void *src, size_t len)
+{
+    const u_char *sptr = src;
+    u_char *dptr = dest;
+    __m512i bits = _mm512_setzero_si512();
+    __m512i v0, v1, v2, v3;
+    size_t off;
+
+    for (off = 0; off + 4 * sizeof(v0) <= len; off += 4 * sizeof(v0)) {
+        v0 = _mm512_loadu_si512(sptr + off);
+        v1 = _mm512_loadu_si512(sptr + off + 64);
+        v2 = _mm512_loadu_si512(sptr + off + 128);
+        v3 = _mm512_loadu_si512(sptr + off + 192);
+        _mm512_storeu_si512(dptr + off, v0);
+        _mm512_storeu_si512(dptr + off + 64, v1);
+        _mm512_storeu_si512(dptr + off + 128, v2);
+        _mm512_storeu_si512(dptr + off + 192, v3);
+        bits = _mm512_or_si512(bits, _mm512_or_si512(_mm512_or_si512(v0, v1), _mm512_or_si512(v2, v3)));
+    }
+    return zeros_copy_generic(dptr + off, sptr + off, len - off) && _mm512_test_epi64_mask(bits, bits) == 0;
+}
+
+#elif ZEROS_NEON
+
+static int
+zeros_check_neon(const void *data, size_t len)
+{
+    const uint8_t *ptr = data;
+    uint8x16_t v;
+    size_t off;
+
+    for (off = 0; off + 4 * sizeof(v) <= len; off += 4 * sizeof(v)) {
+        v = vorrq_u8(vorrq_u8(vld1q_u8(ptr + off), vld1q_u8(ptr + off + 16)),
+          vorrq_u8(vld1q_u8(ptr + off + 32), vld1q_u8(ptr + off + 48)));
+        if (vmaxvq_u8(v) != 0)
+            return 0;
+    }
+    return zeros_check_generic(ptr + off, len - off);
+}
+
+static int
+zeros_copy_neon(void *dest, const void *src, size_t len)
+{
+    const uint8_t *sptr = src;
+    uint8_t *dptr = dest;
+    uint8x16_t bits = vdupq_n_u8(0);
+    uint8x16_t v0, v1, v2, v3;
+    size_t off;
+
+    for (off = 0; off + 4 * sizeof(v0) <= len; off += 4 * sizeof(v0)) {
+        v0 = vld1q_u8(sptr + off);
+        v1 = vld1q_u8(sptr + off + 16);
+        v2 = vld1q_u8(sptr + off + 32);
+        v3 = vld1q_u8(sptr + off + 48);
+        vst1q_u8(dptr + off, v0);
+        vst1q_u8(dptr + off + 16, v1);
+        vst1q_u8(dptr + off + 32, v2);
+        vst1q_u8(dptr + off + 48, v3);
+        bits = vorrq_u8(bits, vorrq_u8(vorrq_u8(v0, v1), vorrq_u8(v2, v3)));
+    }
+    return zeros_copy_generic(dptr + off, sptr + off, len - off) && vmaxvq_u8(bits) == 0;
+}
+
+#endif  /* ZEROS_NEON */
+
+/****************************************************************************
+ *                      BITMAP INTERNAL FUNCTIONS                           *
+ ****************************************************************************/
+
+// Get the number of valid bits in the specified chunk (only the last chunk can be partial)
+static u_int
+bitmap_chunk_bits(const bitmap_t *bitmap, size_t index)
+{
+    const uintmax_t start = (uintmax_t)index * BITMAP_CHUNK_BITS;
+
+    return bitmap->num_blocks - start < BITMAP_CHUNK_BITS ? (u_int)(bitmap->num_blocks - start) : BITMAP_CHUNK_BITS;
+}
+
+// Allocate a dense chunk initialized to all zeros or all ones; returns NULL if out of memory
+static struct bitmap_chunk *
+bitmap_chunk_alloc(const bitmap_t *bitmap, size_t index, int value)
+{
+    struct bitmap_chunk *chunk;
+
+    if ((chunk = malloc(sizeof(*chunk))) == NULL)
+        return NULL;
+    memset(chunk->words, value ? 0xff : 0x00, sizeof(chunk->words));
+    bitmap_chunk_trim(bitmap, index, chunk);
+    chunk->count = value ? bitmap_chunk_bits(bitmap, index) : 0;
+    return chunk;
+}
+
+// Duplicate a dense chunk; returns NULL if out of memory
+static struct bitmap_chunk *
+bitmap_chunk_copy(const struct bitmap_chunk *chunk)
+{
+    struct bitmap_chunk *copy;
+
+    if ((copy = malloc(sizeof(*copy))) != NULL)
+        memcpy(copy, chunk, sizeof(*copy));
+    return copy;
+}
+
+// Replace a chunk with a uniform chunk, freeing it if dense
+static void
+bitmap_chunk_fill(bitmap_t *bitmap, size_t index, int value)
+{
+    struct bitmap_chunk *const chunk = bitmap->chunks[index];
+
+    if (chunk != NULL && chunk != BITMAP_ONES)
+        free(chunk);
+    bitmap->chunks[index] = value ? BITMAP_ONES : NULL;
+}
+
+// Collapse a dense chunk that has become uniform
+static void
+bitmap_chunk_settle(bitmap_t *bitmap, size_t index)
+{
+    const struct bitmap_chunk *const chunk = bitmap->chunks[index];
+
+    if (chunk->count == 0)
+        bitmap_chunk_fill(bitmap, index, 0);
+    else if (chunk->count == bitmap_chunk_bits(bitmap, index))
+        bitmap_chunk_fill(bitmap, index, 1);
+}
+
+// Clear any bits in a dense chunk that lie past the end of the bitmap
+static void
+bitmap_chunk_trim(const bitmap_t *bitmap, size_t index, struct bitmap_chunk *chunk)
+{
+    const u_int nbits = bitmap_chunk_bits(bitmap, index);
+    u_int i;
+
+    if (nbits == BITMAP_CHUNK_BITS)
+        return;
+    i = nbits / BITMAP_WORD_BITS;
+    if (nbits % BITMAP_WORD_BITS != 0)
+        chunk->words[i++] &= ((bitmap_word_t)1 << (nbits % BITMAP_WORD_BITS)) - 1;
+    while (i < BITMAP_CHUNK_WORDS)
+        chunk->words[i++] = 0;
+}
+
+// Count the bits set in a dense chunk
+static u_int
+bitmap_chunk_popcount(const struct bitmap_chunk *chunk)
+{
+    u_int count = 0;
+    u_int i;
+
+    for (i = 0; i < BITMAP_CHUNK_WORDS; i++)
+        count += __builtin_popcountl(chunk->words[i]);
+    return count;
+}
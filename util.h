@@ -37,8 +37,14 @@
 // Forward decl's
 struct s3b_config;
 
-// Bitmap type
-typedef uintptr_t bitmap_t;
+// Access to counters that are updated without holding a lock
+#define ATOMIC_LOAD(var)            __atomic_load_n(&(var), __ATOMIC_SEQ_CST)
+#define ATOMIC_STORE(var, value)    __atomic_store_n(&(var), (value), __ATOMIC_SEQ_CST)
+#define ATOMIC_ADD(var, value)      __atomic_add_fetch(&(var), (value), __ATOMIC_SEQ_CST)
+#define ATOMIC_SUB(var, value)      __atomic_sub_fetch(&(var), (value), __ATOMIC_SEQ_CST)
+
+// Bitmap type (opaque)
+typedef struct bitmap bitmap_t;
 
 // A list of block numbers
 struct block_list {
@@ -95,6 +101,7 @@ extern void syslog_logger(int level, const char *fmt, ...) __attribute__ ((__for
 extern void stderr_logger(int level, const char *fmt, ...) __attribute__ ((__format__ (__printf__, 2, 3)));
 extern int find_string_in_table(const char *const *table, const char *value);
 extern int block_is_zeros(const void *data);
+extern int block_copy_is_zeros(void *dest, const void *src);
 extern int snvprintf(char *buf, int bufsize, const char *format, ...) __attribute__ ((__format__ (__printf__, 3, 4)));
 extern char *prefix_log_format(int level, const char *fmt);
 extern void calculate_boundary_info(struct boundary_info *info, u_int block_size, const void *buf, size_t size, off_t offset);
@@ -122,19 +129,33 @@ extern void kill_remaining_children(const struct s3b_config *config, pid_t excep
 extern pid_t wait_for_child_to_exit(const struct s3b_config *config, struct child_proc *proc, int sleep_if_none, int expect_signal);
 
 // Bitmaps
-extern bitmap_t *bitmap_init(s3b_block_t num_blocks, int value);
+extern bitmap_t *bitmap_init(s3b_block_t num_blocks, int value, int safe);
 extern void bitmap_free(bitmap_t **bitmapp);
-extern size_t bitmap_size(s3b_block_t num_blocks);
 extern int bitmap_test(const bitmap_t *bitmap, s3b_block_t block_num);
 extern void bitmap_set(bitmap_t *bitmap, s3b_block_t block_num, int value);
 extern void bitmap_and(bitmap_t *dst, const bitmap_t *src, s3b_block_t num_blocks);
 extern void bitmap_or(bitmap_t *dst, const bitmap_t *src, s3b_block_t num_blocks);
 extern void bitmap_not(bitmap_t *bitmap, s3b_block_t num_blocks);
+extern s3b_block_t bitmap_find_next(const bitmap_t *bitmap, s3b_block_t num_blocks, s3b_block_t block_num, int value);
+extern size_t bitmap_export_size(s3b_block_t num_blocks);
+extern void bitmap_export(const bitmap_t *bitmap, s3b_block_t num_blocks, u_char *buf);
+extern bitmap_t *bitmap_import(const u_char *buf, s3b_block_t num_blocks, int safe);
 
 // Block lists
 extern void block_list_init(struct block_list *list);
 extern int block_list_append(struct block_list *list, s3b_block_t block_num);
 extern void block_list_free(struct block_list *list);
 
+// Latency histograms
+extern uint64_t latency_hist_micros(void);
+extern void latency_hist_record(struct latency_hist *hist, uint64_t micros);
+extern void latency_hist_copy(struct latency_hist *dst, const struct latency_hist *src);
+extern void latency_hist_clear(struct latency_hist *hist);
+extern u_int latency_hist_count(const struct latency_hist *hist);
+extern uint64_t latency_hist_percentile(const struct latency_hist *hist, double percentile);
+
 // Generic s3backer_store functions
+extern int generic_read_blocks(struct s3backer_store *s3b, s3b_block_t block_num, u_int num_blocks, void *dest);
+extern int generic_write_blocks(struct s3backer_store *s3b, s3b_block_t block_num, u_int num_blocks, const void *src);
+extern int generic_block_status(struct s3backer_store *s3b, s3b_block_t block_num, u_int num_blocks, int *zerop, u_int *countp);
 extern int generic_bulk_zero(struct s3backer_store *s3b, const s3b_block_t *block_nums, u_int num_blocks);
@@ -91,13 +91,17 @@ static int zero_cache_meta_data(struct s3backer_store *s3b, off_t *file_sizep, u
 static int zero_cache_set_mount_token(struct s3backer_store *s3b, int32_t *old_valuep, int32_t new_value);
 static int zero_cache_read_block(struct s3backer_store *s3b, s3b_block_t block_num, void *dest,
   u_char *actual_etag, const u_char *expect_etag, int strict);
+static int zero_cache_read_blocks(struct s3backer_store *s3b, s3b_block_t block_num, u_int num_blocks, void *dest);
+static int zero_cache_prefetch_blocks(struct s3backer_store *s3b, s3b_block_t block_num, u_int num_blocks);
 static int zero_cache_write_block(struct s3backer_store *s3b, s3b_block_t block_num, const void *src, u_char *etag,
   check_cancel_t *check_cancel, void *check_cancel_arg);
+static int zero_cache_write_blocks(struct s3backer_store *s3b, s3b_block_t block_num, u_int num_blocks, const void *src);
 static int zero_cache_read_block_part(struct s3backer_store *s3b, s3b_block_t block_num, u_int off, u_int len, void *dest);
 static int zero_cache_write_block_part(struct s3backer_store *s3b, s3b_block_t block_num, u_int off, u_int len, const void *src);
 static int zero_cache_flush_blocks(struct s3backer_store *s3b, const s3b_block_t *block_nums, u_int num_blocks, long timeout);
 static int zero_cache_bulk_zero(struct s3backer_store *const s3b, const s3b_block_t *block_nums, u_int num_blocks);
 static int zero_cache_survey_non_zero(struct s3backer_store *s3b, block_list_func_t *callback, void *arg);
+static int zero_cache_block_status(struct s3backer_store *s3b, s3b_block_t block_num, u_int num_blocks, int *zerop, u_int *countp);
 static int zero_cache_shutdown(struct s3backer_store *s3b);
 static void zero_cache_destroy(struct s3backer_store *s3b);
 
@@ -131,7 +135,11 @@ zero_cache_create(struct zero_cache_conf *config, struct s3backer_store *inner)
     s3b->meta_data = zero_cache_meta_data;
     s3b->set_mount_token = zero_cache_set_mount_token;
     s3b->read_block = zero_cache_read_block;
+    s3b->read_blocks = zero_cache_read_blocks;
+    if (inner->prefetch_blocks != NULL)
+        s3b->prefetch_blocks = zero_cache_prefetch_blocks;
     s3b->write_block = zero_cache_write_block;
+    s3b->write_blocks = zero_cache_write_blocks;
     if (inner->read_block_part != NULL)
         s3b->read_block_part = zero_cache_read_block_part;
     if (inner->write_block_part != NULL)
@@ -139,6 +147,7 @@ zero_cache_create(struct zero_cache_conf *config, struct s3backer_store *inner)
     s3b->flush_blocks = zero_cache_flush_blocks;
     s3b->bulk_zero = zero_cache_bulk_zero;
     s3b->survey_non_zero = zero_cache_survey_non_zero;
+    s3b->block_status = zero_cache_block_status;
     s3b->shutdown = zero_cache_shutdown;
     s3b->destroy = zero_cache_destroy;
     if ((priv = calloc(1, sizeof(*priv))) == NULL) {
@@ -154,7 +163,7 @@ zero_cache_create(struct zero_cache_conf *config, struct s3backer_store *inner)
         goto fail3;
 
     // Initialize bit map
-    if ((priv->zeros = bitmap_init(config->num_blocks, 0)) == NULL) {
+    if ((priv->zeros = bitmap_init(config->num_blocks, 0, 0)) == NULL) {
         r = errno;
         (*config->log)(LOG_ERR, "calloc(): %s", strerror(r));
         goto fail4;
@@ -199,7 +208,7 @@ zero_cache_create_threads(struct s3backer_store *s3b)
 
     // Initialize survey bitmap (to all 1's)
     assert(priv->survey_zeros == NULL);
-    if ((priv->survey_zeros = bitmap_init(config->num_blocks, 1)) == NULL) {
+    if ((priv->survey_zeros = bitmap_init(config->num_blocks, 1, 0)) == NULL) {
         r = errno;
         (*config->log)(LOG_ERR, "malloc(): %s", strerror(r));
         goto fail1;
@@ -356,6 +365,31 @@ zero_cache_survey_non_zero(struct s3backer_store *s3b, block_list_func_t *callba
     return ENOTSUP;
 }
 
+static int
+zero_cache_block_status(struct s3backer_store *s3b, s3b_block_t block_num, u_int num_blocks, int *zerop, u_int *countp)
+{
+    struct zero_cache_private *const priv = s3b->data;
+    struct zero_cache_conf *const config = priv->config;
+    s3b_block_t next;
+
+    // Blocks we know are zero can be reported directly
+    pthread_mutex_lock(&priv->mutex);
+    if (bitmap_test(priv->zeros, block_num)) {
+        next = bitmap_find_next(priv->zeros, config->num_blocks, block_num, 0);
+        CHECK_RETURN(pthread_mutex_unlock(&priv->mutex));
+        *zerop = 1;
+        *countp = next - block_num < num_blocks ? next - block_num : num_blocks;
+        return 0;
+    }
+    next = bitmap_find_next(priv->zeros, config->num_blocks, block_num, 1);
+    CHECK_RETURN(pthread_mutex_unlock(&priv->mutex));
+
+    // Ask the lower layer about the rest, up to the next block we know is zero
+    if (next - block_num < num_blocks)
+        num_blocks = next - block_num;
+    return (*priv->inner->block_status)(priv->inner, block_num, num_blocks, zerop, countp);
+}
+
 static int
 zero_cache_read_block(struct s3backer_store *const s3b, s3b_block_t block_num, void *dest,
   u_char *actual_etag, const u_char *expect_etag, int strict)
@@ -393,6 +427,87 @@ zero_cache_read_block(struct s3backer_store *const s3b, s3b_block_t block_num, v
     return r;
 }
 
+static int
+zero_cache_read_blocks(struct s3backer_store *const s3b, s3b_block_t block_num, u_int num_blocks, void *dest)
+{
+    struct zero_cache_private *const priv = s3b->data;
+    struct zero_cache_conf *const config = priv->config;
+    u_int num_zero;
+    u_int num_read;
+    u_int i;
+    int r;
+
+    while (num_blocks > 0) {
+
+        // Find the leading run of blocks known to be zero, followed by the run of blocks we have to actually read
+        pthread_mutex_lock(&priv->mutex);
+        for (num_zero = 0; num_zero < num_blocks && bitmap_test(priv->zeros, block_num + num_zero); num_zero++)
+            ;
+        for (num_read = 0; num_zero + num_read < num_blocks && !bitmap_test(priv->zeros, block_num + num_zero + num_read); num_read++)
+            ;
+        priv->stats.read_hits += num_zero;
+        CHECK_RETURN(pthread_mutex_unlock(&priv->mutex));
+
+        // Fill in the known zero blocks
+        memset(dest, 0, (size_t)num_zero * config->block_size);
+        dest = (char *)dest + (size_t)num_zero * config->block_size;
+        block_num += num_zero;
+        num_blocks -= num_zero;
+        if (num_read == 0)
+            continue;
+
+        // Read the other blocks all at once
+        if ((r = (*priv->inner->read_blocks)(priv->inner, block_num, num_read, dest)) != 0)
+            return r;
+
+        // Update cache
+        for (i = 0; i < num_read; i++) {
+            const int zero = block_is_zeros(dest);
+
+            pthread_mutex_lock(&priv->mutex);
+            zero_cache_update_block(priv, block_num, zero);
+            CHECK_RETURN(pthread_mutex_unlock(&priv->mutex));
+            dest = (char *)dest + config->block_size;
+            block_num++;
+        }
+        num_blocks -= num_read;
+    }
+
+    // Done
+    return 0;
+}
+
+static int
+zero_cache_prefetch_blocks(struct s3backer_store *const s3b, s3b_block_t block_num, u_int num_blocks)
+{
+    struct zero_cache_private *const priv = s3b->data;
+    struct zero_cache_conf *const config = priv->config;
+    const s3b_block_t end = block_num + num_blocks;
+    s3b_block_t next;
+    int r;
+
+    while (block_num < end) {
+
+        // Skip over blocks known to be zero, then find the run of blocks that follows them
+        pthread_mutex_lock(&priv->mutex);
+        block_num = bitmap_find_next(priv->zeros, config->num_blocks, block_num, 0);
+        next = bitmap_find_next(priv->zeros, config->num_blocks, block_num, 1);
+        CHECK_RETURN(pthread_mutex_unlock(&priv->mutex));
+        if (block_num >= end)
+            break;
+        if (next > end)
+            next = end;
+
+        // Prefetch that run
+        if ((r = (*priv->inner->prefetch_blocks)(priv->inner, block_num, next - block_num)) != 0)
+            return r;
+        block_num = next;
+    }
+
+    // Done
+    return 0;
+}
+
 static int
 zero_cache_write_block(struct s3backer_store *const s3b, s3b_block_t block_num, const void *src, u_char *caller_etag,
   check_cancel_t *check_cancel, void *check_cancel_arg)
@@ -433,6 +548,49 @@ zero_cache_write_block(struct s3backer_store *const s3b, s3b_block_t block_num,
     return r;
 }
 
+static int
+zero_cache_write_blocks(struct s3backer_store *const s3b, s3b_block_t block_num, u_int num_blocks, const void *src)
+{
+    struct zero_cache_private *const priv = s3b->data;
+    struct zero_cache_conf *const config = priv->config;
+    u_int num_data;
+    u_int i;
+    int r;
+
+    while (num_blocks > 0) {
+
+        // Handle zero blocks individually
+        if (block_is_zeros(src)) {
+            if ((r = zero_cache_write_block(s3b, block_num, NULL, NULL, NULL, NULL)) != 0)
+                return r;
+            src = (const char *)src + config->block_size;
+            block_num++;
+            num_blocks--;
+            continue;
+        }
+
+        // Find the run of non-zero blocks
+        for (num_data = 1; num_data < num_blocks && !block_is_zeros((const char *)src + (size_t)num_data * config->block_size); num_data++)
+            ;
+
+        // Update cache - these blocks are no longer zero (and if there's an error, we're no longer sure)
+        pthread_mutex_lock(&priv->mutex);
+        for (i = 0; i < num_data; i++)
+            zero_cache_update_block(priv, block_num + i, 0);
+        CHECK_RETURN(pthread_mutex_unlock(&priv->mutex));
+
+        // Write them all at once
+        if ((r = (*priv->inner->write_blocks)(priv->inner, block_num, num_data, src)) != 0)
+            return r;
+        src = (const char *)src + (size_t)num_data * config->block_size;
+        block_num += num_data;
+        num_blocks -= num_data;
+    }
+
+    // Done
+    return 0;
+}
+
 static int
 zero_cache_read_block_part(struct s3backer_store *s3b, s3b_block_t block_num, u_int off, u_int len, void *dest)
 {